@@ -0,0 +1,83 @@
+#ifndef INCLUDE_ADMINSERVER_HPP_
+#define INCLUDE_ADMINSERVER_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+
+// AdminServer: Local HTTP listener exposing "GET /metrics"
+// Listens on a Unix socket or a loopback TCP port and is multiplexed on the
+// server's EventLoop. Every connection is non-blocking with its own buffers,
+// so a slow scraper never blocks the IRC reactor; each connection serves a
+// single request and is closed once the response is flushed, or after
+// kConnectionTimeout seconds without traffic. When all slots are taken the
+// idlest connection still without a complete request makes room, so idle
+// clients cannot lock scrapers out.
+class AdminServer {
+ public:
+  AdminServer(EventLoop* eventLoop, const Metrics* metrics);
+  ~AdminServer();
+
+  // Start listening
+  // address: "unix:<path>" or a TCP port number (bound on 127.0.0.1)
+  // Throws: std::runtime_error if the address is invalid or setup fails
+  void listen(const std::string& address);
+
+  // Close the listener and all connections; listen() may be called again
+  void stop();
+
+  // Check if fd is the admin listener or one of its connections
+  bool ownsFd(int fd) const;
+
+  // Handle an epoll event for an fd owned by the admin listener
+  void handleEvent(int fd, uint32_t events);
+
+  // Close the connections idle for kConnectionTimeout
+  void runTimers();
+
+  // Milliseconds until runTimers() has work, -1 if none
+  int getTimeoutMs() const;
+
+ private:
+  static const int kMaxQueue = 8;
+  static const size_t kMaxConnections = 8;
+  static const size_t kMaxRequestSize = 4096;
+  static const int kConnectionTimeout = 5;  // Seconds
+
+  struct AdminConnection {
+    std::string readBuffer;
+    std::string writeBuffer;
+    bool responded;  // Response built, waiting for the flush to complete
+    double lastActivity;  // getMonotonicTime() of accept or the last I/O
+
+    AdminConnection() : responded(false), lastActivity(0) {}
+  };
+
+  EventLoop* eventLoop_;
+  const Metrics* metrics_;
+  int listenFd_;
+  std::string unixPath_;  // Unlinked on destruction when set
+  std::map<int, AdminConnection> connections_;
+
+  void listenUnix(const std::string& path);
+  void listenTcp(const std::string& portStr);
+  void finishListen(const std::string& description);
+  void acceptConnections();
+  void handleRead(int fd, AdminConnection& conn);
+  void handleWrite(int fd, AdminConnection& conn);
+  void closeConnection(int fd);
+  // The connection idle for the longest time, among those still reading
+  // their request if pendingOnly (INVALID_FD: none)
+  int getIdlestConnection(bool pendingOnly) const;
+  std::string buildResponse(const std::string& requestLine) const;
+
+  AdminServer();                                   // = delete
+  AdminServer(const AdminServer& src);             // = delete
+  AdminServer& operator=(const AdminServer& src);  // = delete
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef INCLUDE_BINARYCODEC_HPP_
+#define INCLUDE_BINARYCODEC_HPP_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+
+// BinaryWriter: Builds a compact binary record
+// Integers are stored little-endian with a fixed width, strings as a 32-bit
+// length followed by the raw bytes.
+class BinaryWriter {
+ public:
+  BinaryWriter();
+  ~BinaryWriter();
+
+  void writeU8(uint8_t value);
+  void writeU32(uint32_t value);
+  void writeU64(uint64_t value);
+  void writeBool(bool value);
+  void writeString(const std::string& value);
+
+  const std::string& getData() const;
+
+ private:
+  std::string data_;
+
+  BinaryWriter(const BinaryWriter& src);             // = delete
+  BinaryWriter& operator=(const BinaryWriter& src);  // = delete
+};
+
+// BinaryReader: Reads a record written by BinaryWriter
+// Reads directly from the given memory (e.g. an mmap'ed file) without
+// copying it. Every read is bounds-checked.
+// Throws: std::runtime_error when a value extends past the end of the data
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size);
+  ~BinaryReader();
+
+  uint8_t readU8();
+  uint32_t readU32();
+  uint64_t readU64();
+  bool readBool();
+  std::string readString();
+
+  bool atEnd() const;
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_;
+
+  void require(size_t length) const;
+
+  BinaryReader();                                    // = delete
+  BinaryReader(const BinaryReader& src);             // = delete
+  BinaryReader& operator=(const BinaryReader& src);  // = delete
+};
+
+#endif
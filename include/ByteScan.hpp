@@ -0,0 +1,39 @@
+#ifndef INCLUDE_BYTESCAN_HPP_
+#define INCLUDE_BYTESCAN_HPP_
+
+#include <cstddef>
+
+// Instruction sets of the byte scanning kernels, from slowest to fastest
+enum ScanLevel {
+  SCAN_LEVEL_SCALAR,  // Byte at a time, any CPU
+  SCAN_LEVEL_SSE2,    // 16 bytes per step (every x86-64 CPU)
+  SCAN_LEVEL_AVX2     // 32 bytes per step
+};
+
+// Kernels for the per-byte loops of framing, parsing and casemapping
+// The fastest level the CPU supports is picked on first use
+// (__builtin_cpu_supports); all levels return the same results.
+
+// Offset of the '\r' of the first "\r\n" in data
+// Returns: length if there is none
+size_t findCrlf(const char* data, size_t length);
+
+// Offset of the first NUL, CR or LF (bytes a parameter may not contain)
+// Returns: length if there is none
+size_t findForbiddenByte(const char* data, size_t length);
+
+// RFC1459 lower case in place (see ircToLower)
+void foldCase(char* data, size_t length);
+
+// Remove every occurrence of byte, keeping the order of the others
+// Returns: New length
+size_t removeByte(char* data, size_t length, char byte);
+
+ScanLevel getScanLevel();
+const char* getScanLevelName(ScanLevel level);
+// Use level if the CPU supports it (tests and benchmarks), else the best
+// supported one
+// Returns: The level now in use
+ScanLevel setScanLevel(ScanLevel level);
+
+#endif
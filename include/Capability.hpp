@@ -0,0 +1,24 @@
+#ifndef INCLUDE_CAPABILITY_HPP_
+#define INCLUDE_CAPABILITY_HPP_
+
+#include <string>
+
+// IRCv3 capabilities the server offers (CAP LS), one bit each in the set a
+// client enabled with CAP REQ (see User::getCaps())
+enum Capability {
+  CAP_MESSAGE_TAGS = 1 << 0,  // msgid and client-only tags, TAGMSG
+  CAP_ECHO_MESSAGE = 1 << 1,  // PRIVMSG is echoed back to its sender
+  CAP_SERVER_TIME = 1 << 2,   // Relayed messages carry a "time" tag
+  CAP_BATCH = 1 << 3          // Join bursts and playback come in a BATCH
+};
+
+// Every capability of the registry
+unsigned allCapabilities();
+
+// Returns: The capability called name, or 0 if there is no such one
+unsigned findCapability(const std::string& name);
+
+// Space-separated names of the capabilities in caps, in registry order
+std::string capabilityNames(unsigned caps);
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef INCLUDE_CASEMAPPEDMAP_HPP_
+#define INCLUDE_CASEMAPPEDMAP_HPP_
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+// CaseMappedMap: Hash table keyed by nicknames or channel names
+// Keys compare with RFC1459 casemapping (ircCaseEqual) on their original
+// bytes, so lookups need no lowercased copy. Open addressing with linear
+// probing; erase shifts the following entries back instead of leaving
+// tombstones, so probe sequences stay short under NICK/JOIN/PART churn.
+// Entries keep the key as first inserted; iteration order is unspecified.
+template <typename T>
+class CaseMappedMap {
+ public:
+  typedef std::pair<std::string, T> value_type;
+
+  class const_iterator {
+   public:
+    const_iterator() : map_(NULL), index_(0) {}
+    const value_type& operator*() const { return map_->entries_[index_]; }
+    const value_type* operator->() const { return &map_->entries_[index_]; }
+    const_iterator& operator++() {
+      ++index_;
+      skipEmpty();
+      return *this;
+    }
+    bool operator==(const const_iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return index_ != other.index_;
+    }
+    // Table slot of the entry, to resume an iteration with from()
+    size_t slot() const { return index_; }
+
+   private:
+    friend class CaseMappedMap;
+    const CaseMappedMap* map_;
+    size_t index_;
+
+    const_iterator(const CaseMappedMap* map, size_t index)
+        : map_(map), index_(index) {
+      skipEmpty();
+    }
+    void skipEmpty() {
+      while (index_ < map_->used_.size() && !map_->used_[index_]) ++index_;
+    }
+  };
+
+  CaseMappedMap() : size_(0) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, used_.size()); }
+  // First entry at or after slot (see const_iterator::slot())
+  // Entries keep their slot until the table grows or an erase shifts them
+  // back, so an iteration resumed after such changes may skip or repeat
+  // entries (never crash)
+  const_iterator from(size_t slot) const {
+    return const_iterator(this, slot < used_.size() ? slot : used_.size());
+  }
+
+  // Returns: Pointer to the value stored for key, or NULL if absent
+  T* find(const std::string& key) {
+    size_t index;
+    return lookup(key, &index) ? &entries_[index].second : NULL;
+  }
+  const T* find(const std::string& key) const {
+    size_t index;
+    return lookup(key, &index) ? &entries_[index].second : NULL;
+  }
+
+  // Insert or replace; a replaced entry keeps its original key spelling
+  void set(const std::string& key, const T& value) {
+    size_t index = 0;
+    if (lookup(key, &index)) {
+      entries_[index].second = value;
+      return;
+    }
+    // Keep the load factor at most 1/2
+    if ((size_ + 1) * 2 > used_.size()) {
+      grow();
+      lookup(key, &index);
+    }
+    entries_[index] = value_type(key, value);
+    hashes_[index] = ircCaseHash(key);
+    used_[index] = true;
+    ++size_;
+  }
+
+  // Returns: true if key was present
+  bool erase(const std::string& key) {
+    size_t index;
+    if (!lookup(key, &index)) return false;
+    size_t mask = used_.size() - 1;
+    // Backward shift: move up every following entry whose probe sequence
+    // passes through the hole
+    size_t next = (index + 1) & mask;
+    while (used_[next]) {
+      size_t home = hashes_[next] & mask;
+      if (((next - home) & mask) >= ((next - index) & mask)) {
+        entries_[index] = entries_[next];
+        hashes_[index] = hashes_[next];
+        index = next;
+      }
+      next = (next + 1) & mask;
+    }
+    entries_[index] = value_type();
+    used_[index] = false;
+    --size_;
+    return true;
+  }
+
+  void clear() {
+    entries_.clear();
+    hashes_.clear();
+    used_.clear();
+    size_ = 0;
+  }
+
+ private:
+  static const size_t kInitialSlots = 16;
+
+  std::vector<value_type> entries_;
+  std::vector<size_t> hashes_;
+  std::vector<bool> used_;
+  size_t size_;
+
+  // Find key's slot, or the free slot where it would be inserted
+  // Returns: true if key is present
+  bool lookup(const std::string& key, size_t* index) const {
+    if (used_.empty()) return false;
+    size_t mask = used_.size() - 1;
+    size_t hash = ircCaseHash(key);
+    size_t i = hash & mask;
+    while (used_[i]) {
+      if (hashes_[i] == hash && ircCaseEqual(entries_[i].first, key)) {
+        *index = i;
+        return true;
+      }
+      i = (i + 1) & mask;
+    }
+    *index = i;
+    return false;
+  }
+
+  void grow() {
+    size_t slots = used_.empty() ? kInitialSlots : used_.size() * 2;
+    std::vector<value_type> entries(slots);
+    std::vector<size_t> hashes(slots);
+    std::vector<bool> used(slots, false);
+    for (size_t i = 0; i < used_.size(); ++i) {
+      if (!used_[i]) continue;
+      size_t j = hashes_[i] & (slots - 1);
+      while (used[j]) j = (j + 1) & (slots - 1);
+      entries[j] = entries_[i];
+      hashes[j] = hashes_[i];
+      used[j] = true;
+    }
+    entries_.swap(entries);
+    hashes_.swap(hashes);
+    used_.swap(used);
+  }
+
+  CaseMappedMap(const CaseMappedMap& src);             // = delete
+  CaseMappedMap& operator=(const CaseMappedMap& src);  // = delete
+};
+
+#endif
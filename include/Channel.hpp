@@ -13,11 +13,31 @@
 #ifndef INCLUDE_CHANNEL_HPP_
 #define INCLUDE_CHANNEL_HPP_
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "Hostmask.hpp"
 #include "User.hpp"
 
+// Mask lists of a channel (MODE +b, +e and +I)
+enum MaskList {
+  MASK_LIST_BAN,
+  MASK_LIST_EXCEPTION,         // Overrides a ban
+  MASK_LIST_INVITE_EXCEPTION,  // Joins an invite-only channel uninvited
+  MASK_LIST_COUNT              // Number of lists (not a list)
+};
+
+struct MaskEntry {
+  MaskEntry(const Hostmask& mask, const std::string& setBy, long setAt);
+
+  Hostmask mask;
+  std::string setBy;  // Nickname
+  long setAt;         // Unix time
+};
+
 // Channel: Represents an IRC channel
 // Manages channel members, operators, topic, and modes
 class Channel {
@@ -30,6 +50,7 @@ class Channel {
   const std::string& getTopic() const;
   const std::set<int>& getMembers() const;    // Set of user FDs
   const std::set<int>& getOperators() const;  // Set of operator FDs
+  const std::set<int>& getInvited() const;    // Set of invited FDs
   bool isInviteOnly() const;
   bool isTopicRestricted() const;
   bool hasUserLimit() const;
@@ -61,12 +82,30 @@ class Channel {
   void removeInvite(int userFd);
   bool isInvited(int userFd) const;
 
+  // Mask lists
+  static const size_t kMaxMasks = 100;  // Per list
+  // mask: Completed by Hostmask::normalize()
+  // Returns: false if the list is full or has the mask (casemapped)
+  bool addMask(MaskList list, const std::string& mask, const std::string& setBy,
+               long setAt);
+  // Returns: false if the list does not have the mask
+  bool removeMask(MaskList list, const std::string& mask);
+  const std::vector<MaskEntry>& getMasks(MaskList list) const;
+  // Matches a ban and no exception
+  // Results are cached per user until its identity (User::getIdentity())
+  // or the ban or exception list changes
+  bool isBanned(const User* user);
+  bool isInviteException(const User* user) const;
+
  private:
   std::string name_;
   std::string topic_;
   std::set<int> members_;    // File descriptors of members
   std::set<int> operators_;  // File descriptors of operators
   std::set<int> invited_;    // File descriptors of invited users
+  std::vector<MaskEntry> masks_[MASK_LIST_COUNT];
+  // User id -> (identity when checked, banned)
+  std::map<int, std::pair<unsigned long, bool> > banCache_;
 
   // Channel modes
   bool inviteOnly_;
@@ -0,0 +1,110 @@
+#ifndef INCLUDE_CHANNELHISTORY_HPP_
+#define INCLUDE_CHANNELHISTORY_HPP_
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// One message of a channel history (see ChannelHistory::get())
+struct HistoryMessage {
+  long time;           // Milliseconds since the epoch
+  std::string source;  // nick!user@host of the sender
+  std::string msgid;
+  std::string text;
+};
+
+// A CHATHISTORY reference: a time, or a msgid
+struct HistoryRef {
+  bool byMsgId;
+  long time;
+  std::string msgid;
+};
+
+// Messages of a read relative to a HistoryRef
+enum HistorySide {
+  HISTORY_BEFORE,  // The newest ones before it (all: no reference)
+  HISTORY_FROM,    // The oldest ones at or after it
+  HISTORY_AFTER    // The oldest ones after it
+};
+
+// msgids sort by the process start time before the '-', then by the counter
+// after it, each shorter first, then bytewise: the order MessageClock
+// issues them in, across processes too
+// Returns: <0, 0 or >0 as a sorts before, with or after b
+int compareMsgIds(const std::string& a, const std::string& b);
+// Returns: <0, 0 or >0 as message sorts before, at or after ref
+int compareToRef(const HistoryMessage& message, const HistoryRef& ref);
+
+// ChannelHistory: Recent PRIVMSGs of one channel, oldest first (CHATHISTORY)
+// A ring of fixed-size entries: the time, the index of the sender in a table
+// of interned sources, and the msgid and text as offsets into an arena.
+// Evicting the oldest message leaves its bytes at the front of the arena,
+// dropped at once when they make up half of it. Times and msgids only grow
+// (see MessageClock), so both are found by binary search.
+class ChannelHistory {
+ public:
+  explicit ChannelHistory(const std::string& channel);
+  ~ChannelHistory();
+
+  const std::string& getChannel() const;  // Name as first recorded
+  size_t size() const;
+  bool empty() const;
+  // Memory held, arena waste aside (what HistoryStore limits)
+  size_t getBytes() const;
+  long getOldestTime() const;  // Only if !empty()
+
+  // Record a message; an earlier time than the newest one is raised to it
+  // Returns: Bytes the history grew by
+  size_t append(long time, const std::string& source,
+                const std::string& msgid, const std::string& text);
+  // Drop the oldest message (only if !empty())
+  // Returns: Bytes freed
+  size_t evictOldest();
+
+  HistoryMessage get(size_t index) const;
+  // Returns: Index of the first message at or after time, or size()
+  size_t lowerBound(long time) const;
+  // Returns: Index of the first message after time, or size()
+  size_t upperBound(long time) const;
+  // Returns: Index of the message with msgid, or size() if there is none
+  size_t find(const std::string& msgid) const;
+  // The same bounds for a time or msgid reference
+  size_t lowerBound(const HistoryRef& ref) const;
+  size_t upperBound(const HistoryRef& ref) const;
+
+ private:
+  struct Entry {
+    long time;
+    unsigned source;        // Index in sources_
+    size_t offset;          // Of msgid then text in arena_
+    unsigned short msgidLength;
+    unsigned short textLength;
+  };
+  struct Source {
+    std::string name;
+    size_t refs;  // Entries sent by it, 0: the slot is free
+  };
+
+  std::string channel_;
+  std::deque<Entry> entries_;
+  std::string arena_;
+  size_t arenaStart_;  // Bytes of arena_ before the oldest message
+  std::vector<Source> sources_;
+  std::map<std::string, unsigned> sourceIndex_;
+  std::vector<unsigned> freeSources_;
+  size_t bytes_;
+
+  // Returns: Index of the first message whose msgid does not sort before
+  // msgid, or size()
+  size_t lowerBoundMsgId(const std::string& msgid) const;
+  unsigned internSource(const std::string& name, size_t* grown);
+  // Returns: Bytes freed (the source's, once nothing refers to it)
+  size_t releaseSource(unsigned index);
+
+  ChannelHistory();                                      // = delete
+  ChannelHistory(const ChannelHistory& src);             // = delete
+  ChannelHistory& operator=(const ChannelHistory& src);  // = delete
+};
+
+#endif
@@ -1,9 +1,9 @@
 #ifndef INCLUDE_CHANNELMANAGER_HPP_
 #define INCLUDE_CHANNELMANAGER_HPP_
 
-#include <map>
 #include <string>
 
+#include "CaseMappedMap.hpp"
 #include "Channel.hpp"
 
 // ChannelManager: Manages the collection of IRC channels
@@ -29,13 +29,13 @@ class ChannelManager {
   Channel* getChannel(const std::string& name);
 
   // Get all channels
-  const std::map<std::string, Channel*>& getChannels() const;
+  const CaseMappedMap<Channel*>& getChannels() const;
 
   // Check if a channel exists
   bool channelExists(const std::string& name) const;
 
  private:
-  std::map<std::string, Channel*> channels_;  // channel name -> Channel*
+  CaseMappedMap<Channel*> channels_;  // channel name -> Channel*
 
   ChannelManager(const ChannelManager& src);             // = delete
   ChannelManager& operator=(const ChannelManager& src);  // = delete
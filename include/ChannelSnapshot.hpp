@@ -0,0 +1,42 @@
+#ifndef INCLUDE_CHANNELSNAPSHOT_HPP_
+#define INCLUDE_CHANNELSNAPSHOT_HPP_
+
+#include <cstddef>
+#include <string>
+
+#include "BinaryCodec.hpp"
+#include "ChannelManager.hpp"
+
+// ChannelSnapshot: Channel configuration saved to a compact binary file
+// Stores name, topic, key, user limit, modes and mask lists of every
+// channel, so that it survives a restart or a crash.
+// Restored channels start without members; like a new channel, the first
+// member to join becomes operator.
+class ChannelSnapshot {
+ public:
+  // Serialize the channels
+  static std::string encode(const ChannelManager& channelManager);
+
+  // Replace the file at path atomically (temporary file, fsync, rename)
+  // Throws: std::runtime_error on I/O errors
+  static void write(const std::string& path, const std::string& data);
+
+  // Recreate the channels of the snapshot at path (memory-mapped)
+  // Returns: number of channels restored, 0 if the file does not exist
+  // Throws: std::runtime_error if the file cannot be read or is malformed
+  static size_t restore(const std::string& path,
+                        ChannelManager& channelManager);
+
+  // Ban, exception and invite exception lists of channel (also part of the
+  // upgrade handoff, see Server)
+  static void writeMasks(BinaryWriter& writer, const Channel* channel);
+  // Throws: std::runtime_error if the data is truncated
+  static void readMasks(BinaryReader& reader, Channel* channel);
+
+ private:
+  ChannelSnapshot();                                       // = delete
+  ChannelSnapshot(const ChannelSnapshot& src);             // = delete
+  ChannelSnapshot& operator=(const ChannelSnapshot& src);  // = delete
+};
+
+#endif
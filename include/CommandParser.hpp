@@ -6,8 +6,19 @@
 
 #include "User.hpp"
 
+// MessageTag: One tag of an IRCv3 "@key=value;..." prefix, pointing into
+// the parsed line (valid as long as it is). The value is still escaped,
+// see CommandParser::unescapeTagValue()
+struct MessageTag {
+  const char* key;  // "+" first for client-only tags
+  size_t keyLength;
+  const char* value;
+  size_t valueLength;  // 0 for a tag without value
+};
+
 // Command: Represents a parsed IRC command
 struct Command {
+  std::vector<MessageTag> tags;  // Empty for most messages
   std::string prefix;   // Optional prefix (usually empty from clients)
   std::string command;  // Command name (PASS, NICK, JOIN, etc.)
   std::vector<std::string> params;  // Command parameters
@@ -15,18 +26,55 @@ struct Command {
   Command() : prefix(""), command("") {}
 };
 
+// Outcome of CommandParser::parse()
+enum ParseResult {
+  PARSE_OK,
+  PARSE_ERROR_EMPTY,
+  PARSE_ERROR_TOO_LONG,
+  PARSE_ERROR_TAGS_TOO_LONG,
+  PARSE_ERROR_BAD_TAG,
+  PARSE_ERROR_LEADING_SPACE,
+  PARSE_ERROR_EMPTY_PREFIX,
+  PARSE_ERROR_PREFIX_ONLY,
+  PARSE_ERROR_NO_COMMAND,
+  PARSE_ERROR_BAD_COMMAND,
+  PARSE_ERROR_TOO_MANY_PARAMS,
+  PARSE_ERROR_NUL,
+  PARSE_ERROR_CR,
+  PARSE_ERROR_LF
+};
+
 // CommandParser: Parses IRC commands per RFC1459
 class CommandParser {
  public:
   CommandParser();
   ~CommandParser();
 
-  // Parse IRC message into Command structure
-  // Format: [:prefix] COMMAND [params] [:trailing]
-  // message: Raw IRC message (CRLF terminator already stripped)
+  // Parse IRC message into cmd without throwing (malformed input from
+  // clients is common and must stay cheap)
+  // Format: [@tags] [:prefix] COMMAND [params] [:trailing]
+  // message: Raw IRC message (CRLF terminator already stripped); cmd.tags
+  //          point into it
+  // Returns: PARSE_OK, or why the message is invalid (cmd is then partial)
+  ParseResult parse(const std::string& message, Command& cmd);
+
+  // Same as parse()
   // Throws: std::runtime_error if message format is invalid
   Command parseCommand(const std::string& message);
 
+  // Static description of a parse error, e.g. for logs
+  static const char* getErrorMessage(ParseResult result);
+
+  // Returns: The last tag of cmd called key, or NULL
+  static const MessageTag* findTag(const Command& cmd, const std::string& key);
+
+  // Client-only tags of cmd ("+key" ones), as sent: "+a=1;+b", or empty
+  static std::string getClientTags(const Command& cmd);
+
+  // Value of tag with its escapes decoded: \: is ';', \s is ' ', \\ is
+  // '\', \r and \n are CR and LF
+  static std::string unescapeTagValue(const MessageTag& tag);
+
  private:
   CommandParser(const CommandParser& src);             // = delete
   CommandParser& operator=(const CommandParser& src);  // = delete
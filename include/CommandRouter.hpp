@@ -1,12 +1,18 @@
 #ifndef INCLUDE_COMMANDROUTER_HPP_
 #define INCLUDE_COMMANDROUTER_HPP_
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "ChannelManager.hpp"
 #include "CommandParser.hpp"
 #include "EventLoop.hpp"
+#include "HistoryLog.hpp"
+#include "HistoryStore.hpp"
+#include "MessageClock.hpp"
 #include "ResponseFormatter.hpp"
+#include "TaggedMessage.hpp"
 #include "User.hpp"
 #include "UserManager.hpp"
 
@@ -15,6 +21,8 @@ enum CommandResult {
   CMD_DISCONNECT  // Need to disconnect the client
 };
 
+class LinkManager;
+
 // CommandRouter: Routes IRC commands to appropriate handlers
 // Dispatches parsed commands to command handlers
 class CommandRouter {
@@ -28,11 +36,89 @@ class CommandRouter {
   // ConnectionManager)
   CommandResult processMessage(User* user, const std::string& message);
 
+  // Relay changes to linked servers (see LinkManager)
+  void setLinkManager(LinkManager* linkManager);
+
+  // Malformed lines within 10 seconds that disconnect a client, 0: never
+  // (ServerConfig::malformedLimit)
+  void setMalformedLimit(int limit);
+
+  // Execute a channel or message command relayed from a linked server for a
+  // remote user; permission checks were done by the user's server
+  void processRemote(User* user, const Command& cmd);
+
+  // Announce the departure of user to its channels and leave them
+  // Called for every registered user that goes away (QUIT, disconnect,
+  // netsplit); the user is unregistered so a second call does nothing
+  void quitUser(User* user, const std::string& reason);
+
+  // Promote the first member of a channel left without operators
+  void ensureOperator(Channel* channel);
+
+  // Tell user and the users sharing a channel with it about its new
+  // nickname, and the MONITOR watchers of both nicknames; called before the
+  // change (the message has the old prefix)
+  void announceNick(User* user, const std::string& newNick);
+
+  // Tell the MONITOR watchers of user's nickname that it is online (on
+  // registration, or once a linked server introduced it)
+  void announceSignOn(const User* user);
+
+  // Queue message for the local members of channel except exceptFd, with
+  // the tags each enabled
+  void broadcastToChannel(const Channel* channel, const std::string& message,
+                          int exceptFd);
+
+  // Memory for the CHATHISTORY of all channels, 0: keep none
+  // (ServerConfig::historyMemory)
+  void setHistoryLimit(size_t maxBytes);
+  // Keep the history of channels in directory too (see HistoryLog); the
+  // event loop must exist, its wakeup fd reports answers of the log
+  // Throws: std::runtime_error if the directory cannot be used
+  void openHistoryLog(const std::string& directory,
+                      const std::vector<std::string>& channels);
+  // Write what is queued, answer the CHATHISTORY queries waiting for the
+  // log and stop logging (before an upgrade)
+  void closeHistoryLog();
+  // Answer the CHATHISTORY queries the history log has read for; Server
+  // calls it when the event loop reports its wakeup fd
+  void deliverHistory();
+  // Pass the history log the messages its writer could not take yet; Server
+  // calls it every event loop iteration, and polls while some are left
+  void retryHistoryLog();
+  bool hasHistoryBacklog() const;
+
+  // Read the clock of the message tags (once per event loop iteration)
+  void updateClock();
+
+  // Queue more of user's LIST or WHO while its write buffer is below the
+  // high water mark; Server calls it whenever output to such a user was
+  // sent
+  void continueReply(User* user);
+
  private:
   UserManager* userManager_;
   ChannelManager* channelManager_;
   EventLoop* eventLoop_;
+  LinkManager* linkManager_;
   CommandParser* parser_;
+  MessageClock clock_;
+  HistoryStore history_;
+  HistoryLog historyLog_;
+  int malformedLimit_;
+  unsigned long batchCount_;  // BATCH references handed out
+  // A CHATHISTORY waiting for the history log, by HistoryQuery::id
+  struct PendingHistory {
+    User* user;
+    std::string subcommand;  // Upper case
+    bool latest;             // LATEST *
+    size_t limit;
+  };
+  std::map<unsigned long, PendingHistory> pendingHistory_;
+  unsigned long historyQueries_;
+  // RPL_MYINFO channel modes and RPL_ISUPPORT lines (see renderISupport())
+  std::string channelModes_;
+  std::vector<std::string> isupport_;
   // NOTE: Password stored in plain text for educational purposes
   // Production systems should use secure memory handling (e.g., mlock,
   // explicit zeroing) C++98 has limited options for secure string handling
@@ -52,13 +138,21 @@ class CommandRouter {
   void handleUser(User* user, const Command& cmd);
   void handleJoin(User* user, const Command& cmd);
   void handlePart(User* user, const Command& cmd);
+  void handleNames(User* user, const Command& cmd);
+  void handleList(User* user, const Command& cmd);
+  void handleWho(User* user, const Command& cmd);
+  void handleWhois(User* user, const Command& cmd);
   void handlePrivmsg(User* user, const Command& cmd);
+  void handleTagmsg(User* user, const Command& cmd);
   void handleKick(User* user, const Command& cmd);
   void handleInvite(User* user, const Command& cmd);
   void handleTopic(User* user, const Command& cmd);
   void handleMode(User* user, const Command& cmd);
   void handleQuit(User* user, const Command& cmd);
   void handleCap(User* user, const Command& cmd);
+  void handleChatHistory(User* user, const Command& cmd);
+  void handleAway(User* user, const Command& cmd);
+  void handleMonitor(User* user, const Command& cmd);
   void handlePing(User* user, const Command& cmd);
   void handlePong(User* user, const Command& cmd);
 
@@ -66,6 +160,64 @@ class CommandRouter {
   // Helpers
   // ==========================================
   void sendResponse(User* user, const std::string& response);
+  // PRIVMSG of cmd to one of its targets
+  void sendPrivmsg(User* user, const std::string& target, const Command& cmd);
+  // Open a BATCH of type about target for a user that enabled batch
+  // Returns: Its reference, empty if the user gets the lines unbatched
+  std::string startBatch(User* user, const char* type,
+                         const std::string& target);
+  void endBatch(User* user, const std::string& batch);
+  // sendResponse() of line as part of batch (empty: none)
+  void sendInBatch(User* user, const std::string& batch,
+                   const std::string& line);
+  // RPL_MONONLINE to the watchers of nickname, prefix being its
+  // nick!user@host, or RPL_MONOFFLINE (prefix empty)
+  void notifyWatchers(const std::string& nickname, const std::string& prefix);
+  // A MONITOR reply listing items, as many per line as 512 bytes allow
+  typedef std::string (*MonitorReply)(const std::string& target,
+                                      const std::string& list);
+  void sendMonitorReplies(User* user, MonitorReply format,
+                          const std::vector<std::string>& items);
+  // Queue RPL_NAMREPLY lines (as few as 512 bytes allow) and
+  // RPL_ENDOFNAMES for channel, in batch (empty: none)
+  void sendNames(User* user, const Channel* channel, const std::string& batch);
+  // End user's LIST or WHO still in progress with its end numeric, so the
+  // client does not wait for it once another reply replaces it
+  void abortReply(User* user);
+  // Queue the next piece of a LIST or WHO reply (see continueReply())
+  // Returns: true once the reply is complete (end marker queued)
+  bool continueList(User* user, ReplyCursor* cursor);
+  bool continueWho(User* user, ReplyCursor* cursor);
+  // WHO mask: matched against nickname, username, host and real name
+  bool matchesWho(const std::string& mask, const User* user);
+  // RPL_WHOISUSER, RPL_WHOISSERVER and RPL_WHOISCHANNELS about target
+  void sendWhois(User* user, const User* target);
+  // "timestamp=<server-time>" or "msgid=<id>" into reference
+  // Returns: false if ref is malformed
+  bool parseHistoryRef(const std::string& ref, HistoryRef* reference);
+  // Queue the CHATHISTORY reply of pending, query holding what the log
+  // read for it (nothing if the channel is not logged)
+  void answerChatHistory(const PendingHistory& pending,
+                         const HistoryQuery& query);
+  // Append limit messages of query's channel for its read-th read, from
+  // the ring and what the log found, oldest first
+  void collectHistory(const HistoryQuery& query, size_t read, size_t limit,
+                      std::vector<HistoryMessage>* messages);
+  // Reply, throttle or disconnect (see processMessage())
+  CommandResult handleMalformed(User* user, const std::string& message,
+                                ParseResult result);
+  // Queue message as rendered for recipient's capabilities
+  void sendTagged(User* recipient, TaggedMessage& message);
+  // sendTagged() to the local members of channel except exceptFd
+  void broadcastTagged(const Channel* channel, TaggedMessage& message,
+                       int exceptFd);
+  // Queue message once for each local user sharing a channel with user
+  void sendToChannelPeers(const User* user, TaggedMessage& message);
+  // Render what registration advertises from the limits in force; again
+  // whenever one changes (history enabled or not)
+  void renderISupport();
+  // Once PASS, NICK and USER are done and CAP negotiation is not pending
+  void tryCompleteRegistration(User* user);
   void completeRegistration(User* user);
   bool isValidChannelName(const std::string& name);
   bool isValidNickname(const std::string& nickname);
@@ -87,6 +239,12 @@ class CommandRouter {
                           size_t& argIndex,
                           const std::vector<std::string>& params,
                           std::string& appliedModes, std::string& appliedArgs);
+  // Returns: false if mode is not b, e or I
+  static bool getMaskList(char mode, MaskList* list);
+  void sendMaskList(User* user, const Channel* chan, MaskList list);
+  void applyModeMask(User* sender, Channel* chan, MaskList list, bool adding,
+                     size_t& argIndex, const std::vector<std::string>& params,
+                     std::string& appliedModes, std::string& appliedArgs);
   void broadcastModeChange(User* user, const std::string& channel,
                            const std::string& appliedModes,
                            const std::string& appliedArgs, Channel* chan);
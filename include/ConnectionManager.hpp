@@ -4,10 +4,13 @@
 #include <string>
 #include <vector>
 
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
 #include "User.hpp"
 
 #define BUFFER_SIZE 4096
-#define MAX_BUFFER_SIZE 8192
+// Longest line: 8191 bytes of IRCv3 tags, then 512 (CRLF included)
+#define MAX_BUFFER_SIZE 8703
 
 // Result codes for receive operation
 enum ReceiveResult {
@@ -28,11 +31,13 @@ enum SendResult {
 // Note: User management is handled by UserManager
 class ConnectionManager {
  public:
-  ConnectionManager();
+  // metrics: Receives byte counters (not owned)
+  explicit ConnectionManager(Metrics* metrics);
   ~ConnectionManager();
 
   // Accept a new connection from the server socket
-  // Returns: Pointer to new User object, or NULL if no connection available
+  // Returns: Pointer to new User object (its socket is non-blocking and
+  // close-on-exec), or NULL if no connection available
   // Throws: std::runtime_error on error
   // Note: Caller is responsible for adding user to UserManager
   User* acceptConnection(int serverFd);
@@ -49,7 +54,18 @@ class ConnectionManager {
   // SEND_ERROR
   SendResult sendData(User* user);
 
+  // Send the write buffers of several users as one batch
+  // Makes a single send attempt per user through eventLoop (one system call
+  // for the whole batch on the io_uring backend)
+  // users: Distinct users with non-empty write buffers
+  // results: Receives one SendResult per user, in the order of users
+  void sendBatch(const EventLoop& eventLoop, const std::vector<User*>& users,
+                 std::vector<SendResult>& results);
+
  private:
+  Metrics* metrics_;
+
+  ConnectionManager();                                         // = delete
   ConnectionManager(const ConnectionManager& src);             // = delete
   ConnectionManager& operator=(const ConnectionManager& src);  // = delete
 };
@@ -1,22 +1,50 @@
 #ifndef INCLUDE_EVENTLOOP_HPP_
 #define INCLUDE_EVENTLOOP_HPP_
 
+#include <stdint.h>
 #include <sys/epoll.h>
+#include <sys/types.h>
 
+#include <cstddef>
+#include <deque>
+#include <map>
 #include <stdexcept>
+#include <vector>
+
+#include "IoUring.hpp"
 
 #define INVALID_FD -1
 
+// Readiness notification mechanism used by EventLoop
+enum EventBackend {
+  EVENT_BACKEND_EPOLL,    // epoll_ctl() per change, epoll_wait()
+  EVENT_BACKEND_IO_URING  // Multishot polls, batched in one io_uring_enter()
+};
+
+// One send of a batch (see EventLoop::sendBatch)
+struct SendRequest {
+  int fd;
+  const char* data;
+  size_t length;
+  ssize_t result;  // Set by sendBatch: bytes sent, or -errno on failure
+};
+
 // EventLoop: Wrapper class for epoll operations
 // Manages the lifetime of an epoll instance and provides
 // methods to add, modify, remove file descriptors, and wait for events.
+// With EVENT_BACKEND_IO_URING the same interface is served by an io_uring
+// instance: interest changes are queued and submitted together with the next
+// wait() or sendBatch(), so they cost no system call of their own.
 class EventLoop {
  public:
   EventLoop();
   ~EventLoop();
 
-  // Create an epoll instance
-  void create();
+  // Create an epoll (or io_uring) instance
+  // Throws: std::runtime_error if the backend is unavailable
+  void create(EventBackend backend = EVENT_BACKEND_EPOLL);
+
+  EventBackend getBackend() const;
 
   // Add a file descriptor to epoll
   // events: Events to monitor (EPOLLIN, EPOLLOUT, etc.)
@@ -36,10 +64,68 @@ class EventLoop {
   // maxEvents: Maximum size of the array
   // timeout: Timeout in milliseconds, -1 for infinite wait
   // Returns: Number of events occurred, -1 on error
+  // (io_uring: may return 0 before the timeout expired)
   int wait(struct epoll_event* events, int maxEvents, int timeout) const;
 
+  // Send several buffers, one non-blocking send attempt each
+  // The epoll backend issues one send() per request; the io_uring backend
+  // submits all of them with a single io_uring_enter()
+  // Throws: std::runtime_error if the batch cannot be submitted
+  void sendBatch(SendRequest* requests, size_t count) const;
+
+  // Queue fd for the batched send after the current dispatch round
+  // Replaces registering EPOLLOUT for output that usually fits into the
+  // socket buffer right away (see Server::flushWrites)
+  void requestWrite(int fd);
+
+  // Move the queued write requests into fds (in request order)
+  void takeWriteRequests(std::vector<int>& fds);
+
+  bool hasWriteRequests() const;
+
+  // Create an eventfd that other threads signal with wakeup(); wait()
+  // reports it like any registered fd (see Mailbox)
+  // Throws: std::runtime_error if the eventfd cannot be created
+  void enableWakeup();
+
+  // INVALID_FD until enableWakeup()
+  int getWakeupFd() const;
+
+  // Make the owning thread's wait() return; callable from any thread
+  void wakeup() const;
+
+  // Reset the wakeup fd after wait() reported it
+  void consumeWakeup() const;
+
+  // Number of system calls issued since the last call
+  unsigned long takeSyscallCount();
+
  private:
+  // io_uring: Interest registered for one fd
+  struct PollState {
+    uint32_t tag;  // Identifies the armed poll request in user_data
+    uint32_t events;
+  };
+
+  EventBackend backend_;
   int epollFd_;
+  IoUring* uring_;
+  // io_uring state changes inside const methods (the epoll equivalents only
+  // touch kernel state), hence mutable
+  mutable std::map<int, PollState> polls_;
+  mutable uint32_t nextTag_;
+  mutable std::deque<struct epoll_event> deferredEvents_;
+  mutable unsigned long syscallCount_;
+  unsigned long countedEnters_;  // io_uring_enter() calls already counted
+  std::vector<int> writeRequests_;
+  int wakeupFd_;
+
+  void armPoll(int fd, uint32_t events) const;
+  void cancelPoll(int fd, uint32_t tag) const;
+  void handleCompletion(const struct io_uring_cqe* cqe) const;
+  int waitIoUring(struct epoll_event* events, int maxEvents,
+                  int timeout) const;
+  void sendBatchIoUring(SendRequest* requests, size_t count) const;
 
   EventLoop(const EventLoop& src);             // = delete
   EventLoop& operator=(const EventLoop& src);  // = delete
@@ -0,0 +1,34 @@
+#ifndef INCLUDE_HANDOFF_HPP_
+#define INCLUDE_HANDOFF_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Handoff: Transfer of server state and file descriptors between processes
+// Used by the upgrade mode: the running server sends its serialized state
+// and all listening and client sockets over a connected Unix stream socket
+// to the freshly exec'd binary. File descriptors travel as SCM_RIGHTS
+// ancillary data in chunks of at most kMaxFdsPerMessage.
+class Handoff {
+ public:
+  // Maximum descriptors per SCM_RIGHTS message (SCM_MAX_FD in Linux)
+  static const size_t kMaxFdsPerMessage = 253;
+
+  // Send state and fds; the fds stay open in the sending process
+  // Throws: std::runtime_error on I/O errors (e.g. the receiver died)
+  static void send(int sock, const std::string& state,
+                   const std::vector<int>& fds);
+
+  // Receive what send() sent; fds are received close-on-exec and keep the
+  // order in which they were sent
+  // Throws: std::runtime_error on I/O errors or malformed data
+  static void receive(int sock, std::string& state, std::vector<int>& fds);
+
+ private:
+  Handoff();                               // = delete
+  Handoff(const Handoff& src);             // = delete
+  Handoff& operator=(const Handoff& src);  // = delete
+};
+
+#endif
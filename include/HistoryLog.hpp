@@ -0,0 +1,143 @@
+#ifndef INCLUDE_HISTORYLOG_HPP_
+#define INCLUDE_HISTORYLOG_HPP_
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "CaseMappedMap.hpp"
+#include "ChannelHistory.hpp"
+#include "EventLoop.hpp"
+#include "MpscQueue.hpp"
+
+// The completely written part of one segment of a HistoryLog channel
+struct HistorySegment {
+  unsigned number;
+  size_t logBytes;
+  size_t indexBytes;
+};
+
+// One read of a HistoryQuery
+struct HistoryRead {
+  HistorySide side;
+  bool hasRef;  // false: the newest messages (HISTORY_BEFORE only)
+  size_t limit;
+  std::vector<HistoryMessage> messages;  // Found, oldest first
+};
+
+// Reads of one channel's log, done by the writer thread (see
+// HistoryLog::query())
+struct HistoryQuery {
+  unsigned long id;  // The caller's
+  std::string channel;
+  HistoryRef ref;
+  std::vector<HistoryRead> reads;
+};
+
+// HistoryLog: Persistent history of selected channels (IRCSERV_HISTORY_DIR)
+// Every channel has a directory of numbered segments, only ever appended
+// to: NNNNNNNN.log holds the messages (BinaryWriter records), NNNNNNNN.idx
+// the time and offset of every 16th of them. A writer thread appends and
+// syncs the files, and answers queries through read-only mappings of what
+// it has completed, locating messages by binary search on the sparse
+// index. The event loop only exchanges messages with it (Mailbox): it
+// never waits for the disk.
+class HistoryLog {
+ public:
+  static const size_t kDefaultSegmentBytes = 16 * 1024 * 1024;
+  // Queries not taken back by takeAnswers() yet
+  static const size_t kMaxQueries = 256;
+
+  HistoryLog();
+  ~HistoryLog();  // close()
+
+  // Start logging channels into directory (created if missing); a segment
+  // is closed once its log reaches segmentBytes. Answers wake answerLoop
+  // (EventLoop::enableWakeup() already called).
+  // Throws: std::runtime_error if directory cannot be used, or another
+  //         process logs into it
+  void open(const std::string& directory,
+            const std::vector<std::string>& channels, EventLoop* answerLoop,
+            size_t segmentBytes = kDefaultSegmentBytes);
+  // Write everything queued and answer the queries, then stop the writer
+  // (no-op if not open); takeAnswers() still returns the answers
+  void close();
+  bool isOpen() const;
+  bool isLogged(const std::string& channel) const;
+
+  // Queue a message of a logged channel for the writer; never blocks (what
+  // the writer cannot take yet waits in a backlog, see retryBacklog())
+  void append(const std::string& channel, long time, const std::string& source,
+              const std::string& msgid, const std::string& text);
+
+  // Queue query for the writer, which does its reads once the messages
+  // appended before are written
+  // Returns: false if the channel is not logged or kMaxQueries are pending
+  bool query(const HistoryQuery& query);
+  // Move the answered queries into answers (event loop thread, when
+  // answerLoop reports its wakeup fd)
+  void takeAnswers(std::vector<HistoryQuery>& answers);
+  // Hand the writer what it can take of the backlog (event loop thread,
+  // every iteration while hasBacklog())
+  void retryBacklog();
+  bool hasBacklog() const;
+
+ private:
+  // One logged channel
+  struct ChannelLog {
+    std::string path;
+    long lastTime;  // Event loop: time of the last append
+    // Writer only (the event loop before it starts)
+    std::vector<HistorySegment> segments;
+    // About the last segment
+    int logFd;
+    int indexFd;
+    size_t records;         // Buffered ones included
+    size_t pendingRecords;  // In the buffers, written at the end of a batch
+    std::string logBuffer;
+    std::string indexBuffer;
+  };
+  // Encoded message, or query, for the writer; log NULL: stop
+  struct Record {
+    ChannelLog* log;
+    HistoryQuery* query;  // Owned by the record until answered
+    long time;
+    std::string data;
+  };
+
+  std::string directory_;
+  size_t segmentBytes_;
+  int lockFd_;
+  CaseMappedMap<ChannelLog*> channels_;  // Fixed while open
+  EventLoop* writerLoop_;
+  Mailbox<Record>* mailbox_;
+  std::deque<Record> backlog_;  // Not taken by the mailbox yet
+  Mailbox<HistoryQuery*>* answers_;  // kMaxQueries: never full
+  std::vector<HistoryQuery*> answered_;  // Drained from answers_
+  size_t queries_;  // Queried, not taken back yet
+  bool running_;
+  pthread_t writer_;
+
+  void post(const Record& record);
+  void loadSegments(ChannelLog* channel);
+  // Cut an incomplete last record (a crash while writing) and restore
+  // missing index entries of the last segment
+  void recoverSegment(ChannelLog* channel);
+  void release();
+
+  // Writer thread
+  static void* runWriter(void* self);
+  void writeRecords();
+  void writeRecord(const Record& record);
+  void answer(const ChannelLog* channel, HistoryQuery* query);
+  void flush(ChannelLog* channel);
+  void openSegment(ChannelLog* channel, unsigned number);
+
+  HistoryLog(const HistoryLog& src);             // = delete
+  HistoryLog& operator=(const HistoryLog& src);  // = delete
+};
+
+#endif
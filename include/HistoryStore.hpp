@@ -0,0 +1,51 @@
+#ifndef INCLUDE_HISTORYSTORE_HPP_
+#define INCLUDE_HISTORYSTORE_HPP_
+
+#include <set>
+#include <string>
+#include <utility>
+
+#include "CaseMappedMap.hpp"
+#include "ChannelHistory.hpp"
+
+// HistoryStore: The ChannelHistory of every channel that has one, under one
+// memory limit for all of them
+// Once over it, the oldest message of the whole server goes first: the
+// histories are ordered by the time of their oldest message. A history
+// outlives its channel (clients rejoining an emptied channel still find
+// it) until eviction empties it.
+class HistoryStore {
+ public:
+  HistoryStore();
+  ~HistoryStore();
+
+  // maxBytes: For all channels together, 0 disables the history
+  // maxMessages: Per channel
+  void setLimits(size_t maxBytes, size_t maxMessages);
+  bool isEnabled() const;
+  size_t getBytes() const;
+
+  void record(const std::string& channel, long time, const std::string& source,
+              const std::string& msgid, const std::string& text);
+
+  // Returns: NULL if nothing was recorded for channel (or all evicted)
+  const ChannelHistory* find(const std::string& channel) const;
+
+ private:
+  typedef std::pair<long, ChannelHistory*> OldestKey;
+
+  CaseMappedMap<ChannelHistory*> histories_;
+  std::set<OldestKey> byOldest_;  // Non-empty histories, next victim first
+  size_t bytes_;
+  size_t maxBytes_;
+  size_t maxMessages_;
+
+  // Drop the oldest message of history, and history once it is empty
+  void evictOldest(ChannelHistory* history);
+  void clear();
+
+  HistoryStore(const HistoryStore& src);             // = delete
+  HistoryStore& operator=(const HistoryStore& src);  // = delete
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef INCLUDE_HOSTMASK_HPP_
+#define INCLUDE_HOSTMASK_HPP_
+
+#include <string>
+#include <vector>
+
+#include "User.hpp"
+
+// Hostmask: nick!user@host glob ('*' any run, '?' one byte) of the channel
+// ban, exception and invite exception lists
+// The mask is compiled once: split at its stars into a literal prefix, a
+// literal suffix and the segments in between, all casefolded. A match
+// checks the length, the prefix and suffix in place, then finds each
+// middle segment leftmost-first (correct for globs, as the segments have
+// fixed lengths), with std::string::find when the mask has no '?'.
+class Hostmask {
+ public:
+  // mask: Completed by normalize()
+  explicit Hostmask(const std::string& mask);
+  ~Hostmask();
+
+  // Complete a mask to nick!user@host: "nick" is "nick!*@*", "user@host"
+  // is "*!user@host" and "nick!user" is "nick!user@*"
+  static std::string normalize(const std::string& mask);
+
+  // "nick!user@host" of user, casefolded: what matches() takes
+  static std::string makeTarget(const User* user);
+
+  const std::string& getMask() const;  // Normalized, original case
+  bool matches(const std::string& target) const;
+
+ private:
+  std::string mask_;
+  bool hasStar_;
+  bool hasQuestion_;
+  size_t minLength_;                  // Bytes the segments need
+  std::string prefix_;                // Before the first '*'
+  std::string suffix_;                // After the last '*'
+  std::vector<std::string> middle_;  // Between stars, in order
+
+  bool matchesAt(const std::string& segment, const std::string& target,
+                 size_t pos) const;
+  // Returns: Offset of segment in target at or after pos, or npos
+  size_t find(const std::string& segment, const std::string& target,
+              size_t pos) const;
+
+  Hostmask();  // = delete
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef INCLUDE_IOURING_HPP_
+#define INCLUDE_IOURING_HPP_
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+
+#define INVALID_FD -1
+
+// IoUring: Minimal io_uring instance driven by raw system calls
+// Owns the ring file descriptor and the shared submission/completion queue
+// mappings. SQEs are queued with getSqe() and handed to the kernel in one
+// io_uring_enter() by submitAndWait(); completions are consumed in order
+// with peekCqe()/advanceCq().
+class IoUring {
+ public:
+  IoUring();
+  ~IoUring();
+
+  // Create the ring and map its queues
+  // entries: Submission queue size (the completion queue is 8 times larger)
+  // Throws: std::runtime_error if io_uring is unavailable or lacks a feature
+  // the event loop relies on
+  void setup(unsigned entries);
+
+  // Get a zeroed SQE to fill in; it is submitted by the next submitAndWait()
+  // Submits the queued SQEs first when the submission queue is full
+  // Throws: std::runtime_error if the queued SQEs cannot be submitted
+  struct io_uring_sqe* getSqe();
+
+  // Submit all queued SQEs and wait for minComplete completions
+  // timeout: Timeout in milliseconds, -1 for infinite wait
+  // Returns: 0 on success, -errno on failure (-ETIME on timeout)
+  int submitAndWait(unsigned minComplete, int timeout);
+
+  // Oldest unconsumed completion, or NULL if the completion queue is empty
+  struct io_uring_cqe* peekCqe() const;
+
+  // Mark the completion returned by peekCqe() as consumed
+  void advanceCq();
+
+  // Number of SQEs queued but not yet submitted
+  unsigned getPendingCount() const;
+
+  // Number of io_uring_enter() calls made so far
+  unsigned long getEnterCount() const;
+
+ private:
+  int ringFd_;
+  void* ringMap_;  // Submission and completion rings (single mapping)
+  size_t ringMapSize_;
+  struct io_uring_sqe* sqes_;
+  size_t sqesMapSize_;
+
+  // Submission queue ring
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned* sqArray_;
+  unsigned sqTailLocal_;  // Tail including SQEs not yet published
+  unsigned sqEntries_;
+  unsigned pending_;
+
+  // Completion queue ring
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  struct io_uring_cqe* cqes_;
+
+  unsigned long enterCount_;
+
+  void publishPending();
+
+  IoUring(const IoUring& src);             // = delete
+  IoUring& operator=(const IoUring& src);  // = delete
+};
+
+#endif
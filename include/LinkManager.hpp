@@ -0,0 +1,231 @@
+#ifndef INCLUDE_LINKMANAGER_HPP_
+#define INCLUDE_LINKMANAGER_HPP_
+
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ChannelManager.hpp"
+#include "CommandParser.hpp"
+#include "EventLoop.hpp"
+#include "ServerConfig.hpp"
+#include "UserManager.hpp"
+
+#define INVALID_FD -1
+
+class CommandRouter;
+
+// LinkManager: Links to other servers of the network
+// Linked servers form a spanning tree and share their users and channels.
+// Each server announces itself with "SERVER <name> <password> :<info>",
+// then sends a burst of everything it knows and afterwards relays every
+// change it makes or receives to all other links. Users of other servers
+// are User objects with a negative id, so channels and the command handlers
+// treat them like local users; CommandRouter skips them when sending.
+//
+// Messages between servers use the client syntax with the source as prefix:
+// a user's network-wide id ("<server>/<n>") or a server name.
+//   :<server> SERVER <name> :<info>        server behind <server>
+//   :<server> UID <uid> <nick> <nickts> <user> <host> :<realname>
+//   :<server> CHANNEL <channel> <modes> [<key>] [<limit>] :[@]<uid> ...
+//   :<server> TOPIC <channel> :<topic>     burst topic (kept if greater)
+//   :<server> BMASK <channel> b|e|I :<mask> ...  burst mask list (merged)
+//   :<server> MODE <channel> +o <nick>     operator granted by a server
+//   :<server> KILL <uid> :<reason>         nickname collision loser
+//   :<server> SQUIT <name> :<reason>       server and its users are gone
+//   :<uid> NICK <nick> <nickts>
+//   :<uid> QUIT :<reason>
+//   :<uid> JOIN|PART|PRIVMSG|KICK|INVITE|TOPIC|MODE <client parameters>
+// Nickname collisions keep the user with the older nickname (then the
+// smaller id); the other one is disconnected on every server.
+class LinkManager {
+ public:
+  LinkManager(EventLoop* eventLoop, UserManager* userMgr,
+              ChannelManager* chanMgr, CommandRouter* cmdRouter);
+  ~LinkManager();
+
+  // Read the link settings and start listening and connecting
+  // Throws: std::runtime_error if the link listener cannot be opened
+  void start(const ServerConfig& config);
+
+  // Close the listener and all links; start() may be called again
+  void stop();
+
+  const std::string& getServerName() const;
+
+  // Check if fd is the link listener or a link
+  bool ownsFd(int fd) const;
+
+  // Handle an epoll event for an fd owned by the link manager
+  void handleEvent(int fd, uint32_t events);
+
+  // Connect to configured servers whose retry time has come, and close
+  // links that did not complete the handshake in time
+  void runTimers();
+
+  // Milliseconds until runTimers() has work, -1 if none
+  int getTimeoutMs() const;
+
+  // Send the output queued for links
+  void flush();
+
+  // Move the local users disconnected by a nickname collision into fds;
+  // their channels are already left and an ERROR is queued for them
+  void takeKilledUsers(std::vector<int>& fds);
+
+  // ==========================================
+  // Propagation (called by CommandRouter)
+  // ==========================================
+
+  // Announce a newly registered local user
+  void introduceUser(User* user);
+
+  // Announce the new nickname of a local user
+  void relayNick(User* user);
+
+  // Announce that a local user quit
+  void relayQuit(User* user, const std::string& reason);
+
+  // Relay a command of source to all links except the one it came from
+  void relay(User* source, const std::string& command,
+             const std::vector<std::string>& params);
+
+  // Relay a channel message only to links with members of channel
+  void relayToChannel(User* source, const Channel* channel,
+                      const std::string& command,
+                      const std::vector<std::string>& params);
+
+  // Relay a command addressed to target towards target's server
+  void relayToUser(User* source, const User* target,
+                   const std::string& command,
+                   const std::vector<std::string>& params);
+
+  // Announce that this server made user an operator of channel
+  void relayOperator(const Channel* channel, const User* user);
+
+ private:
+  static const int kMaxQueue = 8;
+  static const size_t kMaxLinks = 16;
+  static const size_t kMaxReadBuffer = 65536;     // Without a complete line
+  static const size_t kMaxWriteBuffer = 8388608;  // Peer too slow: drop
+  static const size_t kMaxBurstLine = 400;
+  static const double kReconnectDelay;
+  static const double kHandshakeTimeout;  // From accept() or connect()
+
+  enum LinkState {
+    LINK_CONNECTING,  // Outgoing, connect() in progress
+    LINK_HANDSHAKE,   // Waiting for the peer's SERVER line
+    LINK_ACTIVE
+  };
+
+  struct Link {
+    LinkState state;
+    int peerIndex;     // Index into peers_ for outgoing links, -1 incoming
+    std::string name;  // Peer server name once active
+    std::string address;
+    std::string readBuffer;
+    std::string writeBuffer;
+    bool writeArmed;  // EPOLLOUT registered
+    bool overflowed;  // Write buffer limit exceeded, closed on flush()
+    double deadline;  // Monotonic time to be active by (kHandshakeTimeout)
+
+    Link()
+        : state(LINK_HANDSHAKE),
+          peerIndex(-1),
+          writeArmed(false),
+          overflowed(false),
+          deadline(0) {}
+  };
+
+  // Server configured in IRCSERV_LINKS
+  struct Peer {
+    ListenAddress address;
+    int fd;              // Current link, INVALID_FD if not connected
+    double nextAttempt;  // Monotonic time of the next connection attempt
+
+    Peer() : fd(INVALID_FD), nextAttempt(0) {}
+  };
+
+  // Server somewhere behind a link
+  struct RemoteServer {
+    int linkFd;
+    std::string uplink;  // Server that introduced it
+    std::string info;
+  };
+
+  EventLoop* eventLoop_;
+  UserManager* userManager_;
+  ChannelManager* channelManager_;
+  CommandRouter* cmdRouter_;
+  CommandParser parser_;
+  std::string serverName_;
+  std::string password_;
+  ListenAddress listenAddress_;
+  int listenFd_;
+  std::vector<Peer> peers_;
+  std::map<int, Link> links_;
+  std::map<std::string, RemoteServer> servers_;
+  std::set<int> pendingWrites_;  // Links with queued output
+  std::vector<int> killedUsers_;
+  int nextRemoteId_;  // Ids of remote users count down from -2
+  unsigned long nextUid_;
+
+  // Connection handling
+  void listen();
+  void acceptLinks();
+  void connectPeer(size_t index);
+  void finishConnect(int fd, Link& link);
+  void handleRead(int fd);
+  void writeLink(int fd);
+  void closeLink(int fd, const std::string& reason);
+  void queue(int fd, const std::string& line);
+  void sendToAll(const std::string& line, int exceptFd);
+
+  // Protocol
+  void handleLine(int fd, const std::string& line);
+  void handleHandshake(int fd, Link& link, const Command& cmd);
+  void handleServerMessage(int fd, const std::string& source,
+                           const Command& cmd, const std::string& line);
+  void handleUserMessage(int fd, User* user, const Command& cmd,
+                         const std::string& line);
+  void sendBurst(int fd);
+  void sendChannelBurst(int fd, const Channel* channel);
+  void introduceServer(int fd, const std::string& uplink,
+                       const std::string& name, const std::string& info,
+                       const std::string& line);
+  void addRemoteUser(int fd, const std::string& server, const Command& cmd,
+                     const std::string& line);
+  void changeRemoteNick(int fd, User* user, const Command& cmd,
+                        const std::string& line);
+  void mergeChannel(int fd, const Command& cmd, const std::string& line);
+  void mergeTopic(int fd, const std::string& server, const Command& cmd,
+                  const std::string& line);
+  void mergeMasks(int fd, const std::string& server, const Command& cmd,
+                  const std::string& line);
+  void grantOperator(int fd, const std::string& server, const Command& cmd,
+                     const std::string& line);
+  void squitServer(int fd, const std::string& name, const std::string& line);
+  void dropServers(const std::set<std::string>& names,
+                   const std::string& reason, bool promote);
+  bool winsCollision(long nickTime, const std::string& uid, User* other);
+  void killUser(User* user, const std::string& reason, int exceptFd);
+  void removeRemoteUser(User* user, const std::string& reason);
+
+  // Helpers
+  const std::string& getUid(User* user);
+  std::string formatIntroduction(User* user);
+  void deliver(User* user, const std::string& message);
+  void deliverToChannel(const Channel* channel, const std::string& message);
+  static std::string formatLine(const std::string& source,
+                                const std::string& command,
+                                const std::vector<std::string>& params);
+
+  LinkManager();                                   // = delete
+  LinkManager(const LinkManager& src);             // = delete
+  LinkManager& operator=(const LinkManager& src);  // = delete
+};
+
+#endif
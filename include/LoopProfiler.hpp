@@ -0,0 +1,99 @@
+#ifndef INCLUDE_LOOPPROFILER_HPP_
+#define INCLUDE_LOOPPROFILER_HPP_
+
+#include <map>
+#include <string>
+
+#include "Metrics.hpp"
+
+// Phases of one event loop iteration
+enum LoopPhase {
+  LOOP_PHASE_ACCEPT,    // Accepting new connections
+  LOOP_PHASE_READ,      // recv() and message framing
+  LOOP_PHASE_DISPATCH,  // Parsing and executing commands
+  LOOP_PHASE_WRITE,     // send() of queued output
+  LOOP_PHASE_COUNT      // Number of phases (not a phase)
+};
+
+// LoopProfiler: Per-iteration instrumentation of the event loop
+// Server::run() brackets every epoll_wait wakeup with beginIteration() and
+// endIteration() and reports the time spent per phase and connection in
+// between. Each iteration is fed into Metrics; per-interval aggregates
+// (including the connection that cost the most) are kept for periodic
+// summaries.
+class LoopProfiler {
+ public:
+  // metrics: Receives loop histograms and counters (not owned)
+  // slowThreshold: Iterations longer than this (seconds) are reported as slow
+  // reportInterval: Seconds between summaries, 0 disables summaries
+  LoopProfiler(Metrics* metrics, double slowThreshold, double reportInterval);
+  ~LoopProfiler();
+
+  // Start an iteration right after epoll_wait() returned eventCount events
+  void beginIteration(int eventCount);
+
+  // Attribute time spent in a phase to the connection fd
+  // fd: -1 if the time is not attributable to a single connection
+  void record(LoopPhase phase, int fd, double seconds);
+
+  // Finish the current iteration
+  // Returns: true if the iteration exceeded the slow threshold
+  bool endIteration();
+
+  // Check if a summary is due; if so, the finished interval is kept for
+  // formatInterval() and a new interval starts
+  bool takeIntervalSummary();
+
+  // Human readable description of the last iteration / the last interval
+  std::string formatIteration() const;
+  std::string formatInterval() const;
+
+  // Connection that cost the most in the last iteration / interval
+  // Returns: fd, or -1 if no connection was recorded
+  // Note: fds are reused after disconnect, so the fd may already belong to a
+  // different connection when it is looked up
+  int getIterationWorstFd() const;
+  int getIntervalWorstFd() const;
+
+ private:
+  struct Stats {
+    unsigned long iterations;
+    unsigned long events;
+    double totalTime;
+    double maxTime;
+    double phaseTime[LOOP_PHASE_COUNT];
+
+    Stats();
+    void reset();
+  };
+
+  Metrics* metrics_;
+  double slowThreshold_;
+  double reportInterval_;
+
+  // Current iteration
+  double iterationStart_;
+  int iterationEvents_;
+  double iterationDuration_;
+  double iterationPhaseTime_[LOOP_PHASE_COUNT];
+  int iterationWorstFd_;
+  double iterationWorstTime_;
+  int currentFd_;  // fd of the last record(), merged while unchanged
+  double currentFdTime_;
+
+  // Current interval
+  double intervalStart_;
+  Stats interval_;
+  Stats lastInterval_;  // Snapshot taken by takeIntervalSummary()
+  std::map<int, double> connectionTime_;  // fd -> time in this interval
+  int lastIntervalWorstFd_;
+  double lastIntervalWorstTime_;
+
+  void flushCurrentFd();
+
+  LoopProfiler();                                    // = delete
+  LoopProfiler(const LoopProfiler& src);             // = delete
+  LoopProfiler& operator=(const LoopProfiler& src);  // = delete
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef INCLUDE_MESSAGECLOCK_HPP_
+#define INCLUDE_MESSAGECLOCK_HPP_
+
+#include <ctime>
+#include <string>
+
+// MessageClock: The "time" and "msgid" tags of relayed messages
+// The wall clock is read once per event loop iteration (update()), and the
+// ISO-8601 string re-rendered by strftime() only when the second changes;
+// messages of an iteration share its time. Message ids are this process's
+// start time and a counter, both in hex: unique without a lookup, and
+// increasing as compareMsgIds() orders them (see ChannelHistory).
+class MessageClock {
+ public:
+  MessageClock();
+  ~MessageClock();
+
+  // Read the wall clock (Server calls it once per loop iteration)
+  void update();
+
+  // "2026-10-18T12:34:56.789Z": UTC, milliseconds, as of the last update()
+  const std::string& getServerTime() const;
+  long getMillis() const;  // The same, in milliseconds since the epoch
+
+  // millis (since the epoch) as getServerTime() shows it
+  static std::string formatServerTime(long millis);
+  // Returns: false if serverTime is not "YYYY-MM-DDThh:mm:ss[.sss]Z"
+  static bool parseServerTime(const std::string& serverTime, long* millis);
+
+  // A new message id, never returned before by any process
+  std::string nextMsgId();
+
+ private:
+  std::string serverTime_;
+  time_t renderedSecond_;  // Second serverTime_ shows, milliseconds aside
+  long millis_;
+  std::string idPrefix_;   // Start time, then '-'
+  unsigned long nextId_;
+
+  MessageClock(const MessageClock& src);             // = delete
+  MessageClock& operator=(const MessageClock& src);  // = delete
+};
+
+#endif
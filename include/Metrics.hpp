@@ -0,0 +1,92 @@
+#ifndef INCLUDE_METRICS_HPP_
+#define INCLUDE_METRICS_HPP_
+
+#include <cstddef>
+#include <string>
+
+// Monotonic counters (only ever increase)
+enum MetricCounter {
+  METRIC_CONNECTIONS_ACCEPTED,
+  METRIC_CONNECTIONS_REJECTED,
+  METRIC_CONNECTIONS_CLOSED,
+  METRIC_MESSAGES_RECEIVED,
+  METRIC_BYTES_RECEIVED,
+  METRIC_BYTES_SENT,
+  METRIC_LOOP_ITERATIONS,
+  METRIC_LOOP_SLOW_ITERATIONS,
+  METRIC_SYSCALLS,
+  METRIC_COUNTER_COUNT  // Number of counters (not a metric)
+};
+
+// Gauges (current value, may go up and down)
+enum MetricGauge {
+  METRIC_USERS_CONNECTED,
+  METRIC_CHANNELS,
+  METRIC_GAUGE_COUNT  // Number of gauges (not a metric)
+};
+
+// Accumulated durations in seconds (counters with fractional values)
+// The METRIC_LOOP_*_TIME entries follow the order of LoopPhase
+enum MetricTimeCounter {
+  METRIC_LOOP_ACCEPT_TIME,
+  METRIC_LOOP_READ_TIME,
+  METRIC_LOOP_DISPATCH_TIME,
+  METRIC_LOOP_WRITE_TIME,
+  METRIC_TIME_COUNTER_COUNT  // Number of time counters (not a metric)
+};
+
+// Histograms (cumulative buckets with fixed upper bounds)
+enum MetricHistogram {
+  METRIC_COMMAND_DURATION,
+  METRIC_LOOP_ITERATION_DURATION,
+  METRIC_LOOP_EVENTS_PER_WAKEUP,
+  METRIC_HISTOGRAM_COUNT  // Number of histograms (not a metric)
+};
+
+// Metrics: In-process registry of server counters, gauges and histograms
+// Updated by the server core on the event loop thread and rendered in the
+// Prometheus text exposition format by the admin listener.
+// Recording is allocation-free; only render() builds strings.
+class Metrics {
+ public:
+  Metrics();
+  ~Metrics();
+
+  // Add value to a counter
+  void increment(MetricCounter counter, unsigned long value = 1);
+
+  // Add a duration (seconds) to a time counter
+  void addTime(MetricTimeCounter counter, double seconds);
+
+  // Set the current value of a gauge
+  void setGauge(MetricGauge gauge, long value);
+
+  // Record one observation in a histogram
+  // value: Observed value in the histogram's unit (seconds for durations)
+  void observe(MetricHistogram histogram, double value);
+
+  // Getters (mainly for tests)
+  unsigned long getCounter(MetricCounter counter) const;
+  double getTime(MetricTimeCounter counter) const;
+  long getGauge(MetricGauge gauge) const;
+  unsigned long getHistogramCount(MetricHistogram histogram) const;
+
+  // Render all metrics in Prometheus text format (version 0.0.4)
+  std::string render() const;
+
+ private:
+  static const size_t kMaxBuckets = 16;
+
+  unsigned long counters_[METRIC_COUNTER_COUNT];
+  double times_[METRIC_TIME_COUNTER_COUNT];
+  long gauges_[METRIC_GAUGE_COUNT];
+  // Per-bucket (non-cumulative) counts, the last bucket is +Inf
+  unsigned long buckets_[METRIC_HISTOGRAM_COUNT][kMaxBuckets];
+  unsigned long histogramCounts_[METRIC_HISTOGRAM_COUNT];
+  double histogramSums_[METRIC_HISTOGRAM_COUNT];
+
+  Metrics(const Metrics& src);             // = delete
+  Metrics& operator=(const Metrics& src);  // = delete
+};
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef INCLUDE_MPSCQUEUE_HPP_
+#define INCLUDE_MPSCQUEUE_HPP_
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "EventLoop.hpp"
+
+// MpscQueue: Bounded multi-producer single-consumer queue without locks
+// A ring of slots with a sequence number each (D. Vyukov's bounded queue):
+// producers claim a slot with one compare-and-swap on the shared enqueue
+// position, then publish it by advancing the slot's sequence; the single
+// consumer reads the slots in order and hands them back the same way.
+// A producer interrupted between claim and publish delays the consumer at
+// that slot only until it resumes; no thread ever blocks on a lock.
+// Atomics are GCC builtins (C++98 has no std::atomic).
+template <typename T>
+class MpscQueue {
+ public:
+  // capacity: Rounded up to a power of two (at least 2)
+  explicit MpscQueue(size_t capacity)
+      : slots_(roundCapacity(capacity)),
+        mask_(slots_.size() - 1),
+        enqueuePos_(0),
+        dequeuePos_(0) {
+    for (size_t i = 0; i < slots_.size(); ++i) slots_[i].sequence = i;
+  }
+
+  size_t getCapacity() const { return slots_.size(); }
+
+  // Append value; callable from any thread
+  // Returns: false if the queue is full
+  bool tryPush(const T& value) {
+    size_t pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      size_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        // Free slot: claim it (on failure pos is reloaded)
+        if (__atomic_compare_exchange_n(&enqueuePos_, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+          slot.value = value;
+          __atomic_store_n(&slot.sequence, pos + 1, __ATOMIC_RELEASE);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // Not consumed yet: full
+      } else {
+        pos = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+      }
+    }
+  }
+
+  // Remove the oldest value; only the consumer thread may call this
+  // Returns: false if the queue is empty
+  bool tryPop(T& value) {
+    Slot& slot = slots_[dequeuePos_ & mask_];
+    size_t sequence = __atomic_load_n(&slot.sequence, __ATOMIC_ACQUIRE);
+    if (sequence != dequeuePos_ + 1) return false;
+    value = slot.value;
+    slot.value = T();  // Release what the slot holds (e.g. string memory)
+    __atomic_store_n(&slot.sequence, dequeuePos_ + mask_ + 1,
+                     __ATOMIC_RELEASE);
+    ++dequeuePos_;
+    return true;
+  }
+
+ private:
+  static const size_t kCacheLine = 64;
+
+  struct Slot {
+    size_t sequence;  // pos + 1: published, pos + capacity: free again
+    T value;
+  };
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  // Producers and the consumer write different cache lines
+  char padding0_[kCacheLine];
+  size_t enqueuePos_;
+  char padding1_[kCacheLine];
+  size_t dequeuePos_;
+
+  static size_t roundCapacity(size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+      if (rounded > (static_cast<size_t>(-1) >> 2)) {
+        throw std::length_error("MpscQueue capacity too large");
+      }
+      rounded <<= 1;
+    }
+    return rounded;
+  }
+
+  MpscQueue();                                 // = delete
+  MpscQueue(const MpscQueue& src);             // = delete
+  MpscQueue& operator=(const MpscQueue& src);  // = delete
+};
+
+// Mailbox: MpscQueue whose consumer sleeps in an EventLoop
+// Producers post() from any thread; the first message after a drain()
+// signals the loop's wakeup fd, so a burst of messages costs one eventfd
+// write. The owning thread calls drain() when wait() reports
+// EventLoop::getWakeupFd().
+template <typename T>
+class Mailbox {
+ public:
+  // eventLoop: Consumer's loop, EventLoop::enableWakeup() already called
+  Mailbox(EventLoop* eventLoop, size_t capacity)
+      : queue_(capacity), eventLoop_(eventLoop), signaled_(0) {}
+
+  // Callable from any thread
+  // Returns: false if the mailbox is full (the caller decides to retry or
+  //          drop; nothing is queued)
+  bool post(const T& message) {
+    if (!queue_.tryPush(message)) return false;
+    if (__atomic_exchange_n(&signaled_, 1, __ATOMIC_ACQ_REL) == 0) {
+      eventLoop_->wakeup();
+    }
+    return true;
+  }
+
+  // Append all queued messages to messages (consumer thread only)
+  // Returns: Number of messages appended
+  size_t drain(std::vector<T>& messages) {
+    // Cleared first: a message posted after this signals again
+    __atomic_store_n(&signaled_, 0, __ATOMIC_SEQ_CST);
+    size_t count = 0;
+    T message;
+    while (queue_.tryPop(message)) {
+      messages.push_back(message);
+      ++count;
+    }
+    return count;
+  }
+
+  size_t getCapacity() const { return queue_.getCapacity(); }
+
+ private:
+  MpscQueue<T> queue_;
+  EventLoop* eventLoop_;
+  int signaled_;  // Wakeup pending since the last drain()
+
+  Mailbox();                               // = delete
+  Mailbox(const Mailbox& src);             // = delete
+  Mailbox& operator=(const Mailbox& src);  // = delete
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 
+#include "Channel.hpp"
 #include "User.hpp"
 
 // ResponseFormatter: Formats IRC protocol messages according to RFC1459
@@ -17,7 +18,14 @@ class ResponseFormatter {
   static std::string rplWelcome(const User* user);
   static std::string rplYourHost(const User* user);
   static std::string rplCreated(const User* user);
-  static std::string rplMyInfo(const User* user);
+  // channelModes: every channel mode handled (see CHANMODES and PREFIX)
+  static std::string rplMyInfo(const User* user,
+                               const std::string& channelModes);
+  // RPL_ISUPPORT after its target, for tokens (13 at most): rendered once,
+  // completed per client by rplISupport()
+  static std::string isupportTail(const std::vector<std::string>& tokens);
+  static std::string rplISupport(const std::string& target,
+                                 const std::string& tail);
 
   // ==========================================
   // Command responses
@@ -52,6 +60,79 @@ class ResponseFormatter {
                                    const std::string& modes,
                                    const std::string& args);
   static std::string rplQuit(const User* user, const std::string& reason);
+  static std::string rplNick(const User* user, const std::string& newNick);
+  static std::string rplTagmsg(const User* from, const std::string& target);
+  // PRIVMSG of a CHATHISTORY playback; source: nick!user@host
+  static std::string rplHistoryPrivmsg(const std::string& source,
+                                       const std::string& target,
+                                       const std::string& message);
+  // CAP reply: subcommand LS, LIST, ACK or NAK with its capability list
+  static std::string rplCap(const std::string& target,
+                            const std::string& subcommand,
+                            const std::string& caps);
+  // RPL_NAMREPLY (353) up to the list of names: the caller appends the
+  // space-separated names and the CRLF (see CommandRouter::sendNames())
+  static std::string rplNamReplyHead(const std::string& target,
+                                     const std::string& channel);
+  static std::string rplEndOfNames(const std::string& target,
+                                   const std::string& channel);
+  static std::string rplListStart(const std::string& target);
+  static std::string rplList(const std::string& target,
+                             const std::string& channel, size_t users,
+                             const std::string& topic);
+  static std::string rplListEnd(const std::string& target);
+  // RPL_WHOREPLY about user as seen in channel ("*": none), op: is one of
+  // its operators
+  static std::string rplWhoReply(const std::string& target,
+                                 const std::string& channel, const User* user,
+                                 bool op);
+  static std::string rplEndOfWho(const std::string& target,
+                                 const std::string& mask);
+  static std::string rplWhoisUser(const std::string& target, const User* user);
+  static std::string rplWhoisServer(const std::string& target,
+                                    const User* user);
+  // RPL_WHOISCHANNELS up to the list of channels (see rplNamReplyHead())
+  static std::string rplWhoisChannelsHead(const std::string& target,
+                                          const std::string& nickname);
+  static std::string rplEndOfWhois(const std::string& target,
+                                   const std::string& nickname);
+  // RPL_BANLIST, RPL_EXCEPTLIST or RPL_INVITELIST and their end markers
+  static std::string rplMaskList(MaskList list, const std::string& target,
+                                 const std::string& channel,
+                                 const MaskEntry& entry);
+  static std::string rplEndOfMaskList(MaskList list, const std::string& target,
+                                      const std::string& channel);
+  static std::string rplAway(const std::string& target,
+                             const std::string& nickname,
+                             const std::string& message);
+  static std::string rplUnaway(const std::string& target);
+  static std::string rplNowAway(const std::string& target);
+  // MONITOR replies: list is comma-separated (nick!user@host for online
+  // users, nicknames otherwise)
+  static std::string rplMonOnline(const std::string& target,
+                                  const std::string& list);
+  static std::string rplMonOffline(const std::string& target,
+                                   const std::string& list);
+  static std::string rplMonList(const std::string& target,
+                                const std::string& list);
+  static std::string rplEndOfMonList(const std::string& target);
+
+  // IRCv3 BATCH: start (type and its target) and end of the batch with
+  // reference, and line as part of it (a "batch" tag added)
+  static std::string batchStart(const std::string& reference,
+                                const std::string& type,
+                                const std::string& target);
+  static std::string batchEnd(const std::string& reference);
+  static std::string inBatch(const std::string& reference,
+                             const std::string& line);
+
+  // IRCv3 standard reply: "FAIL command code context :description"
+  static std::string fail(const std::string& command, const std::string& code,
+                          const std::string& context,
+                          const std::string& description);
+
+  // "nick!user@host" of user, as it prefixes the messages it sends
+  static std::string formatUserPrefix(const User* user);
 
   // ==========================================
   // Error responses (400-599)
@@ -64,8 +145,12 @@ class ResponseFormatter {
                                          const std::string& channel);
   static std::string errTooManyChannels(const std::string& target,
                                         const std::string& channel);
+  static std::string errTooManyTargets(const std::string& target,
+                                       const std::string& targets);
   static std::string errUnknownCommand(const std::string& target,
                                        const std::string& command);
+  static std::string errInvalidCapCmd(const std::string& target,
+                                      const std::string& subcommand);
   static std::string errErroneusNickname(const std::string& target,
                                          const std::string& nickname);
   static std::string errNicknameInUse(const std::string& target,
@@ -88,6 +173,10 @@ class ResponseFormatter {
                                        const std::string& channel);
   static std::string errBadChannelKey(const std::string& target,
                                       const std::string& channel);
+  static std::string errBannedFromChan(const std::string& target,
+                                       const std::string& channel);
+  static std::string errBanListFull(const std::string& target,
+                                    const std::string& channel, char mode);
   static std::string errChanOPrivsNeeded(const std::string& target,
                                          const std::string& channel);
   static std::string errUnknownMode(const std::string& target, char mode);
@@ -95,6 +184,9 @@ class ResponseFormatter {
                                          const std::string& channel, char mode,
                                          const std::string& param,
                                          const std::string& description);
+  // ERR_MONLISTFULL: list (comma-separated) was not added, limit reached
+  static std::string errMonListFull(const std::string& target, size_t limit,
+                                    const std::string& list);
 
  private:
   // Helper: Format IRC message with prefix, command, and parameters
@@ -103,10 +195,6 @@ class ResponseFormatter {
                                    const std::string& command,
                                    const std::vector<std::string>& params);
 
-  // Helper: Format user prefix (nick!user@host)
-  // Returns: Formatted prefix for command responses
-  static std::string formatUserPrefix(const User* user);
-
   ResponseFormatter();                                     // = delete
   ~ResponseFormatter();                                    // = delete
   ResponseFormatter(const ResponseFormatter& src);         // = delete
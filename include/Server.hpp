@@ -14,20 +14,28 @@
 #define INCLUDE_SERVER_HPP_
 
 #include <sys/epoll.h>
+#include <sys/types.h>
 
 #include <string>
+#include <vector>
 
+#include "AdminServer.hpp"
 #include "ChannelManager.hpp"
 #include "CommandRouter.hpp"
 #include "ConnectionManager.hpp"
 #include "EventLoop.hpp"
+#include "LinkManager.hpp"
+#include "LoopProfiler.hpp"
+#include "Metrics.hpp"
+#include "ServerConfig.hpp"
 #include "UserManager.hpp"
 
 #define INVALID_FD -1
 
 class Server {
  public:
-  Server(const std::string& portStr, const std::string& password);
+  Server(const std::string& portStr, const std::string& password,
+         const ServerConfig& config);
   ~Server();
   void run();
 
@@ -40,23 +48,54 @@ class Server {
   // Member variables
   int port_;
   std::string password_;
-  int serverSocket_;
+  std::vector<int> listenFds_;
+  std::string executablePath_;  // Binary started by an upgrade
+  ServerConfig config_;
   EventLoop eventLoop_;
+  Metrics metrics_;
+  LoopProfiler profiler_;
   ConnectionManager connManager_;
   UserManager userManager_;
   ChannelManager channelManager_;
   CommandRouter cmdRouter_;
+  AdminServer adminServer_;
+  LinkManager linkManager_;
+  pid_t snapshotPid_;        // Running snapshot writer, -1 if none
+  double nextSnapshotTime_;  // Monotonic time of the next snapshot
 
   // Helper methods
   void validateAndSetPort(const std::string& portStr);
   void validatePassword(const std::string& password);
-  void setupServerSocket();
+  void setupListeners();
+  void openListener(const ListenAddress& listenAddress);
+  bool isListener(int fd) const;
   void handleEvent(const struct epoll_event& event);
-  void acceptConnections();
+  void acceptConnections(int listenFd);
   void handleUserError(int fd);
   void handleUserRead(User* user);
   void handleUserWrite(User* user);
+  void flushWrites();
   void disconnectUser(int fd);
+  void disconnectKilledUsers();
+  void updateGauges();
+  void reportLoopProfile();
+  int getWaitTimeout() const;
+
+  // Channel snapshots (see ChannelSnapshot)
+  void restoreSnapshot();
+  void runSnapshots();
+  void startSnapshot();
+  void reapSnapshot(int options);
+  void saveSnapshot();
+  std::string describeConnection(int fd);
+
+  // Upgrade: hand all sockets and state over to a freshly started binary
+  // Returns: true once the new process has taken over (run() then returns),
+  //          false if the upgrade failed and this process keeps serving
+  bool upgrade();
+  std::string serializeState(std::vector<int>& fds);
+  void resumeFromHandoff(int sock);
+  void restoreState(const std::string& state, const std::vector<int>& fds);
 
   Server();                              // = delete
   Server(const Server& src);             // = delete
@@ -0,0 +1,114 @@
+#ifndef INCLUDE_SERVERCONFIG_HPP_
+#define INCLUDE_SERVERCONFIG_HPP_
+
+#include <string>
+#include <vector>
+
+#include "EventLoop.hpp"
+
+// One listening socket of the IRC server (see ServerConfig::listenAddresses)
+struct ListenAddress {
+  // Numeric IPv4 or IPv6 address, "*" for all addresses (dual-stack)
+  std::string host;
+  int port;
+  int backlog;  // listen() backlog, 0 for the server default
+
+  ListenAddress();
+  ListenAddress(const std::string& host, int port, int backlog);
+};
+
+// ServerConfig: Optional runtime settings of the server
+// The mandatory interface stays "./ircserv <port> <password>", so everything
+// optional is read from IRCSERV_* environment variables instead.
+struct ServerConfig {
+  // Admin listener for the metrics endpoint (IRCSERV_ADMIN_LISTEN)
+  // Format: "unix:<path>" or a TCP port number bound on 127.0.0.1
+  // Empty: admin listener disabled
+  std::string adminListen;
+
+  // Event loop iterations slower than this are logged as warnings
+  // (IRCSERV_SLOW_LOOP_MS, default 50, 0 disables the warning)
+  double slowLoopThreshold;  // seconds
+
+  // Interval of the event loop profiling summary
+  // (IRCSERV_LOOP_REPORT_INTERVAL in seconds, default 60, 0 disables)
+  double loopReportInterval;  // seconds
+
+  // Listening sockets (IRCSERV_LISTEN), comma separated
+  // "<host>:<port>[/<backlog>]" with IPv6 hosts in brackets, e.g.
+  // "*:6667,[2001:db8::1]:6697/128"
+  // "*" binds all IPv4 and IPv6 addresses with one dual-stack socket; an
+  // explicit IPv6 address is bound IPv6-only so that it can be combined with
+  // IPv4 listeners on the same port
+  // Empty: "*" on the port given on the command line
+  std::vector<ListenAddress> listenAddresses;
+
+  // Readiness notification backend
+  // (IRCSERV_EVENT_BACKEND: "epoll" (default) or "io_uring")
+  EventBackend eventBackend;
+
+  // Channel snapshot file (IRCSERV_SNAPSHOT_PATH), restored at startup
+  // Empty: snapshots disabled
+  std::string snapshotPath;
+
+  // Interval of the periodic snapshots (IRCSERV_SNAPSHOT_INTERVAL in
+  // seconds, default 60, 0: only when the server stops)
+  double snapshotInterval;  // seconds
+
+  // Malformed lines a client may send within 10 seconds before it is
+  // disconnected (IRCSERV_MALFORMED_LIMIT, default 50, 0 disables); only
+  // the first few of them are answered and logged
+  int malformedLimit;
+
+  // Memory for the channel histories served by CHATHISTORY, all channels
+  // together (IRCSERV_HISTORY_KB in KiB, default 16384, 0 disables)
+  size_t historyMemory;  // bytes
+
+  // Directory of the persistent history (IRCSERV_HISTORY_DIR, see
+  // HistoryLog) and the channels kept there (IRCSERV_HISTORY_CHANNELS,
+  // comma separated); empty: nothing is written to disk
+  std::string historyDirectory;
+  std::vector<std::string> historyChannels;
+
+  // Set by a running server in the process it starts for an upgrade
+  // (IRCSERV_UPGRADE_FD): Unix socket on which the state and all sockets
+  // are handed over; -1 for a normal start
+  int upgradeFd;
+
+  // Name of this server in a network of linked servers
+  // (IRCSERV_SERVER_NAME, default "ft_irc"); unique within the network
+  std::string serverName;
+
+  // Server links (see LinkManager), all empty/unset: not linked
+  // Shared secret of the network (IRCSERV_LINK_PASSWORD)
+  std::string linkPassword;
+  // Listener for other servers (IRCSERV_LINK_LISTEN,
+  // "<host>:<port>[/<backlog>]" as in IRCSERV_LISTEN), port 0 if unset
+  ListenAddress linkListen;
+  // Servers to connect to (IRCSERV_LINKS), comma separated "<host>:<port>"
+  // with numeric addresses, IPv6 in brackets
+  std::vector<ListenAddress> linkPeers;
+
+  ServerConfig();
+
+  // Build a configuration from the process environment
+  // Throws: std::runtime_error if a variable has an invalid value
+  static ServerConfig fromEnvironment();
+
+  // Parse a TCP port number (1-65535)
+  // Throws: std::runtime_error if invalid
+  static int parsePort(const std::string& portStr);
+
+  // Parse one "<host>:<port>[/<backlog>]" entry of IRCSERV_LISTEN
+  // Throws: std::runtime_error if invalid
+  static ListenAddress parseListenAddress(const std::string& spec);
+
+  // Parse one "<host>:<port>" entry of IRCSERV_LINKS
+  // Throws: std::runtime_error if invalid
+  static ListenAddress parsePeerAddress(const std::string& spec);
+
+  // Server names: 1-63 letters, digits, '.', '-' or '_'
+  static bool isValidServerName(const std::string& name);
+};
+
+#endif
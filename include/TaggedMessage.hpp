@@ -0,0 +1,42 @@
+#ifndef INCLUDE_TAGGEDMESSAGE_HPP_
+#define INCLUDE_TAGGEDMESSAGE_HPP_
+
+#include <string>
+
+#include "MessageClock.hpp"
+
+// TaggedMessage: A relayed line as each recipient gets it, by the
+// capabilities it enabled: server-time adds "time", message-tags "msgid"
+// and the sender's client-only tags. Each variant is rendered once, when a
+// recipient first needs it, and shared by the others; the message id is
+// only taken then.
+class TaggedMessage {
+ public:
+  // line: CRLF-terminated; clientTags: see CommandParser::getClientTags()
+  // tagsOnly: Clients without message-tags get nothing (TAGMSG)
+  TaggedMessage(const std::string& line, MessageClock* clock,
+                const std::string& clientTags, bool tagsOnly);
+  ~TaggedMessage();
+
+  // Returns: The line for a client with caps (Capability bits), empty if
+  //          it gets none
+  const std::string& render(unsigned caps);
+
+  // Taken from the clock on first use, like render() does
+  const std::string& getMsgId();
+
+ private:
+  std::string line_;
+  MessageClock* clock_;
+  std::string clientTags_;
+  bool tagsOnly_;
+  std::string msgid_;        // Empty until a variant needs it
+  std::string variants_[3];  // time, msgid and client tags, both
+  std::string none_;
+
+  TaggedMessage();                                     // = delete
+  TaggedMessage(const TaggedMessage& src);             // = delete
+  TaggedMessage& operator=(const TaggedMessage& src);  // = delete
+};
+
+#endif
@@ -13,11 +13,33 @@
 #ifndef INCLUDE_USER_HPP_
 #define INCLUDE_USER_HPP_
 
-#include <set>
 #include <string>
+#include <vector>
 
 #define INVALID_FD -1
 
+class Channel;
+
+enum ReplyKind {
+  REPLY_LIST,
+  REPLY_WHO_CHANNEL,  // WHO #channel: its members
+  REPLY_WHO_MASK      // WHO mask: every user
+};
+
+// A long reply (LIST, WHO) in progress, continued as the write buffer
+// drains (see CommandRouter::continueReply())
+struct ReplyCursor {
+  explicit ReplyCursor(ReplyKind kind);
+
+  ReplyKind kind;
+  size_t slot;  // LIST: next slot of the channel table to visit
+  int nextId;   // WHO: next user id (members and users are sorted by id)
+  size_t minUsers;  // LIST: member count bounds, inclusive
+  size_t maxUsers;
+  std::vector<std::string> masks;  // A match for one is listed, none: all
+  std::string target;              // WHO: channel name or mask, as given
+};
+
 class User {
  public:
   User(int socketFd, const std::string& ip);
@@ -31,6 +53,19 @@ class User {
   const std::string& getRealname() const;
   bool isAuthenticated() const;
   bool isRegistered() const;
+  const std::string& getUid() const;
+  long getNickTime() const;
+  // Changes whenever nick!user@host does (cached mask matches compare it)
+  unsigned long getIdentity() const;
+  unsigned getCaps() const;  // Capability bits enabled with CAP REQ
+  bool hasCap(unsigned cap) const;
+  // Registration waits for CAP END once the client started negotiating
+  bool isNegotiatingCaps() const;
+  const std::string& getAwayMessage() const;  // Empty unless AWAY
+  // Nicknames watched with MONITOR, as given; kept by UserManager, which
+  // indexes the watchers of each nickname
+  const std::vector<std::string>& getMonitored() const;
+  std::vector<std::string>& getMonitored();
 
   // Setters
   void setNickname(const std::string& nickname);
@@ -38,12 +73,39 @@ class User {
   void setRealname(const std::string& realname);
   void setAuthenticated(bool authenticated);
   void setRegistered(bool registered);
+  void setUid(const std::string& uid);  // Use UserManager::setUid
+  void setNickTime(long nickTime);
+  void setCaps(unsigned caps);
+  void setNegotiatingCaps(bool negotiating);
+  void setAwayMessage(const std::string& message);  // Empty: back
+
+  // Users of other servers (see LinkManager) have a negative id instead of a
+  // socket and are reached through the link they were introduced on
+  void setRemote(const std::string& server, int linkFd);
+  bool isRemote() const;
+  const std::string& getServer() const;  // Empty for local users
+  int getLinkFd() const;                 // INVALID_FD for local users
 
   // Channel operations
-  void joinChannel(const std::string& channel);
-  void leaveChannel(const std::string& channel);
-  bool isInChannel(const std::string& channel) const;
-  const std::set<std::string>& getJoinedChannels() const;
+  // Handles stay valid while the user is a member: ChannelManager only
+  // deletes channels nobody is in
+  void joinChannel(Channel* channel);
+  void leaveChannel(Channel* channel);
+  bool isInChannel(const Channel* channel) const;
+  const std::vector<Channel*>& getJoinedChannels() const;
+
+  // Count a malformed line received at now (seconds, monotonic)
+  // Returns: Malformed lines in the current window of window seconds,
+  //          this one included
+  int countMalformed(double now, double window);
+
+  // LIST or WHO output waiting for room in the write buffer
+  // Returns: NULL if no such reply is in progress
+  ReplyCursor* getReplyCursor();
+  // A reply still in progress must be ended first (see
+  // CommandRouter::abortReply())
+  void startReply(const ReplyCursor& cursor);
+  void endReply();
 
   // Buffer access (for ConnectionManager and Server)
   std::string& getReadBuffer();
@@ -59,7 +121,19 @@ class User {
   std::string writeBuffer_;
   bool authenticated_;
   bool registered_;
-  std::set<std::string> joinedChannels_;
+  std::vector<Channel*> joinedChannels_;  // Few per user: linear scans
+  std::string uid_;     // Network-wide id, assigned on registration
+  long nickTime_;       // When the nickname was taken (collision tie-break)
+  std::string server_;  // Server the user is connected to, empty if local
+  int linkFd_;
+  int malformedCount_;
+  double malformedWindowStart_;
+  ReplyCursor* replyCursor_;
+  unsigned long identity_;
+  unsigned caps_;
+  bool negotiatingCaps_;
+  std::string awayMessage_;
+  std::vector<std::string> monitored_;
 
   User();                            // = delete
   User(const User& src);             // = delete
@@ -1,15 +1,21 @@
 #ifndef INCLUDE_USERMANAGER_HPP_
 #define INCLUDE_USERMANAGER_HPP_
 
+#include <cstddef>
 #include <map>
 #include <string>
+#include <vector>
 
+#include "CaseMappedMap.hpp"
 #include "User.hpp"
 
 // UserManager: Manages the collection of connected users
 // Handles adding, removing, and looking up users by file descriptor or nickname
 class UserManager {
  public:
+  // Nicknames one user may watch with MONITOR
+  static const size_t kMaxMonitored = 100;
+
   UserManager();
   ~UserManager();
 
@@ -18,7 +24,7 @@ class UserManager {
   void addUser(User* user);
 
   // Remove a user by file descriptor
-  // Deletes the User object and removes from map
+  // Deletes the User object and removes from map (and its MONITOR list)
   void removeUser(int fd);
 
   // Remove all users (used in destructor)
@@ -32,9 +38,16 @@ class UserManager {
   // Returns: Pointer to User, or NULL if not found
   User* getUserByNickname(const std::string& nickname);
 
-  // Get all users
+  // Get a user by network-wide id (see LinkManager)
+  // Returns: Pointer to User, or NULL if not found
+  User* getUserByUid(const std::string& uid);
+
+  // Get all users, including the users of linked servers (negative ids)
   const std::map<int, User*>& getUsers() const;
 
+  // Number of users connected to this server
+  size_t getLocalUserCount() const;
+
   // Check if a nickname is already in use
   bool isNicknameInUse(const std::string& nickname) const;
 
@@ -47,9 +60,24 @@ class UserManager {
   void updateNickname(User* user, const std::string& oldNick,
                       const std::string& newNick);
 
+  // Set the network-wide id of a user (maintains the id index)
+  void setUid(User* user, const std::string& uid);
+
+  // MONITOR: user watches nickname (whether or not it is in use)
+  // Returns: false if user's list is full (kMaxMonitored)
+  bool addMonitor(User* user, const std::string& nickname);
+  void removeMonitor(User* user, const std::string& nickname);
+  void clearMonitors(User* user);
+  // Returns: The users watching nickname, NULL if none
+  const std::vector<User*>* getWatchers(const std::string& nickname) const;
+
  private:
   std::map<int, User*> users_;                // fd -> User*
-  std::map<std::string, User*> usersByNick_;  // nickname -> User*
+  CaseMappedMap<User*> usersByNick_;         // nickname -> User*
+  std::map<std::string, User*> usersByUid_;   // network-wide id -> User*
+  // Reverse index of the MONITOR lists: nickname -> users watching it
+  CaseMappedMap<std::vector<User*> > watchers_;
+  size_t remoteUserCount_;
 
   UserManager(const UserManager& src);             // = delete
   UserManager& operator=(const UserManager& src);  // = delete
@@ -45,7 +45,18 @@ std::string createLog(LogLevel level, LogCategory category,
 void log(LogLevel level, LogCategory category, const std::string& message);
 std::string createErrorMessage(const std::string& context, int errsv);
 std::string int_to_string(int value);
+
+// RFC1459 casemapping: A-Z and [\]^ are the upper case of a-z and {|}~
+char ircToLower(char c);
+bool ircCaseEqual(const std::string& a, const std::string& b);
+// Hash of the casemapped bytes (equal for ircCaseEqual strings)
+size_t ircCaseHash(const std::string& s);
 std::string normalizeNickname(const std::string& nickname);
 std::string normalizeChannelName(const std::string& channelName);
+// Wildcard match with casemapping: '*' any run of bytes, '?' one byte
+bool ircMatch(const std::string& mask, const std::string& name);
+
+// Seconds from an arbitrary fixed point (CLOCK_MONOTONIC), for durations
+double getMonotonicTime();
 
 #endif
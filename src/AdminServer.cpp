@@ -0,0 +1,344 @@
+#include "AdminServer.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "utils.hpp"
+
+AdminServer::AdminServer(EventLoop* eventLoop, const Metrics* metrics)
+    : eventLoop_(eventLoop), metrics_(metrics), listenFd_(INVALID_FD) {}
+
+AdminServer::~AdminServer() {
+  for (std::map<int, AdminConnection>::iterator it = connections_.begin();
+       it != connections_.end(); ++it) {
+    close(it->first);
+  }
+  if (listenFd_ != INVALID_FD) close(listenFd_);
+  if (!unixPath_.empty()) unlink(unixPath_.c_str());
+}
+
+void AdminServer::stop() {
+  while (!connections_.empty()) closeConnection(connections_.begin()->first);
+  if (listenFd_ == INVALID_FD) return;
+  eventLoop_->removeFd(listenFd_);
+  close(listenFd_);
+  listenFd_ = INVALID_FD;
+  if (!unixPath_.empty()) unlink(unixPath_.c_str());
+  unixPath_.clear();
+}
+
+// ==========================================
+// Setup
+// ==========================================
+
+void AdminServer::listen(const std::string& address) {
+  if (address.compare(0, 5, "unix:") == 0) {
+    listenUnix(address.substr(5));
+  } else {
+    listenTcp(address);
+  }
+}
+
+void AdminServer::listenUnix(const std::string& path) {
+  struct sockaddr_un addr;
+  if (path.empty() || path.length() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error("Invalid admin socket path: " + path);
+  }
+
+  listenFd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("socket", errsv));
+  }
+
+  // Remove a stale socket left behind by a previous run
+  unlink(path.c_str());
+
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.length());
+  if (bind(listenFd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("bind", errsv));
+  }
+  unixPath_ = path;
+  finishListen("unix:" + path);
+}
+
+void AdminServer::listenTcp(const std::string& portStr) {
+  if (portStr.empty() || portStr.length() > 5) {
+    throw std::runtime_error("Invalid admin port: " + portStr);
+  }
+  int port = 0;
+  for (size_t i = 0; i < portStr.length(); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(portStr[i])))
+      throw std::runtime_error("Invalid admin port: " + portStr);
+    port = port * 10 + (portStr[i] - '0');
+  }
+  if (port < 1 || port > 65535) {
+    throw std::runtime_error("Invalid admin port: " + portStr);
+  }
+
+  listenFd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("socket", errsv));
+  }
+
+  int opt = 1;
+  if (setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("setsockopt", errsv));
+  }
+
+  // Loopback only: the endpoint is unauthenticated
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (bind(listenFd_, reinterpret_cast<struct sockaddr*>(&addr),
+           sizeof(addr)) < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("bind", errsv));
+  }
+  finishListen("127.0.0.1:" + portStr);
+}
+
+void AdminServer::finishListen(const std::string& description) {
+  if (::listen(listenFd_, kMaxQueue) < 0) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("listen", errsv));
+  }
+  eventLoop_->addFd(listenFd_, EPOLLIN);
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Admin listener started on " + description);
+}
+
+// ==========================================
+// Event handling
+// ==========================================
+
+bool AdminServer::ownsFd(int fd) const {
+  if (listenFd_ == INVALID_FD) return false;
+  return fd == listenFd_ || connections_.find(fd) != connections_.end();
+}
+
+void AdminServer::handleEvent(int fd, uint32_t events) {
+  if (fd == listenFd_) {
+    if (events & EPOLLIN) acceptConnections();
+    return;
+  }
+
+  std::map<int, AdminConnection>::iterator it = connections_.find(fd);
+  if (it == connections_.end()) return;
+
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    closeConnection(fd);
+    return;
+  }
+  if (events & EPOLLIN) {
+    handleRead(fd, it->second);
+    // handleRead may have closed the connection
+    it = connections_.find(fd);
+    if (it == connections_.end()) return;
+  }
+  if ((events & EPOLLOUT) && it->second.responded) {
+    handleWrite(fd, it->second);
+  }
+}
+
+void AdminServer::acceptConnections() {
+  // Edge-triggered: accept all pending connections
+  while (true) {
+    int fd = accept4(listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+            createErrorMessage("accept4 (admin)", errno));
+      }
+      return;
+    }
+
+    // A connection being answered is about to close on its own
+    if (connections_.size() >= kMaxConnections) {
+      int idlest = getIdlestConnection(true);
+      if (idlest == INVALID_FD) {
+        log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+            "Too many admin connections, rejecting");
+        close(fd);
+        continue;
+      }
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+          "Too many admin connections, closing the idlest");
+      closeConnection(idlest);
+    }
+
+    try {
+      eventLoop_->addFd(fd, EPOLLIN);
+    } catch (const std::exception& e) {
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK, e.what());
+      close(fd);
+      continue;
+    }
+    connections_[fd] = AdminConnection();
+    connections_[fd].lastActivity = getMonotonicTime();
+  }
+}
+
+void AdminServer::runTimers() {
+  double deadline = getMonotonicTime() - kConnectionTimeout;
+  std::map<int, AdminConnection>::iterator it = connections_.begin();
+  while (it != connections_.end()) {
+    int fd = it->first;
+    bool expired = it->second.lastActivity <= deadline;
+    ++it;  // closeConnection() erases fd
+    if (expired) {
+      log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK, "Admin connection timed out");
+      closeConnection(fd);
+    }
+  }
+}
+
+int AdminServer::getTimeoutMs() const {
+  int idlest = getIdlestConnection(false);
+  if (idlest == INVALID_FD) return -1;
+  double remaining = connections_.find(idlest)->second.lastActivity +
+                     kConnectionTimeout - getMonotonicTime();
+  return remaining > 0 ? static_cast<int>(remaining * 1000) + 1 : 0;
+}
+
+int AdminServer::getIdlestConnection(bool pendingOnly) const {
+  int idlest = INVALID_FD;
+  double idlestTime = 0;
+  for (std::map<int, AdminConnection>::const_iterator it =
+           connections_.begin();
+       it != connections_.end(); ++it) {
+    if (pendingOnly && it->second.responded) continue;
+    if (idlest == INVALID_FD || it->second.lastActivity < idlestTime) {
+      idlest = it->first;
+      idlestTime = it->second.lastActivity;
+    }
+  }
+  return idlest;
+}
+
+void AdminServer::handleRead(int fd, AdminConnection& conn) {
+  char buffer[1024];
+
+  // Read all available data (edge-triggered mode)
+  while (true) {
+    ssize_t bytesRead = recv(fd, buffer, sizeof(buffer), 0);
+    if (bytesRead > 0) {
+      conn.lastActivity = getMonotonicTime();
+      if (conn.responded) continue;  // Ignore anything after the request
+      conn.readBuffer.append(buffer, bytesRead);
+      if (conn.readBuffer.size() > kMaxRequestSize) {
+        closeConnection(fd);
+        return;
+      }
+    } else if (bytesRead == 0) {
+      // Peer closed before (or right after) sending a full request
+      if (!conn.responded) closeConnection(fd);
+      return;
+    } else {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      closeConnection(fd);
+      return;
+    }
+  }
+
+  if (conn.responded) return;
+
+  // Wait for the end of the request headers
+  if (conn.readBuffer.find("\r\n\r\n") == std::string::npos &&
+      conn.readBuffer.find("\n\n") == std::string::npos) {
+    return;
+  }
+
+  size_t lineEnd = conn.readBuffer.find_first_of("\r\n");
+  conn.writeBuffer = buildResponse(conn.readBuffer.substr(0, lineEnd));
+  conn.readBuffer.clear();
+  conn.responded = true;
+
+  // Try to answer inline; EPOLLOUT is only armed if the socket is full
+  handleWrite(fd, conn);
+}
+
+void AdminServer::handleWrite(int fd, AdminConnection& conn) {
+  while (!conn.writeBuffer.empty()) {
+    ssize_t bytesSent = send(fd, conn.writeBuffer.data(),
+                             conn.writeBuffer.size(), MSG_NOSIGNAL);
+    if (bytesSent > 0) {
+      conn.lastActivity = getMonotonicTime();
+      conn.writeBuffer.erase(0, bytesSent);
+    } else if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Slow scraper: continue on the next writable event
+      eventLoop_->modifyFd(fd, EPOLLIN | EPOLLOUT);
+      return;
+    } else {
+      closeConnection(fd);
+      return;
+    }
+  }
+  closeConnection(fd);
+}
+
+void AdminServer::closeConnection(int fd) {
+  eventLoop_->removeFd(fd);
+  close(fd);
+  connections_.erase(fd);
+}
+
+// ==========================================
+// HTTP
+// ==========================================
+
+std::string AdminServer::buildResponse(const std::string& requestLine) const {
+  // Request line: <method> <target> <version>
+  size_t methodEnd = requestLine.find(' ');
+  std::string method = requestLine.substr(0, methodEnd);
+  std::string target;
+  if (methodEnd != std::string::npos) {
+    size_t targetEnd = requestLine.find(' ', methodEnd + 1);
+    target = requestLine.substr(methodEnd + 1, targetEnd == std::string::npos
+                                                   ? std::string::npos
+                                                   : targetEnd - methodEnd - 1);
+  }
+  // Ignore the query string
+  target = target.substr(0, target.find('?'));
+
+  std::string status;
+  std::string contentType = "text/plain; charset=utf-8";
+  std::string body;
+  if (method != "GET") {
+    status = "405 Method Not Allowed";
+    body = "Method not allowed\n";
+  } else if (target != "/metrics") {
+    status = "404 Not Found";
+    body = "Not found\n";
+  } else {
+    status = "200 OK";
+    contentType = "text/plain; version=0.0.4; charset=utf-8";
+    body = metrics_->render();
+  }
+
+  std::string response = "HTTP/1.1 " + status + "\r\n";
+  response += "Content-Type: " + contentType + "\r\n";
+  response += "Content-Length: " + int_to_string(body.size()) + "\r\n";
+  response += "Connection: close\r\n\r\n";
+  response += body;
+  return response;
+}
@@ -0,0 +1,75 @@
+#include "BinaryCodec.hpp"
+
+#include <stdexcept>
+#include <string>
+
+BinaryWriter::BinaryWriter() {}
+
+BinaryWriter::~BinaryWriter() {}
+
+void BinaryWriter::writeU8(uint8_t value) {
+  data_ += static_cast<char>(value);
+}
+
+void BinaryWriter::writeU32(uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    data_ += static_cast<char>((value >> shift) & 0xFF);
+  }
+}
+
+void BinaryWriter::writeU64(uint64_t value) {
+  writeU32(static_cast<uint32_t>(value & 0xFFFFFFFF));
+  writeU32(static_cast<uint32_t>(value >> 32));
+}
+
+void BinaryWriter::writeBool(bool value) { writeU8(value ? 1 : 0); }
+
+void BinaryWriter::writeString(const std::string& value) {
+  writeU32(static_cast<uint32_t>(value.size()));
+  data_ += value;
+}
+
+const std::string& BinaryWriter::getData() const { return data_; }
+
+BinaryReader::BinaryReader(const char* data, size_t size)
+    : data_(data), size_(size), offset_(0) {}
+
+BinaryReader::~BinaryReader() {}
+
+void BinaryReader::require(size_t length) const {
+  if (length > size_ - offset_) {
+    throw std::runtime_error("Binary record is truncated");
+  }
+}
+
+uint8_t BinaryReader::readU8() {
+  require(1);
+  return static_cast<uint8_t>(data_[offset_++]);
+}
+
+uint32_t BinaryReader::readU32() {
+  require(4);
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(data_[offset_++]))
+             << (8 * i);
+  }
+  return value;
+}
+
+uint64_t BinaryReader::readU64() {
+  uint64_t low = readU32();
+  return low | (static_cast<uint64_t>(readU32()) << 32);
+}
+
+bool BinaryReader::readBool() { return readU8() != 0; }
+
+std::string BinaryReader::readString() {
+  uint32_t length = readU32();
+  require(length);
+  std::string value(data_ + offset_, length);
+  offset_ += length;
+  return value;
+}
+
+bool BinaryReader::atEnd() const { return offset_ == size_; }
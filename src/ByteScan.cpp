@@ -0,0 +1,276 @@
+#include "ByteScan.hpp"
+
+#include <cstring>
+
+#include "utils.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// ==========================================
+// Scalar kernels (also the tails of the vector ones)
+// ==========================================
+
+size_t findCrlfScalar(const char* data, size_t length) {
+  for (size_t i = 0; i + 1 < length; ++i) {
+    if (data[i] == '\r' && data[i + 1] == '\n') return i;
+  }
+  return length;
+}
+
+size_t findForbiddenByteScalar(const char* data, size_t length) {
+  for (size_t i = 0; i < length; ++i) {
+    if (data[i] == '\0' || data[i] == '\r' || data[i] == '\n') return i;
+  }
+  return length;
+}
+
+void foldCaseScalar(char* data, size_t length) {
+  for (size_t i = 0; i < length; ++i) data[i] = ircToLower(data[i]);
+}
+
+#ifdef BYTESCAN_X86
+
+// Case folding adds 0x20 to the bytes 'A'..'^' (30 values): shifted by
+// 128 - 'A' they are the signed bytes below -98
+const char kFoldShift = static_cast<char>(128 - 'A');
+const char kFoldLimit = -98;
+
+// ==========================================
+// SSE2 kernels (16 bytes per step)
+// ==========================================
+
+__attribute__((target("sse2"))) size_t findCrlfSse2(const char* data,
+                                                    size_t length) {
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  size_t i = 0;
+  // The second load looks one byte ahead for the '\n'
+  for (; i + 17 <= length; i += 16) {
+    __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+    int mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(current, cr), _mm_cmpeq_epi8(next, lf)));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return i + findCrlfScalar(data + i, length - i);
+}
+
+__attribute__((target("sse2"))) size_t findForbiddenByteSse2(
+    const char* data, size_t length) {
+  const __m128i nul = _mm_setzero_si128();
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hits = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, nul),
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, cr), _mm_cmpeq_epi8(bytes, lf)));
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  return i + findForbiddenByteScalar(data + i, length - i);
+}
+
+__attribute__((target("sse2"))) void foldCaseSse2(char* data,
+                                                  size_t length) {
+  const __m128i shift = _mm_set1_epi8(kFoldShift);
+  const __m128i limit = _mm_set1_epi8(kFoldLimit);
+  const __m128i bit = _mm_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i* chunk = reinterpret_cast<__m128i*>(data + i);
+    __m128i bytes = _mm_loadu_si128(chunk);
+    __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(bytes, shift), limit);
+    _mm_storeu_si128(chunk,
+                     _mm_add_epi8(bytes, _mm_and_si128(upper, bit)));
+  }
+  foldCaseScalar(data + i, length - i);
+}
+
+// ==========================================
+// AVX2 kernels (32 bytes per step)
+// ==========================================
+
+__attribute__((target("avx2"))) size_t findCrlfAvx2(const char* data,
+                                                    size_t length) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 33 <= length; i += 32) {
+    __m256i current =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i next =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 1));
+    unsigned int mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(current, cr),
+                                              _mm256_cmpeq_epi8(next, lf))));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  // Tail in this function: calling the SSE2 kernel (legacy encoding) with
+  // dirty upper halves costs more than it saves
+  if (i + 17 <= length) {
+    __m128i current =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i next =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 1));
+    int mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(current, _mm256_castsi256_si128(cr)),
+                      _mm_cmpeq_epi8(next, _mm256_castsi256_si128(lf))));
+    if (mask != 0) return i + __builtin_ctz(mask);
+    i += 16;
+  }
+  return i + findCrlfScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2"))) size_t findForbiddenByteAvx2(
+    const char* data, size_t length) {
+  const __m256i nul = _mm256_setzero_si256();
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i bytes =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+    __m256i hits =
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, nul),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, cr),
+                                        _mm256_cmpeq_epi8(bytes, lf)));
+    unsigned int mask =
+        static_cast<unsigned int>(_mm256_movemask_epi8(hits));
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+  if (i + 16 <= length) {
+    __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    __m128i hits = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, _mm256_castsi256_si128(nul)),
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm256_castsi256_si128(cr)),
+                     _mm_cmpeq_epi8(bytes, _mm256_castsi256_si128(lf))));
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) return i + __builtin_ctz(mask);
+    i += 16;
+  }
+  return i + findForbiddenByteScalar(data + i, length - i);
+}
+
+__attribute__((target("avx2"))) void foldCaseAvx2(char* data,
+                                                  size_t length) {
+  const __m256i shift = _mm256_set1_epi8(kFoldShift);
+  const __m256i limit = _mm256_set1_epi8(kFoldLimit);
+  const __m256i bit = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i* chunk = reinterpret_cast<__m256i*>(data + i);
+    __m256i bytes = _mm256_loadu_si256(chunk);
+    __m256i upper =
+        _mm256_cmpgt_epi8(limit, _mm256_add_epi8(bytes, shift));
+    _mm256_storeu_si256(chunk,
+                        _mm256_add_epi8(bytes, _mm256_and_si256(upper, bit)));
+  }
+  if (i + 16 <= length) {
+    __m128i* chunk = reinterpret_cast<__m128i*>(data + i);
+    __m128i bytes = _mm_loadu_si128(chunk);
+    __m128i upper = _mm_cmplt_epi8(
+        _mm_add_epi8(bytes, _mm256_castsi256_si128(shift)),
+        _mm256_castsi256_si128(limit));
+    __m128i add = _mm_and_si128(upper, _mm256_castsi256_si128(bit));
+    _mm_storeu_si128(chunk, _mm_add_epi8(bytes, add));
+    i += 16;
+  }
+  foldCaseScalar(data + i, length - i);
+}
+
+#endif  // BYTESCAN_X86
+
+// ==========================================
+// Dispatch
+// ==========================================
+
+struct Kernels {
+  size_t (*findCrlf)(const char* data, size_t length);
+  size_t (*findForbiddenByte)(const char* data, size_t length);
+  void (*foldCase)(char* data, size_t length);
+};
+
+#ifdef BYTESCAN_X86
+const Kernels kKernels[] = {
+    {findCrlfScalar, findForbiddenByteScalar, foldCaseScalar},
+    {findCrlfSse2, findForbiddenByteSse2, foldCaseSse2},
+    {findCrlfAvx2, findForbiddenByteAvx2, foldCaseAvx2}};
+#else
+const Kernels kKernels[] = {
+    {findCrlfScalar, findForbiddenByteScalar, foldCaseScalar}};
+#endif
+
+ScanLevel detectScanLevel() {
+#ifdef BYTESCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return SCAN_LEVEL_AVX2;
+  if (__builtin_cpu_supports("sse2")) return SCAN_LEVEL_SSE2;
+#endif
+  return SCAN_LEVEL_SCALAR;
+}
+
+ScanLevel getSupportedLevel() {
+  static const ScanLevel supported = detectScanLevel();
+  return supported;
+}
+
+ScanLevel& currentLevel() {
+  static ScanLevel level = getSupportedLevel();
+  return level;
+}
+
+const Kernels& kernels() { return kKernels[currentLevel()]; }
+
+}  // namespace
+
+size_t findCrlf(const char* data, size_t length) {
+  return kernels().findCrlf(data, length);
+}
+
+size_t findForbiddenByte(const char* data, size_t length) {
+  return kernels().findForbiddenByte(data, length);
+}
+
+void foldCase(char* data, size_t length) {
+  kernels().foldCase(data, length);
+}
+
+size_t removeByte(char* data, size_t length, char byte) {
+  // memchr is already vectorized by the C library; most buffers have none
+  char* found = static_cast<char*>(std::memchr(data, byte, length));
+  if (!found) return length;
+  char* out = found;
+  for (char* in = found + 1; in < data + length; ++in) {
+    if (*in != byte) *out++ = *in;
+  }
+  return out - data;
+}
+
+ScanLevel getScanLevel() { return currentLevel(); }
+
+const char* getScanLevelName(ScanLevel level) {
+  switch (level) {
+    case SCAN_LEVEL_SSE2:
+      return "sse2";
+    case SCAN_LEVEL_AVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+ScanLevel setScanLevel(ScanLevel level) {
+  currentLevel() = level > getSupportedLevel() ? getSupportedLevel() : level;
+  return currentLevel();
+}
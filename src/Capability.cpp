@@ -0,0 +1,43 @@
+#include "Capability.hpp"
+
+#include <string>
+
+namespace {
+struct CapabilityEntry {
+  Capability cap;
+  const char* name;
+};
+
+// The registry: add an entry to offer a capability
+const CapabilityEntry kCapabilities[] = {
+    {CAP_MESSAGE_TAGS, "message-tags"},
+    {CAP_ECHO_MESSAGE, "echo-message"},
+    {CAP_SERVER_TIME, "server-time"},
+    {CAP_BATCH, "batch"},
+};
+const size_t kCapabilityCount =
+    sizeof(kCapabilities) / sizeof(kCapabilities[0]);
+}  // namespace
+
+unsigned allCapabilities() {
+  unsigned caps = 0;
+  for (size_t i = 0; i < kCapabilityCount; ++i) caps |= kCapabilities[i].cap;
+  return caps;
+}
+
+unsigned findCapability(const std::string& name) {
+  for (size_t i = 0; i < kCapabilityCount; ++i) {
+    if (name == kCapabilities[i].name) return kCapabilities[i].cap;
+  }
+  return 0;
+}
+
+std::string capabilityNames(unsigned caps) {
+  std::string names;
+  for (size_t i = 0; i < kCapabilityCount; ++i) {
+    if (!(caps & kCapabilities[i].cap)) continue;
+    if (!names.empty()) names += ' ';
+    names += kCapabilities[i].name;
+  }
+  return names;
+}
@@ -12,6 +12,30 @@
 
 #include "Channel.hpp"
 
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace {
+// Entries for users that went away are only replaced: bound the cache
+const size_t kMaxBanCache = 1024;
+
+bool matchesAny(const std::vector<MaskEntry>& masks,
+                const std::string& target) {
+  for (size_t i = 0; i < masks.size(); ++i) {
+    if (masks[i].mask.matches(target)) return true;
+  }
+  return false;
+}
+}  // namespace
+
+MaskEntry::MaskEntry(const Hostmask& mask, const std::string& setBy,
+                     long setAt)
+    : mask(mask), setBy(setBy), setAt(setAt) {}
+
 Channel::Channel(const std::string& name)
     : name_(name),
       inviteOnly_(false),
@@ -30,6 +54,8 @@ const std::set<int>& Channel::getMembers() const { return members_; }
 
 const std::set<int>& Channel::getOperators() const { return operators_; }
 
+const std::set<int>& Channel::getInvited() const { return invited_; }
+
 bool Channel::isInviteOnly() const { return inviteOnly_; }
 
 bool Channel::isTopicRestricted() const { return topicRestricted_; }
@@ -95,3 +121,59 @@ void Channel::removeInvite(int userFd) { invited_.erase(userFd); }
 bool Channel::isInvited(int userFd) const {
   return invited_.find(userFd) != invited_.end();
 }
+
+// Mask lists
+bool Channel::addMask(MaskList list, const std::string& mask,
+                      const std::string& setBy, long setAt) {
+  std::vector<MaskEntry>& masks = masks_[list];
+  if (masks.size() >= kMaxMasks) return false;
+  Hostmask compiled(mask);
+  for (size_t i = 0; i < masks.size(); ++i) {
+    if (ircCaseEqual(masks[i].mask.getMask(), compiled.getMask())) {
+      return false;
+    }
+  }
+  masks.push_back(MaskEntry(compiled, setBy, setAt));
+  if (list != MASK_LIST_INVITE_EXCEPTION) banCache_.clear();
+  return true;
+}
+
+bool Channel::removeMask(MaskList list, const std::string& mask) {
+  std::vector<MaskEntry>& masks = masks_[list];
+  std::string normalized = Hostmask::normalize(mask);
+  for (size_t i = 0; i < masks.size(); ++i) {
+    if (ircCaseEqual(masks[i].mask.getMask(), normalized)) {
+      masks.erase(masks.begin() + i);
+      if (list != MASK_LIST_INVITE_EXCEPTION) banCache_.clear();
+      return true;
+    }
+  }
+  return false;
+}
+
+const std::vector<MaskEntry>& Channel::getMasks(MaskList list) const {
+  return masks_[list];
+}
+
+bool Channel::isBanned(const User* user) {
+  if (masks_[MASK_LIST_BAN].empty()) return false;
+  int id = user->getSocketFd();
+  std::map<int, std::pair<unsigned long, bool> >::iterator it =
+      banCache_.find(id);
+  if (it != banCache_.end() && it->second.first == user->getIdentity()) {
+    return it->second.second;
+  }
+  std::string target = Hostmask::makeTarget(user);
+  bool banned = matchesAny(masks_[MASK_LIST_BAN], target) &&
+                !matchesAny(masks_[MASK_LIST_EXCEPTION], target);
+  if (it == banCache_.end() && banCache_.size() >= kMaxBanCache) {
+    banCache_.clear();
+  }
+  banCache_[id] = std::make_pair(user->getIdentity(), banned);
+  return banned;
+}
+
+bool Channel::isInviteException(const User* user) const {
+  const std::vector<MaskEntry>& masks = masks_[MASK_LIST_INVITE_EXCEPTION];
+  return !masks.empty() && matchesAny(masks, Hostmask::makeTarget(user));
+}
@@ -0,0 +1,193 @@
+#include "ChannelHistory.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+// Longest msgid and text kept (a line is at most 512 bytes anyway)
+const size_t kMaxFieldLength = 0xffff;
+
+// Shorter first, then bytewise: the order of hex numbers without leading
+// zeros
+int compareShortlex(const std::string& a, size_t aPos, size_t aLength,
+                    const std::string& b, size_t bPos, size_t bLength) {
+  if (aLength != bLength) return aLength < bLength ? -1 : 1;
+  return a.compare(aPos, aLength, b, bPos, bLength);
+}
+}  // namespace
+
+int compareMsgIds(const std::string& a, const std::string& b) {
+  // A msgid without a '-' (not ours) is all prefix
+  size_t aDash = std::min(a.find('-'), a.length());
+  size_t bDash = std::min(b.find('-'), b.length());
+  int order = compareShortlex(a, 0, aDash, b, 0, bDash);
+  if (order != 0) return order;
+  return compareShortlex(a, aDash, a.length() - aDash, b, bDash,
+                         b.length() - bDash);
+}
+
+int compareToRef(const HistoryMessage& message, const HistoryRef& ref) {
+  if (ref.byMsgId) return compareMsgIds(message.msgid, ref.msgid);
+  if (message.time == ref.time) return 0;
+  return message.time < ref.time ? -1 : 1;
+}
+
+ChannelHistory::ChannelHistory(const std::string& channel)
+    : channel_(channel), arenaStart_(0), bytes_(0) {}
+
+ChannelHistory::~ChannelHistory() {}
+
+const std::string& ChannelHistory::getChannel() const { return channel_; }
+
+size_t ChannelHistory::size() const { return entries_.size(); }
+
+bool ChannelHistory::empty() const { return entries_.empty(); }
+
+size_t ChannelHistory::getBytes() const { return bytes_; }
+
+long ChannelHistory::getOldestTime() const { return entries_.front().time; }
+
+size_t ChannelHistory::append(long time, const std::string& source,
+                              const std::string& msgid,
+                              const std::string& text) {
+  size_t grown = 0;
+  Entry entry;
+  entry.time = entries_.empty() ? time : std::max(time, entries_.back().time);
+  entry.source = internSource(source, &grown);
+  entry.offset = arena_.size();
+  entry.msgidLength =
+      static_cast<unsigned short>(std::min(msgid.length(), kMaxFieldLength));
+  entry.textLength =
+      static_cast<unsigned short>(std::min(text.length(), kMaxFieldLength));
+  arena_.append(msgid, 0, entry.msgidLength);
+  arena_.append(text, 0, entry.textLength);
+  entries_.push_back(entry);
+  grown += sizeof(Entry) + entry.msgidLength + entry.textLength;
+  bytes_ += grown;
+  return grown;
+}
+
+size_t ChannelHistory::evictOldest() {
+  const Entry& oldest = entries_.front();
+  size_t length = oldest.msgidLength + oldest.textLength;
+  size_t freed = sizeof(Entry) + length + releaseSource(oldest.source);
+  arenaStart_ = oldest.offset + length;
+  entries_.pop_front();
+  bytes_ -= freed;
+
+  if (entries_.empty()) {
+    arena_.clear();
+    arenaStart_ = 0;
+  } else if (arenaStart_ * 2 > arena_.size()) {
+    arena_.erase(0, arenaStart_);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      entries_[i].offset -= arenaStart_;
+    }
+    arenaStart_ = 0;
+  }
+  return freed;
+}
+
+HistoryMessage ChannelHistory::get(size_t index) const {
+  const Entry& entry = entries_[index];
+  HistoryMessage message;
+  message.time = entry.time;
+  message.source = sources_[entry.source].name;
+  message.msgid = arena_.substr(entry.offset, entry.msgidLength);
+  message.text =
+      arena_.substr(entry.offset + entry.msgidLength, entry.textLength);
+  return message;
+}
+
+size_t ChannelHistory::lowerBound(long time) const {
+  size_t low = 0;
+  size_t high = entries_.size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (entries_[middle].time < time) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+size_t ChannelHistory::upperBound(long time) const {
+  return time == LONG_MAX ? entries_.size() : lowerBound(time + 1);
+}
+
+size_t ChannelHistory::find(const std::string& msgid) const {
+  size_t index = lowerBoundMsgId(msgid);
+  if (index == entries_.size()) return index;
+  const Entry& entry = entries_[index];
+  if (entry.msgidLength == msgid.length() &&
+      arena_.compare(entry.offset, entry.msgidLength, msgid) == 0) {
+    return index;
+  }
+  return entries_.size();
+}
+
+size_t ChannelHistory::lowerBound(const HistoryRef& ref) const {
+  return ref.byMsgId ? lowerBoundMsgId(ref.msgid) : lowerBound(ref.time);
+}
+
+size_t ChannelHistory::upperBound(const HistoryRef& ref) const {
+  if (!ref.byMsgId) return upperBound(ref.time);
+  size_t index = find(ref.msgid);
+  return index < entries_.size() ? index + 1 : lowerBoundMsgId(ref.msgid);
+}
+
+size_t ChannelHistory::lowerBoundMsgId(const std::string& msgid) const {
+  size_t low = 0;
+  size_t high = entries_.size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    const Entry& entry = entries_[middle];
+    int order = entry.msgidLength == msgid.length()
+                    ? arena_.compare(entry.offset, entry.msgidLength, msgid)
+                    : (entry.msgidLength < msgid.length() ? -1 : 1);
+    if (order < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+unsigned ChannelHistory::internSource(const std::string& name,
+                                      size_t* grown) {
+  std::map<std::string, unsigned>::iterator it = sourceIndex_.find(name);
+  if (it != sourceIndex_.end()) {
+    ++sources_[it->second].refs;
+    return it->second;
+  }
+  unsigned index;
+  if (freeSources_.empty()) {
+    index = static_cast<unsigned>(sources_.size());
+    sources_.push_back(Source());
+  } else {
+    index = freeSources_.back();
+    freeSources_.pop_back();
+  }
+  sources_[index].name = name;
+  sources_[index].refs = 1;
+  sourceIndex_[name] = index;
+  *grown += sizeof(Source) + 2 * name.length();  // The table and the index
+  return index;
+}
+
+size_t ChannelHistory::releaseSource(unsigned index) {
+  Source& source = sources_[index];
+  if (--source.refs > 0) return 0;
+  size_t freed = sizeof(Source) + 2 * source.name.length();
+  sourceIndex_.erase(source.name);
+  std::string().swap(source.name);
+  freeSources_.push_back(index);
+  return freed;
+}
@@ -7,9 +7,6 @@ ChannelManager::ChannelManager() {}
 ChannelManager::~ChannelManager() { removeAll(); }
 
 Channel* ChannelManager::createChannel(const std::string& name) {
-  // Normalize channel name (case-insensitive per RFC1459)
-  std::string normalizedName = normalizeChannelName(name);
-
   // Check if channel already exists
   if (channelExists(name)) {
     log(LOG_LEVEL_WARNING, LOG_CATEGORY_CHANNEL,
@@ -18,11 +15,11 @@ Channel* ChannelManager::createChannel(const std::string& name) {
   }
 
   // Create new channel with exception safety
-  // Store with original name but index with normalized name
+  // Indexed case-insensitively per RFC1459
   Channel* newChannel = NULL;
   try {
     newChannel = new Channel(name);
-    channels_[normalizedName] = newChannel;
+    channels_.set(name, newChannel);
   } catch (...) {
     delete newChannel;  // NULL-safe in C++
     throw;
@@ -33,22 +30,21 @@ Channel* ChannelManager::createChannel(const std::string& name) {
 }
 
 void ChannelManager::removeChannel(const std::string& name) {
-  std::string normalizedName = normalizeChannelName(name);
-  std::map<std::string, Channel*>::iterator it = channels_.find(normalizedName);
-  if (it == channels_.end()) {
+  Channel** channel = channels_.find(name);
+  if (!channel) {
     log(LOG_LEVEL_WARNING, LOG_CATEGORY_CHANNEL,
         "Attempted to remove non-existent channel: " + name);
     return;
   }
 
-  delete it->second;
-  channels_.erase(it);
+  delete *channel;
+  channels_.erase(name);
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL, "Channel removed: " + name);
 }
 
 void ChannelManager::removeAll() {
-  for (std::map<std::string, Channel*>::iterator it = channels_.begin();
+  for (CaseMappedMap<Channel*>::const_iterator it = channels_.begin();
        it != channels_.end(); ++it) {
     delete it->second;
   }
@@ -56,17 +52,14 @@ void ChannelManager::removeAll() {
 }
 
 Channel* ChannelManager::getChannel(const std::string& name) {
-  std::string normalizedName = normalizeChannelName(name);
-  std::map<std::string, Channel*>::iterator it = channels_.find(normalizedName);
-  if (it == channels_.end()) return NULL;
-  return it->second;
+  Channel** channel = channels_.find(name);
+  return channel ? *channel : NULL;
 }
 
-const std::map<std::string, Channel*>& ChannelManager::getChannels() const {
+const CaseMappedMap<Channel*>& ChannelManager::getChannels() const {
   return channels_;
 }
 
 bool ChannelManager::channelExists(const std::string& name) const {
-  std::string normalizedName = normalizeChannelName(name);
-  return channels_.find(normalizedName) != channels_.end();
+  return channels_.find(name) != NULL;
 }
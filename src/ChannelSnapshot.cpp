@@ -0,0 +1,196 @@
+#include "ChannelSnapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BinaryCodec.hpp"
+#include "utils.hpp"
+
+namespace {
+const uint32_t kSnapshotMagic = 0x53435249;  // "IRCS"
+// Version 2 added the mask lists, version 3 dropped the operator nicknames;
+// older files are still read
+const uint32_t kSnapshotVersion = 3;
+
+// Close a file descriptor and unmap a mapping on scope exit
+class FileMapping {
+ public:
+  FileMapping() : fd(-1), data(MAP_FAILED), size(0) {}
+  ~FileMapping() {
+    if (data != MAP_FAILED) munmap(data, size);
+    if (fd >= 0) close(fd);
+  }
+
+  int fd;
+  void* data;
+  size_t size;
+
+ private:
+  FileMapping(const FileMapping& src);             // = delete
+  FileMapping& operator=(const FileMapping& src);  // = delete
+};
+
+void restoreChannel(BinaryReader& reader, ChannelManager& channelManager,
+                    uint32_t version) {
+  std::string name = reader.readString();
+  Channel* channel = channelManager.createChannel(name);
+  if (!channel) {
+    throw std::runtime_error("Channel snapshot: duplicate channel " + name);
+  }
+  channel->setTopic(reader.readString());
+  std::string key = reader.readString();
+  if (!key.empty()) channel->setKey(key);
+  channel->setInviteOnly(reader.readBool());
+  channel->setTopicRestricted(reader.readBool());
+  bool hasUserLimit = reader.readBool();
+  uint32_t userLimit = reader.readU32();
+  if (hasUserLimit) channel->setUserLimit(userLimit);
+  if (version < 3) {
+    // Operator nicknames: a nickname proves nothing, they are ignored
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      reader.readString();
+    }
+  }
+  if (version >= 2) ChannelSnapshot::readMasks(reader, channel);
+}
+}  // namespace
+
+std::string ChannelSnapshot::encode(const ChannelManager& channelManager) {
+  BinaryWriter writer;
+  writer.writeU32(kSnapshotMagic);
+  writer.writeU32(kSnapshotVersion);
+
+  const CaseMappedMap<Channel*>& channels =
+      channelManager.getChannels();
+  writer.writeU32(static_cast<uint32_t>(channels.size()));
+  for (CaseMappedMap<Channel*>::const_iterator it = channels.begin();
+       it != channels.end(); ++it) {
+    const Channel* channel = it->second;
+    writer.writeString(channel->getName());
+    writer.writeString(channel->getTopic());
+    writer.writeString(channel->getKey());
+    writer.writeBool(channel->isInviteOnly());
+    writer.writeBool(channel->isTopicRestricted());
+    writer.writeBool(channel->hasUserLimit());
+    writer.writeU32(static_cast<uint32_t>(channel->getUserLimit()));
+    writeMasks(writer, channel);
+  }
+  return writer.getData();
+}
+
+void ChannelSnapshot::write(const std::string& path, const std::string& data) {
+  // Unique per process: the snapshot of an old process during an upgrade
+  // may still be running
+  std::string tmpPath = path + ".tmp." + int_to_string(getpid());
+  int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0600);
+  if (fd < 0) {
+    throw std::runtime_error(createErrorMessage("open", errno) + " (" +
+                             tmpPath + ")");
+  }
+
+  const char* cursor = data.data();
+  size_t remaining = data.size();
+  while (remaining > 0) {
+    ssize_t written = ::write(fd, cursor, remaining);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      int errsv = errno;
+      close(fd);
+      unlink(tmpPath.c_str());
+      throw std::runtime_error(createErrorMessage("write", errsv));
+    }
+    cursor += written;
+    remaining -= written;
+  }
+
+  // The data must be on disk before the rename makes it the snapshot,
+  // otherwise a crash could leave an empty file behind
+  if (fsync(fd) < 0) {
+    int errsv = errno;
+    close(fd);
+    unlink(tmpPath.c_str());
+    throw std::runtime_error(createErrorMessage("fsync", errsv));
+  }
+  close(fd);
+  if (rename(tmpPath.c_str(), path.c_str()) < 0) {
+    int errsv = errno;
+    unlink(tmpPath.c_str());
+    throw std::runtime_error(createErrorMessage("rename", errsv));
+  }
+}
+
+size_t ChannelSnapshot::restore(const std::string& path,
+                                ChannelManager& channelManager) {
+  FileMapping file;
+  file.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (file.fd < 0) {
+    if (errno == ENOENT) return 0;
+    throw std::runtime_error(createErrorMessage("open", errno) + " (" + path +
+                             ")");
+  }
+  struct stat st;
+  if (fstat(file.fd, &st) < 0) {
+    throw std::runtime_error(createErrorMessage("fstat", errno));
+  }
+  if (st.st_size == 0) {
+    throw std::runtime_error("Channel snapshot: empty file");
+  }
+
+  // Read in place: no copy of the file into a buffer
+  file.size = static_cast<size_t>(st.st_size);
+  file.data = mmap(NULL, file.size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+  if (file.data == MAP_FAILED) {
+    throw std::runtime_error(createErrorMessage("mmap", errno));
+  }
+
+  BinaryReader reader(static_cast<const char*>(file.data), file.size);
+  if (reader.readU32() != kSnapshotMagic) {
+    throw std::runtime_error("Channel snapshot: not a snapshot file");
+  }
+  uint32_t version = reader.readU32();
+  if (version < 1 || version > kSnapshotVersion) {
+    throw std::runtime_error("Channel snapshot: unsupported version");
+  }
+  uint32_t channelCount = reader.readU32();
+  for (uint32_t i = 0; i < channelCount; ++i) {
+    restoreChannel(reader, channelManager, version);
+  }
+  if (!reader.atEnd()) {
+    throw std::runtime_error("Channel snapshot: trailing data");
+  }
+  return channelCount;
+}
+
+void ChannelSnapshot::writeMasks(BinaryWriter& writer, const Channel* channel) {
+  for (int list = 0; list < MASK_LIST_COUNT; ++list) {
+    const std::vector<MaskEntry>& masks =
+        channel->getMasks(static_cast<MaskList>(list));
+    writer.writeU32(static_cast<uint32_t>(masks.size()));
+    for (size_t i = 0; i < masks.size(); ++i) {
+      writer.writeString(masks[i].mask.getMask());
+      writer.writeString(masks[i].setBy);
+      writer.writeU32(static_cast<uint32_t>(masks[i].setAt));
+    }
+  }
+}
+
+void ChannelSnapshot::readMasks(BinaryReader& reader, Channel* channel) {
+  for (int list = 0; list < MASK_LIST_COUNT; ++list) {
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      std::string mask = reader.readString();
+      std::string setBy = reader.readString();
+      long setAt = static_cast<long>(reader.readU32());
+      channel->addMask(static_cast<MaskList>(list), mask, setBy, setAt);
+    }
+  }
+}
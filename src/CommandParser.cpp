@@ -6,8 +6,16 @@
 #include <string>
 #include <vector>
 
+#include "ByteScan.hpp"
 #include "utils.hpp"
 
+namespace {
+// Longest @tags section, '@' and the space after it included (IRCv3)
+const size_t kMaxTagsLength = 8191;
+// Longest message after the tags (510 chars max per RFC1459)
+const size_t kMaxMessageLength = 510;
+}  // namespace
+
 CommandParser::CommandParser() {}
 
 CommandParser::~CommandParser() {}
@@ -26,91 +34,213 @@ static size_t skipSpaces(const std::string& str, size_t pos) {
 }
 
 // Helper: Validate command format (letters or 3 digits)
-static void validateCommand(const std::string& command) {
-  if (command.empty()) {
-    throw std::runtime_error("Invalid message: No command found.");
-  }
+static ParseResult validateCommand(const std::string& command) {
+  if (command.empty()) return PARSE_ERROR_NO_COMMAND;
 
   // Check for 3-digit numeric command (e.g., "001")
   if (command.length() == 3 &&
       std::isdigit(static_cast<unsigned char>(command[0])) &&
       std::isdigit(static_cast<unsigned char>(command[1])) &&
       std::isdigit(static_cast<unsigned char>(command[2]))) {
-    return;
+    return PARSE_OK;
   }
 
   // Check for alphabetic command
   for (size_t i = 0; i < command.length(); ++i) {
     if (!std::isalpha(static_cast<unsigned char>(command[i]))) {
-      throw std::runtime_error(
-          "Invalid message: Command must be <letter> { <letter> } | <number> "
-          "<number> <number>.");
+      return PARSE_ERROR_BAD_COMMAND;
     }
   }
+  return PARSE_OK;
 }
 
-// Helper: Validate parameters
-static void validateParams(const std::vector<std::string>& params) {
-  if (params.size() > 15) {
-    throw std::runtime_error("Invalid message: Too many params (max 15).");
+// Helper: Validate a tag key: ['+'] [vendor '/'] name, where the vendor is
+// a host name and the name letters, digits and '-'
+static bool isValidTagKey(const char* key, size_t length) {
+  size_t i = (length > 0 && key[0] == '+') ? 1 : 0;
+  if (i == length) return false;
+  for (; i < length; ++i) {
+    unsigned char c = static_cast<unsigned char>(key[i]);
+    if (!std::isalnum(c) && c != '-' && c != '.' && c != '/') return false;
+  }
+  return key[length - 1] != '/';
+}
+
+// Helper: Split the tags section (between '@' and the space) into spans of
+// the line
+static ParseResult parseTags(const char* tags, size_t length,
+                             std::vector<MessageTag>& out) {
+  if (findForbiddenByte(tags, length) != length) return PARSE_ERROR_BAD_TAG;
+  const char* end = tags + length;
+  while (tags < end) {
+    const char* tagEnd = std::find(tags, end, ';');
+    const char* equals = std::find(tags, tagEnd, '=');
+    MessageTag tag;
+    tag.key = tags;
+    tag.keyLength = equals - tags;
+    tag.value = equals == tagEnd ? tagEnd : equals + 1;
+    tag.valueLength = tagEnd - tag.value;
+    if (!isValidTagKey(tag.key, tag.keyLength)) return PARSE_ERROR_BAD_TAG;
+    out.push_back(tag);
+    tags = tagEnd == end ? end : tagEnd + 1;
   }
+  return out.empty() ? PARSE_ERROR_BAD_TAG : PARSE_OK;
+}
+
+// Helper: Validate parameters
+static ParseResult validateParams(const std::vector<std::string>& params) {
+  if (params.size() > 15) return PARSE_ERROR_TOO_MANY_PARAMS;
 
   for (size_t i = 0; i < params.size(); ++i) {
     const std::string& param = params[i];
-    if (param.find('\0') != std::string::npos) {
-      throw std::runtime_error("Invalid message: Parameter contains NUL.");
+    // One vector scan for the common case of a clean parameter
+    if (findForbiddenByte(param.data(), param.length()) == param.length()) {
+      continue;
     }
-    if (param.find('\r') != std::string::npos) {
-      throw std::runtime_error("Invalid message: Parameter contains CR.");
+    if (param.find('\0') != std::string::npos) return PARSE_ERROR_NUL;
+    if (param.find('\r') != std::string::npos) return PARSE_ERROR_CR;
+    return PARSE_ERROR_LF;
+  }
+  return PARSE_OK;
+}
+
+const char* CommandParser::getErrorMessage(ParseResult result) {
+  switch (result) {
+    case PARSE_OK:
+      return "No error.";
+    case PARSE_ERROR_EMPTY:
+      return "Invalid message: Message is empty.";
+    case PARSE_ERROR_TOO_LONG:
+      return "Invalid message: 510 characters maximum allowed for the "
+             "command and its parameters.";
+    case PARSE_ERROR_TAGS_TOO_LONG:
+      return "Invalid message: 8191 bytes maximum allowed for the tags.";
+    case PARSE_ERROR_BAD_TAG:
+      return "Invalid message: Tags must be <key> [ '=' <value> ] { ';' "
+             "<key> [ '=' <value> ] }.";
+    case PARSE_ERROR_LEADING_SPACE:
+      return "Invalid message: Message must not start with space.";
+    case PARSE_ERROR_EMPTY_PREFIX:
+      return "Invalid message: Prefix must not be empty or start with space.";
+    case PARSE_ERROR_PREFIX_ONLY:
+      return "Invalid message: Prefix found but no command.";
+    case PARSE_ERROR_NO_COMMAND:
+      return "Invalid message: No command found.";
+    case PARSE_ERROR_BAD_COMMAND:
+      return "Invalid message: Command must be <letter> { <letter> } | "
+             "<number> <number> <number>.";
+    case PARSE_ERROR_TOO_MANY_PARAMS:
+      return "Invalid message: Too many params (max 15).";
+    case PARSE_ERROR_NUL:
+      return "Invalid message: Parameter contains NUL.";
+    case PARSE_ERROR_CR:
+      return "Invalid message: Parameter contains CR.";
+    case PARSE_ERROR_LF:
+      return "Invalid message: Parameter contains LF.";
+  }
+  return "Invalid message.";
+}
+
+const MessageTag* CommandParser::findTag(const Command& cmd,
+                                        const std::string& key) {
+  for (size_t i = cmd.tags.size(); i > 0; --i) {
+    const MessageTag& tag = cmd.tags[i - 1];
+    if (key.compare(0, std::string::npos, tag.key, tag.keyLength) == 0) {
+      return &tag;
     }
-    if (param.find('\n') != std::string::npos) {
-      throw std::runtime_error("Invalid message: Parameter contains LF.");
+  }
+  return NULL;
+}
+
+std::string CommandParser::getClientTags(const Command& cmd) {
+  std::string tags;
+  for (size_t i = 0; i < cmd.tags.size(); ++i) {
+    const MessageTag& tag = cmd.tags[i];
+    if (tag.key[0] != '+') continue;
+    if (!tags.empty()) tags += ';';
+    tags.append(tag.key, tag.keyLength);
+    if (tag.valueLength > 0) {
+      tags += '=';
+      tags.append(tag.value, tag.valueLength);
     }
   }
+  return tags;
+}
+
+std::string CommandParser::unescapeTagValue(const MessageTag& tag) {
+  std::string value;
+  value.reserve(tag.valueLength);
+  for (size_t i = 0; i < tag.valueLength; ++i) {
+    char c = tag.value[i];
+    if (c != '\\') {
+      value += c;
+      continue;
+    }
+    if (++i == tag.valueLength) break;  // Trailing lone backslash: dropped
+    switch (tag.value[i]) {
+      case ':':
+        value += ';';
+        break;
+      case 's':
+        value += ' ';
+        break;
+      case 'r':
+        value += '\r';
+        break;
+      case 'n':
+        value += '\n';
+        break;
+      default:  // Backslash, or unknown escape: the escaping one is dropped
+        value += tag.value[i];
+    }
+  }
+  return value;
 }
 
-// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
 Command CommandParser::parseCommand(const std::string& message) {
   Command cmd;
+  ParseResult result = parse(message, cmd);
+  if (result != PARSE_OK) throw std::runtime_error(getErrorMessage(result));
+  return cmd;
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+ParseResult CommandParser::parse(const std::string& message, Command& cmd) {
   size_t pos = 0;
 
   // Validate message not empty
-  if (message.empty()) {
-    throw std::runtime_error("Invalid message: Message is empty.");
+  if (message.empty()) return PARSE_ERROR_EMPTY;
+
+  // Parse optional IRCv3 tags: spans of message, nothing is copied
+  if (message[0] == '@') {
+    size_t spacePos = message.find(' ');
+    if (spacePos == std::string::npos) return PARSE_ERROR_NO_COMMAND;
+    if (spacePos + 1 > kMaxTagsLength) return PARSE_ERROR_TAGS_TOO_LONG;
+    ParseResult result =
+        parseTags(message.data() + 1, spacePos - 1, cmd.tags);
+    if (result != PARSE_OK) return result;
+    pos = skipSpaces(message, spacePos);
+    if (pos >= message.length()) return PARSE_ERROR_NO_COMMAND;
   }
 
   // Validate message length (510 chars max per RFC1459)
-  if (message.length() > 510) {
-    throw std::runtime_error(
-        "Invalid message: 510 characters maximum allowed for the command and "
-        "its parameters.");
-  }
+  if (message.length() - pos > kMaxMessageLength) return PARSE_ERROR_TOO_LONG;
 
   // Validate message doesn't start with space
-  if (message[0] == ' ') {
-    throw std::runtime_error(
-        "Invalid message: Message must not start with space.");
-  }
+  if (message[0] == ' ') return PARSE_ERROR_LEADING_SPACE;
 
   // Parse optional prefix (messages from clients usually don't have prefix)
   if (message[pos] == ':') {
     ++pos;
     size_t spacePos = message.find(' ', pos);
-    if (spacePos == std::string::npos) {
-      throw std::runtime_error("Invalid message: Prefix found but no command.");
-    }
+    if (spacePos == std::string::npos) return PARSE_ERROR_PREFIX_ONLY;
+    if (spacePos == pos) return PARSE_ERROR_EMPTY_PREFIX;
     cmd.prefix = message.substr(pos, spacePos - pos);
-    if (cmd.prefix.empty()) {
-      throw std::runtime_error(
-          "Invalid message: Prefix must not be empty or start with space.");
-    }
     pos = skipSpaces(message, spacePos);
   }
 
   // Validate command exists
-  if (pos >= message.length()) {
-    throw std::runtime_error("Invalid message: No command found.");
-  }
+  if (pos >= message.length()) return PARSE_ERROR_NO_COMMAND;
 
   // Parse command
   size_t cmdEnd = pos;
@@ -119,7 +249,8 @@ Command CommandParser::parseCommand(const std::string& message) {
   }
 
   cmd.command = message.substr(pos, cmdEnd - pos);
-  validateCommand(cmd.command);
+  ParseResult result = validateCommand(cmd.command);
+  if (result != PARSE_OK) return result;
 
   // Convert command to uppercase for case-insensitive matching
   for (size_t i = 0; i < cmd.command.length(); ++i) {
@@ -148,7 +279,5 @@ Command CommandParser::parseCommand(const std::string& message) {
   }
 
   // Validate parameters
-  validateParams(cmd.params);
-
-  return cmd;
+  return validateParams(cmd.params);
 }
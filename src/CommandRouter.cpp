@@ -1,18 +1,103 @@
 #include "CommandRouter.hpp"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "Capability.hpp"
+#include "LinkManager.hpp"
 #include "utils.hpp"
 
+namespace {
+// Malformed lines are counted per client in windows of this many seconds
+const double kMalformedWindow = 10.0;
+// Malformed lines per window that are still answered and logged
+const int kMalformedReplies = 5;
+// Longest line sent to a client, CRLF included (RFC1459)
+const size_t kMaxLineLength = 512;
+// LIST and WHO output stops while the write buffer holds this many bytes
+// and resumes once it has been sent (see CommandRouter::continueReply())
+const size_t kReplyHighWater = 8192;
+// Messages kept per channel for CHATHISTORY, and sent for one query at most
+const size_t kMaxHistoryMessages = 1000;
+const size_t kMaxChatHistory = 100;
+// BATCH type of the lines answering a JOIN (vendor-specific, there is no
+// standard one)
+const char kJoinBatch[] = "ft_irc/join";
+// Longest AWAY message kept, longer ones are cut
+const size_t kMaxAwayLength = 200;
+// Name and key lengths accepted (RFC1459)
+const size_t kMaxNicknameLength = 9;
+const size_t kMaxChannelLength = 200;
+const size_t kMaxKeyLength = 23;
+// PRIVMSG recipients per command
+const size_t kMaxTargets = 4;
+// Channel modes of handleMode() in CHANMODES order: lists, always with a
+// parameter, with a parameter when set, without
+const char kChannelModes[] = "beI,k,l,it";
+// RPL_ISUPPORT tokens per line (the reply has 15 parameters at most)
+const size_t kISupportPerLine = 13;
+
+// Non-empty entries of a comma-separated list
+std::vector<std::string> splitTargets(const std::string& list) {
+  std::vector<std::string> targets;
+  size_t start = 0;
+  while (start <= list.length()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) end = list.length();
+    if (end > start) targets.push_back(list.substr(start, end - start));
+    start = end + 1;
+  }
+  return targets;
+}
+
+bool msgIdLess(const HistoryMessage& a, const HistoryMessage& b) {
+  return compareMsgIds(a.msgid, b.msgid) < 0;
+}
+
+bool msgIdEqual(const HistoryMessage& a, const HistoryMessage& b) {
+  return a.msgid == b.msgid;
+}
+
+// ">n" / "<n" LIST filter into cursor's member bounds
+// Returns: false if token is not a member count filter
+bool parseListBound(const std::string& token, ReplyCursor* cursor) {
+  if (token.length() < 2 || (token[0] != '>' && token[0] != '<')) {
+    return false;
+  }
+  for (size_t i = 1; i < token.length(); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(token[i]))) return false;
+  }
+  size_t count = std::strtoul(token.c_str() + 1, NULL, 10);
+  if (token[0] == '>') {
+    cursor->minUsers = count + 1;
+  } else {
+    cursor->maxUsers = count > 0 ? count - 1 : 0;
+    if (count == 0) cursor->minUsers = 1;  // Nothing has fewer than 0
+  }
+  return true;
+}
+}  // namespace
+
 CommandRouter::CommandRouter(UserManager* userMgr, ChannelManager* chanMgr,
                              EventLoop* eventLoop, const std::string& password)
     : userManager_(userMgr),
       channelManager_(chanMgr),
       eventLoop_(eventLoop),
+      linkManager_(NULL),
       parser_(new CommandParser()),
-      password_(password) {}
+      malformedLimit_(50),
+      batchCount_(0),
+      historyQueries_(0),
+      password_(password) {
+  renderISupport();
+}
 
 CommandRouter::~CommandRouter() { delete parser_; }
 
@@ -28,18 +113,71 @@ CommandResult CommandRouter::processMessage(User* user,
     return CMD_CONTINUE;
   }
 
+  // Result codes instead of exceptions: a client flooding garbage must not
+  // cost an unwind (and a heap-allocated message) per line
+  Command cmd;
+  ParseResult result = parser_->parse(message, cmd);
+  if (result != PARSE_OK) return handleMalformed(user, message, result);
+
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND, user->getIp() + ": " + message);
+  return dispatch(user, cmd);
+}
+
+void CommandRouter::setLinkManager(LinkManager* linkManager) {
+  linkManager_ = linkManager;
+}
+
+void CommandRouter::setMalformedLimit(int limit) { malformedLimit_ = limit; }
+
+void CommandRouter::setHistoryLimit(size_t maxBytes) {
+  history_.setLimits(maxBytes, kMaxHistoryMessages);
+  renderISupport();
+}
 
-  try {
-    Command cmd = parser_->parseCommand(message);
-    return dispatch(user, cmd);
-  } catch (const std::exception& e) {
-    // Log detailed error internally
+void CommandRouter::openHistoryLog(const std::string& directory,
+                                   const std::vector<std::string>& channels) {
+  eventLoop_->enableWakeup();
+  historyLog_.open(directory, channels, eventLoop_);
+  renderISupport();
+}
+
+void CommandRouter::closeHistoryLog() {
+  historyLog_.close();
+  deliverHistory();
+  renderISupport();
+}
+
+void CommandRouter::deliverHistory() {
+  std::vector<HistoryQuery> answers;
+  historyLog_.takeAnswers(answers);
+  for (size_t i = 0; i < answers.size(); ++i) {
+    std::map<unsigned long, PendingHistory>::iterator it =
+        pendingHistory_.find(answers[i].id);
+    if (it == pendingHistory_.end()) continue;  // The user left
+    answerChatHistory(it->second, answers[i]);
+    pendingHistory_.erase(it);
+  }
+}
+
+void CommandRouter::retryHistoryLog() {
+  if (historyLog_.hasBacklog()) historyLog_.retryBacklog();
+}
+
+bool CommandRouter::hasHistoryBacklog() const {
+  return historyLog_.hasBacklog();
+}
+
+void CommandRouter::updateClock() { clock_.update(); }
+
+void CommandRouter::processRemote(User* user, const Command& cmd) {
+  if (cmd.command == "JOIN" || cmd.command == "PART" ||
+      cmd.command == "PRIVMSG" || cmd.command == "KICK" ||
+      cmd.command == "INVITE" || cmd.command == "TOPIC" ||
+      cmd.command == "MODE" || cmd.command == "AWAY") {
+    dispatch(user, cmd);
+  } else {
     log(LOG_LEVEL_WARNING, LOG_CATEGORY_COMMAND,
-        "Failed to parse command from " + user->getIp() + ": " + e.what());
-    // Send sanitized error response to client (don't expose internal details)
-    sendResponse(user, "ERROR :Invalid message format\r\n");
-    return CMD_CONTINUE;
+        "Unexpected command from linked server: " + cmd.command);
   }
 }
 
@@ -64,8 +202,24 @@ CommandResult CommandRouter::dispatch(User* user, const Command& cmd) {
     handleJoin(user, cmd);
   } else if (cmd.command == "PART") {
     handlePart(user, cmd);
+  } else if (cmd.command == "NAMES") {
+    handleNames(user, cmd);
+  } else if (cmd.command == "LIST") {
+    handleList(user, cmd);
+  } else if (cmd.command == "WHO") {
+    handleWho(user, cmd);
+  } else if (cmd.command == "WHOIS") {
+    handleWhois(user, cmd);
   } else if (cmd.command == "PRIVMSG") {
     handlePrivmsg(user, cmd);
+  } else if (cmd.command == "TAGMSG") {
+    handleTagmsg(user, cmd);
+  } else if (cmd.command == "CHATHISTORY") {
+    handleChatHistory(user, cmd);
+  } else if (cmd.command == "AWAY") {
+    handleAway(user, cmd);
+  } else if (cmd.command == "MONITOR") {
+    handleMonitor(user, cmd);
   } else if (cmd.command == "KICK") {
     handleKick(user, cmd);
   } else if (cmd.command == "INVITE") {
@@ -165,16 +319,15 @@ void CommandRouter::handleNick(User* user, const Command& cmd) {
 
   // Update nickname
   std::string oldNick = user->getNickname();
+  if (user->isRegistered()) announceNick(user, newNick);
   userManager_->updateNickname(user, oldNick, newNick);
+  user->setNickTime(static_cast<long>(std::time(NULL)));
+  if (linkManager_ && user->isRegistered()) linkManager_->relayNick(user);
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
       "Nickname set: " + user->getIp() + " -> " + newNick);
 
-  // Check if registration is complete (authenticated + nickname + user info)
-  if (!user->isRegistered() && user->isAuthenticated() &&
-      !user->getUsername().empty()) {
-    completeRegistration(user);
-  }
+  tryCompleteRegistration(user);
 }
 
 void CommandRouter::handleUser(User* user, const Command& cmd) {
@@ -212,10 +365,7 @@ void CommandRouter::handleUser(User* user, const Command& cmd) {
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
       "User info set: " + user->getIp() + " (username: " + username + ")");
 
-  // Check if registration is complete (authenticated + nickname + user info)
-  if (user->isAuthenticated() && !user->getNickname().empty()) {
-    completeRegistration(user);
-  }
+  tryCompleteRegistration(user);
 }
 
 void CommandRouter::handleJoin(User* user, const Command& cmd) {
@@ -258,8 +408,8 @@ void CommandRouter::handleJoin(User* user, const Command& cmd) {
           "Failed to create channel: " + channelName);
       return;
     }
-    // First user becomes operator
-    channel->addOperator(user->getSocketFd());
+    // First user becomes operator (a remote user's server announces it)
+    if (!user->isRemote()) channel->addOperator(user->getSocketFd());
     log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
         "Channel created: " + channelName + " by " + user->getNickname());
   }
@@ -269,14 +419,24 @@ void CommandRouter::handleJoin(User* user, const Command& cmd) {
     return;  // Already in channel, silently ignore
   }
 
-  // Check channel modes
-  if (channel->isInviteOnly() && !channel->isInvited(user->getSocketFd())) {
+  // Check channel modes (remote users were admitted by their server)
+  // An invitation overrides bans and invite-only
+  bool trusted = user->isRemote();
+  bool invited = channel->isInvited(user->getSocketFd());
+  if (!trusted && !invited && channel->isBanned(user)) {
+    sendResponse(user, ResponseFormatter::errBannedFromChan(user->getNickname(),
+                                                            channelName));
+    return;
+  }
+
+  if (!trusted && channel->isInviteOnly() && !invited &&
+      !channel->isInviteException(user)) {
     sendResponse(user, ResponseFormatter::errInviteOnlyChan(user->getNickname(),
                                                             channelName));
     return;
   }
 
-  if (channel->hasUserLimit() &&
+  if (!trusted && channel->hasUserLimit() &&
       channel->getMemberCount() >= channel->getUserLimit()) {
     sendResponse(user, ResponseFormatter::errChannelIsFull(user->getNickname(),
                                                            channelName));
@@ -284,7 +444,7 @@ void CommandRouter::handleJoin(User* user, const Command& cmd) {
   }
 
   // Check channel key if set
-  if (!channel->getKey().empty()) {
+  if (!trusted && !channel->getKey().empty()) {
     std::string providedKey = cmd.params.size() > 1 ? cmd.params[1] : "";
     if (providedKey != channel->getKey()) {
       sendResponse(user, ResponseFormatter::errBadChannelKey(
@@ -295,23 +455,42 @@ void CommandRouter::handleJoin(User* user, const Command& cmd) {
 
   // Add user to channel
   channel->addMember(user->getSocketFd());
-  user->joinChannel(channelName);
+  user->joinChannel(channel);
+
+  // Like the creator of a new channel, the first member of a channel
+  // restored from a snapshot becomes operator (relayed after the JOIN)
+  if (!trusted && channel->getOperators().empty()) {
+    channel->addOperator(user->getSocketFd());
+  }
 
   // Remove invite if present
   if (channel->isInvited(user->getSocketFd())) {
     channel->removeInvite(user->getSocketFd());
   }
 
-  // Broadcast JOIN to all channel members (including the user)
+  // Broadcast JOIN to all channel members; the user's own copy opens the
+  // burst of topic and names, all queued before the next flush
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_CHANNEL,
       "Broadcasting JOIN to " + channelName);
-  std::string joinMsg = ResponseFormatter::rplJoin(user, channelName);
-  const std::set<int>& members = channel->getMembers();
-  for (std::set<int>::const_iterator it = members.begin(); it != members.end();
-       ++it) {
-    User* member = userManager_->getUserByFd(*it);
-    if (member) {
-      sendResponse(member, joinMsg);
+  TaggedMessage join(ResponseFormatter::rplJoin(user, channelName), &clock_,
+                     "", false);
+  broadcastTagged(channel, join, user->getSocketFd());
+  std::string batch = startBatch(user, kJoinBatch, channel->getName());
+  sendInBatch(user, batch, join.render(user->getCaps()));
+  if (!channel->getTopic().empty()) {
+    sendInBatch(user, batch,
+                ResponseFormatter::rplTopic(user->getNickname(),
+                                            channel->getName(),
+                                            channel->getTopic()));
+  }
+  sendNames(user, channel, batch);
+  endBatch(user, batch);
+
+  if (linkManager_) {
+    linkManager_->relay(user, "JOIN",
+                        std::vector<std::string>(1, channelName));
+    if (!trusted && channel->isOperator(user->getSocketFd())) {
+      linkManager_->relayOperator(channel, user);
     }
   }
 
@@ -319,6 +498,249 @@ void CommandRouter::handleJoin(User* user, const Command& cmd) {
       user->getNickname() + " joined " + channelName);
 }
 
+void CommandRouter::handleNames(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+
+  // Without a channel: only the end marker (listing every channel and
+  // user is not supported)
+  if (cmd.params.empty()) {
+    sendResponse(user,
+                 ResponseFormatter::rplEndOfNames(user->getNickname(), "*"));
+    return;
+  }
+
+  const std::string& list = cmd.params[0];
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) end = list.size();
+    std::string name = list.substr(start, end - start);
+    start = end + 1;
+    if (name.empty()) continue;
+    Channel* channel = channelManager_->getChannel(name);
+    if (channel) {
+      sendNames(user, channel, "");
+    } else {
+      sendResponse(user,
+                   ResponseFormatter::rplEndOfNames(user->getNickname(), name));
+    }
+  }
+}
+
+void CommandRouter::handleList(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+
+  // LIST [<filter>{,<filter>}]: channel masks, ">n" and "<n" member counts
+  ReplyCursor cursor(REPLY_LIST);
+  if (!cmd.params.empty()) {
+    const std::string& list = cmd.params[0];
+    size_t start = 0;
+    while (start <= list.length()) {
+      size_t end = list.find(',', start);
+      if (end == std::string::npos) end = list.length();
+      std::string token = list.substr(start, end - start);
+      start = end + 1;
+      if (!token.empty() && !parseListBound(token, &cursor)) {
+        cursor.masks.push_back(token);
+      }
+    }
+  }
+  abortReply(user);
+  sendResponse(user, ResponseFormatter::rplListStart(user->getNickname()));
+  user->startReply(cursor);
+  continueReply(user);
+}
+
+void CommandRouter::continueReply(User* user) {
+  ReplyCursor* cursor = user->getReplyCursor();
+  if (!cursor || user->isRemote()) return;
+  std::string& out = user->getWriteBuffer();
+  bool wasEmpty = out.empty();
+  bool done = cursor->kind == REPLY_LIST ? continueList(user, cursor)
+                                         : continueWho(user, cursor);
+  if (done) user->endReply();
+  if (wasEmpty && !out.empty()) eventLoop_->requestWrite(user->getSocketFd());
+}
+
+void CommandRouter::abortReply(User* user) {
+  const ReplyCursor* cursor = user->getReplyCursor();
+  if (!cursor) return;
+  if (cursor->kind == REPLY_LIST) {
+    sendResponse(user, ResponseFormatter::rplListEnd(user->getNickname()));
+  } else {
+    sendResponse(user, ResponseFormatter::rplEndOfWho(user->getNickname(),
+                                                      cursor->target));
+  }
+  user->endReply();
+}
+
+bool CommandRouter::continueList(User* user, ReplyCursor* cursor) {
+  std::string& out = user->getWriteBuffer();
+  const CaseMappedMap<Channel*>& channels = channelManager_->getChannels();
+  CaseMappedMap<Channel*>::const_iterator it = channels.from(cursor->slot);
+  for (; it != channels.end() && out.size() < kReplyHighWater; ++it) {
+    const Channel* channel = it->second;
+    size_t users = channel->getMemberCount();
+    if (users < cursor->minUsers || users > cursor->maxUsers) continue;
+    bool matched = cursor->masks.empty();
+    for (size_t i = 0; !matched && i < cursor->masks.size(); ++i) {
+      matched = ircMatch(cursor->masks[i], channel->getName());
+    }
+    if (!matched) continue;
+    out += ResponseFormatter::rplList(user->getNickname(), channel->getName(),
+                                      users, channel->getTopic());
+  }
+  if (it != channels.end()) {
+    cursor->slot = it.slot();
+    return false;
+  }
+  out += ResponseFormatter::rplListEnd(user->getNickname());
+  return true;
+}
+
+void CommandRouter::handleWho(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+
+  // WHO, WHO 0, WHO * and an empty mask list everybody
+  std::string mask = cmd.params.empty() ? "*" : cmd.params[0];
+  if (mask.empty() || mask == "0") mask = "*";
+  abortReply(user);
+
+  if (mask[0] == '#' || mask[0] == '&') {
+    ReplyCursor cursor(REPLY_WHO_CHANNEL);
+    cursor.target = mask;
+    user->startReply(cursor);
+    continueReply(user);
+    return;
+  }
+
+  // An exact nickname is looked up, not matched against every user
+  if (mask.find_first_of("*?") == std::string::npos) {
+    User* found = userManager_->getUserByNickname(mask);
+    if (found && found->isRegistered()) {
+      sendResponse(user, ResponseFormatter::rplWhoReply(user->getNickname(),
+                                                        "*", found, false));
+      sendResponse(user,
+                   ResponseFormatter::rplEndOfWho(user->getNickname(), mask));
+      return;
+    }
+  }
+  ReplyCursor cursor(REPLY_WHO_MASK);
+  cursor.target = mask;
+  cursor.masks.push_back(mask);
+  user->startReply(cursor);
+  continueReply(user);
+}
+
+bool CommandRouter::continueWho(User* user, ReplyCursor* cursor) {
+  std::string& out = user->getWriteBuffer();
+  if (cursor->kind == REPLY_WHO_CHANNEL) {
+    // Members are looked up again each time: the channel may be gone
+    Channel* channel = channelManager_->getChannel(cursor->target);
+    if (channel) {
+      const std::set<int>& members = channel->getMembers();
+      std::set<int>::const_iterator it = members.lower_bound(cursor->nextId);
+      for (; it != members.end() && out.size() < kReplyHighWater; ++it) {
+        const User* member = userManager_->getUserByFd(*it);
+        if (!member) continue;
+        out += ResponseFormatter::rplWhoReply(user->getNickname(),
+                                              channel->getName(), member,
+                                              channel->isOperator(*it));
+      }
+      if (it != members.end()) {
+        cursor->nextId = *it;
+        return false;
+      }
+    }
+  } else {
+    const std::map<int, User*>& users = userManager_->getUsers();
+    std::map<int, User*>::const_iterator it =
+        users.lower_bound(cursor->nextId);
+    for (; it != users.end() && out.size() < kReplyHighWater; ++it) {
+      const User* other = it->second;
+      if (!other->isRegistered() || !matchesWho(cursor->masks[0], other)) {
+        continue;
+      }
+      out += ResponseFormatter::rplWhoReply(user->getNickname(), "*", other,
+                                            false);
+    }
+    if (it != users.end()) {
+      cursor->nextId = it->first;
+      return false;
+    }
+  }
+  out += ResponseFormatter::rplEndOfWho(user->getNickname(), cursor->target);
+  return true;
+}
+
+// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+bool CommandRouter::matchesWho(const std::string& mask, const User* user) {
+  return ircMatch(mask, user->getNickname()) ||
+         ircMatch(mask, user->getUsername()) ||
+         ircMatch(mask, user->getIp()) || ircMatch(mask, user->getRealname());
+}
+
+void CommandRouter::handleWhois(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+  if (cmd.params.empty()) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(user->getNickname(),
+                                                            "WHOIS"));
+    return;
+  }
+
+  // WHOIS [<server>] <nick>{,<nick>}: answered here whatever the server
+  const std::string& list = cmd.params.back();
+  size_t start = 0;
+  while (start <= list.length()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) end = list.length();
+    std::string nickname = list.substr(start, end - start);
+    start = end + 1;
+    if (nickname.empty()) continue;
+    User* found = userManager_->getUserByNickname(nickname);
+    if (!found || !found->isRegistered()) {
+      sendResponse(user, ResponseFormatter::errNoSuchNick(user->getNickname(),
+                                                          nickname));
+    } else {
+      sendWhois(user, found);
+      nickname = found->getNickname();
+    }
+    sendResponse(user, ResponseFormatter::rplEndOfWhois(user->getNickname(),
+                                                        nickname));
+  }
+}
+
+void CommandRouter::sendWhois(User* user, const User* target) {
+  const std::string& nickname = user->getNickname();
+  sendResponse(user, ResponseFormatter::rplWhoisUser(nickname, target));
+  sendResponse(user, ResponseFormatter::rplWhoisServer(nickname, target));
+  if (!target->getAwayMessage().empty()) {
+    sendResponse(user, ResponseFormatter::rplAway(nickname,
+                                                  target->getNickname(),
+                                                  target->getAwayMessage()));
+  }
+
+  // Channels, as many per RPL_WHOISCHANNELS line as fit
+  const std::vector<Channel*>& channels = target->getJoinedChannels();
+  const std::string head =
+      ResponseFormatter::rplWhoisChannelsHead(nickname, target->getNickname());
+  std::string line;
+  for (size_t i = 0; i < channels.size(); ++i) {
+    bool op = channels[i]->isOperator(target->getSocketFd());
+    const std::string& name = channels[i]->getName();
+    if (!line.empty() &&
+        head.size() + line.size() + 1 + op + name.size() + 2 >
+            kMaxLineLength) {
+      sendResponse(user, head + line + "\r\n");
+      line.clear();
+    }
+    if (!line.empty()) line += ' ';
+    if (op) line += '@';
+    line += name;
+  }
+  if (!line.empty()) sendResponse(user, head + line + "\r\n");
+}
+
 void CommandRouter::handlePart(User* user, const Command& cmd) {
   std::string params;
   for (size_t i = 0; i < cmd.params.size(); ++i) {
@@ -360,38 +782,28 @@ void CommandRouter::handlePart(User* user, const Command& cmd) {
   // Broadcast PART to all channel members (including the user)
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_CHANNEL,
       "Broadcasting PART from " + channelName);
-  std::string partMsg = ResponseFormatter::rplPart(user, channelName, reason);
-  const std::set<int>& members = channel->getMembers();
-  for (std::set<int>::const_iterator it = members.begin(); it != members.end();
-       ++it) {
-    User* member = userManager_->getUserByFd(*it);
-    if (member) {
-      sendResponse(member, partMsg);
-    }
-  }
+  broadcastToChannel(channel,
+                     ResponseFormatter::rplPart(user, channelName, reason),
+                     INVALID_FD);
 
   // Remove user from channel
   channel->removeMember(user->getSocketFd());
   channel->removeOperator(user->getSocketFd());
-  user->leaveChannel(channelName);
+  user->leaveChannel(channel);
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
       user->getNickname() + " left " + channelName);
 
-  // Auto-promote: if no operators left but channel has members, promote first
-  // member. Note: user is already removed from members at this point, so
-  // begin() points to the first remaining member.
-  if (channel->getOperators().empty() && channel->getMemberCount() > 0) {
-    int newOpFd = *channel->getMembers().begin();
-    channel->addOperator(newOpFd);
-    User* newOp = userManager_->getUserByFd(newOpFd);
-    if (newOp) {
-      log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
-          newOp->getNickname() + " auto-promoted to operator in " +
-              channelName);
-    }
+  if (linkManager_) {
+    std::vector<std::string> relayParams;
+    relayParams.push_back(channelName);
+    relayParams.push_back(reason);
+    linkManager_->relay(user, "PART", relayParams);
   }
 
+  // Auto-promote (decided by the server of the leaving user)
+  if (!user->isRemote()) ensureOperator(channel);
+
   // Remove channel if empty
   if (channel->getMemberCount() == 0) {
     channelManager_->removeChannel(channelName);
@@ -421,8 +833,41 @@ void CommandRouter::handlePrivmsg(User* user, const Command& cmd) {
     return;
   }
 
-  const std::string& target = cmd.params[0];
+  // PRIVMSG <target>{,<target>} <text>: up to MAXTARGETS recipients, each
+  // once
+  std::vector<std::string> listed = splitTargets(cmd.params[0]);
+  std::vector<std::string> targets;
+  for (size_t i = 0; i < listed.size(); ++i) {
+    bool seen = false;
+    for (size_t j = 0; j < targets.size() && !seen; ++j) {
+      seen = ircCaseEqual(targets[j], listed[i]);
+    }
+    if (!seen) targets.push_back(listed[i]);
+  }
+  if (targets.empty()) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(user->getNickname(),
+                                                            "PRIVMSG"));
+    return;
+  }
+  if (targets.size() > kMaxTargets) {
+    sendResponse(user, ResponseFormatter::errTooManyTargets(
+                           user->getNickname(), cmd.params[0]));
+    return;
+  }
+  for (size_t i = 0; i < targets.size(); ++i) {
+    sendPrivmsg(user, targets[i], cmd);
+  }
+}
+
+void CommandRouter::sendPrivmsg(User* user, const std::string& target,
+                                const Command& cmd) {
   const std::string& message = cmd.params[1];
+  std::vector<std::string> relayParams;
+  relayParams.push_back(target);
+  relayParams.push_back(message);
+  // Client-only tags reach the recipients that enabled message-tags
+  TaggedMessage privmsg(ResponseFormatter::rplPrivmsg(user, target, message),
+                        &clock_, CommandParser::getClientTags(cmd), false);
 
   // Check if target is a channel or user
   if (!target.empty() && (target[0] == '#' || target[0] == '&')) {
@@ -441,6 +886,14 @@ void CommandRouter::handlePrivmsg(User* user, const Command& cmd) {
       return;
     }
 
+    // Banned members may not speak, unless they are operators
+    if (!user->isRemote() && !channel->isOperator(user->getSocketFd()) &&
+        channel->isBanned(user)) {
+      sendResponse(user, ResponseFormatter::errCannotSendToChan(
+                             user->getNickname(), target));
+      return;
+    }
+
     // TODO(Phase 5): Check moderated mode (+m) - only ops/voiced users can send
     // TODO(Phase 5): Check no-external messages (+n) - handled by membership
     // check above
@@ -450,17 +903,18 @@ void CommandRouter::handlePrivmsg(User* user, const Command& cmd) {
     log(LOG_LEVEL_DEBUG, LOG_CATEGORY_COMMAND,
         "Queueing PRIVMSG to " + target + " members");
     // Broadcast message to all channel members except sender
-    std::string privmsgMsg =
-        ResponseFormatter::rplPrivmsg(user, target, message);
-    const std::set<int>& members = channel->getMembers();
-    for (std::set<int>::const_iterator it = members.begin();
-         it != members.end(); ++it) {
-      if (*it != user->getSocketFd()) {  // Don't echo to sender
-        User* member = userManager_->getUserByFd(*it);
-        if (member) {
-          sendResponse(member, privmsgMsg);
-        }
-      }
+    broadcastTagged(channel, privmsg, user->getSocketFd());
+    if (user->hasCap(CAP_ECHO_MESSAGE)) sendTagged(user, privmsg);
+    if (history_.isEnabled() ||
+        historyLog_.isLogged(channel->getName())) {
+      std::string source = ResponseFormatter::formatUserPrefix(user);
+      history_.record(channel->getName(), clock_.getMillis(), source,
+                      privmsg.getMsgId(), message);
+      historyLog_.append(channel->getName(), clock_.getMillis(), source,
+                         privmsg.getMsgId(), message);
+    }
+    if (linkManager_) {
+      linkManager_->relayToChannel(user, channel, "PRIVMSG", relayParams);
     }
 
     log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
@@ -474,15 +928,265 @@ void CommandRouter::handlePrivmsg(User* user, const Command& cmd) {
       return;
     }
 
-    std::string privmsgMsg =
-        ResponseFormatter::rplPrivmsg(user, target, message);
-    sendResponse(targetUser, privmsgMsg);
+    sendTagged(targetUser, privmsg);
+    if (user->hasCap(CAP_ECHO_MESSAGE)) sendTagged(user, privmsg);
+    if (!targetUser->getAwayMessage().empty()) {
+      sendResponse(user, ResponseFormatter::rplAway(
+                             user->getNickname(), targetUser->getNickname(),
+                             targetUser->getAwayMessage()));
+    }
+    if (linkManager_) {
+      linkManager_->relayToUser(user, targetUser, "PRIVMSG", relayParams);
+    }
 
     log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
         user->getNickname() + " sent private message to " + target);
   }
 }
 
+// TAGMSG: client-only tags without a message (e.g. typing notifications),
+// only for recipients that enabled message-tags. Not relayed to links.
+void CommandRouter::handleTagmsg(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+  if (cmd.params.empty()) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(user->getNickname(),
+                                                            "TAGMSG"));
+    return;
+  }
+
+  const std::string& target = cmd.params[0];
+  std::string tags = CommandParser::getClientTags(cmd);
+  if (tags.empty()) return;
+  TaggedMessage tagmsg(ResponseFormatter::rplTagmsg(user, target), &clock_,
+                       tags, true);
+
+  if (!target.empty() && (target[0] == '#' || target[0] == '&')) {
+    Channel* channel = channelManager_->getChannel(target);
+    if (!channel) {
+      sendResponse(user, ResponseFormatter::errNoSuchChannel(
+                             user->getNickname(), target));
+      return;
+    }
+    if (!channel->isMember(user->getSocketFd()) ||
+        (!channel->isOperator(user->getSocketFd()) &&
+         channel->isBanned(user))) {
+      sendResponse(user, ResponseFormatter::errCannotSendToChan(
+                             user->getNickname(), target));
+      return;
+    }
+    broadcastTagged(channel, tagmsg, user->getSocketFd());
+  } else {
+    User* targetUser = userManager_->getUserByNickname(target);
+    if (!targetUser) {
+      sendResponse(
+          user, ResponseFormatter::errNoSuchNick(user->getNickname(), target));
+      return;
+    }
+    sendTagged(targetUser, tagmsg);
+  }
+  if (user->hasCap(CAP_ECHO_MESSAGE)) sendTagged(user, tagmsg);
+}
+
+// CHATHISTORY <LATEST|BEFORE|AFTER|AROUND> <channel> <ref> <limit>
+// ref: "timestamp=<server-time>" or "msgid=<id>" (LATEST also "*"); BEFORE
+// and AFTER exclude it, LATEST stops after it, AROUND centers on it. The
+// messages go oldest first, with the tags the user enabled.
+void CommandRouter::handleChatHistory(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+  if (cmd.params.size() < 4) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(user->getNickname(),
+                                                            "CHATHISTORY"));
+    return;
+  }
+
+  std::string subcommand = cmd.params[0];
+  for (size_t i = 0; i < subcommand.length(); ++i) {
+    subcommand[i] = std::toupper(static_cast<unsigned char>(subcommand[i]));
+  }
+  const std::string& target = cmd.params[1];
+  const std::string& ref = cmd.params[2];
+  if (subcommand != "LATEST" && subcommand != "BEFORE" &&
+      subcommand != "AFTER" && subcommand != "AROUND") {
+    sendResponse(user, ResponseFormatter::fail("CHATHISTORY",
+                                               "INVALID_PARAMS", subcommand,
+                                               "Unknown subcommand"));
+    return;
+  }
+  const std::string& limitParam = cmd.params[3];
+  size_t limit = 0;
+  if (limitParam.find_first_not_of("0123456789") == std::string::npos &&
+      limitParam.length() <= 9) {
+    limit = std::strtoul(limitParam.c_str(), NULL, 10);
+  }
+  if (limit == 0) {
+    sendResponse(user, ResponseFormatter::fail("CHATHISTORY",
+                                               "INVALID_PARAMS", subcommand,
+                                               "Invalid limit"));
+    return;
+  }
+  if (limit > kMaxChatHistory) limit = kMaxChatHistory;
+
+  Channel* channel = channelManager_->getChannel(target);
+  if (!channel || !channel->isMember(user->getSocketFd())) {
+    sendResponse(user, ResponseFormatter::fail("CHATHISTORY", "INVALID_TARGET",
+                                               subcommand + " " + target,
+                                               "Not a channel you are on"));
+    return;
+  }
+
+  HistoryRef reference;
+  reference.byMsgId = false;
+  reference.time = 0;
+  bool latest = subcommand == "LATEST" && ref == "*";
+  if (!latest && !parseHistoryRef(ref, &reference)) {
+    sendResponse(user, ResponseFormatter::fail("CHATHISTORY",
+                                               "INVALID_PARAMS", subcommand,
+                                               "Invalid message reference"));
+    return;
+  }
+  // The reads the reply needs; answered at once unless the log has to do
+  // them (on its writer thread, see deliverHistory())
+  HistoryQuery query;
+  query.id = ++historyQueries_;
+  query.channel = channel->getName();
+  query.ref = reference;
+  HistoryRead read = {HISTORY_BEFORE, true, limit,
+                      std::vector<HistoryMessage>()};
+  if (reference.byMsgId) {
+    HistoryRead check = {HISTORY_FROM, true, 1, std::vector<HistoryMessage>()};
+    query.reads.push_back(check);
+  }
+  if (subcommand == "LATEST") {
+    read.hasRef = false;
+  } else if (subcommand == "AFTER") {
+    read.side = HISTORY_AFTER;
+  } else if (subcommand == "AROUND") {
+    read.limit = limit / 2;
+    query.reads.push_back(read);
+    read.side = HISTORY_FROM;
+    read.limit = limit;  // Cut to what the first read leaves
+  }
+  query.reads.push_back(read);
+
+  PendingHistory pending = {user, subcommand, latest, limit};
+  if (!historyLog_.isLogged(query.channel)) {
+    answerChatHistory(pending, query);
+  } else if (historyLog_.query(query)) {
+    pendingHistory_[query.id] = pending;
+  } else {
+    sendResponse(user, ResponseFormatter::fail("CHATHISTORY", "MESSAGE_ERROR",
+                                               subcommand + " " + target,
+                                               "Too many history queries"));
+  }
+}
+
+void CommandRouter::answerChatHistory(const PendingHistory& pending,
+                                      const HistoryQuery& query) {
+  User* user = pending.user;
+  const std::string& subcommand = pending.subcommand;
+  const HistoryRef& reference = query.ref;
+  size_t limit = pending.limit;
+  size_t read = 0;
+  // An unknown msgid matches nothing (evicted, or never sent here)
+  bool known = true;
+  if (reference.byMsgId) {
+    std::vector<HistoryMessage> found;
+    collectHistory(query, read++, 1, &found);
+    known = !found.empty() && found[0].msgid == reference.msgid;
+  }
+
+  std::vector<HistoryMessage> messages;
+  if (!known) {
+    // An empty batch
+  } else if (subcommand == "LATEST") {
+    collectHistory(query, read, limit, &messages);
+    // Only what came after the reference
+    size_t first = 0;
+    while (!pending.latest && first < messages.size() &&
+           compareToRef(messages[first], reference) <= 0) {
+      ++first;
+    }
+    messages.erase(messages.begin(), messages.begin() + first);
+  } else if (subcommand == "AROUND") {
+    collectHistory(query, read, limit / 2, &messages);
+    collectHistory(query, read + 1, limit - messages.size(), &messages);
+  } else {
+    collectHistory(query, read, limit, &messages);
+  }
+
+  std::string batch = startBatch(user, "chathistory", query.channel);
+  bool time = user->hasCap(CAP_SERVER_TIME);
+  bool tags = user->hasCap(CAP_MESSAGE_TAGS);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const HistoryMessage& message = messages[i];
+    std::string line;
+    if (time || tags) {
+      line += '@';
+      if (time) line += "time=" + MessageClock::formatServerTime(message.time);
+      if (time && tags) line += ';';
+      if (tags) line += "msgid=" + message.msgid;
+      line += ' ';
+    }
+    line += ResponseFormatter::rplHistoryPrivmsg(message.source, query.channel,
+                                                 message.text);
+    sendInBatch(user, batch, line);
+  }
+  endBatch(user, batch);
+}
+
+bool CommandRouter::parseHistoryRef(const std::string& ref,
+                                    HistoryRef* reference) {
+  reference->byMsgId = ref.compare(0, 6, "msgid=") == 0;
+  reference->time = 0;
+  if (reference->byMsgId) {
+    reference->msgid = ref.substr(6);
+    return !reference->msgid.empty();
+  }
+  return ref.compare(0, 10, "timestamp=") == 0 &&
+         MessageClock::parseServerTime(ref.substr(10), &reference->time);
+}
+
+// The ring keeps the newest messages, the log of a logged channel all of
+// them but those still queued to its writer: both are asked for limit
+// messages (the log possibly for more) and the union is cut to limit
+// again. msgids order the messages of both the same way.
+void CommandRouter::collectHistory(const HistoryQuery& query, size_t read,
+                                   size_t limit,
+                                   std::vector<HistoryMessage>* messages) {
+  if (limit == 0) return;
+  const HistoryRead& spec = query.reads[read];
+  const HistoryRef& ref = query.ref;
+  std::vector<HistoryMessage> found;
+  const ChannelHistory* history = history_.find(query.channel);
+  if (history) {
+    size_t begin = 0;
+    size_t end = history->size();
+    if (spec.side == HISTORY_BEFORE) {
+      if (spec.hasRef) end = history->lowerBound(ref);
+      if (end > limit) begin = end - limit;
+    } else {
+      begin = spec.side == HISTORY_FROM ? history->lowerBound(ref)
+                                        : history->upperBound(ref);
+      if (end - begin > limit) end = begin + limit;
+    }
+    for (size_t i = begin; i < end; ++i) found.push_back(history->get(i));
+  }
+  if (!spec.messages.empty()) {
+    found.insert(found.end(), spec.messages.begin(), spec.messages.end());
+    std::sort(found.begin(), found.end(), msgIdLess);
+    found.erase(std::unique(found.begin(), found.end(), msgIdEqual),
+                found.end());
+  }
+  if (found.size() > limit) {
+    if (spec.side == HISTORY_BEFORE) {
+      found.erase(found.begin(), found.end() - limit);
+    } else {
+      found.resize(limit);
+    }
+  }
+  messages->insert(messages->end(), found.begin(), found.end());
+}
+
 void CommandRouter::handleKick(User* user, const Command& cmd) {
   std::string params;
   for (size_t i = 0; i < cmd.params.size(); ++i) {
@@ -525,8 +1229,8 @@ void CommandRouter::handleKick(User* user, const Command& cmd) {
     return;
   }
 
-  // Check if kicker is an operator
-  if (!chan->isOperator(user->getSocketFd())) {
+  // Check if kicker is an operator (remote: checked by the kicker's server)
+  if (!user->isRemote() && !chan->isOperator(user->getSocketFd())) {
     sendResponse(user, ResponseFormatter::errChanOPrivsNeeded(
                            user->getNickname(), channel));
     return;
@@ -549,20 +1253,21 @@ void CommandRouter::handleKick(User* user, const Command& cmd) {
 
   // Broadcast KICK message to all channel members
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_COMMAND, "Broadcasting KICK to " + channel);
-  std::string kickMsg =
-      ResponseFormatter::rplKick(user, channel, targetNick, reason);
-  const std::set<int>& members = chan->getMembers();
-  for (std::set<int>::const_iterator it = members.begin(); it != members.end();
-       ++it) {
-    User* member = userManager_->getUserByFd(*it);
-    if (member) {
-      sendResponse(member, kickMsg);
-    }
+  broadcastToChannel(
+      chan, ResponseFormatter::rplKick(user, channel, targetNick, reason),
+      INVALID_FD);
+
+  if (linkManager_) {
+    std::vector<std::string> relayParams;
+    relayParams.push_back(channel);
+    relayParams.push_back(targetNick);
+    relayParams.push_back(reason);
+    linkManager_->relay(user, "KICK", relayParams);
   }
 
   // Remove target from channel
   chan->removeMember(targetUser->getSocketFd());
-  targetUser->leaveChannel(channel);
+  targetUser->leaveChannel(chan);
 
   // If channel is empty, remove it
   if (chan->getMemberCount() == 0) {
@@ -628,7 +1333,8 @@ void CommandRouter::handleInvite(User* user, const Command& cmd) {
   }
 
   // If channel is invite-only, only operators can invite
-  if (chan->isInviteOnly() && !chan->isOperator(user->getSocketFd())) {
+  if (!user->isRemote() && chan->isInviteOnly() &&
+      !chan->isOperator(user->getSocketFd())) {
     sendResponse(user, ResponseFormatter::errChanOPrivsNeeded(
                            user->getNickname(), channel));
     return;
@@ -644,6 +1350,11 @@ void CommandRouter::handleInvite(User* user, const Command& cmd) {
   // Send INVITE message to target
   sendResponse(targetUser,
                ResponseFormatter::rplInvite(user, targetNick, channel));
+  if (linkManager_) {
+    linkManager_->relayToUser(
+        user, targetUser, "INVITE",
+        std::vector<std::string>(cmd.params.begin(), cmd.params.begin() + 2));
+  }
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
       user->getNickname() + " invited " + targetNick + " to " + channel);
@@ -701,7 +1412,8 @@ void CommandRouter::handleTopic(User* user, const Command& cmd) {
   }
 
   // Setting topic - check permissions
-  if (chan->isTopicRestricted() && !chan->isOperator(user->getSocketFd())) {
+  if (!user->isRemote() && chan->isTopicRestricted() &&
+      !chan->isOperator(user->getSocketFd())) {
     sendResponse(user, ResponseFormatter::errChanOPrivsNeeded(
                            user->getNickname(), channel));
     return;
@@ -714,15 +1426,14 @@ void CommandRouter::handleTopic(User* user, const Command& cmd) {
   // Broadcast topic change to all channel members
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_COMMAND,
       "Broadcasting TOPIC to " + channel);
-  std::string topicMsg =
-      ResponseFormatter::rplTopicChange(user, channel, newTopic);
-  const std::set<int>& members = chan->getMembers();
-  for (std::set<int>::const_iterator it = members.begin(); it != members.end();
-       ++it) {
-    User* member = userManager_->getUserByFd(*it);
-    if (member) {
-      sendResponse(member, topicMsg);
-    }
+  broadcastToChannel(
+      chan, ResponseFormatter::rplTopicChange(user, channel, newTopic),
+      INVALID_FD);
+  if (linkManager_) {
+    std::vector<std::string> relayParams;
+    relayParams.push_back(channel);
+    relayParams.push_back(newTopic);
+    linkManager_->relay(user, "TOPIC", relayParams);
   }
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
@@ -775,8 +1486,18 @@ void CommandRouter::handleMode(User* user, const Command& cmd) {
     return;
   }
 
-  // Check if user is operator for mode changes
-  if (!chan->isOperator(user->getSocketFd())) {
+  // "MODE #channel b" (or e, I, with a sign): the list, for any member
+  MaskList list;
+  const std::string& query = cmd.params[1];
+  if (cmd.params.size() == 2 && !query.empty() &&
+      query.length() <= 2 && getMaskList(query[query.length() - 1], &list) &&
+      (query.length() == 1 || query[0] == '+' || query[0] == '-')) {
+    sendMaskList(user, chan, list);
+    return;
+  }
+
+  // Check if user is operator for mode changes (remote: checked already)
+  if (!user->isRemote() && !chan->isOperator(user->getSocketFd())) {
     sendResponse(user, ResponseFormatter::errChanOPrivsNeeded(
                            user->getNickname(), channel));
     return;
@@ -823,6 +1544,9 @@ void CommandRouter::handleMode(User* user, const Command& cmd) {
     } else if (mode == 'l') {
       applyModeUserLimit(user, chan, adding, argIndex, cmd.params, appliedModes,
                          appliedArgs);
+    } else if (getMaskList(mode, &list)) {
+      applyModeMask(user, chan, list, adding, argIndex, cmd.params,
+                    appliedModes, appliedArgs);
     } else {
       sendResponse(
           user, ResponseFormatter::errUnknownMode(user->getNickname(), mode));
@@ -832,6 +1556,19 @@ void CommandRouter::handleMode(User* user, const Command& cmd) {
   // Broadcast mode change to all channel members if any modes were applied
   if (!appliedModes.empty()) {
     broadcastModeChange(user, channel, appliedModes, appliedArgs, chan);
+    if (linkManager_) {
+      std::vector<std::string> relayParams;
+      relayParams.push_back(channel);
+      relayParams.push_back(appliedModes);
+      size_t start = 0;
+      while (start < appliedArgs.length()) {
+        size_t end = appliedArgs.find(' ', start);
+        if (end == std::string::npos) end = appliedArgs.length();
+        relayParams.push_back(appliedArgs.substr(start, end - start));
+        start = end + 1;
+      }
+      linkManager_->relay(user, "MODE", relayParams);
+    }
   }
 }
 
@@ -850,59 +1587,92 @@ void CommandRouter::handleQuit(User* user, const Command& cmd) {
           ")");
 
   // Send QUIT confirmation to the user
-  std::string quitMsg = ResponseFormatter::rplQuit(user, reason);
-  sendResponse(user, quitMsg);
+  sendResponse(user, ResponseFormatter::rplQuit(user, reason));
+  quitUser(user, reason);
+
+  // Note: Actual disconnection is handled by Server layer
+  // This just broadcasts the QUIT message to relevant users
+}
+
+void CommandRouter::quitUser(User* user, const std::string& reason) {
+  if (!user->isRegistered()) return;
+  user->setRegistered(false);
+  if (linkManager_ && !user->isRemote()) {
+    linkManager_->relayQuit(user, reason);
+  }
+  notifyWatchers(user->getNickname(), "");
+  // Its CHATHISTORY answers are dropped when the log delivers them
+  std::map<unsigned long, PendingHistory>::iterator pending =
+      pendingHistory_.begin();
+  while (pending != pendingHistory_.end()) {
+    if (pending->second.user == user) {
+      pendingHistory_.erase(pending++);
+    } else {
+      ++pending;
+    }
+  }
 
   // Broadcast QUIT to all channels the user is in
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_COMMAND,
       "Broadcasting QUIT from " + user->getNickname());
-  // Create copy to avoid iterator invalidation when removing user from channels
-  std::set<std::string> channelsCopy = user->getJoinedChannels();
-  for (std::set<std::string>::const_iterator it = channelsCopy.begin();
-       it != channelsCopy.end(); ++it) {
-    Channel* channel = channelManager_->getChannel(*it);
-    if (!channel) continue;
-
-    // Send QUIT message to all channel members except the quitting user
-    const std::set<int>& members = channel->getMembers();
-    for (std::set<int>::const_iterator mit = members.begin();
-         mit != members.end(); ++mit) {
-      if (*mit != user->getSocketFd()) {
-        User* member = userManager_->getUserByFd(*mit);
-        if (member) {
-          sendResponse(member, quitMsg);
-        }
-      }
-    }
+  TaggedMessage quit(ResponseFormatter::rplQuit(user, reason), &clock_, "",
+                     false);
+  sendToChannelPeers(user, quit);
+  const std::vector<Channel*>& channels = user->getJoinedChannels();
+  while (!channels.empty()) {
+    Channel* channel = channels.back();
 
     // Remove user from channel
-    user->leaveChannel(*it);
+    user->leaveChannel(channel);
     channel->removeMember(user->getSocketFd());
     channel->removeOperator(user->getSocketFd());
 
-    // Auto-promote: if no operators left but channel has members, promote first
-    // member. Note: user is already removed from members at this point, so
-    // begin() points to the first remaining member.
-    if (channel->getOperators().empty() && channel->getMemberCount() > 0) {
-      int newOpFd = *channel->getMembers().begin();
-      channel->addOperator(newOpFd);
-      User* newOp = userManager_->getUserByFd(newOpFd);
-      if (newOp) {
-        log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
-            newOp->getNickname() + " auto-promoted to operator in " + *it);
-      }
-    }
+    // Auto-promote (decided by the server of the quitting user)
+    if (!user->isRemote()) ensureOperator(channel);
 
     // Remove channel if empty
     if (channel->getMemberCount() == 0) {
-      channelManager_->removeChannel(*it);
+      std::string name = channel->getName();
+      channelManager_->removeChannel(name);
       log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
-          "Channel removed: " + *it + " (empty after QUIT)");
+          "Channel removed: " + name + " (empty after QUIT)");
     }
   }
+}
 
-  // Note: Actual disconnection is handled by Server layer
-  // This just broadcasts the QUIT message to relevant users
+void CommandRouter::announceNick(User* user, const std::string& newNick) {
+  TaggedMessage nick(ResponseFormatter::rplNick(user, newNick), &clock_, "",
+                     false);
+  sendTagged(user, nick);
+  sendToChannelPeers(user, nick);
+  if (!ircCaseEqual(user->getNickname(), newNick)) {
+    notifyWatchers(user->getNickname(), "");
+  }
+  notifyWatchers(newNick, newNick + "!" + user->getUsername() + "@" +
+                              user->getIp());
+}
+
+void CommandRouter::announceSignOn(const User* user) {
+  notifyWatchers(user->getNickname(),
+                 ResponseFormatter::formatUserPrefix(user));
+}
+
+// Auto-promote: if no operators left but channel has members, promote first
+// member. Called after the leaving user was removed from the members, so
+// begin() points to the first remaining member.
+void CommandRouter::ensureOperator(Channel* channel) {
+  if (!channel->getOperators().empty() || channel->getMemberCount() == 0) {
+    return;
+  }
+  int newOpFd = *channel->getMembers().begin();
+  channel->addOperator(newOpFd);
+  User* newOp = userManager_->getUserByFd(newOpFd);
+  if (newOp) {
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_CHANNEL,
+        newOp->getNickname() + " auto-promoted to operator in " +
+            channel->getName());
+    if (linkManager_) linkManager_->relayOperator(channel, newOp);
+  }
 }
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
@@ -914,11 +1684,58 @@ void CommandRouter::handleCap(User* user, const Command& cmd) {
   }
   log(LOG_LEVEL_DEBUG, LOG_CATEGORY_COMMAND,
       "CAP command from " + user->getIp() + " params: [" + params + "]");
-  // CAP command is sent by modern IRC clients for capability negotiation
-  // We don't support any capabilities, so just silently ignore it
-  // This prevents "Unknown command" errors for clients using CAP
-  (void)user;  // Suppress unused parameter warning
-  (void)cmd;   // Suppress unused parameter warning
+  std::string nick = user->getNickname().empty() ? "*" : user->getNickname();
+  if (cmd.params.empty()) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(nick, "CAP"));
+    return;
+  }
+
+  std::string subcommand = cmd.params[0];
+  for (size_t i = 0; i < subcommand.length(); ++i) {
+    subcommand[i] = std::toupper(static_cast<unsigned char>(subcommand[i]));
+  }
+  // LS and REQ before registration hold it until CAP END
+  if ((subcommand == "LS" || subcommand == "REQ") && !user->isRegistered()) {
+    user->setNegotiatingCaps(true);
+  }
+
+  if (subcommand == "LS") {
+    sendResponse(user, ResponseFormatter::rplCap(nick, "LS",
+                                                 capabilityNames(
+                                                     allCapabilities())));
+  } else if (subcommand == "LIST") {
+    sendResponse(user, ResponseFormatter::rplCap(
+                           nick, "LIST", capabilityNames(user->getCaps())));
+  } else if (subcommand == "REQ") {
+    // All or nothing: one unknown capability NAKs the whole request
+    const std::string request = cmd.params.size() > 1 ? cmd.params[1] : "";
+    unsigned caps = user->getCaps();
+    size_t start = request.find_first_not_of(' ');
+    bool valid = start != std::string::npos;
+    while (start != std::string::npos && valid) {
+      size_t end = request.find(' ', start);
+      std::string name = request.substr(start, end - start);
+      bool removing = name[0] == '-';
+      unsigned cap = findCapability(removing ? name.substr(1) : name);
+      if (cap == 0) {
+        valid = false;
+      } else if (removing) {
+        caps &= ~cap;
+      } else {
+        caps |= cap;
+      }
+      start = request.find_first_not_of(' ', end);
+    }
+    if (valid) user->setCaps(caps);
+    sendResponse(user, ResponseFormatter::rplCap(nick, valid ? "ACK" : "NAK",
+                                                 request));
+  } else if (subcommand == "END") {
+    user->setNegotiatingCaps(false);
+    tryCompleteRegistration(user);
+  } else {
+    sendResponse(user,
+                 ResponseFormatter::errInvalidCapCmd(nick, cmd.params[0]));
+  }
 }
 
 void CommandRouter::handlePing(User* user, const Command& cmd) {
@@ -1026,7 +1843,7 @@ void CommandRouter::applyModeKey(User* sender, Channel* chan, bool adding,
       }
 
       // Enforce reasonable length limit (23 chars per RFC 1459)
-      if (key.length() > 23) {
+      if (key.length() > kMaxKeyLength) {
         sendResponse(sender,
                      ResponseFormatter::errInvalidModeParam(
                          sender->getNickname(), chan->getName(), 'k', key,
@@ -1160,47 +1977,415 @@ void CommandRouter::applyModeUserLimit(User* sender, Channel* chan, bool adding,
   }
 }
 
+bool CommandRouter::getMaskList(char mode, MaskList* list) {
+  switch (mode) {
+    case 'b':
+      *list = MASK_LIST_BAN;
+      return true;
+    case 'e':
+      *list = MASK_LIST_EXCEPTION;
+      return true;
+    case 'I':
+      *list = MASK_LIST_INVITE_EXCEPTION;
+      return true;
+    default:
+      return false;
+  }
+}
+
+void CommandRouter::sendMaskList(User* user, const Channel* chan,
+                                 MaskList list) {
+  const std::vector<MaskEntry>& masks = chan->getMasks(list);
+  for (size_t i = 0; i < masks.size(); ++i) {
+    sendResponse(user, ResponseFormatter::rplMaskList(list, user->getNickname(),
+                                                      chan->getName(),
+                                                      masks[i]));
+  }
+  sendResponse(user, ResponseFormatter::rplEndOfMaskList(
+                         list, user->getNickname(), chan->getName()));
+}
+
+void CommandRouter::applyModeMask(User* sender, Channel* chan, MaskList list,
+                                  bool adding, size_t& argIndex,
+                                  const std::vector<std::string>& params,
+                                  std::string& appliedModes,
+                                  std::string& appliedArgs) {
+  static const char kModes[MASK_LIST_COUNT] = {'b', 'e', 'I'};
+  char mode = kModes[list];
+  // Without a mask: the list, as in "MODE #channel +b"
+  if (argIndex >= params.size()) {
+    sendMaskList(sender, chan, list);
+    return;
+  }
+  const std::string& mask = params[argIndex++];
+  if (mask.empty() || mask.length() > 100) {
+    sendResponse(sender, ResponseFormatter::errInvalidModeParam(
+                             sender->getNickname(), chan->getName(), mode,
+                             mask, "Invalid mask: empty or too long"));
+    return;
+  }
+
+  std::string normalized = Hostmask::normalize(mask);
+  if (adding) {
+    if (chan->getMasks(list).size() >= Channel::kMaxMasks) {
+      sendResponse(sender, ResponseFormatter::errBanListFull(
+                               sender->getNickname(), chan->getName(), mode));
+      return;
+    }
+    if (!chan->addMask(list, normalized, sender->getNickname(),
+                       static_cast<long>(std::time(NULL)))) {
+      return;  // Already listed
+    }
+  } else if (!chan->removeMask(list, normalized)) {
+    return;
+  }
+  appliedModes += adding ? '+' : '-';
+  appliedModes += mode;
+  appliedArgs += appliedArgs.empty() ? "" : " ";
+  appliedArgs += normalized;
+}
+
 void CommandRouter::broadcastModeChange(User* user, const std::string& channel,
                                         const std::string& appliedModes,
                                         const std::string& appliedArgs,
                                         Channel* chan) {
-  std::string modeMsg = ResponseFormatter::rplModeChange(
-      user, channel, appliedModes, appliedArgs);
-  const std::set<int>& members = chan->getMembers();
-  for (std::set<int>::const_iterator it = members.begin(); it != members.end();
-       ++it) {
-    User* member = userManager_->getUserByFd(*it);
-    if (member) {
-      sendResponse(member, modeMsg);
-    }
-  }
+  broadcastToChannel(chan,
+                     ResponseFormatter::rplModeChange(user, channel,
+                                                      appliedModes,
+                                                      appliedArgs),
+                     INVALID_FD);
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
       user->getNickname() + " set mode " + appliedModes + " on " + channel);
 }
 
+// AWAY [:message]: without a message (or an empty one) the user is back
+void CommandRouter::handleAway(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+  std::string message = cmd.params.empty() ? "" : cmd.params[0];
+  if (message.length() > kMaxAwayLength) message.resize(kMaxAwayLength);
+  user->setAwayMessage(message);
+  sendResponse(user, message.empty()
+                         ? ResponseFormatter::rplUnaway(user->getNickname())
+                         : ResponseFormatter::rplNowAway(user->getNickname()));
+  if (linkManager_) {
+    linkManager_->relay(user, "AWAY", std::vector<std::string>(1, message));
+  }
+}
+
+// MONITOR + targets, - targets, C (clear), L (list) or S (status)
+// The watchers of a nickname are indexed (UserManager::getWatchers()), so
+// sign-ons, nick changes and quits only reach them
+void CommandRouter::handleMonitor(User* user, const Command& cmd) {
+  if (!user->isRegistered()) return;
+  std::string subcommand = cmd.params.empty() ? "" : cmd.params[0];
+  for (size_t i = 0; i < subcommand.length(); ++i) {
+    subcommand[i] = std::toupper(static_cast<unsigned char>(subcommand[i]));
+  }
+  bool withTargets = subcommand == "+" || subcommand == "-";
+  if (subcommand.empty() || (withTargets && cmd.params.size() < 2)) {
+    sendResponse(user, ResponseFormatter::errNeedMoreParams(user->getNickname(),
+                                                            "MONITOR"));
+    return;
+  }
+
+  std::vector<std::string> targets;
+  if (withTargets) {
+    targets = splitTargets(cmd.params[1]);
+  } else if (subcommand == "L" || subcommand == "S") {
+    targets = user->getMonitored();
+  }
+
+  if (subcommand == "-") {
+    for (size_t i = 0; i < targets.size(); ++i) {
+      userManager_->removeMonitor(user, targets[i]);
+    }
+  } else if (subcommand == "C") {
+    userManager_->clearMonitors(user);
+  } else if (subcommand == "L") {
+    sendMonitorReplies(user, &ResponseFormatter::rplMonList, targets);
+    sendResponse(user,
+                 ResponseFormatter::rplEndOfMonList(user->getNickname()));
+  } else if (subcommand == "+" || subcommand == "S") {
+    std::vector<std::string> online;
+    std::vector<std::string> offline;
+    for (size_t i = 0; i < targets.size(); ++i) {
+      if (subcommand == "+" &&
+          !userManager_->addMonitor(user, targets[i])) {
+        std::string rest;
+        for (size_t j = i; j < targets.size(); ++j) {
+          if (!rest.empty()) rest += ',';
+          rest += targets[j];
+        }
+        sendResponse(user, ResponseFormatter::errMonListFull(
+                               user->getNickname(),
+                               UserManager::kMaxMonitored, rest));
+        break;
+      }
+      const User* found = userManager_->getUserByNickname(targets[i]);
+      if (found && found->isRegistered()) {
+        online.push_back(ResponseFormatter::formatUserPrefix(found));
+      } else {
+        offline.push_back(targets[i]);
+      }
+    }
+    sendMonitorReplies(user, &ResponseFormatter::rplMonOnline, online);
+    sendMonitorReplies(user, &ResponseFormatter::rplMonOffline, offline);
+  }
+}
+
 // ==========================================
 // Helpers
 // ==========================================
 
-// NOLINTNEXTLINE(readability-convert-member-functions-to-static)
+void CommandRouter::broadcastToChannel(const Channel* channel,
+                                       const std::string& message,
+                                       int exceptFd) {
+  TaggedMessage tagged(message, &clock_, "", false);
+  broadcastTagged(channel, tagged, exceptFd);
+}
+
+// The first malformed lines of a window are logged and answered; later ones
+// are dropped silently, and reaching the limit disconnects the client
+CommandResult CommandRouter::handleMalformed(User* user,
+                                             const std::string& message,
+                                             ParseResult result) {
+  int count = user->countMalformed(getMonotonicTime(), kMalformedWindow);
+  if (malformedLimit_ > 0 && count >= malformedLimit_) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_COMMAND,
+        "Disconnecting " + user->getIp() + ": " + int_to_string(count) +
+            " malformed messages");
+    sendResponse(user, "ERROR :Closing Link: " + user->getIp() +
+                           " (Too many malformed messages)\r\n");
+    return CMD_DISCONNECT;
+  }
+  if (count > kMalformedReplies) return CMD_CONTINUE;
+
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND, user->getIp() + ": " + message);
+  // Log detailed error internally
+  log(LOG_LEVEL_WARNING, LOG_CATEGORY_COMMAND,
+      "Failed to parse command from " + user->getIp() + ": " +
+          CommandParser::getErrorMessage(result));
+  if (count == kMalformedReplies) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_COMMAND,
+        "Ignoring further malformed messages from " + user->getIp());
+  }
+  // Send sanitized error response to client (don't expose internal details)
+  sendResponse(user, "ERROR :Invalid message format\r\n");
+  return CMD_CONTINUE;
+}
+
+void CommandRouter::sendTagged(User* recipient, TaggedMessage& message) {
+  if (!recipient) return;
+  const std::string& line = message.render(recipient->getCaps());
+  if (!line.empty()) sendResponse(recipient, line);
+}
+
+// Users of linked servers have negative ids: the member set keeps them in
+// front, so the fan-out starts at the first local member
+void CommandRouter::broadcastTagged(const Channel* channel,
+                                    TaggedMessage& message, int exceptFd) {
+  const std::set<int>& members = channel->getMembers();
+  for (std::set<int>::const_iterator it = members.lower_bound(0);
+       it != members.end(); ++it) {
+    if (*it != exceptFd) sendTagged(userManager_->getUserByFd(*it), message);
+  }
+}
+
+void CommandRouter::sendToChannelPeers(const User* user,
+                                       TaggedMessage& message) {
+  // Members of several of the channels get the message once
+  std::set<int> recipients;
+  const std::vector<Channel*>& channels = user->getJoinedChannels();
+  for (size_t i = 0; i < channels.size(); ++i) {
+    const std::set<int>& members = channels[i]->getMembers();
+    recipients.insert(members.lower_bound(0), members.end());
+  }
+  recipients.erase(user->getSocketFd());
+  for (std::set<int>::const_iterator it = recipients.begin();
+       it != recipients.end(); ++it) {
+    sendTagged(userManager_->getUserByFd(*it), message);
+  }
+}
+
 void CommandRouter::sendResponse(User* user, const std::string& response) {
-  if (!user) return;
+  // Users of linked servers get their messages from their own server
+  if (!user || user->isRemote()) return;
   bool wasEmpty = user->getWriteBuffer().empty();
   user->getWriteBuffer() += response;
-  // Register EPOLLOUT only when buffer transitions from empty to non-empty
+  // Queue for the batched send after this dispatch round only when buffer
+  // transitions from empty to non-empty (otherwise a send is already queued
+  // or EPOLLOUT is registered)
   if (wasEmpty) {
-    eventLoop_->modifyFd(user->getSocketFd(), EPOLLIN | EPOLLOUT);
+    eventLoop_->requestWrite(user->getSocketFd());
+  }
+}
+
+std::string CommandRouter::startBatch(User* user, const char* type,
+                                      const std::string& target) {
+  if (user->isRemote() || !user->hasCap(CAP_BATCH)) return "";
+  char reference[24];
+  std::snprintf(reference, sizeof(reference), "%lx", ++batchCount_);
+  sendResponse(user, ResponseFormatter::batchStart(reference, type, target));
+  return reference;
+}
+
+void CommandRouter::endBatch(User* user, const std::string& batch) {
+  if (!batch.empty()) sendResponse(user, ResponseFormatter::batchEnd(batch));
+}
+
+void CommandRouter::sendInBatch(User* user, const std::string& batch,
+                                const std::string& line) {
+  sendResponse(user,
+               batch.empty() ? line : ResponseFormatter::inBatch(batch, line));
+}
+
+void CommandRouter::sendNames(User* user, const Channel* channel,
+                              const std::string& batch) {
+  if (!user || user->isRemote()) return;
+  std::string& out = user->getWriteBuffer();
+  bool wasEmpty = out.empty();
+  // The tag does not count against the 512 bytes of a line
+  const std::string tag = batch.empty() ? "" : "@batch=" + batch + " ";
+  const std::string head = ResponseFormatter::rplNamReplyHead(
+      user->getNickname(), channel->getName());
+  const std::set<int>& members = channel->getMembers();
+
+  // Names go straight into the write buffer, as many per line as fit
+  // Reserve for full nicknames and one head per 40 of them
+  out.reserve(out.size() + members.size() * 12 +
+              (members.size() / 40 + 1) * (tag.size() + head.size() + 2) +
+              tag.size() + 64);
+  size_t lineStart = std::string::npos;
+  for (std::set<int>::const_iterator it = members.begin();
+       it != members.end(); ++it) {
+    const User* member = userManager_->getUserByFd(*it);
+    if (!member) continue;
+    const std::string& nickname = member->getNickname();
+    bool op = channel->isOperator(*it);
+    if (lineStart != std::string::npos &&
+        out.size() - lineStart + 1 + op + nickname.size() + 2 >
+            kMaxLineLength) {
+      out += "\r\n";
+      lineStart = std::string::npos;
+    }
+    if (lineStart == std::string::npos) {
+      out += tag;
+      lineStart = out.size();
+      out += head;
+    } else {
+      out += ' ';
+    }
+    if (op) out += '@';
+    out += nickname;
+  }
+  if (lineStart != std::string::npos) out += "\r\n";
+  out += tag;
+  out += ResponseFormatter::rplEndOfNames(user->getNickname(),
+                                          channel->getName());
+  if (wasEmpty) eventLoop_->requestWrite(user->getSocketFd());
+}
+
+void CommandRouter::notifyWatchers(const std::string& nickname,
+                                   const std::string& prefix) {
+  const std::vector<User*>* watchers = userManager_->getWatchers(nickname);
+  if (!watchers) return;
+  for (size_t i = 0; i < watchers->size(); ++i) {
+    User* watcher = (*watchers)[i];
+    const std::string& target = watcher->getNickname();
+    sendResponse(watcher,
+                 prefix.empty()
+                     ? ResponseFormatter::rplMonOffline(target, nickname)
+                     : ResponseFormatter::rplMonOnline(target, prefix));
+  }
+}
+
+void CommandRouter::sendMonitorReplies(User* user, MonitorReply format,
+                                       const std::vector<std::string>& items) {
+  const std::string& nickname = user->getNickname();
+  size_t empty = format(nickname, "").size();
+  std::string list;
+  for (size_t i = 0; i < items.size(); ++i) {
+    if (!list.empty() &&
+        empty + list.size() + 1 + items[i].size() > kMaxLineLength) {
+      sendResponse(user, format(nickname, list));
+      list.clear();
+    }
+    if (!list.empty()) list += ',';
+    list += items[i];
+  }
+  if (!list.empty()) sendResponse(user, format(nickname, list));
+}
+
+void CommandRouter::renderISupport() {
+  channelModes_.clear();
+  for (const char* mode = kChannelModes; *mode; ++mode) {
+    if (*mode != ',') channelModes_ += *mode;
+  }
+  channelModes_ += 'o';
+
+  std::string maxList;
+  for (const char* mode = kChannelModes; *mode != ','; ++mode) {
+    if (!maxList.empty()) maxList += ',';
+    maxList += std::string(1, *mode) + ":" + int_to_string(Channel::kMaxMasks);
+  }
+  std::string maxTargets = int_to_string(kMaxTargets);
+  bool history = history_.isEnabled() || historyLog_.isOpen();
+
+  std::vector<std::string> tokens;
+  tokens.push_back("AWAYLEN=" + int_to_string(kMaxAwayLength));
+  tokens.push_back("CASEMAPPING=rfc1459");
+  tokens.push_back(std::string("CHANMODES=") + kChannelModes);
+  tokens.push_back("CHANNELLEN=" + int_to_string(kMaxChannelLength));
+  tokens.push_back("CHANTYPES=#&");
+  if (history) {
+    tokens.push_back("CHATHISTORY=" + int_to_string(kMaxChatHistory));
+  }
+  tokens.push_back("ELIST=MU");
+  tokens.push_back("EXCEPTS=e");
+  tokens.push_back("INVEX=I");
+  tokens.push_back("KEYLEN=" + int_to_string(kMaxKeyLength));
+  tokens.push_back("MAXLIST=" + maxList);
+  tokens.push_back("MAXTARGETS=" + maxTargets);
+  tokens.push_back("MODES");
+  tokens.push_back("MONITOR=" + int_to_string(UserManager::kMaxMonitored));
+  if (history) tokens.push_back("MSGREFTYPES=msgid,timestamp");
+  tokens.push_back("NETWORK=ft_irc");
+  tokens.push_back("NICKLEN=" + int_to_string(kMaxNicknameLength));
+  tokens.push_back("PREFIX=(o)@");
+  tokens.push_back("TARGMAX=JOIN:1,PART:1,PRIVMSG:" + maxTargets +
+                   ",TAGMSG:1");
+
+  isupport_.clear();
+  for (size_t i = 0; i < tokens.size(); i += kISupportPerLine) {
+    size_t end = std::min(tokens.size(), i + kISupportPerLine);
+    isupport_.push_back(ResponseFormatter::isupportTail(
+        std::vector<std::string>(tokens.begin() + i, tokens.begin() + end)));
+  }
+}
+
+void CommandRouter::tryCompleteRegistration(User* user) {
+  if (!user->isRegistered() && user->isAuthenticated() &&
+      !user->getNickname().empty() && !user->getUsername().empty() &&
+      !user->isNegotiatingCaps()) {
+    completeRegistration(user);
   }
 }
 
 void CommandRouter::completeRegistration(User* user) {
   user->setRegistered(true);
 
-  // Send welcome messages (001-004)
+  // Send welcome messages (001-005)
   sendResponse(user, ResponseFormatter::rplWelcome(user));
   sendResponse(user, ResponseFormatter::rplYourHost(user));
   sendResponse(user, ResponseFormatter::rplCreated(user));
-  sendResponse(user, ResponseFormatter::rplMyInfo(user));
+  sendResponse(user, ResponseFormatter::rplMyInfo(user, channelModes_));
+  for (size_t i = 0; i < isupport_.size(); ++i) {
+    sendResponse(user,
+                 ResponseFormatter::rplISupport(user->getNickname(),
+                                                isupport_[i]));
+  }
+  if (linkManager_) linkManager_->introduceUser(user);
+  announceSignOn(user);
 
   log(LOG_LEVEL_INFO, LOG_CATEGORY_COMMAND,
       "Registration complete: " + user->getNickname() + "!" +
@@ -1209,7 +2394,7 @@ void CommandRouter::completeRegistration(User* user) {
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
 bool CommandRouter::isValidChannelName(const std::string& name) {
-  if (name.empty() || name.length() > 200) {
+  if (name.empty() || name.length() > kMaxChannelLength) {
     return false;
   }
 
@@ -1238,7 +2423,7 @@ bool CommandRouter::isValidNickname(const std::string& nickname) {
   // 3. No reserved nickname checking (e.g., "anonymous", server names)
   // These limitations are acceptable for educational/RFC1459 strict compliance
 
-  if (nickname.empty() || nickname.length() > 9) {
+  if (nickname.empty() || nickname.length() > kMaxNicknameLength) {
     return false;
   }
 
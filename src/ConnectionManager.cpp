@@ -1,52 +1,73 @@
 #include "ConnectionManager.hpp"
 
 #include <arpa/inet.h>
-#include <fcntl.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
-#include <algorithm>
 #include <cerrno>
 #include <cstring>
 #include <stdexcept>
 #include <string>
 
+#include "ByteScan.hpp"
 #include "User.hpp"
 #include "utils.hpp"
 
-ConnectionManager::ConnectionManager() {}
+// Helper: Format the address of an accepted connection
+// IPv4 clients of a dual-stack listener arrive as v4-mapped IPv6 addresses
+// (::ffff:a.b.c.d) and are shown as plain IPv4. A leading ':' would end the
+// host when it is sent as an IRC parameter, so "::1" becomes "0::1".
+// buf: At least INET6_ADDRSTRLEN + 1 bytes
+static void formatAddress(const struct sockaddr_storage& addr, char* buf) {
+  if (addr.ss_family == AF_INET6) {
+    const struct sockaddr_in6* addr6 =
+        reinterpret_cast<const struct sockaddr_in6*>(&addr);
+    if (IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr)) {
+      inet_ntop(AF_INET, &addr6->sin6_addr.s6_addr[12], buf, INET_ADDRSTRLEN);
+      return;
+    }
+    buf[0] = '0';
+    inet_ntop(AF_INET6, &addr6->sin6_addr, buf + 1, INET6_ADDRSTRLEN);
+    if (buf[1] != ':') std::memmove(buf, buf + 1, std::strlen(buf + 1) + 1);
+    return;
+  }
+  const struct sockaddr_in* addr4 =
+      reinterpret_cast<const struct sockaddr_in*>(&addr);
+  inet_ntop(AF_INET, &addr4->sin_addr, buf, INET_ADDRSTRLEN);
+}
+
+ConnectionManager::ConnectionManager(Metrics* metrics) : metrics_(metrics) {}
 
 ConnectionManager::~ConnectionManager() {}
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
 User* ConnectionManager::acceptConnection(int serverFd) {
-  struct sockaddr_in userAddr;
+  struct sockaddr_storage userAddr;
   socklen_t userAddrLen = sizeof(userAddr);
 
   // Accept new connection
-  // This creates a new socket file descriptor for the user
-  int userFd = accept(serverFd, reinterpret_cast<struct sockaddr*>(&userAddr),
-                      &userAddrLen);
+  // This creates a new socket file descriptor for the user, already
+  // non-blocking and close-on-exec (no separate fcntl() needed)
+  int userFd;
+  do {
+    metrics_->increment(METRIC_SYSCALLS);
+    userFd = accept4(serverFd, reinterpret_cast<struct sockaddr*>(&userAddr),
+                     &userAddrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    // ECONNABORTED: the peer reset the connection while it was queued
+    // (common during reconnect storms), just take the next one
+  } while (userFd < 0 && (errno == ECONNABORTED || errno == EINTR));
   if (userFd < 0) {
     // No more connections waiting (normal for edge-triggered mode)
     if (errno == EAGAIN || errno == EWOULDBLOCK) return NULL;
     // Unexpected error
     throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
-                                       createErrorMessage("accept", errno)));
-  }
-
-  // Set the new user socket to non-blocking mode
-  if (fcntl(userFd, F_SETFL, O_NONBLOCK) < 0) {
-    int errsv = errno;
-    close(userFd);
-    throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
-                                       createErrorMessage("fcntl", errsv)));
+                                       createErrorMessage("accept4", errno)));
   }
 
   // Get user IP address
-  char userIp[INET_ADDRSTRLEN];
-  inet_ntop(AF_INET, &userAddr.sin_addr, userIp, INET_ADDRSTRLEN);
+  char userIp[INET6_ADDRSTRLEN + 1];
+  formatAddress(userAddr, userIp);
 
   // Create new user
   // Use try-catch for exception safety (issue #24)
@@ -64,38 +85,41 @@ User* ConnectionManager::acceptConnection(int serverFd) {
 
 ReceiveResult ConnectionManager::receiveData(
     User* user, std::vector<std::string>& messages) {
-  (void)this;  // Suppress unused warning
   char buffer[BUFFER_SIZE];
 
   // Read all available data (edge-triggered mode)
   while (true) {
+    metrics_->increment(METRIC_SYSCALLS);
     ssize_t bytesRead = recv(user->getSocketFd(), buffer, BUFFER_SIZE - 1, 0);
 
     if (bytesRead > 0) {
-      user->getReadBuffer().append(buffer, bytesRead);
-
-      // Remove all Ctrl-D (EOT, '\x04') characters from the buffer
+      metrics_->increment(METRIC_BYTES_RECEIVED, bytesRead);
+      // Remove all Ctrl-D (EOT, '\x04') characters before buffering
+      size_t length = removeByte(buffer, bytesRead, '\x04');
       std::string& readBuf = user->getReadBuffer();
-      readBuf.erase(std::remove(readBuf.begin(), readBuf.end(), '\x04'),
-                    readBuf.end());
+      // Earlier bytes hold no "\r\n"; the last one may be its '\r'
+      size_t scanFrom = readBuf.empty() ? 0 : readBuf.size() - 1;
+      readBuf.append(buffer, length);
+
+      // Extract complete messages (ending with \r\n), then drop them and
+      // their "\r\n" with one erase
+      size_t start = 0;
+      size_t pos = scanFrom + findCrlf(readBuf.data() + scanFrom,
+                                       readBuf.size() - scanFrom);
+      while (pos < readBuf.size()) {
+        if (pos > start) messages.push_back(readBuf.substr(start, pos - start));
+        start = pos + 2;
+        pos = start + findCrlf(readBuf.data() + start, readBuf.size() - start);
+      }
+      readBuf.erase(0, start);
 
-      // Prevent DoS attacks by limiting buffer size
-      if (readBuf.size() > MAX_BUFFER_SIZE) {
+      // Prevent DoS attacks by limiting the incomplete line: it cannot end
+      // within the limit anymore
+      if (readBuf.size() >= MAX_BUFFER_SIZE) {
         log(LOG_LEVEL_ERROR, LOG_CATEGORY_CONNECTION,
             "Read buffer is too large: " + user->getIp());
         return RECV_ERROR;
       }
-
-      // Extract complete messages (ending with \r\n)
-      size_t pos = readBuf.find("\r\n");
-      while (pos != std::string::npos) {
-        std::string message = readBuf.substr(0, pos);
-        readBuf.erase(0, pos + 2);  // Also delete "\r\n"
-        if (!message.empty()) {
-          messages.push_back(message);
-        }
-        pos = readBuf.find("\r\n");
-      }
     } else if (bytesRead == 0) {
       // The user closed the connection
       return RECV_CLOSED;
@@ -114,7 +138,6 @@ ReceiveResult ConnectionManager::receiveData(
 }
 
 SendResult ConnectionManager::sendData(User* user) {
-  (void)this;  // Suppress unused warning
   std::string& writeBuf = user->getWriteBuffer();
 
   if (writeBuf.empty()) {
@@ -126,9 +149,11 @@ SendResult ConnectionManager::sendData(User* user) {
   size_t totalSent = 0;
 
   while (!writeBuf.empty()) {
+    metrics_->increment(METRIC_SYSCALLS);
     ssize_t bytesSent = send(user->getSocketFd(), writeBuf.c_str(),
                              writeBuf.size(), MSG_NOSIGNAL);
     if (bytesSent > 0) {
+      metrics_->increment(METRIC_BYTES_SENT, bytesSent);
       writeBuf.erase(0, bytesSent);
       totalSent += bytesSent;
     } else if (bytesSent < 0) {
@@ -157,3 +182,48 @@ SendResult ConnectionManager::sendData(User* user) {
       "Sent " + int_to_string(totalSent) + " bytes to " + user->getIp());
   return SEND_COMPLETE;
 }
+
+void ConnectionManager::sendBatch(const EventLoop& eventLoop,
+                                  const std::vector<User*>& users,
+                                  std::vector<SendResult>& results) {
+  results.assign(users.size(), SEND_COMPLETE);
+  if (users.empty()) return;
+
+  // The requests point into the write buffers, which stay untouched until
+  // the batch has completed
+  std::vector<SendRequest> requests(users.size());
+  for (size_t i = 0; i < users.size(); ++i) {
+    const std::string& writeBuf = users[i]->getWriteBuffer();
+    requests[i].fd = users[i]->getSocketFd();
+    requests[i].data = writeBuf.data();
+    requests[i].length = writeBuf.size();
+    requests[i].result = 0;
+  }
+  eventLoop.sendBatch(&requests[0], requests.size());
+
+  for (size_t i = 0; i < users.size(); ++i) {
+    User* user = users[i];
+    std::string& writeBuf = user->getWriteBuffer();
+    ssize_t bytesSent = requests[i].result;
+    if (bytesSent >= 0) {
+      metrics_->increment(METRIC_BYTES_SENT, bytesSent);
+      writeBuf.erase(0, bytesSent);
+      if (!writeBuf.empty()) {
+        log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
+            "Partial send for " + user->getIp() +
+                " (sent: " + int_to_string(bytesSent) +
+                ", remaining: " + int_to_string(writeBuf.size()) + " bytes)");
+        results[i] = SEND_SUCCESS;
+      }
+    } else if (bytesSent == -EAGAIN || bytesSent == -EWOULDBLOCK) {
+      log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
+          "Send buffer full for " + user->getIp() +
+              " (queued: " + int_to_string(writeBuf.size()) + " bytes)");
+      results[i] = SEND_SUCCESS;
+    } else {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          createErrorMessage("send", static_cast<int>(-bytesSent)));
+      results[i] = SEND_ERROR;
+    }
+  }
+}
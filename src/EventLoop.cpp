@@ -1,70 +1,348 @@
 #include "EventLoop.hpp"
 
+#include <linux/io_uring.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include <cerrno>
 #include <cstring>
 #include <stdexcept>
+#include <vector>
 
+#include "IoUring.hpp"
 #include "utils.hpp"
 
-EventLoop::EventLoop() : epollFd_(INVALID_FD) {}
+namespace {
+// Submission queue size of the io_uring backend
+const unsigned kRingEntries = 256;
+
+// user_data layout of io_uring requests: tag in the upper 32 bits, fd (polls)
+// or request index (sends) in the lower 32 bits
+// Tag 0 marks completions nobody waits for (poll removals)
+const uint32_t kIgnoredTag = 0;
+const uint32_t kSendTag = 0xFFFFFFFFU;
+
+uint64_t makeUserData(uint32_t tag, uint32_t low) {
+  return (static_cast<uint64_t>(tag) << 32) | low;
+}
+
+uint32_t userDataTag(uint64_t userData) {
+  return static_cast<uint32_t>(userData >> 32);
+}
+
+uint32_t userDataLow(uint64_t userData) {
+  return static_cast<uint32_t>(userData & 0xFFFFFFFFU);
+}
+
+void throwCtlError(const char* function, int errsv) {
+  throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+                                     createErrorMessage(function, errsv)));
+}
+}  // namespace
+
+EventLoop::EventLoop()
+    : backend_(EVENT_BACKEND_EPOLL),
+      epollFd_(INVALID_FD),
+      uring_(NULL),
+      nextTag_(1),
+      syscallCount_(0),
+      countedEnters_(0),
+      wakeupFd_(INVALID_FD) {}
 
 EventLoop::~EventLoop() {
+  // Closing the ring cancels all armed polls
+  delete uring_;
+  if (wakeupFd_ != INVALID_FD) close(wakeupFd_);
   if (epollFd_ != INVALID_FD) {
     close(epollFd_);
   }
 }
 
-void EventLoop::create() {
+void EventLoop::create(EventBackend backend) {
+  backend_ = backend;
+  if (backend_ == EVENT_BACKEND_IO_URING) {
+    uring_ = new IoUring();
+    try {
+      uring_->setup(kRingEntries);
+    } catch (...) {
+      delete uring_;
+      uring_ = NULL;
+      throw;
+    }
+    return;
+  }
+
   // Create an epoll instance
-  // The argument 0 means "no special flags"
-  epollFd_ = epoll_create1(0);
+  // Close-on-exec: not inherited by the binary started for an upgrade
+  epollFd_ = epoll_create1(EPOLL_CLOEXEC);
   if (epollFd_ < 0) {
     int errsv = errno;
     throw std::runtime_error(createErrorMessage("epoll_create1", errsv));
   }
 }
 
+EventBackend EventLoop::getBackend() const { return backend_; }
+
 void EventLoop::addFd(int fd, uint32_t events) const {
+  if (uring_) {
+    if (polls_.count(fd)) throwCtlError("io_uring poll", EEXIST);
+    armPoll(fd, events);
+    return;
+  }
+
   struct epoll_event ev;
   std::memset(&ev, 0, sizeof(ev));
   // Always use edge-triggered mode (EPOLLET)
   ev.events = events | EPOLLET;
   ev.data.fd = fd;
 
+  ++syscallCount_;
   if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
-    int errsv = errno;
-    throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
-                                       createErrorMessage("epoll_ctl", errsv)));
+    throwCtlError("epoll_ctl", errno);
   }
 }
 
 void EventLoop::modifyFd(int fd, uint32_t events) const {
+  if (uring_) {
+    std::map<int, PollState>::iterator it = polls_.find(fd);
+    if (it == polls_.end()) throwCtlError("io_uring poll", ENOENT);
+    if (it->second.events == (events & ~EPOLLET)) return;
+    // Re-arming checks the current readiness, so no edge is lost between
+    // the removal and the new poll
+    cancelPoll(fd, it->second.tag);
+    armPoll(fd, events);
+    return;
+  }
+
   struct epoll_event ev;
   std::memset(&ev, 0, sizeof(ev));
   // Always use edge-triggered mode (EPOLLET)
   ev.events = events | EPOLLET;
   ev.data.fd = fd;
 
+  ++syscallCount_;
   if (epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev) < 0) {
-    int errsv = errno;
-    throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
-                                       createErrorMessage("epoll_ctl", errsv)));
+    throwCtlError("epoll_ctl", errno);
   }
 }
 
 void EventLoop::removeFd(int fd) const {
+  if (uring_) {
+    std::map<int, PollState>::iterator it = polls_.find(fd);
+    if (it == polls_.end()) throwCtlError("io_uring poll", ENOENT);
+    cancelPoll(fd, it->second.tag);
+    polls_.erase(it);
+    return;
+  }
+
   // In Linux 2.6.9+, the event argument can be NULL for EPOLL_CTL_DEL
+  ++syscallCount_;
   if (epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, NULL) < 0) {
-    int errsv = errno;
-    throw std::runtime_error(createLog(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
-                                       createErrorMessage("epoll_ctl", errsv)));
+    throwCtlError("epoll_ctl", errno);
   }
 }
 
 int EventLoop::wait(struct epoll_event* events, int maxEvents,
                     int timeout) const {
+  if (uring_) return waitIoUring(events, maxEvents, timeout);
+  ++syscallCount_;
   return epoll_wait(epollFd_, events, maxEvents, timeout);
 }
+
+void EventLoop::sendBatch(SendRequest* requests, size_t count) const {
+  if (uring_) {
+    sendBatchIoUring(requests, count);
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    ++syscallCount_;
+    ssize_t sent = send(requests[i].fd, requests[i].data, requests[i].length,
+                        MSG_NOSIGNAL);
+    requests[i].result = sent < 0 ? -errno : sent;
+  }
+}
+
+void EventLoop::requestWrite(int fd) { writeRequests_.push_back(fd); }
+
+void EventLoop::takeWriteRequests(std::vector<int>& fds) {
+  fds.clear();
+  fds.swap(writeRequests_);
+}
+
+bool EventLoop::hasWriteRequests() const { return !writeRequests_.empty(); }
+
+void EventLoop::enableWakeup() {
+  if (wakeupFd_ != INVALID_FD) return;
+  ++syscallCount_;
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) throwCtlError("eventfd", errno);
+  try {
+    addFd(fd, EPOLLIN);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  wakeupFd_ = fd;
+}
+
+int EventLoop::getWakeupFd() const { return wakeupFd_; }
+
+// Not counted in syscallCount_: other threads call this
+void EventLoop::wakeup() const {
+  uint64_t one = 1;
+  // EAGAIN: the counter is saturated, a wakeup is pending anyway
+  while (write(wakeupFd_, &one, sizeof(one)) < 0 && errno == EINTR) {
+  }
+}
+
+void EventLoop::consumeWakeup() const {
+  uint64_t count;
+  ++syscallCount_;
+  while (read(wakeupFd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+  }
+}
+
+unsigned long EventLoop::takeSyscallCount() {
+  unsigned long count = syscallCount_;
+  syscallCount_ = 0;
+  if (uring_) {
+    count += uring_->getEnterCount() - countedEnters_;
+    countedEnters_ = uring_->getEnterCount();
+  }
+  return count;
+}
+
+// ==========================================
+// io_uring backend
+// ==========================================
+
+void EventLoop::armPoll(int fd, uint32_t events) const {
+  // Edge-triggered unless IORING_POLL_ADD_LEVEL is given, like EPOLLET
+  events &= ~EPOLLET;
+  PollState state;
+  state.tag = nextTag_++;
+  state.events = events;
+  if (nextTag_ == kSendTag) nextTag_ = kIgnoredTag + 1;
+
+  struct io_uring_sqe* sqe = uring_->getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = events;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = makeUserData(state.tag, static_cast<uint32_t>(fd));
+  polls_[fd] = state;
+}
+
+void EventLoop::cancelPoll(int fd, uint32_t tag) const {
+  // Completions of the old tag that are still queued are dropped by
+  // handleCompletion(); the fd may already be reused when they arrive
+  struct io_uring_sqe* sqe = uring_->getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = makeUserData(tag, static_cast<uint32_t>(fd));
+  sqe->user_data = makeUserData(kIgnoredTag, 0);
+}
+
+void EventLoop::handleCompletion(const struct io_uring_cqe* cqe) const {
+  uint32_t tag = userDataTag(cqe->user_data);
+  if (tag == kIgnoredTag || tag == kSendTag) return;
+
+  int fd = static_cast<int>(userDataLow(cqe->user_data));
+  std::map<int, PollState>::iterator it = polls_.find(fd);
+  if (it == polls_.end() || it->second.tag != tag) return;  // Stale poll
+
+  uint32_t revents;
+  if (cqe->res < 0) {
+    // The poll could not be armed or was terminated; report it like epoll
+    // reports a broken descriptor and let the owner remove the fd
+    revents = EPOLLERR;
+  } else {
+    revents = static_cast<uint32_t>(cqe->res);
+    // The kernel may end a multishot poll (e.g. under memory pressure)
+    if (!(cqe->flags & IORING_CQE_F_MORE)) armPoll(fd, it->second.events);
+  }
+
+  // Consecutive completions for one fd become one event
+  if (!deferredEvents_.empty() && deferredEvents_.back().data.fd == fd) {
+    deferredEvents_.back().events |= revents;
+    return;
+  }
+  struct epoll_event ev;
+  std::memset(&ev, 0, sizeof(ev));
+  ev.events = revents;
+  ev.data.fd = fd;
+  deferredEvents_.push_back(ev);
+}
+
+int EventLoop::waitIoUring(struct epoll_event* events, int maxEvents,
+                           int timeout) const {
+  struct io_uring_cqe* cqe;
+  while ((cqe = uring_->peekCqe()) != NULL) {
+    handleCompletion(cqe);
+    uring_->advanceCq();
+  }
+
+  if (deferredEvents_.empty()) {
+    // Submit queued interest changes and block in the same system call
+    // A timeout is not reported when SQEs were submitted, and completions
+    // may all turn out stale, so 0 events can be returned early
+    int ret = uring_->submitAndWait(1, timeout);
+    if (ret == -ETIME) return 0;
+    if (ret < 0) {
+      errno = -ret;
+      return -1;
+    }
+    while ((cqe = uring_->peekCqe()) != NULL) {
+      handleCompletion(cqe);
+      uring_->advanceCq();
+    }
+  } else if (uring_->getPendingCount() > 0) {
+    // Events are ready already; still hand over queued changes so that
+    // removed descriptors are released and new polls get armed
+    int ret = uring_->submitAndWait(0, 0);
+    if (ret < 0) {
+      errno = -ret;
+      return -1;
+    }
+  }
+
+  int count = 0;
+  while (count < maxEvents && !deferredEvents_.empty()) {
+    events[count++] = deferredEvents_.front();
+    deferredEvents_.pop_front();
+  }
+  return count;
+}
+
+void EventLoop::sendBatchIoUring(SendRequest* requests, size_t count) const {
+  for (size_t i = 0; i < count; ++i) {
+    struct io_uring_sqe* sqe = uring_->getSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = requests[i].fd;
+    sqe->addr = reinterpret_cast<uint64_t>(requests[i].data);
+    sqe->len = static_cast<uint32_t>(requests[i].length);
+    // MSG_DONTWAIT: complete with -EAGAIN instead of waiting for buffer space
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+    sqe->user_data = makeUserData(kSendTag, static_cast<uint32_t>(i));
+  }
+
+  // Non-blocking sends complete during submission, so this normally takes a
+  // single io_uring_enter(); poll completions are kept for the next wait()
+  size_t remaining = count;
+  while (remaining > 0) {
+    int ret = uring_->submitAndWait(static_cast<unsigned>(remaining), -1);
+    if (ret < 0 && ret != -EINTR) throwCtlError("io_uring_enter", -ret);
+    struct io_uring_cqe* cqe;
+    while ((cqe = uring_->peekCqe()) != NULL) {
+      if (userDataTag(cqe->user_data) == kSendTag) {
+        requests[userDataLow(cqe->user_data)].result = cqe->res;
+        --remaining;
+      } else {
+        handleCompletion(cqe);
+      }
+      uring_->advanceCq();
+    }
+  }
+}
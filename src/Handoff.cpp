@@ -0,0 +1,162 @@
+#include "Handoff.hpp"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BinaryCodec.hpp"
+#include "utils.hpp"
+
+namespace {
+// "IRCH" (ircserv handoff), guards against talking to a foreign process
+const uint32_t kHandoffMagic = 0x48435249;
+const size_t kHeaderSize = 12;            // magic, state size, fd count
+const uint32_t kMaxStateSize = 1U << 30;  // Sanity limit (1 GiB)
+
+void writeAll(int sock, const char* data, size_t length) {
+  while (length > 0) {
+    ssize_t sent = ::send(sock, data, length, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(createErrorMessage("send", errno));
+    }
+    data += sent;
+    length -= sent;
+  }
+}
+
+void readAll(int sock, char* data, size_t length) {
+  while (length > 0) {
+    ssize_t received = recv(sock, data, length, 0);
+    if (received == 0) {
+      throw std::runtime_error("Handoff: peer closed the connection");
+    }
+    if (received < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(createErrorMessage("recv", errno));
+    }
+    data += received;
+    length -= received;
+  }
+}
+
+void sendFdChunk(int sock, const int* fds, size_t count) {
+  // SCM_RIGHTS needs at least one byte of regular data to travel with
+  char byte = 'F';
+  struct iovec iov;
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+
+  std::vector<char> control(CMSG_SPACE(count * sizeof(int)));
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control[0];
+  msg.msg_controllen = control.size();
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+
+  while (sendmsg(sock, &msg, MSG_NOSIGNAL) < 0) {
+    if (errno != EINTR) {
+      throw std::runtime_error(createErrorMessage("sendmsg", errno));
+    }
+  }
+}
+
+// Receive one chunk of descriptors and append them to fds
+void receiveFdChunk(int sock, std::vector<int>& fds) {
+  char byte;
+  struct iovec iov;
+  iov.iov_base = &byte;
+  iov.iov_len = 1;
+
+  std::vector<char> control(
+      CMSG_SPACE(Handoff::kMaxFdsPerMessage * sizeof(int)));
+  struct msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = &control[0];
+  msg.msg_controllen = control.size();
+
+  ssize_t received;
+  while ((received = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC)) < 0) {
+    if (errno != EINTR) {
+      throw std::runtime_error(createErrorMessage("recvmsg", errno));
+    }
+  }
+  if (received == 0) {
+    throw std::runtime_error("Handoff: peer closed the connection");
+  }
+
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+       cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+      continue;
+    }
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const int* passed = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+    fds.insert(fds.end(), passed, passed + count);
+  }
+  // Checked after collecting so that the delivered fds get closed
+  if (msg.msg_flags & MSG_CTRUNC) {
+    throw std::runtime_error("Handoff: file descriptors were truncated");
+  }
+}
+}  // namespace
+
+void Handoff::send(int sock, const std::string& state,
+                   const std::vector<int>& fds) {
+  BinaryWriter header;
+  header.writeU32(kHandoffMagic);
+  header.writeU32(static_cast<uint32_t>(state.size()));
+  header.writeU32(static_cast<uint32_t>(fds.size()));
+  writeAll(sock, header.getData().data(), header.getData().size());
+  writeAll(sock, state.data(), state.size());
+
+  for (size_t i = 0; i < fds.size(); i += kMaxFdsPerMessage) {
+    size_t count = fds.size() - i;
+    if (count > kMaxFdsPerMessage) count = kMaxFdsPerMessage;
+    sendFdChunk(sock, &fds[i], count);
+  }
+}
+
+void Handoff::receive(int sock, std::string& state, std::vector<int>& fds) {
+  char headerData[kHeaderSize];
+  readAll(sock, headerData, kHeaderSize);
+  BinaryReader header(headerData, kHeaderSize);
+  if (header.readU32() != kHandoffMagic) {
+    throw std::runtime_error("Handoff: bad magic");
+  }
+  uint32_t stateSize = header.readU32();
+  uint32_t fdCount = header.readU32();
+  if (stateSize > kMaxStateSize) {
+    throw std::runtime_error("Handoff: state too large");
+  }
+
+  state.resize(stateSize);
+  if (stateSize > 0) readAll(sock, &state[0], stateSize);
+
+  fds.clear();
+  try {
+    while (fds.size() < fdCount) receiveFdChunk(sock, fds);
+    if (fds.size() != fdCount) {
+      throw std::runtime_error("Handoff: unexpected number of descriptors");
+    }
+  } catch (...) {
+    for (size_t i = 0; i < fds.size(); ++i) close(fds[i]);
+    fds.clear();
+    throw;
+  }
+}
@@ -0,0 +1,752 @@
+#include "HistoryLog.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BinaryCodec.hpp"
+#include "utils.hpp"
+
+namespace {
+// Every kIndexInterval-th record of a segment has an index entry: its time
+// and offset, 8 bytes each
+const size_t kIndexInterval = 16;
+const size_t kIndexEntryBytes = 16;
+// Messages queued to the writer before the event loop keeps a backlog
+const size_t kMailboxCapacity = 4096;
+
+std::string segmentPath(const std::string& directory, unsigned number,
+                        const char* extension) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "/%08u.%s", number, extension);
+  return directory + name;
+}
+
+// Casefolded channel name with the bytes unsafe in file names as %XX
+std::string directoryName(const std::string& channel) {
+  std::string folded = normalizeChannelName(channel);
+  std::string name;
+  for (size_t i = 0; i < folded.length(); ++i) {
+    unsigned char c = static_cast<unsigned char>(folded[i]);
+    if (std::isalnum(c) || c == '-' || c == '_' || c == '.') {
+      name += static_cast<char>(c);
+    } else {
+      char escaped[4];
+      std::snprintf(escaped, sizeof(escaped), "%%%02X", c);
+      name += escaped;
+    }
+  }
+  return name;
+}
+
+void makeDirectory(const std::string& path) {
+  if (mkdir(path.c_str(), 0750) < 0 && errno != EEXIST) {
+    throw std::runtime_error(createErrorMessage("mkdir " + path, errno));
+  }
+}
+
+size_t fileSize(const std::string& path) {
+  struct stat info;
+  if (stat(path.c_str(), &info) < 0) return 0;
+  return static_cast<size_t>(info.st_size);
+}
+
+bool writeAll(int fd, const std::string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    written += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Record: body length (U32), then time (U64), source, msgid and text
+std::string encodeRecord(long time, const std::string& source,
+                         const std::string& msgid, const std::string& text) {
+  BinaryWriter body;
+  body.writeU64(static_cast<uint64_t>(time));
+  body.writeString(source);
+  body.writeString(msgid);
+  body.writeString(text);
+  BinaryWriter record;
+  record.writeU32(static_cast<uint32_t>(body.getData().size()));
+  return record.getData() + body.getData();
+}
+
+std::string encodeIndexEntry(long time, size_t offset) {
+  BinaryWriter entry;
+  entry.writeU64(static_cast<uint64_t>(time));
+  entry.writeU64(offset);
+  return entry.getData();
+}
+
+// Throws: std::runtime_error if the record is incomplete
+// Returns: Offset of the next record
+size_t decodeRecord(const char* data, size_t size, size_t offset,
+                    HistoryMessage* message) {
+  BinaryReader header(data + offset, size - offset);
+  uint32_t length = header.readU32();
+  if (length > size - offset - 4) {
+    throw std::runtime_error("History log record is truncated");
+  }
+  BinaryReader body(data + offset + 4, length);
+  message->time = static_cast<long>(body.readU64());
+  message->source = body.readString();
+  message->msgid = body.readString();
+  message->text = body.readString();
+  return offset + 4 + length;
+}
+
+// Read-only mapping of the first size bytes of a file
+class MappedFile {
+ public:
+  MappedFile(const std::string& path, size_t size) : data_(NULL), size_(size) {
+    if (size_ == 0) return;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      throw std::runtime_error(createErrorMessage("open " + path, errno));
+    }
+    void* data = mmap(NULL, size_, PROT_READ, MAP_SHARED, fd, 0);
+    int errsv = errno;
+    close(fd);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error(createErrorMessage("mmap " + path, errsv));
+    }
+    data_ = static_cast<const char*>(data);
+  }
+  ~MappedFile() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+
+  MappedFile(const MappedFile& src);             // = delete
+  MappedFile& operator=(const MappedFile& src);  // = delete
+};
+
+// The segments of one channel as a query sees them, mapped on first use
+class SegmentSet {
+ public:
+  SegmentSet(const std::string& directory,
+             const std::vector<HistorySegment>& segments)
+      : directory_(directory),
+        segments_(segments),
+        logs_(segments.size(), static_cast<MappedFile*>(NULL)),
+        indexes_(segments.size(), static_cast<MappedFile*>(NULL)) {}
+  ~SegmentSet() {
+    for (size_t i = 0; i < logs_.size(); ++i) {
+      delete logs_[i];
+      delete indexes_[i];
+    }
+  }
+
+  size_t size() const { return segments_.size(); }
+  size_t logBytes(size_t segment) const {
+    return segments_[segment].logBytes;
+  }
+  size_t entries(size_t segment) const {
+    return segments_[segment].indexBytes / kIndexEntryBytes;
+  }
+  long entryTime(size_t segment, size_t entry) {
+    BinaryReader reader(index(segment).data() + entry * kIndexEntryBytes,
+                        kIndexEntryBytes);
+    return static_cast<long>(reader.readU64());
+  }
+  size_t entryOffset(size_t segment, size_t entry) {
+    BinaryReader reader(index(segment).data() + entry * kIndexEntryBytes,
+                        kIndexEntryBytes);
+    reader.readU64();
+    return static_cast<size_t>(reader.readU64());
+  }
+  // Returns: Offset of the next record
+  size_t read(size_t segment, size_t offset, HistoryMessage* message) {
+    if (!logs_[segment]) {
+      logs_[segment] =
+          new MappedFile(segmentPath(directory_, segments_[segment].number,
+                                     "log"),
+                         segments_[segment].logBytes);
+    }
+    return decodeRecord(logs_[segment]->data(), logs_[segment]->size(),
+                        offset, message);
+  }
+
+ private:
+  std::string directory_;
+  std::vector<HistorySegment> segments_;
+  std::vector<MappedFile*> logs_;
+  std::vector<MappedFile*> indexes_;
+
+  const MappedFile& index(size_t segment) {
+    if (!indexes_[segment]) {
+      indexes_[segment] =
+          new MappedFile(segmentPath(directory_, segments_[segment].number,
+                                     "idx"),
+                         entries(segment) * kIndexEntryBytes);
+    }
+    return *indexes_[segment];
+  }
+
+  SegmentSet(const SegmentSet& src);             // = delete
+  SegmentSet& operator=(const SegmentSet& src);  // = delete
+};
+
+// A record boundary in a SegmentSet (the end of a segment included)
+struct Position {
+  size_t segment;
+  size_t offset;
+};
+
+// Whether message comes before the bound at ref: before ref, or also at
+// it when the bound is exclusive
+bool precedes(const HistoryMessage& message, const HistoryRef& ref,
+              bool inclusive) {
+  int order = compareToRef(message, ref);
+  return inclusive ? order < 0 : order <= 0;
+}
+
+bool entryPrecedes(SegmentSet& set, size_t segment, size_t entry,
+                   const HistoryRef& ref, bool inclusive) {
+  if (!ref.byMsgId) {
+    long time = set.entryTime(segment, entry);
+    return inclusive ? time < ref.time : time <= ref.time;
+  }
+  HistoryMessage message;
+  set.read(segment, set.entryOffset(segment, entry), &message);
+  return precedes(message, ref, inclusive);
+}
+
+// Returns: Position of the first record that does not precede the bound
+Position seek(SegmentSet& set, const HistoryRef& ref, bool inclusive) {
+  // The last segment whose first record precedes the bound holds it
+  size_t low = 0;
+  size_t high = set.size();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (set.entries(middle) > 0 &&
+        entryPrecedes(set, middle, 0, ref, inclusive)) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  Position position = {0, 0};
+  if (low == 0) return position;
+  position.segment = low - 1;
+
+  // Then the last index entry that precedes it, and on record by record
+  size_t first = 0;
+  size_t last = set.entries(position.segment);
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    if (entryPrecedes(set, position.segment, middle, ref, inclusive)) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  position.offset = set.entryOffset(position.segment, first - 1);
+  HistoryMessage message;
+  while (position.offset < set.logBytes(position.segment)) {
+    size_t next = set.read(position.segment, position.offset, &message);
+    if (!precedes(message, ref, inclusive)) return position;
+    position.offset = next;
+  }
+  if (position.segment + 1 < set.size()) {
+    ++position.segment;
+    position.offset = 0;
+  }
+  return position;
+}
+
+void readForward(SegmentSet& set, Position position, size_t limit,
+                 std::vector<HistoryMessage>* messages) {
+  HistoryMessage message;
+  for (size_t count = 0; count < limit;) {
+    if (position.offset >= set.logBytes(position.segment)) {
+      if (++position.segment >= set.size()) return;
+      position.offset = 0;
+      continue;
+    }
+    position.offset = set.read(position.segment, position.offset, &message);
+    messages->push_back(message);
+    ++count;
+  }
+}
+
+// The limit records before position, stepping back through the index
+void readBackward(SegmentSet& set, Position position, size_t limit,
+                  std::vector<HistoryMessage>* messages) {
+  std::deque<HistoryMessage> found;
+  size_t end = position.offset;
+  size_t segment = position.segment;
+  while (found.size() < limit) {
+    if (end == 0) {
+      if (segment == 0) break;
+      end = set.logBytes(--segment);
+      continue;
+    }
+    // Index entries of the records before end
+    size_t low = 0;
+    size_t high = set.entries(segment);
+    while (low < high) {
+      size_t middle = low + (high - low) / 2;
+      if (set.entryOffset(segment, middle) < end) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    size_t needed = limit - found.size();
+    size_t back = needed / kIndexInterval + 1;
+    size_t first = low > back ? low - back : 0;
+    size_t start = low > 0 ? set.entryOffset(segment, first) : 0;
+
+    std::vector<HistoryMessage> chunk;
+    HistoryMessage message;
+    for (size_t offset = start; offset < end;) {
+      offset = set.read(segment, offset, &message);
+      chunk.push_back(message);
+    }
+    size_t skip = chunk.size() > needed ? chunk.size() - needed : 0;
+    found.insert(found.begin(), chunk.begin() + skip, chunk.end());
+    end = start;
+  }
+  messages->insert(messages->end(), found.begin(), found.end());
+}
+}  // namespace
+
+HistoryLog::HistoryLog()
+    : segmentBytes_(kDefaultSegmentBytes),
+      lockFd_(-1),
+      writerLoop_(NULL),
+      mailbox_(NULL),
+      answers_(NULL),
+      queries_(0),
+      running_(false) {}
+
+HistoryLog::~HistoryLog() {
+  close();
+  for (size_t i = 0; i < answered_.size(); ++i) delete answered_[i];
+}
+
+void HistoryLog::open(const std::string& directory,
+                      const std::vector<std::string>& channels,
+                      EventLoop* answerLoop, size_t segmentBytes) {
+  if (running_) throw std::runtime_error("History log is already open");
+  directory_ = directory;
+  segmentBytes_ = segmentBytes;
+  try {
+    makeDirectory(directory_);
+    std::string lockPath = directory_ + "/lock";
+    lockFd_ = ::open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0640);
+    if (lockFd_ < 0) {
+      throw std::runtime_error(createErrorMessage("open " + lockPath, errno));
+    }
+    if (flock(lockFd_, LOCK_EX | LOCK_NB) < 0) {
+      throw std::runtime_error("History log " + directory_ +
+                               " is used by another process");
+    }
+    for (size_t i = 0; i < channels.size(); ++i) {
+      if (channels[i].empty() || channels_.find(channels[i])) continue;
+      ChannelLog* channel = new ChannelLog();
+      channel->path = directory_ + "/" + directoryName(channels[i]);
+      channel->lastTime = 0;
+      channel->logFd = -1;
+      channel->indexFd = -1;
+      channel->records = 0;
+      channel->pendingRecords = 0;
+      channels_.set(channels[i], channel);
+      makeDirectory(channel->path);
+      loadSegments(channel);
+    }
+
+    writerLoop_ = new EventLoop();
+    writerLoop_->create(EVENT_BACKEND_EPOLL);
+    writerLoop_->enableWakeup();
+    mailbox_ = new Mailbox<Record>(writerLoop_, kMailboxCapacity);
+    answers_ = new Mailbox<HistoryQuery*>(answerLoop, kMaxQueries);
+    // Signals stay with the event loop thread
+    sigset_t all;
+    sigset_t previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    int error = pthread_create(&writer_, NULL, &HistoryLog::runWriter, this);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (error != 0) {
+      throw std::runtime_error(createErrorMessage("pthread_create", error));
+    }
+    running_ = true;
+  } catch (...) {
+    release();
+    throw;
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "History log: " + int_to_string(static_cast<int>(channels_.size())) +
+          " channel(s) in " + directory_);
+}
+
+void HistoryLog::close() {
+  if (running_) {
+    Record stop;
+    stop.log = NULL;
+    stop.query = NULL;
+    stop.time = 0;
+    post(stop);
+    while (!backlog_.empty()) {
+      if (mailbox_->post(backlog_.front())) {
+        backlog_.pop_front();
+      } else {
+        sched_yield();
+      }
+    }
+    pthread_join(writer_, NULL);
+    running_ = false;
+  }
+  release();
+}
+
+bool HistoryLog::isOpen() const { return running_; }
+
+bool HistoryLog::isLogged(const std::string& channel) const {
+  return running_ && channels_.find(channel) != NULL;
+}
+
+void HistoryLog::append(const std::string& channel, long time,
+                        const std::string& source, const std::string& msgid,
+                        const std::string& text) {
+  ChannelLog** found = channels_.find(channel);
+  if (!running_ || !found) return;
+  // Times only grow, so that the index is sorted
+  time = std::max(time, (*found)->lastTime);
+  (*found)->lastTime = time;
+  Record record;
+  record.log = *found;
+  record.query = NULL;
+  record.time = time;
+  record.data = encodeRecord(time, source, msgid, text);
+  post(record);
+}
+
+bool HistoryLog::query(const HistoryQuery& query) {
+  ChannelLog** found = channels_.find(query.channel);
+  if (!running_ || !found || queries_ >= kMaxQueries) return false;
+  Record record;
+  record.log = *found;
+  record.query = new HistoryQuery(query);
+  record.time = 0;
+  post(record);
+  ++queries_;
+  return true;
+}
+
+void HistoryLog::takeAnswers(std::vector<HistoryQuery>& answers) {
+  if (answers_) answers_->drain(answered_);
+  for (size_t i = 0; i < answered_.size(); ++i) {
+    answers.push_back(*answered_[i]);
+    delete answered_[i];
+  }
+  queries_ -= answered_.size();
+  answered_.clear();
+}
+
+void HistoryLog::retryBacklog() {
+  while (!backlog_.empty() && mailbox_->post(backlog_.front())) {
+    backlog_.pop_front();
+  }
+}
+
+bool HistoryLog::hasBacklog() const { return !backlog_.empty(); }
+
+void HistoryLog::post(const Record& record) {
+  retryBacklog();
+  if (!backlog_.empty() || !mailbox_->post(record)) {
+    backlog_.push_back(record);
+  }
+}
+
+void HistoryLog::loadSegments(ChannelLog* channel) {
+  DIR* dir = opendir(channel->path.c_str());
+  if (!dir) {
+    throw std::runtime_error(
+        createErrorMessage("opendir " + channel->path, errno));
+  }
+  std::vector<unsigned> numbers;
+  while (struct dirent* entry = readdir(dir)) {
+    std::string name(entry->d_name);
+    if (name.length() == 12 && name.compare(8, 4, ".log") == 0 &&
+        name.find_first_not_of("0123456789") == 8) {
+      numbers.push_back(
+          static_cast<unsigned>(std::strtoul(name.c_str(), NULL, 10)));
+    }
+  }
+  closedir(dir);
+  std::sort(numbers.begin(), numbers.end());
+  for (size_t i = 0; i < numbers.size(); ++i) {
+    HistorySegment segment;
+    segment.number = numbers[i];
+    segment.logBytes = fileSize(segmentPath(channel->path, numbers[i], "log"));
+    segment.indexBytes =
+        fileSize(segmentPath(channel->path, numbers[i], "idx"));
+    channel->segments.push_back(segment);
+  }
+  if (channel->segments.empty()) return;
+  recoverSegment(channel);
+  openSegment(channel, channel->segments.back().number);
+}
+
+void HistoryLog::recoverSegment(ChannelLog* channel) {
+  HistorySegment& last = channel->segments.back();
+  std::string logPath = segmentPath(channel->path, last.number, "log");
+  std::string indexPath = segmentPath(channel->path, last.number, "idx");
+  std::string rebuilt;
+  size_t entries = 0;
+  size_t offset = 0;
+  {
+    MappedFile logFile(logPath, last.logBytes);
+    MappedFile indexFile(indexPath, last.indexBytes -
+                                        last.indexBytes % kIndexEntryBytes);
+    // Entries of complete records, in order
+    while (entries < indexFile.size() / kIndexEntryBytes) {
+      BinaryReader reader(indexFile.data() + entries * kIndexEntryBytes,
+                          kIndexEntryBytes);
+      reader.readU64();
+      size_t entryOffset = static_cast<size_t>(reader.readU64());
+      if (entryOffset >= last.logBytes ||
+          (entries == 0 ? entryOffset != 0 : entryOffset <= offset)) {
+        break;
+      }
+      offset = entryOffset;
+      ++entries;
+    }
+    size_t records = entries > 0 ? (entries - 1) * kIndexInterval : 0;
+    HistoryMessage message;
+    while (offset < logFile.size()) {
+      size_t next;
+      try {
+        next = decodeRecord(logFile.data(), logFile.size(), offset, &message);
+      } catch (std::runtime_error&) {
+        break;
+      }
+      if (records % kIndexInterval == 0 &&
+          records / kIndexInterval >= entries) {
+        rebuilt += encodeIndexEntry(message.time, offset);
+      }
+      ++records;
+      offset = next;
+      channel->lastTime = message.time;
+    }
+    channel->records = records;
+  }
+
+  if (offset < last.logBytes) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_SYSTEM,
+        "History log: incomplete record cut from " + logPath);
+    if (truncate(logPath.c_str(), offset) < 0) {
+      throw std::runtime_error(
+          createErrorMessage("truncate " + logPath, errno));
+    }
+  }
+  size_t indexBytes = entries * kIndexEntryBytes;
+  if (indexBytes != last.indexBytes || !rebuilt.empty()) {
+    int fd = ::open(indexPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0640);
+    bool done = fd >= 0 && ftruncate(fd, indexBytes) == 0 &&
+                lseek(fd, 0, SEEK_END) >= 0 && writeAll(fd, rebuilt);
+    int errsv = errno;
+    if (fd >= 0) ::close(fd);
+    if (!done) {
+      throw std::runtime_error(createErrorMessage("write " + indexPath, errsv));
+    }
+  }
+  last.logBytes = offset;
+  last.indexBytes = indexBytes + rebuilt.size();
+}
+
+void HistoryLog::release() {
+  for (CaseMappedMap<ChannelLog*>::const_iterator it = channels_.begin();
+       it != channels_.end(); ++it) {
+    if (it->second->logFd >= 0) ::close(it->second->logFd);
+    if (it->second->indexFd >= 0) ::close(it->second->indexFd);
+    delete it->second;
+  }
+  channels_.clear();
+  for (size_t i = 0; i < backlog_.size(); ++i) delete backlog_[i].query;
+  backlog_.clear();
+  delete mailbox_;
+  mailbox_ = NULL;
+  // Answered by the writer before it stopped: still for takeAnswers()
+  if (answers_) answers_->drain(answered_);
+  delete answers_;
+  answers_ = NULL;
+  delete writerLoop_;
+  writerLoop_ = NULL;
+  if (lockFd_ >= 0) ::close(lockFd_);
+  lockFd_ = -1;
+}
+
+// ==========================================
+// Writer thread
+// ==========================================
+
+void* HistoryLog::runWriter(void* self) {
+  static_cast<HistoryLog*>(self)->writeRecords();
+  return NULL;
+}
+
+// Everything drained at one wakeup is one batch: one write and one sync
+// per file it touched. Its queries are answered after that, so they see
+// every message appended before them.
+void HistoryLog::writeRecords() {
+  struct epoll_event events[1];
+  std::vector<Record> records;
+  std::vector<Record> queries;
+  bool stopping = false;
+  while (!stopping) {
+    int n = writerLoop_->wait(events, 1, -1);
+    if (n < 0 && errno != EINTR) {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          createErrorMessage("History log writer: epoll_wait", errno));
+    }
+    if (n > 0) writerLoop_->consumeWakeup();
+    records.clear();
+    queries.clear();
+    mailbox_->drain(records);
+    for (size_t i = 0; i < records.size() && !stopping; ++i) {
+      if (records[i].query) {
+        queries.push_back(records[i]);
+      } else if (records[i].log) {
+        writeRecord(records[i]);
+      } else {
+        stopping = true;
+      }
+    }
+    for (CaseMappedMap<ChannelLog*>::const_iterator it = channels_.begin();
+         it != channels_.end(); ++it) {
+      if (it->second->pendingRecords > 0) flush(it->second);
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+      answer(queries[i].log, queries[i].query);
+    }
+  }
+}
+
+void HistoryLog::writeRecord(const Record& record) {
+  ChannelLog* channel = record.log;
+  size_t offset = channel->segments.empty()
+                      ? 0
+                      : channel->segments.back().logBytes +
+                            channel->logBuffer.size();
+  if (channel->logFd < 0 || (channel->records > 0 && offset >= segmentBytes_)) {
+    if (channel->pendingRecords > 0) flush(channel);
+    openSegment(channel, channel->segments.empty()
+                             ? 1
+                             : channel->segments.back().number + 1);
+    if (channel->logFd < 0) return;  // Logged by openSegment()
+    offset = 0;
+  }
+  if (channel->records % kIndexInterval == 0) {
+    channel->indexBuffer += encodeIndexEntry(record.time, offset);
+  }
+  channel->logBuffer += record.data;
+  ++channel->records;
+  ++channel->pendingRecords;
+}
+
+void HistoryLog::flush(ChannelLog* channel) {
+  HistorySegment& last = channel->segments.back();
+  if (writeAll(channel->logFd, channel->logBuffer) &&
+      writeAll(channel->indexFd, channel->indexBuffer) &&
+      fdatasync(channel->logFd) == 0 && fdatasync(channel->indexFd) == 0) {
+    last.logBytes += channel->logBuffer.size();
+    last.indexBytes += channel->indexBuffer.size();
+  } else {
+    // Back to the last complete state; the batch is lost
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        createErrorMessage("History log write to " + channel->path, errno));
+    if (ftruncate(channel->logFd, last.logBytes) < 0 ||
+        ftruncate(channel->indexFd, last.indexBytes) < 0) {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          createErrorMessage("History log truncate in " + channel->path,
+                             errno));
+    }
+    channel->records -= channel->pendingRecords;
+  }
+  channel->logBuffer.clear();
+  channel->indexBuffer.clear();
+  channel->pendingRecords = 0;
+}
+
+void HistoryLog::answer(const ChannelLog* channel, HistoryQuery* query) {
+  const std::vector<HistorySegment>& segments = channel->segments;
+  try {
+    SegmentSet set(channel->path, segments);
+    for (size_t i = 0; i < query->reads.size() && !segments.empty(); ++i) {
+      HistoryRead& read = query->reads[i];
+      if (read.limit == 0) continue;
+      if (read.side == HISTORY_BEFORE) {
+        Position end = {segments.size() - 1, segments.back().logBytes};
+        readBackward(set, read.hasRef ? seek(set, query->ref, true) : end,
+                     read.limit, &read.messages);
+      } else {
+        readForward(set, seek(set, query->ref, read.side == HISTORY_FROM),
+                    read.limit, &read.messages);
+      }
+    }
+  } catch (std::runtime_error& e) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        std::string("History log read failed: ") + e.what());
+  }
+  answers_->post(query);  // Never full: kMaxQueries at most are pending
+}
+
+// Open segment number for appending, a new one if it is not the last
+void HistoryLog::openSegment(ChannelLog* channel, unsigned number) {
+  if (channel->logFd >= 0) ::close(channel->logFd);
+  if (channel->indexFd >= 0) ::close(channel->indexFd);
+  std::string logPath = segmentPath(channel->path, number, "log");
+  std::string indexPath = segmentPath(channel->path, number, "idx");
+  int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+  channel->logFd = ::open(logPath.c_str(), flags, 0640);
+  channel->indexFd = ::open(indexPath.c_str(), flags, 0640);
+  if (channel->logFd < 0 || channel->indexFd < 0) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        createErrorMessage("History log open " + logPath, errno));
+    if (channel->logFd >= 0) ::close(channel->logFd);
+    if (channel->indexFd >= 0) ::close(channel->indexFd);
+    channel->logFd = -1;
+    channel->indexFd = -1;
+    return;
+  }
+  if (!channel->segments.empty() && channel->segments.back().number == number) {
+    return;
+  }
+  HistorySegment segment;
+  segment.number = number;
+  segment.logBytes = 0;
+  segment.indexBytes = 0;
+  channel->segments.push_back(segment);
+  channel->records = 0;
+}
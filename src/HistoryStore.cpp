@@ -0,0 +1,71 @@
+#include "HistoryStore.hpp"
+
+#include <set>
+#include <string>
+
+HistoryStore::HistoryStore() : bytes_(0), maxBytes_(0), maxMessages_(0) {}
+
+HistoryStore::~HistoryStore() { clear(); }
+
+void HistoryStore::setLimits(size_t maxBytes, size_t maxMessages) {
+  maxBytes_ = maxBytes;
+  maxMessages_ = maxMessages;
+  if (maxBytes_ == 0 || maxMessages_ == 0) {
+    clear();
+    return;
+  }
+  while (bytes_ > maxBytes_) evictOldest(byOldest_.begin()->second);
+}
+
+bool HistoryStore::isEnabled() const {
+  return maxBytes_ > 0 && maxMessages_ > 0;
+}
+
+size_t HistoryStore::getBytes() const { return bytes_; }
+
+void HistoryStore::record(const std::string& channel, long time,
+                          const std::string& source, const std::string& msgid,
+                          const std::string& text) {
+  if (!isEnabled()) return;
+  ChannelHistory** found = histories_.find(channel);
+  ChannelHistory* history = found ? *found : NULL;
+  if (!history) {
+    history = new ChannelHistory(channel);
+    histories_.set(channel, history);
+  }
+  bool wasEmpty = history->empty();
+  bytes_ += history->append(time, source, msgid, text);
+  if (wasEmpty) {
+    byOldest_.insert(OldestKey(history->getOldestTime(), history));
+  } else if (history->size() > maxMessages_) {
+    evictOldest(history);  // Not the last one: maxMessages_ > 0
+  }
+  // May evict the new message too (and delete history), if it is so large
+  while (bytes_ > maxBytes_) evictOldest(byOldest_.begin()->second);
+}
+
+const ChannelHistory* HistoryStore::find(const std::string& channel) const {
+  ChannelHistory* const* found = histories_.find(channel);
+  return found ? *found : NULL;
+}
+
+void HistoryStore::evictOldest(ChannelHistory* history) {
+  byOldest_.erase(OldestKey(history->getOldestTime(), history));
+  bytes_ -= history->evictOldest();
+  if (!history->empty()) {
+    byOldest_.insert(OldestKey(history->getOldestTime(), history));
+    return;
+  }
+  histories_.erase(history->getChannel());
+  delete history;
+}
+
+void HistoryStore::clear() {
+  for (CaseMappedMap<ChannelHistory*>::const_iterator it = histories_.begin();
+       it != histories_.end(); ++it) {
+    delete it->second;
+  }
+  histories_.clear();
+  byOldest_.clear();
+  bytes_ = 0;
+}
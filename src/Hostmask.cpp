@@ -0,0 +1,115 @@
+#include "Hostmask.hpp"
+
+#include <string>
+#include <vector>
+
+#include "ByteScan.hpp"
+
+namespace {
+std::string folded(const std::string& s) {
+  std::string result(s);
+  if (!result.empty()) foldCase(&result[0], result.length());
+  return result;
+}
+}  // namespace
+
+Hostmask::Hostmask(const std::string& mask)
+    : mask_(normalize(mask)),
+      hasStar_(false),
+      hasQuestion_(false),
+      minLength_(0) {
+  std::string pattern = folded(mask_);
+  hasQuestion_ = pattern.find('?') != std::string::npos;
+  size_t first = pattern.find('*');
+  if (first == std::string::npos) {
+    prefix_ = pattern;
+    minLength_ = pattern.length();
+    return;
+  }
+  hasStar_ = true;
+  size_t last = pattern.rfind('*');
+  prefix_ = pattern.substr(0, first);
+  suffix_ = pattern.substr(last + 1);
+  minLength_ = prefix_.length() + suffix_.length();
+  size_t start = first + 1;
+  while (start < last) {
+    size_t end = pattern.find('*', start);
+    if (end > start) {
+      middle_.push_back(pattern.substr(start, end - start));
+      minLength_ += end - start;
+    }
+    start = end + 1;
+  }
+}
+
+Hostmask::~Hostmask() {}
+
+std::string Hostmask::normalize(const std::string& mask) {
+  size_t bang = mask.find('!');
+  size_t at = mask.find('@', bang == std::string::npos ? 0 : bang);
+  std::string nick;
+  std::string user;
+  std::string host;
+  if (bang != std::string::npos) {
+    nick = mask.substr(0, bang);
+    user = mask.substr(bang + 1, at == std::string::npos ? std::string::npos
+                                                         : at - bang - 1);
+  } else if (at != std::string::npos) {
+    user = mask.substr(0, at);
+  } else {
+    nick = mask;
+  }
+  if (at != std::string::npos) host = mask.substr(at + 1);
+  return (nick.empty() ? "*" : nick) + "!" + (user.empty() ? "*" : user) +
+         "@" + (host.empty() ? "*" : host);
+}
+
+std::string Hostmask::makeTarget(const User* user) {
+  return folded(user->getNickname() + "!" + user->getUsername() + "@" +
+                user->getIp());
+}
+
+const std::string& Hostmask::getMask() const { return mask_; }
+
+bool Hostmask::matches(const std::string& target) const {
+  if (!hasStar_) {
+    return target.length() == prefix_.length() &&
+           matchesAt(prefix_, target, 0);
+  }
+  if (target.length() < minLength_) return false;
+  size_t suffixStart = target.length() - suffix_.length();
+  if (!matchesAt(prefix_, target, 0) ||
+      !matchesAt(suffix_, target, suffixStart)) {
+    return false;
+  }
+  // Leftmost match of each segment, between the prefix and the suffix
+  size_t pos = prefix_.length();
+  for (size_t i = 0; i < middle_.size(); ++i) {
+    pos = find(middle_[i], target, pos);
+    if (pos == std::string::npos || pos + middle_[i].length() > suffixStart) {
+      return false;
+    }
+    pos += middle_[i].length();
+  }
+  return true;
+}
+
+bool Hostmask::matchesAt(const std::string& segment, const std::string& target,
+                         size_t pos) const {
+  if (!hasQuestion_) {
+    return target.compare(pos, segment.length(), segment) == 0;
+  }
+  for (size_t i = 0; i < segment.length(); ++i) {
+    if (segment[i] != '?' && segment[i] != target[pos + i]) return false;
+  }
+  return true;
+}
+
+size_t Hostmask::find(const std::string& segment, const std::string& target,
+                      size_t pos) const {
+  if (!hasQuestion_) return target.find(segment, pos);
+  for (; pos + segment.length() <= target.length(); ++pos) {
+    if (matchesAt(segment, target, pos)) return pos;
+  }
+  return std::string::npos;
+}
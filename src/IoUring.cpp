@@ -0,0 +1,186 @@
+#include "IoUring.hpp"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "utils.hpp"
+
+// glibc has no wrappers for the io_uring system calls
+static int ioUringSetup(unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete,
+                        unsigned flags, const void* arg, size_t argSize) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit,
+                                  minComplete, flags, arg, argSize));
+}
+
+// Ring indices are shared with the kernel: loads of indices written by the
+// kernel need acquire semantics, publishing our own indices needs release
+static unsigned loadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void storeRelease(unsigned* p, unsigned value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+IoUring::IoUring()
+    : ringFd_(INVALID_FD),
+      ringMap_(MAP_FAILED),
+      ringMapSize_(0),
+      sqes_(NULL),
+      sqesMapSize_(0),
+      sqHead_(NULL),
+      sqTail_(NULL),
+      sqMask_(0),
+      sqArray_(NULL),
+      sqTailLocal_(0),
+      sqEntries_(0),
+      pending_(0),
+      cqHead_(NULL),
+      cqTail_(NULL),
+      cqMask_(0),
+      cqes_(NULL),
+      enterCount_(0) {}
+
+IoUring::~IoUring() {
+  if (sqes_ != NULL) munmap(sqes_, sqesMapSize_);
+  if (ringMap_ != MAP_FAILED) munmap(ringMap_, ringMapSize_);
+  if (ringFd_ != INVALID_FD) close(ringFd_);
+}
+
+void IoUring::setup(unsigned entries) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  // Multishot polls post a completion per readiness change, so leave plenty
+  // of room for them between two drains of the completion queue
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 8;
+
+  ringFd_ = ioUringSetup(entries, &params);
+  if (ringFd_ < 0) {
+    int errsv = errno;
+    ringFd_ = INVALID_FD;
+    throw std::runtime_error(createErrorMessage("io_uring_setup", errsv));
+  }
+  // No setup flag for it: keep the ring out of exec'd processes
+  fcntl(ringFd_, F_SETFD, FD_CLOEXEC);
+
+  // Required features:
+  // - SINGLE_MMAP (5.4): both rings live in one mapping
+  // - NODROP (5.5): completions are never dropped on overflow
+  // - EXT_ARG (5.11): io_uring_enter() accepts a timeout
+  // - RSRC_TAGS (5.13): no feature bit of its own exists for multishot
+  //   poll, which was added in the same release
+  const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                            IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+  if ((params.features & required) != required) {
+    throw std::runtime_error(
+        "io_uring_setup: kernel is too old (Linux 5.13 or later required)");
+  }
+
+  size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  size_t cqSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ringMapSize_ = sqSize > cqSize ? sqSize : cqSize;
+  ringMap_ = mmap(NULL, ringMapSize_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+  if (ringMap_ == MAP_FAILED) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("mmap", errsv));
+  }
+
+  sqesMapSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(NULL, sqesMapSize_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    int errsv = errno;
+    throw std::runtime_error(createErrorMessage("mmap", errsv));
+  }
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  char* ring = static_cast<char*>(ringMap_);
+  sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+  sqMask_ = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+  sqEntries_ = params.sq_entries;
+  sqTailLocal_ = *sqTail_;
+
+  cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+  cqMask_ = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(ring + params.cq_off.cqes);
+}
+
+struct io_uring_sqe* IoUring::getSqe() {
+  if (sqTailLocal_ - loadAcquire(sqHead_) >= sqEntries_) {
+    int ret = submitAndWait(0, 0);
+    if (ret < 0) {
+      throw std::runtime_error(createLog(
+          LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          createErrorMessage("io_uring_enter", -ret)));
+    }
+  }
+  unsigned index = sqTailLocal_ & sqMask_;
+  struct io_uring_sqe* sqe = &sqes_[index];
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqArray_[index] = index;
+  ++sqTailLocal_;
+  ++pending_;
+  return sqe;
+}
+
+void IoUring::publishPending() { storeRelease(sqTail_, sqTailLocal_); }
+
+int IoUring::submitAndWait(unsigned minComplete, int timeout) {
+  publishPending();
+
+  unsigned flags = 0;
+  const void* arg = NULL;
+  size_t argSize = 0;
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg getEventsArg;
+  if (minComplete > 0) {
+    flags |= IORING_ENTER_GETEVENTS;
+    if (timeout >= 0) {
+      ts.tv_sec = timeout / 1000;
+      ts.tv_nsec = (timeout % 1000) * 1000000L;
+      std::memset(&getEventsArg, 0, sizeof(getEventsArg));
+      getEventsArg.ts = reinterpret_cast<unsigned long>(&ts);
+      flags |= IORING_ENTER_EXT_ARG;
+      arg = &getEventsArg;
+      argSize = sizeof(getEventsArg);
+    }
+  }
+
+  ++enterCount_;
+  int ret = ioUringEnter(ringFd_, pending_, minComplete, flags, arg, argSize);
+  int errsv = errno;
+  // The kernel consumes SQEs even if waiting fails afterwards
+  pending_ = sqTailLocal_ - loadAcquire(sqHead_);
+  return ret < 0 ? -errsv : 0;
+}
+
+struct io_uring_cqe* IoUring::peekCqe() const {
+  unsigned head = *cqHead_;
+  if (head == loadAcquire(cqTail_)) return NULL;
+  return &cqes_[head & cqMask_];
+}
+
+void IoUring::advanceCq() { storeRelease(cqHead_, *cqHead_ + 1); }
+
+unsigned IoUring::getPendingCount() const { return pending_; }
+
+unsigned long IoUring::getEnterCount() const { return enterCount_; }
@@ -0,0 +1,1222 @@
+#include "LinkManager.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CommandRouter.hpp"
+#include "ResponseFormatter.hpp"
+#include "utils.hpp"
+
+const double LinkManager::kReconnectDelay = 5.0;
+const double LinkManager::kHandshakeTimeout = 10.0;
+
+namespace {
+const char* const kServerInfo = "ft_irc server";
+
+std::string longToString(long value) {
+  std::ostringstream oss;
+  oss << value;
+  return oss.str();
+}
+
+// Parse a non-negative decimal number (timestamps, limits)
+// Returns: -1 if str is empty, too long or contains non-digits
+long parseNumber(const std::string& str) {
+  if (str.empty() || str.length() > 18) return -1;
+  long result = 0;
+  for (size_t i = 0; i < str.length(); ++i) {
+    if (str[i] < '0' || str[i] > '9') return -1;
+    result = result * 10 + (str[i] - '0');
+  }
+  return result;
+}
+
+// Fill address for a numeric host ("*": all addresses, dual-stack)
+socklen_t makeAddress(const ListenAddress& listenAddress,
+                      struct sockaddr_storage& address) {
+  std::memset(&address, 0, sizeof(address));
+  if (listenAddress.host == "*" ||
+      listenAddress.host.find(':') != std::string::npos) {
+    struct sockaddr_in6* addr6 =
+        reinterpret_cast<struct sockaddr_in6*>(&address);
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_port = htons(listenAddress.port);
+    if (listenAddress.host == "*") {
+      addr6->sin6_addr = in6addr_any;
+    } else {
+      inet_pton(AF_INET6, listenAddress.host.c_str(), &addr6->sin6_addr);
+    }
+    return sizeof(*addr6);
+  }
+  struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&address);
+  addr4->sin_family = AF_INET;
+  addr4->sin_port = htons(listenAddress.port);
+  inet_pton(AF_INET, listenAddress.host.c_str(), &addr4->sin_addr);
+  return sizeof(*addr4);
+}
+
+// Relayed lines are small and must not wait for the previous one's ACK
+void disableNagle(int fd) {
+  int opt = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+}
+
+std::string formatAddress(const ListenAddress& address) {
+  std::string host = address.host;
+  if (host.find(':') != std::string::npos) host = "[" + host + "]";
+  return host + ":" + int_to_string(address.port);
+}
+
+std::string formatPeerAddress(const struct sockaddr_storage& address) {
+  char host[INET6_ADDRSTRLEN] = "?";
+  int port = 0;
+  if (address.ss_family == AF_INET6) {
+    const struct sockaddr_in6* addr6 =
+        reinterpret_cast<const struct sockaddr_in6*>(&address);
+    inet_ntop(AF_INET6, &addr6->sin6_addr, host, sizeof(host));
+    port = ntohs(addr6->sin6_port);
+    return std::string("[") + host + "]:" + int_to_string(port);
+  }
+  const struct sockaddr_in* addr4 =
+      reinterpret_cast<const struct sockaddr_in*>(&address);
+  inet_ntop(AF_INET, &addr4->sin_addr, host, sizeof(host));
+  port = ntohs(addr4->sin_port);
+  return std::string(host) + ":" + int_to_string(port);
+}
+}  // namespace
+
+LinkManager::LinkManager(EventLoop* eventLoop, UserManager* userMgr,
+                         ChannelManager* chanMgr, CommandRouter* cmdRouter)
+    : eventLoop_(eventLoop),
+      userManager_(userMgr),
+      channelManager_(chanMgr),
+      cmdRouter_(cmdRouter),
+      listenFd_(INVALID_FD),
+      nextRemoteId_(-2),
+      nextUid_(1) {}
+
+LinkManager::~LinkManager() {
+  // Remote users are deleted by the UserManager
+  for (std::map<int, Link>::iterator it = links_.begin(); it != links_.end();
+       ++it) {
+    close(it->first);
+  }
+  if (listenFd_ != INVALID_FD) close(listenFd_);
+}
+
+// ==========================================
+// Setup
+// ==========================================
+
+void LinkManager::start(const ServerConfig& config) {
+  serverName_ = config.serverName;
+  password_ = config.linkPassword;
+  listenAddress_ = config.linkListen;
+  peers_.clear();
+  for (size_t i = 0; i < config.linkPeers.size(); ++i) {
+    Peer peer;
+    peer.address = config.linkPeers[i];
+    peers_.push_back(peer);
+  }
+  listen();
+}
+
+void LinkManager::stop() {
+  while (!links_.empty()) closeLink(links_.begin()->first, "Restarting");
+  if (listenFd_ != INVALID_FD) {
+    eventLoop_->removeFd(listenFd_);
+    close(listenFd_);
+    listenFd_ = INVALID_FD;
+  }
+}
+
+const std::string& LinkManager::getServerName() const { return serverName_; }
+
+void LinkManager::listen() {
+  if (listenAddress_.port == 0) return;
+
+  struct sockaddr_storage address;
+  socklen_t addressLen = makeAddress(listenAddress_, address);
+  listenFd_ =
+      socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (listenFd_ < 0) {
+    int errsv = errno;
+    listenFd_ = INVALID_FD;
+    throw std::runtime_error(createErrorMessage("socket", errsv));
+  }
+
+  try {
+    int opt = 1;
+    if (setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) <
+        0) {
+      int errsv = errno;
+      throw std::runtime_error(createErrorMessage("setsockopt", errsv));
+    }
+    if (address.ss_family == AF_INET6) {
+      int v6only = listenAddress_.host == "*" ? 0 : 1;
+      if (setsockopt(listenFd_, IPPROTO_IPV6, IPV6_V6ONLY, &v6only,
+                     sizeof(v6only)) < 0) {
+        int errsv = errno;
+        throw std::runtime_error(createErrorMessage("setsockopt", errsv));
+      }
+    }
+    if (bind(listenFd_, reinterpret_cast<struct sockaddr*>(&address),
+             addressLen) < 0) {
+      int errsv = errno;
+      throw std::runtime_error(createErrorMessage("bind", errsv) +
+                               " (link listener " +
+                               formatAddress(listenAddress_) + ")");
+    }
+    int backlog = listenAddress_.backlog > 0 ? listenAddress_.backlog
+                                             : kMaxQueue;
+    if (::listen(listenFd_, backlog) < 0) {
+      int errsv = errno;
+      throw std::runtime_error(createErrorMessage("listen", errsv));
+    }
+    eventLoop_->addFd(listenFd_, EPOLLIN);
+  } catch (...) {
+    close(listenFd_);
+    listenFd_ = INVALID_FD;
+    throw;
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Link listener started on " + formatAddress(listenAddress_) + " as " +
+          serverName_);
+}
+
+// ==========================================
+// Connections
+// ==========================================
+
+bool LinkManager::ownsFd(int fd) const {
+  if (fd == INVALID_FD) return false;
+  return fd == listenFd_ || links_.find(fd) != links_.end();
+}
+
+void LinkManager::handleEvent(int fd, uint32_t events) {
+  if (fd == listenFd_) {
+    if (events & EPOLLIN) acceptLinks();
+    return;
+  }
+
+  std::map<int, Link>::iterator it = links_.find(fd);
+  if (it == links_.end()) return;
+
+  if (it->second.state == LINK_CONNECTING) {
+    finishConnect(fd, it->second);
+    return;
+  }
+  // Read first: the peer may have sent an ERROR before closing
+  if (events & EPOLLIN) {
+    handleRead(fd);
+    if (links_.find(fd) == links_.end()) return;
+  }
+  if (events & (EPOLLERR | EPOLLHUP)) {
+    closeLink(fd, "Connection closed");
+    return;
+  }
+  if (events & EPOLLOUT) writeLink(fd);
+}
+
+void LinkManager::acceptLinks() {
+  // Edge-triggered: accept all pending connections
+  while (true) {
+    struct sockaddr_storage address;
+    socklen_t addressLen = sizeof(address);
+    int fd = accept4(listenFd_, reinterpret_cast<struct sockaddr*>(&address),
+                     &addressLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+            createErrorMessage("accept4 (link)", errno));
+      }
+      return;
+    }
+
+    if (links_.size() >= kMaxLinks) {
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+          "Too many server links, rejecting");
+      close(fd);
+      continue;
+    }
+
+    disableNagle(fd);
+    try {
+      eventLoop_->addFd(fd, EPOLLIN);
+    } catch (const std::exception& e) {
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK, e.what());
+      close(fd);
+      continue;
+    }
+    Link link;
+    link.address = formatPeerAddress(address);
+    link.deadline = getMonotonicTime() + kHandshakeTimeout;
+    links_[fd] = link;
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+        "Incoming server link from " + link.address);
+  }
+}
+
+void LinkManager::runTimers() {
+  double now = getMonotonicTime();
+  for (size_t i = 0; i < peers_.size(); ++i) {
+    if (peers_[i].fd == INVALID_FD && now >= peers_[i].nextAttempt) {
+      connectPeer(i);
+    }
+  }
+
+  // Collected first: closeLink() erases from links_
+  std::vector<int> expired;
+  for (std::map<int, Link>::const_iterator it = links_.begin();
+       it != links_.end(); ++it) {
+    if (it->second.state != LINK_ACTIVE && now >= it->second.deadline) {
+      expired.push_back(it->first);
+    }
+  }
+  for (size_t i = 0; i < expired.size(); ++i) {
+    closeLink(expired[i], "Handshake timed out");
+  }
+}
+
+int LinkManager::getTimeoutMs() const {
+  int timeout = -1;
+  double now = getMonotonicTime();
+  for (size_t i = 0; i < peers_.size(); ++i) {
+    if (peers_[i].fd != INVALID_FD) continue;
+    double remaining = peers_[i].nextAttempt - now;
+    int ms = remaining > 0 ? static_cast<int>(remaining * 1000) + 1 : 0;
+    if (timeout < 0 || ms < timeout) timeout = ms;
+  }
+  for (std::map<int, Link>::const_iterator it = links_.begin();
+       it != links_.end(); ++it) {
+    if (it->second.state == LINK_ACTIVE) continue;
+    double remaining = it->second.deadline - now;
+    int ms = remaining > 0 ? static_cast<int>(remaining * 1000) + 1 : 0;
+    if (timeout < 0 || ms < timeout) timeout = ms;
+  }
+  return timeout;
+}
+
+void LinkManager::connectPeer(size_t index) {
+  Peer& peer = peers_[index];
+  peer.nextAttempt = getMonotonicTime() + kReconnectDelay;
+  std::string description = formatAddress(peer.address);
+
+  struct sockaddr_storage address;
+  socklen_t addressLen = makeAddress(peer.address, address);
+  int fd =
+      socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+        "Link to " + description + " failed: " +
+            createErrorMessage("socket", errno));
+    return;
+  }
+  disableNagle(fd);
+  if (connect(fd, reinterpret_cast<struct sockaddr*>(&address), addressLen) <
+          0 &&
+      errno != EINPROGRESS) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+        "Link to " + description + " failed: " +
+            createErrorMessage("connect", errno));
+    close(fd);
+    return;
+  }
+  // Writable once the connection is established (or has failed)
+  try {
+    eventLoop_->addFd(fd, EPOLLIN | EPOLLOUT);
+  } catch (const std::exception& e) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK, e.what());
+    close(fd);
+    return;
+  }
+  Link link;
+  link.state = LINK_CONNECTING;
+  link.peerIndex = static_cast<int>(index);
+  link.address = description;
+  link.writeArmed = true;
+  link.deadline = getMonotonicTime() + kHandshakeTimeout;
+  links_[fd] = link;
+  peer.fd = fd;
+}
+
+void LinkManager::finishConnect(int fd, Link& link) {
+  int error = 0;
+  socklen_t errorLen = sizeof(error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLen) < 0) {
+    error = errno;
+  }
+  if (error != 0) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+        "Link to " + link.address + " failed: " +
+            createErrorMessage("connect", error));
+    closeLink(fd, "");
+    return;
+  }
+  link.state = LINK_HANDSHAKE;
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+      "Connected to " + link.address + ", sending handshake");
+  queue(fd, "SERVER " + serverName_ + " " + password_ + " :" + kServerInfo +
+                "\r\n");
+  writeLink(fd);
+}
+
+void LinkManager::handleRead(int fd) {
+  std::string data;
+  data.swap(links_[fd].readBuffer);
+  bool closed = false;
+  char buffer[4096];
+
+  // Read all available data (edge-triggered mode)
+  while (true) {
+    ssize_t bytesRead = recv(fd, buffer, sizeof(buffer), 0);
+    if (bytesRead > 0) {
+      data.append(buffer, bytesRead);
+    } else if (bytesRead == 0) {
+      closed = true;
+      break;
+    } else {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK) closed = true;
+      break;
+    }
+  }
+
+  // Handle complete lines; any of them may close the link
+  size_t start = 0;
+  while (true) {
+    size_t newline = data.find('\n', start);
+    if (newline == std::string::npos) break;
+    size_t end = newline;
+    if (end > start && data[end - 1] == '\r') --end;
+    if (end > start) handleLine(fd, data.substr(start, end - start));
+    start = newline + 1;
+    if (links_.find(fd) == links_.end()) return;
+  }
+  data.erase(0, start);
+
+  if (closed) {
+    closeLink(fd, "Connection closed");
+  } else if (data.size() > kMaxReadBuffer) {
+    closeLink(fd, "Line too long");
+  } else {
+    links_[fd].readBuffer.swap(data);
+  }
+}
+
+void LinkManager::queue(int fd, const std::string& line) {
+  std::map<int, Link>::iterator it = links_.find(fd);
+  if (it == links_.end() || it->second.overflowed) return;
+  if (it->second.writeBuffer.size() + line.size() > kMaxWriteBuffer) {
+    // Closed by flush(): the caller may be iterating over the links
+    it->second.overflowed = true;
+  } else {
+    it->second.writeBuffer += line;
+  }
+  pendingWrites_.insert(fd);
+}
+
+void LinkManager::sendToAll(const std::string& line, int exceptFd) {
+  for (std::map<int, Link>::iterator it = links_.begin(); it != links_.end();
+       ++it) {
+    if (it->first != exceptFd && it->second.state == LINK_ACTIVE) {
+      queue(it->first, line);
+    }
+  }
+}
+
+void LinkManager::flush() {
+  // Closing a link relays the netsplit to the others: repeat until done
+  while (!pendingWrites_.empty()) {
+    std::set<int> fds;
+    fds.swap(pendingWrites_);
+    for (std::set<int>::iterator it = fds.begin(); it != fds.end(); ++it) {
+      std::map<int, Link>::iterator link = links_.find(*it);
+      if (link == links_.end()) continue;
+      if (link->second.overflowed) {
+        closeLink(*it, "SendQ exceeded");
+      } else {
+        writeLink(*it);
+      }
+    }
+  }
+}
+
+void LinkManager::writeLink(int fd) {
+  std::map<int, Link>::iterator it = links_.find(fd);
+  if (it == links_.end() || it->second.state == LINK_CONNECTING) return;
+  Link& link = it->second;
+
+  size_t sent = 0;
+  while (sent < link.writeBuffer.size()) {
+    ssize_t bytesSent =
+        ::send(fd, link.writeBuffer.data() + sent,
+               link.writeBuffer.size() - sent, MSG_NOSIGNAL);
+    if (bytesSent > 0) {
+      sent += bytesSent;
+    } else if (bytesSent < 0 && errno == EINTR) {
+      continue;
+    } else if (bytesSent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      link.writeBuffer.erase(0, sent);
+      if (!link.writeArmed) {
+        eventLoop_->modifyFd(fd, EPOLLIN | EPOLLOUT);
+        link.writeArmed = true;
+      }
+      return;
+    } else {
+      closeLink(fd, createErrorMessage("send", errno));
+      return;
+    }
+  }
+  link.writeBuffer.clear();
+  if (link.writeArmed) {
+    eventLoop_->modifyFd(fd, EPOLLIN);
+    link.writeArmed = false;
+  }
+}
+
+void LinkManager::closeLink(int fd, const std::string& reason) {
+  std::map<int, Link>::iterator it = links_.find(fd);
+  if (it == links_.end()) return;
+  Link link = it->second;
+
+  // Best effort: tell the peer why
+  if (!reason.empty() && link.state != LINK_CONNECTING) {
+    std::string error = "ERROR :" + reason + "\r\n";
+    ::send(fd, error.data(), error.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+  }
+  links_.erase(it);
+  pendingWrites_.erase(fd);
+  eventLoop_->removeFd(fd);
+  close(fd);
+
+  if (link.peerIndex >= 0) {
+    peers_[link.peerIndex].fd = INVALID_FD;
+    peers_[link.peerIndex].nextAttempt =
+        getMonotonicTime() + kReconnectDelay;
+  }
+  if (link.state != LINK_ACTIVE) {
+    if (!reason.empty()) {
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+          "Link " + link.address + " closed: " + reason);
+    }
+    return;
+  }
+
+  // Netsplit: everything behind the link is gone
+  log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+      "Link with " + link.name + " closed: " + reason);
+  std::vector<std::string> params;
+  params.push_back(link.name);
+  params.push_back(reason);
+  sendToAll(formatLine(serverName_, "SQUIT", params), INVALID_FD);
+  std::set<std::string> names;
+  for (std::map<std::string, RemoteServer>::iterator server = servers_.begin();
+       server != servers_.end(); ++server) {
+    if (server->second.linkFd == fd) names.insert(server->first);
+  }
+  dropServers(names, serverName_ + " " + link.name, true);
+}
+
+void LinkManager::takeKilledUsers(std::vector<int>& fds) {
+  fds.clear();
+  fds.swap(killedUsers_);
+}
+
+// ==========================================
+// Protocol
+// ==========================================
+
+void LinkManager::handleLine(int fd, const std::string& line) {
+  std::string source;
+  std::string rest = line;
+  if (line[0] == ':') {
+    size_t space = line.find(' ');
+    if (space == std::string::npos || space == 1) return;
+    source = line.substr(1, space - 1);
+    rest = line.substr(space + 1);
+  }
+
+  Command cmd;
+  ParseResult result = parser_.parse(rest, cmd);
+  if (result != PARSE_OK) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_NETWORK,
+        "Invalid line from link " + links_[fd].address + ": " +
+            CommandParser::getErrorMessage(result));
+    return;
+  }
+
+  Link& link = links_[fd];
+  if (cmd.command == "ERROR") {
+    closeLink(fd, "Peer: " + (cmd.params.empty() ? "" : cmd.params[0]));
+    return;
+  }
+  if (link.state != LINK_ACTIVE) {
+    handleHandshake(fd, link, cmd);
+    return;
+  }
+
+  // Only accept sources that are behind this link
+  if (source.find('/') != std::string::npos) {
+    User* user = userManager_->getUserByUid(source);
+    if (!user || user->getLinkFd() != fd) {
+      log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
+          "Dropped " + cmd.command + " from unknown user " + source);
+      return;
+    }
+    handleUserMessage(fd, user, cmd, line + "\r\n");
+    return;
+  }
+  std::map<std::string, RemoteServer>::iterator server =
+      servers_.find(source);
+  if (server == servers_.end() || server->second.linkFd != fd) {
+    log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
+        "Dropped " + cmd.command + " from unknown server " + source);
+    return;
+  }
+  handleServerMessage(fd, source, cmd, line + "\r\n");
+}
+
+void LinkManager::handleHandshake(int fd, Link& link, const Command& cmd) {
+  if (cmd.command != "SERVER" || cmd.params.size() < 3) {
+    closeLink(fd, "Expected SERVER");
+    return;
+  }
+  const std::string& name = cmd.params[0];
+  if (cmd.params[1] != password_) {
+    closeLink(fd, "Bad link password");
+    return;
+  }
+  if (!ServerConfig::isValidServerName(name)) {
+    closeLink(fd, "Invalid server name");
+    return;
+  }
+  if (name == serverName_ || servers_.find(name) != servers_.end()) {
+    closeLink(fd, "Server " + name + " already exists");
+    return;
+  }
+
+  // An incoming link answers with its own SERVER line
+  if (link.peerIndex < 0) {
+    queue(fd, "SERVER " + serverName_ + " " + password_ + " :" +
+                  kServerInfo + "\r\n");
+  }
+  link.state = LINK_ACTIVE;
+  link.name = name;
+  RemoteServer server;
+  server.linkFd = fd;
+  server.uplink = serverName_;
+  server.info = cmd.params[2];
+  servers_[name] = server;
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+      "Link established with " + name + " (" + link.address + ")");
+
+  sendBurst(fd);
+  std::vector<std::string> params;
+  params.push_back(name);
+  params.push_back(server.info);
+  sendToAll(formatLine(serverName_, "SERVER", params), fd);
+}
+
+void LinkManager::handleServerMessage(int fd, const std::string& source,
+                                      const Command& cmd,
+                                      const std::string& line) {
+  const std::vector<std::string>& params = cmd.params;
+  if (cmd.command == "SERVER" && params.size() >= 2) {
+    introduceServer(fd, source, params[0], params[1], line);
+  } else if (cmd.command == "UID" && params.size() >= 6) {
+    addRemoteUser(fd, source, cmd, line);
+  } else if (cmd.command == "CHANNEL" && params.size() >= 3) {
+    mergeChannel(fd, cmd, line);
+  } else if (cmd.command == "TOPIC" && params.size() >= 2) {
+    mergeTopic(fd, source, cmd, line);
+  } else if (cmd.command == "BMASK" && params.size() >= 3) {
+    mergeMasks(fd, source, cmd, line);
+  } else if (cmd.command == "MODE" && params.size() >= 3) {
+    grantOperator(fd, source, cmd, line);
+  } else if (cmd.command == "KILL" && !params.empty()) {
+    User* user = userManager_->getUserByUid(params[0]);
+    if (user) killUser(user, params.size() > 1 ? params[1] : "Killed", fd);
+  } else if (cmd.command == "SQUIT" && !params.empty()) {
+    squitServer(fd, params[0], line);
+  } else {
+    log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
+        "Ignored " + cmd.command + " from server " + source);
+  }
+}
+
+void LinkManager::handleUserMessage(int fd, User* user, const Command& cmd,
+                                    const std::string& line) {
+  if (cmd.command == "NICK" && cmd.params.size() >= 2) {
+    changeRemoteNick(fd, user, cmd, line);
+  } else if (cmd.command == "QUIT") {
+    sendToAll(line, fd);
+    removeRemoteUser(user, cmd.params.empty() ? "Quit" : cmd.params[0]);
+  } else {
+    // Relayed further by the command handlers
+    cmdRouter_->processRemote(user, cmd);
+  }
+}
+
+// Everything this side of the new link, uplinks before the servers behind
+// them, then users and channels
+void LinkManager::sendBurst(int fd) {
+  std::set<std::string> sent;
+  sent.insert(serverName_);
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (std::map<std::string, RemoteServer>::iterator it = servers_.begin();
+         it != servers_.end(); ++it) {
+      if (it->second.linkFd == fd || sent.count(it->first) > 0 ||
+          sent.count(it->second.uplink) == 0) {
+        continue;
+      }
+      std::vector<std::string> params;
+      params.push_back(it->first);
+      params.push_back(it->second.info);
+      queue(fd, formatLine(it->second.uplink, "SERVER", params));
+      sent.insert(it->first);
+      progress = true;
+    }
+  }
+
+  const std::map<int, User*>& users = userManager_->getUsers();
+  for (std::map<int, User*>::const_iterator it = users.begin();
+       it != users.end(); ++it) {
+    User* user = it->second;
+    if (!user->isRegistered() || user->getLinkFd() == fd) continue;
+    queue(fd, formatIntroduction(user));
+    if (!user->getAwayMessage().empty()) {
+      std::vector<std::string> params(1, user->getAwayMessage());
+      queue(fd, formatLine(getUid(user), "AWAY", params));
+    }
+  }
+
+  const CaseMappedMap<Channel*>& channels =
+      channelManager_->getChannels();
+  for (CaseMappedMap<Channel*>::const_iterator it = channels.begin();
+       it != channels.end(); ++it) {
+    sendChannelBurst(fd, it->second);
+  }
+}
+
+void LinkManager::sendChannelBurst(int fd, const Channel* channel) {
+  std::vector<std::string> params;
+  params.push_back(channel->getName());
+  std::string modes = "+";
+  std::vector<std::string> args;
+  if (channel->isInviteOnly()) modes += "i";
+  if (channel->isTopicRestricted()) modes += "t";
+  if (!channel->getKey().empty()) {
+    modes += "k";
+    args.push_back(channel->getKey());
+  }
+  if (channel->hasUserLimit()) {
+    modes += "l";
+    args.push_back(longToString(static_cast<long>(channel->getUserLimit())));
+  }
+  params.push_back(modes);
+  params.insert(params.end(), args.begin(), args.end());
+
+  // Split the member list to stay within the line length limit
+  std::vector<std::string> lines;
+  std::string members;
+  const std::set<int>& memberFds = channel->getMembers();
+  for (std::set<int>::const_iterator it = memberFds.begin();
+       it != memberFds.end(); ++it) {
+    User* user = userManager_->getUserByFd(*it);
+    if (!user || user->getLinkFd() == fd) continue;
+    if (members.length() > kMaxBurstLine) {
+      lines.push_back(members);
+      members.clear();
+    }
+    if (!members.empty()) members += " ";
+    if (channel->isOperator(*it)) members += "@";
+    members += getUid(user);
+  }
+  // Channels restored from a snapshot wait for their members locally
+  if (members.empty()) return;
+  lines.push_back(members);
+
+  for (size_t i = 0; i < lines.size(); ++i) {
+    params.push_back(lines[i]);
+    queue(fd, formatLine(serverName_, "CHANNEL", params));
+    params.pop_back();
+  }
+  if (!channel->getTopic().empty()) {
+    std::vector<std::string> topicParams;
+    topicParams.push_back(channel->getName());
+    topicParams.push_back(channel->getTopic());
+    queue(fd, formatLine(serverName_, "TOPIC", topicParams));
+  }
+
+  static const char* const kListModes[MASK_LIST_COUNT] = {"b", "e", "I"};
+  for (int list = 0; list < MASK_LIST_COUNT; ++list) {
+    const std::vector<MaskEntry>& masks =
+        channel->getMasks(static_cast<MaskList>(list));
+    std::vector<std::string> maskParams;
+    maskParams.push_back(channel->getName());
+    maskParams.push_back(kListModes[list]);
+    std::string masksLine;
+    for (size_t i = 0; i < masks.size(); ++i) {
+      if (masksLine.length() > kMaxBurstLine) {
+        maskParams.push_back(masksLine);
+        queue(fd, formatLine(serverName_, "BMASK", maskParams));
+        maskParams.pop_back();
+        masksLine.clear();
+      }
+      if (!masksLine.empty()) masksLine += " ";
+      masksLine += masks[i].mask.getMask();
+    }
+    if (masksLine.empty()) continue;
+    maskParams.push_back(masksLine);
+    queue(fd, formatLine(serverName_, "BMASK", maskParams));
+  }
+}
+
+void LinkManager::introduceServer(int fd, const std::string& uplink,
+                                  const std::string& name,
+                                  const std::string& info,
+                                  const std::string& line) {
+  // A server we already know means that the links form a cycle
+  if (name == serverName_ || servers_.find(name) != servers_.end() ||
+      !ServerConfig::isValidServerName(name)) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_NETWORK,
+        "Server " + name + " introduced twice, closing the link with " +
+            links_[fd].name);
+    closeLink(fd, "Server " + name + " already exists");
+    return;
+  }
+  RemoteServer server;
+  server.linkFd = fd;
+  server.uplink = uplink;
+  server.info = info;
+  servers_[name] = server;
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+      "Server " + name + " joined the network behind " + uplink);
+  sendToAll(line, fd);
+}
+
+void LinkManager::addRemoteUser(int fd, const std::string& server,
+                                const Command& cmd, const std::string& line) {
+  const std::string& uid = cmd.params[0];
+  const std::string& nickname = cmd.params[1];
+  long nickTime = parseNumber(cmd.params[2]);
+  if (nickTime < 0 || userManager_->getUserByUid(uid)) return;
+
+  User* existing = userManager_->getUserByNickname(nickname);
+  if (existing) {
+    if (!winsCollision(nickTime, uid, existing)) {
+      // Not forwarded: only the user's side knows it
+      log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+          "Nickname collision on " + nickname + ", rejecting " + uid);
+      std::vector<std::string> params;
+      params.push_back(uid);
+      params.push_back("Nickname collision");
+      queue(fd, formatLine(serverName_, "KILL", params));
+      return;
+    }
+    killUser(existing, "Nickname collision", INVALID_FD);
+  }
+
+  User* user = new User(nextRemoteId_--, cmd.params[4]);
+  user->setRemote(server, fd);
+  user->setUid(uid);
+  user->setUsername(cmd.params[3]);
+  user->setRealname(cmd.params[5]);
+  user->setNickTime(nickTime);
+  user->setAuthenticated(true);
+  user->setRegistered(true);
+  userManager_->addUser(user);
+  userManager_->updateNickname(user, "", nickname);
+  cmdRouter_->announceSignOn(user);
+  sendToAll(line, fd);
+}
+
+void LinkManager::changeRemoteNick(int fd, User* user, const Command& cmd,
+                                   const std::string& line) {
+  const std::string& nickname = cmd.params[0];
+  long nickTime = parseNumber(cmd.params[1]);
+  if (nickTime < 0) return;
+
+  User* existing = userManager_->getUserByNickname(nickname);
+  if (existing && existing != user) {
+    if (!winsCollision(nickTime, user->getUid(), existing)) {
+      killUser(user, "Nickname collision", INVALID_FD);
+      return;
+    }
+    killUser(existing, "Nickname collision", INVALID_FD);
+  }
+  cmdRouter_->announceNick(user, nickname);
+  userManager_->updateNickname(user, user->getNickname(), nickname);
+  user->setNickTime(nickTime);
+  sendToAll(line, fd);
+}
+
+// Burst modes are merged so that both sides end up with the same channel:
+// +i and +t if either side has them, the smaller key and limit
+void LinkManager::mergeChannel(int fd, const Command& cmd,
+                               const std::string& line) {
+  const std::vector<std::string>& params = cmd.params;
+  const std::string& name = params[0];
+  Channel* channel = channelManager_->getChannel(name);
+  bool created = false;
+  if (!channel) {
+    channel = channelManager_->createChannel(name);
+    if (!channel) return;
+    created = true;
+  }
+
+  const std::string& modes = params[1];
+  size_t argIndex = 2;
+  size_t argEnd = params.size() - 1;  // The last parameter lists members
+  bool inviteOnly = false;
+  bool topicRestricted = false;
+  for (size_t i = 0; i < modes.length(); ++i) {
+    if (modes[i] == 'i') {
+      inviteOnly = true;
+    } else if (modes[i] == 't') {
+      topicRestricted = true;
+    } else if (modes[i] == 'k' && argIndex < argEnd) {
+      const std::string& key = params[argIndex++];
+      if (channel->getKey().empty() || key < channel->getKey()) {
+        channel->setKey(key);
+      }
+    } else if (modes[i] == 'l' && argIndex < argEnd) {
+      long limit = parseNumber(params[argIndex++]);
+      if (limit > 0 && (!channel->hasUserLimit() ||
+                        static_cast<size_t>(limit) < channel->getUserLimit())) {
+        channel->setUserLimit(static_cast<size_t>(limit));
+      }
+    }
+  }
+  if (created || inviteOnly) channel->setInviteOnly(inviteOnly);
+  if (created || topicRestricted) channel->setTopicRestricted(topicRestricted);
+
+  const std::string& members = params[argEnd];
+  size_t start = 0;
+  while (start < members.length()) {
+    size_t end = members.find(' ', start);
+    if (end == std::string::npos) end = members.length();
+    std::string uid = members.substr(start, end - start);
+    start = end + 1;
+    bool op = !uid.empty() && uid[0] == '@';
+    if (op) uid.erase(0, 1);
+
+    User* user = userManager_->getUserByUid(uid);
+    if (!user || user->getLinkFd() != fd) continue;
+    int id = user->getSocketFd();
+    if (!channel->isMember(id)) {
+      channel->addMember(id);
+      user->joinChannel(channel);
+      deliverToChannel(channel,
+                       ResponseFormatter::rplJoin(user, channel->getName()));
+    }
+    if (op && !channel->isOperator(id)) {
+      channel->addOperator(id);
+      deliverToChannel(channel, ":" + user->getServer() + " MODE " +
+                                    channel->getName() + " +o " +
+                                    user->getNickname() + "\r\n");
+    }
+  }
+  if (channel->getMemberCount() == 0) {
+    channelManager_->removeChannel(name);
+    return;
+  }
+  sendToAll(line, fd);
+}
+
+// Mask lists of a burst: both sides keep the union
+void LinkManager::mergeMasks(int fd, const std::string& server,
+                             const Command& cmd, const std::string& line) {
+  Channel* channel = channelManager_->getChannel(cmd.params[0]);
+  MaskList list;
+  if (!channel || cmd.params[1].length() != 1) return;
+  if (cmd.params[1] == "b") {
+    list = MASK_LIST_BAN;
+  } else if (cmd.params[1] == "e") {
+    list = MASK_LIST_EXCEPTION;
+  } else if (cmd.params[1] == "I") {
+    list = MASK_LIST_INVITE_EXCEPTION;
+  } else {
+    return;
+  }
+  sendToAll(line, fd);
+
+  const std::string& masks = cmd.params[2];
+  long now = static_cast<long>(std::time(NULL));
+  size_t start = 0;
+  while (start < masks.length()) {
+    size_t end = masks.find(' ', start);
+    if (end == std::string::npos) end = masks.length();
+    std::string mask = masks.substr(start, end - start);
+    start = end + 1;
+    if (mask.empty() || !channel->addMask(list, mask, server, now)) continue;
+    const std::string& added = channel->getMasks(list).back().mask.getMask();
+    deliverToChannel(channel, ":" + server + " MODE " + channel->getName() +
+                                  " +" + cmd.params[1] + " " + added + "\r\n");
+  }
+}
+
+// Topics of a burst: both sides keep the greater one
+void LinkManager::mergeTopic(int fd, const std::string& server,
+                             const Command& cmd, const std::string& line) {
+  Channel* channel = channelManager_->getChannel(cmd.params[0]);
+  if (!channel) return;
+  sendToAll(line, fd);
+  const std::string& topic = cmd.params[1];
+  if (topic <= channel->getTopic()) return;
+  channel->setTopic(topic);
+  deliverToChannel(channel, ":" + server + " TOPIC " + channel->getName() +
+                                " :" + topic + "\r\n");
+}
+
+void LinkManager::grantOperator(int fd, const std::string& server,
+                                const Command& cmd, const std::string& line) {
+  Channel* channel = channelManager_->getChannel(cmd.params[0]);
+  User* user = userManager_->getUserByNickname(cmd.params[2]);
+  if (cmd.params[1] != "+o" || !channel || !user ||
+      !channel->isMember(user->getSocketFd())) {
+    return;
+  }
+  sendToAll(line, fd);
+  if (channel->isOperator(user->getSocketFd())) return;
+  channel->addOperator(user->getSocketFd());
+  deliverToChannel(channel, ":" + server + " MODE " + channel->getName() +
+                                " +o " + user->getNickname() + "\r\n");
+}
+
+void LinkManager::squitServer(int fd, const std::string& name,
+                              const std::string& line) {
+  std::map<std::string, RemoteServer>::iterator it = servers_.find(name);
+  if (it == servers_.end() || it->second.linkFd != fd) return;
+  std::string reason = it->second.uplink + " " + name;
+
+  // The server and everything behind it
+  std::set<std::string> names;
+  names.insert(name);
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (it = servers_.begin(); it != servers_.end(); ++it) {
+      if (names.count(it->second.uplink) > 0 &&
+          names.insert(it->first).second) {
+        progress = true;
+      }
+    }
+  }
+  sendToAll(line, fd);
+  dropServers(names, reason, false);
+}
+
+void LinkManager::dropServers(const std::set<std::string>& names,
+                              const std::string& reason, bool promote) {
+  std::vector<User*> users;
+  std::set<std::string> channels;
+  const std::map<int, User*>& allUsers = userManager_->getUsers();
+  for (std::map<int, User*>::const_iterator it = allUsers.begin();
+       it != allUsers.end(); ++it) {
+    User* user = it->second;
+    if (user->isRemote() && names.count(user->getServer()) > 0) {
+      users.push_back(user);
+      // Names: the removal below deletes channels that become empty
+      const std::vector<Channel*>& joined = user->getJoinedChannels();
+      for (size_t i = 0; i < joined.size(); ++i) {
+        channels.insert(joined[i]->getName());
+      }
+    }
+  }
+  for (size_t i = 0; i < users.size(); ++i) {
+    removeRemoteUser(users[i], reason);
+  }
+  for (std::set<std::string>::const_iterator it = names.begin();
+       it != names.end(); ++it) {
+    servers_.erase(*it);
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+      "Netsplit (" + reason + "): " + int_to_string(names.size()) +
+          " servers, " + int_to_string(users.size()) + " users gone");
+
+  // The server next to the split restores operators on its side
+  if (!promote) return;
+  for (std::set<std::string>::const_iterator it = channels.begin();
+       it != channels.end(); ++it) {
+    Channel* channel = channelManager_->getChannel(*it);
+    if (channel) cmdRouter_->ensureOperator(channel);
+  }
+}
+
+// The older nickname wins, the smaller id on a tie; every server decides the
+// same way, so the loser is gone everywhere
+bool LinkManager::winsCollision(long nickTime, const std::string& uid,
+                                User* other) {
+  if (nickTime != other->getNickTime()) return nickTime < other->getNickTime();
+  return uid < getUid(other);
+}
+
+void LinkManager::killUser(User* user, const std::string& reason,
+                           int exceptFd) {
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_NETWORK,
+      "Killing " + user->getNickname() + " (" + reason + ")");
+  if (user->isRemote()) {
+    std::vector<std::string> params;
+    params.push_back(user->getUid());
+    params.push_back(reason);
+    sendToAll(formatLine(serverName_, "KILL", params), exceptFd);
+    removeRemoteUser(user, reason);
+    return;
+  }
+
+  // Local user: the QUIT relayed by quitUser() removes it everywhere
+  cmdRouter_->quitUser(user, reason);
+  deliver(user, "ERROR :Closing Link: " + user->getIp() + " (" + reason +
+                    ")\r\n");
+  userManager_->updateNickname(user, user->getNickname(), "");
+  userManager_->setUid(user, "");
+  killedUsers_.push_back(user->getSocketFd());
+}
+
+void LinkManager::removeRemoteUser(User* user, const std::string& reason) {
+  cmdRouter_->quitUser(user, reason);
+  userManager_->removeUser(user->getSocketFd());
+}
+
+// ==========================================
+// Propagation
+// ==========================================
+
+void LinkManager::introduceUser(User* user) {
+  sendToAll(formatIntroduction(user), INVALID_FD);
+}
+
+void LinkManager::relayNick(User* user) {
+  std::vector<std::string> params;
+  params.push_back(user->getNickname());
+  params.push_back(longToString(user->getNickTime()));
+  sendToAll(formatLine(getUid(user), "NICK", params), INVALID_FD);
+}
+
+void LinkManager::relayQuit(User* user, const std::string& reason) {
+  sendToAll(formatLine(getUid(user), "QUIT", std::vector<std::string>(
+                                                 1, reason)),
+            INVALID_FD);
+}
+
+void LinkManager::relay(User* source, const std::string& command,
+                        const std::vector<std::string>& params) {
+  if (links_.empty()) return;
+  sendToAll(formatLine(getUid(source), command, params),
+            source->getLinkFd());
+}
+
+void LinkManager::relayToChannel(User* source, const Channel* channel,
+                                 const std::string& command,
+                                 const std::vector<std::string>& params) {
+  std::set<int> linkFds;
+  const std::set<int>& members = channel->getMembers();
+  for (std::set<int>::const_iterator it = members.begin();
+       it != members.end(); ++it) {
+    // Remote ids are negative and sort first
+    if (*it >= 0) break;
+    User* member = userManager_->getUserByFd(*it);
+    if (member && member->getLinkFd() != source->getLinkFd()) {
+      linkFds.insert(member->getLinkFd());
+    }
+  }
+  if (linkFds.empty()) return;
+  std::string line = formatLine(getUid(source), command, params);
+  for (std::set<int>::iterator it = linkFds.begin(); it != linkFds.end();
+       ++it) {
+    queue(*it, line);
+  }
+}
+
+void LinkManager::relayToUser(User* source, const User* target,
+                              const std::string& command,
+                              const std::vector<std::string>& params) {
+  if (!target->isRemote() || target->getLinkFd() == source->getLinkFd()) {
+    return;
+  }
+  queue(target->getLinkFd(), formatLine(getUid(source), command, params));
+}
+
+void LinkManager::relayOperator(const Channel* channel, const User* user) {
+  std::vector<std::string> params;
+  params.push_back(channel->getName());
+  params.push_back("+o");
+  params.push_back(user->getNickname());
+  sendToAll(formatLine(serverName_, "MODE", params), INVALID_FD);
+}
+
+// ==========================================
+// Helpers
+// ==========================================
+
+// Local users get their id when they are first announced
+const std::string& LinkManager::getUid(User* user) {
+  if (user->getUid().empty()) {
+    userManager_->setUid(user,
+                         serverName_ + "/" + longToString(nextUid_++));
+  }
+  return user->getUid();
+}
+
+// Long user and real names are cut to keep the line within 510 characters
+std::string LinkManager::formatIntroduction(User* user) {
+  std::vector<std::string> params;
+  params.push_back(getUid(user));
+  params.push_back(user->getNickname());
+  params.push_back(longToString(user->getNickTime()));
+  params.push_back(user->getUsername().substr(0, 64));
+  params.push_back(user->getIp());
+  params.push_back(user->getRealname().substr(0, 200));
+  return formatLine(user->isRemote() ? user->getServer() : serverName_, "UID",
+                    params);
+}
+
+void LinkManager::deliver(User* user, const std::string& message) {
+  if (user->isRemote()) return;
+  bool wasEmpty = user->getWriteBuffer().empty();
+  user->getWriteBuffer() += message;
+  if (wasEmpty) eventLoop_->requestWrite(user->getSocketFd());
+}
+
+// Local members only, with the tags each enabled
+void LinkManager::deliverToChannel(const Channel* channel,
+                                   const std::string& message) {
+  cmdRouter_->broadcastToChannel(channel, message, INVALID_FD);
+}
+
+// The last parameter only gets a ':' when it needs one, so a relayed command
+// is never longer than the client's original
+std::string LinkManager::formatLine(const std::string& source,
+                                    const std::string& command,
+                                    const std::vector<std::string>& params) {
+  std::string line = ":" + source + " " + command;
+  for (size_t i = 0; i < params.size(); ++i) {
+    line += " ";
+    const std::string& param = params[i];
+    if (i + 1 == params.size() &&
+        (param.empty() || param[0] == ':' ||
+         param.find(' ') != std::string::npos)) {
+      line += ":";
+    }
+    line += param;
+  }
+  return line + "\r\n";
+}
@@ -0,0 +1,175 @@
+#include "LoopProfiler.hpp"
+
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "utils.hpp"
+
+namespace {
+const char* const kPhaseNames[LOOP_PHASE_COUNT] = {"accept", "read",
+                                                   "dispatch", "write"};
+
+std::string formatMillis(double seconds) {
+  std::ostringstream oss;
+  oss.setf(std::ios::fixed);
+  oss.precision(3);
+  oss << seconds * 1000.0 << "ms";
+  return oss.str();
+}
+
+std::string formatPhases(const double* phaseTime) {
+  std::string out;
+  for (size_t i = 0; i < LOOP_PHASE_COUNT; ++i) {
+    if (i > 0) out += " ";
+    out += std::string(kPhaseNames[i]) + "=" + formatMillis(phaseTime[i]);
+  }
+  return out;
+}
+}  // namespace
+
+LoopProfiler::Stats::Stats() { reset(); }
+
+void LoopProfiler::Stats::reset() {
+  iterations = 0;
+  events = 0;
+  totalTime = 0.0;
+  maxTime = 0.0;
+  for (size_t i = 0; i < LOOP_PHASE_COUNT; ++i) phaseTime[i] = 0.0;
+}
+
+LoopProfiler::LoopProfiler(Metrics* metrics, double slowThreshold,
+                           double reportInterval)
+    : metrics_(metrics),
+      slowThreshold_(slowThreshold),
+      reportInterval_(reportInterval),
+      iterationStart_(0.0),
+      iterationEvents_(0),
+      iterationDuration_(0.0),
+      iterationWorstFd_(-1),
+      iterationWorstTime_(0.0),
+      currentFd_(-1),
+      currentFdTime_(0.0),
+      intervalStart_(getMonotonicTime()),
+      lastIntervalWorstFd_(-1),
+      lastIntervalWorstTime_(0.0) {
+  for (size_t i = 0; i < LOOP_PHASE_COUNT; ++i) iterationPhaseTime_[i] = 0.0;
+}
+
+LoopProfiler::~LoopProfiler() {}
+
+void LoopProfiler::beginIteration(int eventCount) {
+  iterationStart_ = getMonotonicTime();
+  iterationEvents_ = eventCount;
+  iterationWorstFd_ = -1;
+  iterationWorstTime_ = 0.0;
+  currentFd_ = -1;
+  currentFdTime_ = 0.0;
+  for (size_t i = 0; i < LOOP_PHASE_COUNT; ++i) iterationPhaseTime_[i] = 0.0;
+}
+
+void LoopProfiler::record(LoopPhase phase, int fd, double seconds) {
+  iterationPhaseTime_[phase] += seconds;
+  metrics_->addTime(static_cast<MetricTimeCounter>(
+                        METRIC_LOOP_ACCEPT_TIME + phase),
+                    seconds);
+
+  // Events for one fd are handled back to back; accumulate them and touch
+  // the per-interval map once per fd change instead of once per record
+  if (fd != currentFd_) {
+    flushCurrentFd();
+    currentFd_ = fd;
+  }
+  currentFdTime_ += seconds;
+}
+
+void LoopProfiler::flushCurrentFd() {
+  if (currentFd_ >= 0) {
+    if (currentFdTime_ > iterationWorstTime_) {
+      iterationWorstTime_ = currentFdTime_;
+      iterationWorstFd_ = currentFd_;
+    }
+    connectionTime_[currentFd_] += currentFdTime_;
+  }
+  currentFd_ = -1;
+  currentFdTime_ = 0.0;
+}
+
+bool LoopProfiler::endIteration() {
+  flushCurrentFd();
+
+  iterationDuration_ = getMonotonicTime() - iterationStart_;
+  metrics_->increment(METRIC_LOOP_ITERATIONS);
+  metrics_->observe(METRIC_LOOP_ITERATION_DURATION, iterationDuration_);
+  metrics_->observe(METRIC_LOOP_EVENTS_PER_WAKEUP, iterationEvents_);
+
+  ++interval_.iterations;
+  interval_.events += iterationEvents_;
+  interval_.totalTime += iterationDuration_;
+  if (iterationDuration_ > interval_.maxTime) {
+    interval_.maxTime = iterationDuration_;
+  }
+  for (size_t i = 0; i < LOOP_PHASE_COUNT; ++i) {
+    interval_.phaseTime[i] += iterationPhaseTime_[i];
+  }
+
+  if (slowThreshold_ > 0.0 && iterationDuration_ > slowThreshold_) {
+    metrics_->increment(METRIC_LOOP_SLOW_ITERATIONS);
+    return true;
+  }
+  return false;
+}
+
+bool LoopProfiler::takeIntervalSummary() {
+  if (reportInterval_ <= 0.0) return false;
+  double now = getMonotonicTime();
+  if (now - intervalStart_ < reportInterval_) return false;
+
+  lastInterval_ = interval_;
+  lastIntervalWorstFd_ = -1;
+  lastIntervalWorstTime_ = 0.0;
+  for (std::map<int, double>::const_iterator it = connectionTime_.begin();
+       it != connectionTime_.end(); ++it) {
+    if (it->second > lastIntervalWorstTime_) {
+      lastIntervalWorstTime_ = it->second;
+      lastIntervalWorstFd_ = it->first;
+    }
+  }
+
+  interval_.reset();
+  connectionTime_.clear();
+  intervalStart_ = now;
+  return true;
+}
+
+std::string LoopProfiler::formatIteration() const {
+  return "iteration took " + formatMillis(iterationDuration_) + " for " +
+         int_to_string(iterationEvents_) + " events (" +
+         formatPhases(iterationPhaseTime_) + ")";
+}
+
+std::string LoopProfiler::formatInterval() const {
+  std::ostringstream oss;
+  oss.setf(std::ios::fixed);
+  oss.precision(2);
+  double avgEvents = 0.0;
+  double avgTime = 0.0;
+  if (lastInterval_.iterations > 0) {
+    avgEvents = static_cast<double>(lastInterval_.events) /
+                static_cast<double>(lastInterval_.iterations);
+    avgTime = lastInterval_.totalTime /
+              static_cast<double>(lastInterval_.iterations);
+  }
+  oss << lastInterval_.iterations << " iterations, " << avgEvents
+      << " events/wakeup, avg " << formatMillis(avgTime) << ", max "
+      << formatMillis(lastInterval_.maxTime) << " ("
+      << formatPhases(lastInterval_.phaseTime) << ")";
+  if (lastIntervalWorstFd_ >= 0) {
+    oss << ", busiest connection " << formatMillis(lastIntervalWorstTime_);
+  }
+  return oss.str();
+}
+
+int LoopProfiler::getIterationWorstFd() const { return iterationWorstFd_; }
+
+int LoopProfiler::getIntervalWorstFd() const { return lastIntervalWorstFd_; }
@@ -0,0 +1,107 @@
+#include "MessageClock.hpp"
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+namespace {
+const char kHexDigits[] = "0123456789abcdef";
+
+// Lowercase hex digits of value, without leading zeros
+std::string toHex(unsigned long value) {
+  char digits[2 * sizeof(value)];
+  size_t start = sizeof(digits);
+  do {
+    digits[--start] = kHexDigits[value & 0xf];
+    value >>= 4;
+  } while (value != 0);
+  return std::string(digits + start, sizeof(digits) - start);
+}
+}  // namespace
+
+MessageClock::MessageClock()
+    : serverTime_("1970-01-01T00:00:00.000Z"),
+      renderedSecond_(-1),
+      millis_(0),
+      nextId_(0) {
+  update();
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  // Microseconds: a process started (upgrade()) within the same second as
+  // the previous one does not repeat its ids
+  idPrefix_ = toHex(static_cast<unsigned long>(now.tv_sec) * 1000000UL +
+                    static_cast<unsigned long>(now.tv_nsec / 1000)) +
+              "-";
+}
+
+MessageClock::~MessageClock() {}
+
+void MessageClock::update() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  if (now.tv_sec != renderedSecond_) {
+    struct tm utc;
+    char rendered[20];
+    gmtime_r(&now.tv_sec, &utc);
+    if (strftime(rendered, sizeof(rendered), "%Y-%m-%dT%H:%M:%S", &utc) ==
+        sizeof(rendered) - 1) {
+      serverTime_.replace(0, sizeof(rendered) - 1, rendered);
+      renderedSecond_ = now.tv_sec;
+    }
+  }
+  int millis = static_cast<int>(now.tv_nsec / 1000000);
+  millis_ = static_cast<long>(now.tv_sec) * 1000 + millis;
+  serverTime_[20] = static_cast<char>('0' + millis / 100);
+  serverTime_[21] = static_cast<char>('0' + millis / 10 % 10);
+  serverTime_[22] = static_cast<char>('0' + millis % 10);
+}
+
+const std::string& MessageClock::getServerTime() const { return serverTime_; }
+
+long MessageClock::getMillis() const { return millis_; }
+
+std::string MessageClock::formatServerTime(long millis) {
+  time_t seconds = static_cast<time_t>(millis / 1000);
+  struct tm utc;
+  char rendered[32];
+  gmtime_r(&seconds, &utc);
+  size_t length =
+      strftime(rendered, sizeof(rendered), "%Y-%m-%dT%H:%M:%S", &utc);
+  std::snprintf(rendered + length, sizeof(rendered) - length, ".%03dZ",
+                static_cast<int>(millis % 1000));
+  return rendered;
+}
+
+bool MessageClock::parseServerTime(const std::string& serverTime,
+                                   long* millis) {
+  // Digits and separators, then optional milliseconds and the 'Z'
+  const char kLayout[] = "dddd-dd-ddTdd:dd:dd";
+  const size_t kLength = sizeof(kLayout) - 1;
+  if (serverTime.length() != kLength + 1 &&
+      serverTime.length() != kLength + 5) {
+    return false;
+  }
+  for (size_t i = 0; i < serverTime.length() - 1; ++i) {
+    char expected = i < kLength ? kLayout[i] : (i == kLength ? '.' : 'd');
+    bool digit = std::isdigit(static_cast<unsigned char>(serverTime[i]));
+    if (expected == 'd' ? !digit : serverTime[i] != expected) return false;
+  }
+  if (serverTime[serverTime.length() - 1] != 'Z') return false;
+
+  struct tm utc = tm();
+  utc.tm_year = std::atoi(serverTime.c_str()) - 1900;
+  utc.tm_mon = std::atoi(serverTime.c_str() + 5) - 1;
+  utc.tm_mday = std::atoi(serverTime.c_str() + 8);
+  utc.tm_hour = std::atoi(serverTime.c_str() + 11);
+  utc.tm_min = std::atoi(serverTime.c_str() + 14);
+  utc.tm_sec = std::atoi(serverTime.c_str() + 17);
+  *millis = static_cast<long>(timegm(&utc)) * 1000;
+  if (serverTime.length() == kLength + 5) {
+    *millis += std::atoi(serverTime.c_str() + kLength + 1);
+  }
+  return true;
+}
+
+std::string MessageClock::nextMsgId() { return idPrefix_ + toHex(nextId_++); }
@@ -0,0 +1,176 @@
+#include "Metrics.hpp"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+namespace {
+struct MetricInfo {
+  const char* name;
+  const char* help;
+};
+
+// Member of a labeled metric family; entries of one family are adjacent
+struct LabeledMetricInfo {
+  const char* name;
+  const char* labels;  // e.g. phase="read"
+  const char* help;
+};
+
+struct HistogramInfo {
+  const char* name;
+  const char* help;
+  const double* bounds;  // Upper bounds in increasing order (without +Inf)
+  size_t boundCount;
+};
+
+// Indexed by MetricCounter
+const MetricInfo kCounterInfo[METRIC_COUNTER_COUNT] = {
+    {"ircserv_connections_accepted_total", "Client connections accepted"},
+    {"ircserv_connections_rejected_total",
+     "Client connections rejected because the user limit was reached"},
+    {"ircserv_connections_closed_total", "Client connections closed"},
+    {"ircserv_messages_received_total", "IRC messages received from clients"},
+    {"ircserv_bytes_received_total", "Bytes received from clients"},
+    {"ircserv_bytes_sent_total", "Bytes sent to clients"},
+    {"ircserv_loop_iterations_total", "Event loop wakeups processed"},
+    {"ircserv_loop_slow_iterations_total",
+     "Event loop iterations exceeding the slow iteration threshold"},
+    {"ircserv_syscalls_total",
+     "System calls issued for client sockets and event notification"}};
+
+// Indexed by MetricTimeCounter
+const LabeledMetricInfo kTimeInfo[METRIC_TIME_COUNTER_COUNT] = {
+    {"ircserv_loop_phase_seconds_total", "phase=\"accept\"",
+     "Time spent per event loop phase"},
+    {"ircserv_loop_phase_seconds_total", "phase=\"read\"",
+     "Time spent per event loop phase"},
+    {"ircserv_loop_phase_seconds_total", "phase=\"dispatch\"",
+     "Time spent per event loop phase"},
+    {"ircserv_loop_phase_seconds_total", "phase=\"write\"",
+     "Time spent per event loop phase"}};
+
+// Indexed by MetricGauge
+const MetricInfo kGaugeInfo[METRIC_GAUGE_COUNT] = {
+    {"ircserv_users_connected", "Currently connected clients"},
+    {"ircserv_channels", "Currently existing channels"}};
+
+// Latency buckets in seconds (50us .. 250ms)
+const double kLatencyBounds[] = {0.00005, 0.0001, 0.00025, 0.0005,
+                                 0.001,   0.0025, 0.005,   0.01,
+                                 0.025,   0.05,   0.1,     0.25};
+const size_t kLatencyBoundCount =
+    sizeof(kLatencyBounds) / sizeof(kLatencyBounds[0]);
+
+// Ready events returned by one epoll_wait (Server::kMaxEvents is 64)
+const double kEventCountBounds[] = {1, 2, 4, 8, 16, 32, 64};
+const size_t kEventCountBoundCount =
+    sizeof(kEventCountBounds) / sizeof(kEventCountBounds[0]);
+
+// Indexed by MetricHistogram
+const HistogramInfo kHistogramInfo[METRIC_HISTOGRAM_COUNT] = {
+    {"ircserv_command_duration_seconds",
+     "Time spent parsing and executing one IRC command", kLatencyBounds,
+     kLatencyBoundCount},
+    {"ircserv_loop_iteration_duration_seconds",
+     "Time spent handling the events of one event loop wakeup",
+     kLatencyBounds, kLatencyBoundCount},
+    {"ircserv_loop_events_per_wakeup", "Ready events per event loop wakeup",
+     kEventCountBounds, kEventCountBoundCount}};
+
+void renderHeader(std::ostringstream& oss, const char* name, const char* help,
+                  const char* type) {
+  oss << "# HELP " << name << " " << help << "\n";
+  oss << "# TYPE " << name << " " << type << "\n";
+}
+}  // namespace
+
+Metrics::Metrics() {
+  for (size_t i = 0; i < METRIC_COUNTER_COUNT; ++i) counters_[i] = 0;
+  for (size_t i = 0; i < METRIC_TIME_COUNTER_COUNT; ++i) times_[i] = 0.0;
+  for (size_t i = 0; i < METRIC_GAUGE_COUNT; ++i) gauges_[i] = 0;
+  for (size_t i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+    for (size_t j = 0; j < kMaxBuckets; ++j) buckets_[i][j] = 0;
+    histogramCounts_[i] = 0;
+    histogramSums_[i] = 0.0;
+  }
+}
+
+Metrics::~Metrics() {}
+
+void Metrics::increment(MetricCounter counter, unsigned long value) {
+  counters_[counter] += value;
+}
+
+void Metrics::addTime(MetricTimeCounter counter, double seconds) {
+  times_[counter] += seconds;
+}
+
+void Metrics::setGauge(MetricGauge gauge, long value) {
+  gauges_[gauge] = value;
+}
+
+void Metrics::observe(MetricHistogram histogram, double value) {
+  const HistogramInfo& info = kHistogramInfo[histogram];
+  // Linear scan: bucket lists are short and the first buckets are the hot ones
+  size_t bucket = 0;
+  while (bucket < info.boundCount && value > info.bounds[bucket]) ++bucket;
+  ++buckets_[histogram][bucket];
+  ++histogramCounts_[histogram];
+  histogramSums_[histogram] += value;
+}
+
+unsigned long Metrics::getCounter(MetricCounter counter) const {
+  return counters_[counter];
+}
+
+double Metrics::getTime(MetricTimeCounter counter) const {
+  return times_[counter];
+}
+
+long Metrics::getGauge(MetricGauge gauge) const { return gauges_[gauge]; }
+
+unsigned long Metrics::getHistogramCount(MetricHistogram histogram) const {
+  return histogramCounts_[histogram];
+}
+
+std::string Metrics::render() const {
+  std::ostringstream oss;
+  oss.precision(9);
+
+  for (size_t i = 0; i < METRIC_COUNTER_COUNT; ++i) {
+    renderHeader(oss, kCounterInfo[i].name, kCounterInfo[i].help, "counter");
+    oss << kCounterInfo[i].name << " " << counters_[i] << "\n";
+  }
+
+  for (size_t i = 0; i < METRIC_TIME_COUNTER_COUNT; ++i) {
+    const LabeledMetricInfo& info = kTimeInfo[i];
+    if (i == 0 || std::strcmp(info.name, kTimeInfo[i - 1].name) != 0) {
+      renderHeader(oss, info.name, info.help, "counter");
+    }
+    oss << info.name << "{" << info.labels << "} " << times_[i] << "\n";
+  }
+
+  for (size_t i = 0; i < METRIC_GAUGE_COUNT; ++i) {
+    renderHeader(oss, kGaugeInfo[i].name, kGaugeInfo[i].help, "gauge");
+    oss << kGaugeInfo[i].name << " " << gauges_[i] << "\n";
+  }
+
+  for (size_t i = 0; i < METRIC_HISTOGRAM_COUNT; ++i) {
+    const HistogramInfo& info = kHistogramInfo[i];
+    renderHeader(oss, info.name, info.help, "histogram");
+    // Prometheus buckets are cumulative
+    unsigned long cumulative = 0;
+    for (size_t j = 0; j < info.boundCount; ++j) {
+      cumulative += buckets_[i][j];
+      oss << info.name << "_bucket{le=\"" << info.bounds[j] << "\"} "
+          << cumulative << "\n";
+    }
+    cumulative += buckets_[i][info.boundCount];
+    oss << info.name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+    oss << info.name << "_sum " << histogramSums_[i] << "\n";
+    oss << info.name << "_count " << histogramCounts_[i] << "\n";
+  }
+
+  return oss.str();
+}
@@ -2,6 +2,8 @@
 
 #include <sstream>
 
+#include "utils.hpp"
+
 // ==========================================
 // Helper methods
 // ==========================================
@@ -73,16 +75,30 @@ std::string ResponseFormatter::rplCreated(const User* user) {
   return formatMessage("ft_irc", "003", params);
 }
 
-std::string ResponseFormatter::rplMyInfo(const User* user) {
+std::string ResponseFormatter::rplMyInfo(const User* user,
+                                         const std::string& channelModes) {
   std::vector<std::string> params;
   params.push_back(user->getNickname());
   params.push_back("ft_irc");
   params.push_back("1.0");
-  params.push_back("io");     // User modes
-  params.push_back("itkol");  // Channel modes
+  params.push_back("io");  // User modes
+  params.push_back(channelModes);
   return formatMessage("ft_irc", "004", params);
 }
 
+std::string ResponseFormatter::isupportTail(
+    const std::vector<std::string>& tokens) {
+  std::vector<std::string> params(tokens);
+  params.push_back("are supported by this server");
+  std::string line = formatMessage("", "", params);
+  return line.substr(1);  // Without the space after the empty command
+}
+
+std::string ResponseFormatter::rplISupport(const std::string& target,
+                                           const std::string& tail) {
+  return ":ft_irc 005 " + target + " " + tail;
+}
+
 // ==========================================
 // Command responses
 // ==========================================
@@ -213,6 +229,236 @@ std::string ResponseFormatter::rplQuit(const User* user,
   return formatMessage(formatUserPrefix(user), "QUIT", params);
 }
 
+std::string ResponseFormatter::rplNick(const User* user,
+                                       const std::string& newNick) {
+  std::vector<std::string> params;
+  params.push_back(newNick);
+  return formatMessage(formatUserPrefix(user), "NICK", params);
+}
+
+std::string ResponseFormatter::rplTagmsg(const User* from,
+                                         const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  return formatMessage(formatUserPrefix(from), "TAGMSG", params);
+}
+
+std::string ResponseFormatter::rplHistoryPrivmsg(const std::string& source,
+                                                 const std::string& target,
+                                                 const std::string& message) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(message);
+  return formatMessage(source, "PRIVMSG", params);
+}
+
+std::string ResponseFormatter::batchStart(const std::string& reference,
+                                          const std::string& type,
+                                          const std::string& target) {
+  return ":ft_irc BATCH +" + reference + " " + type + " " + target + "\r\n";
+}
+
+std::string ResponseFormatter::batchEnd(const std::string& reference) {
+  return ":ft_irc BATCH -" + reference + "\r\n";
+}
+
+std::string ResponseFormatter::inBatch(const std::string& reference,
+                                       const std::string& line) {
+  // Joins the tags the line may already have
+  if (!line.empty() && line[0] == '@') {
+    return "@batch=" + reference + ";" + line.substr(1);
+  }
+  return "@batch=" + reference + " " + line;
+}
+
+std::string ResponseFormatter::fail(const std::string& command,
+                                    const std::string& code,
+                                    const std::string& context,
+                                    const std::string& description) {
+  return ":ft_irc FAIL " + command + " " + code + " " + context + " :" +
+         description + "\r\n";
+}
+
+std::string ResponseFormatter::rplCap(const std::string& target,
+                                      const std::string& subcommand,
+                                      const std::string& caps) {
+  // The list is always the trailing parameter, even with one or no entry
+  return ":ft_irc CAP " + target + " " + subcommand + " :" + caps + "\r\n";
+}
+
+std::string ResponseFormatter::rplNamReplyHead(const std::string& target,
+                                               const std::string& channel) {
+  // "=" : public channel (there are no secret or private ones)
+  return ":ft_irc 353 " + target + " = " + channel + " :";
+}
+
+std::string ResponseFormatter::rplEndOfNames(const std::string& target,
+                                             const std::string& channel) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(channel);
+  params.push_back("End of /NAMES list");
+  return formatMessage("ft_irc", "366", params);
+}
+
+std::string ResponseFormatter::rplListStart(const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back("Channel");
+  params.push_back("Users  Name");
+  return formatMessage("ft_irc", "321", params);
+}
+
+std::string ResponseFormatter::rplList(const std::string& target,
+                                       const std::string& channel,
+                                       size_t users,
+                                       const std::string& topic) {
+  // The topic is always the trailing parameter, even when empty
+  return ":ft_irc 322 " + target + " " + channel + " " +
+         int_to_string(static_cast<int>(users)) + " :" + topic + "\r\n";
+}
+
+std::string ResponseFormatter::rplListEnd(const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back("End of /LIST");
+  return formatMessage("ft_irc", "323", params);
+}
+
+std::string ResponseFormatter::rplWhoReply(const std::string& target,
+                                           const std::string& channel,
+                                           const User* user, bool op) {
+  // Flags: here (H) or gone (G: away), then @ for an operator
+  // Trailing: hop count (linked servers are all one hop away) and real name
+  std::string server = user->isRemote() ? user->getServer() : "ft_irc";
+  std::string flags = user->getAwayMessage().empty() ? "H" : "G";
+  if (op) flags += '@';
+  return ":ft_irc 352 " + target + " " + channel + " " + user->getUsername() +
+         " " + user->getIp() + " " + server + " " + user->getNickname() + " " +
+         flags + " :" + (user->isRemote() ? "1 " : "0 ") +
+         user->getRealname() + "\r\n";
+}
+
+std::string ResponseFormatter::rplEndOfWho(const std::string& target,
+                                           const std::string& mask) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(mask);
+  params.push_back("End of /WHO list");
+  return formatMessage("ft_irc", "315", params);
+}
+
+std::string ResponseFormatter::rplWhoisUser(const std::string& target,
+                                            const User* user) {
+  return ":ft_irc 311 " + target + " " + user->getNickname() + " " +
+         user->getUsername() + " " + user->getIp() + " * :" +
+         user->getRealname() + "\r\n";
+}
+
+std::string ResponseFormatter::rplWhoisServer(const std::string& target,
+                                              const User* user) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(user->getNickname());
+  if (user->isRemote()) {
+    params.push_back(user->getServer());
+    params.push_back("Linked server");
+  } else {
+    params.push_back("ft_irc");
+    params.push_back("ft_irc server");
+  }
+  return formatMessage("ft_irc", "312", params);
+}
+
+std::string ResponseFormatter::rplWhoisChannelsHead(
+    const std::string& target, const std::string& nickname) {
+  return ":ft_irc 319 " + target + " " + nickname + " :";
+}
+
+std::string ResponseFormatter::rplEndOfWhois(const std::string& target,
+                                             const std::string& nickname) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(nickname);
+  params.push_back("End of /WHOIS list");
+  return formatMessage("ft_irc", "318", params);
+}
+
+std::string ResponseFormatter::rplMaskList(MaskList list,
+                                           const std::string& target,
+                                           const std::string& channel,
+                                           const MaskEntry& entry) {
+  static const char* const kCodes[MASK_LIST_COUNT] = {"367", "348", "346"};
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(channel);
+  params.push_back(entry.mask.getMask());
+  params.push_back(entry.setBy);
+  params.push_back(int_to_string(static_cast<int>(entry.setAt)));
+  return formatMessage("ft_irc", kCodes[list], params);
+}
+
+std::string ResponseFormatter::rplEndOfMaskList(MaskList list,
+                                                const std::string& target,
+                                                const std::string& channel) {
+  static const char* const kCodes[MASK_LIST_COUNT] = {"368", "349", "347"};
+  static const char* const kTexts[MASK_LIST_COUNT] = {
+      "End of channel ban list", "End of channel exception list",
+      "End of channel invite list"};
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(channel);
+  params.push_back(kTexts[list]);
+  return formatMessage("ft_irc", kCodes[list], params);
+}
+
+std::string ResponseFormatter::rplAway(const std::string& target,
+                                       const std::string& nickname,
+                                       const std::string& message) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(nickname);
+  params.push_back(message);
+  return formatMessage("ft_irc", "301", params);
+}
+
+std::string ResponseFormatter::rplUnaway(const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back("You are no longer marked as being away");
+  return formatMessage("ft_irc", "305", params);
+}
+
+std::string ResponseFormatter::rplNowAway(const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back("You have been marked as being away");
+  return formatMessage("ft_irc", "306", params);
+}
+
+// The list is always the trailing parameter, even with a single entry
+std::string ResponseFormatter::rplMonOnline(const std::string& target,
+                                            const std::string& list) {
+  return ":ft_irc 730 " + target + " :" + list + "\r\n";
+}
+
+std::string ResponseFormatter::rplMonOffline(const std::string& target,
+                                             const std::string& list) {
+  return ":ft_irc 731 " + target + " :" + list + "\r\n";
+}
+
+std::string ResponseFormatter::rplMonList(const std::string& target,
+                                          const std::string& list) {
+  return ":ft_irc 732 " + target + " :" + list + "\r\n";
+}
+
+std::string ResponseFormatter::rplEndOfMonList(const std::string& target) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back("End of MONITOR list");
+  return formatMessage("ft_irc", "733", params);
+}
+
 // ==========================================
 // Error responses (400-599)
 // ==========================================
@@ -253,6 +499,15 @@ std::string ResponseFormatter::errTooManyChannels(const std::string& target,
   return formatMessage("ft_irc", "405", params);
 }
 
+std::string ResponseFormatter::errTooManyTargets(const std::string& target,
+                                                 const std::string& targets) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(targets);
+  params.push_back("Too many targets, message not delivered");
+  return formatMessage("ft_irc", "407", params);
+}
+
 std::string ResponseFormatter::errUnknownCommand(const std::string& target,
                                                  const std::string& command) {
   std::vector<std::string> params;
@@ -262,6 +517,15 @@ std::string ResponseFormatter::errUnknownCommand(const std::string& target,
   return formatMessage("ft_irc", "421", params);
 }
 
+std::string ResponseFormatter::errInvalidCapCmd(
+    const std::string& target, const std::string& subcommand) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(subcommand);
+  params.push_back("Invalid CAP command");
+  return formatMessage("ft_irc", "410", params);
+}
+
 std::string ResponseFormatter::errErroneusNickname(
     const std::string& target, const std::string& nickname) {
   std::vector<std::string> params;
@@ -361,6 +625,26 @@ std::string ResponseFormatter::errBadChannelKey(const std::string& target,
   return formatMessage("ft_irc", "475", params);
 }
 
+std::string ResponseFormatter::errBannedFromChan(const std::string& target,
+                                                 const std::string& channel) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(channel);
+  params.push_back("Cannot join channel (+b)");
+  return formatMessage("ft_irc", "474", params);
+}
+
+std::string ResponseFormatter::errBanListFull(const std::string& target,
+                                              const std::string& channel,
+                                              char mode) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(channel);
+  params.push_back(std::string(1, mode));
+  params.push_back("Channel list is full");
+  return formatMessage("ft_irc", "478", params);
+}
+
 std::string ResponseFormatter::errChanOPrivsNeeded(const std::string& target,
                                                    const std::string& channel) {
   std::vector<std::string> params;
@@ -392,3 +676,14 @@ std::string ResponseFormatter::errInvalidModeParam(
   params_vec.push_back(description);
   return formatMessage("ft_irc", "696", params_vec);
 }
+
+std::string ResponseFormatter::errMonListFull(const std::string& target,
+                                              size_t limit,
+                                              const std::string& list) {
+  std::vector<std::string> params;
+  params.push_back(target);
+  params.push_back(int_to_string(static_cast<int>(limit)));
+  params.push_back(list);
+  params.push_back("Monitor list is full");
+  return formatMessage("ft_irc", "734", params);
+}
@@ -14,9 +14,12 @@
 
 #include <arpa/inet.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -24,29 +27,132 @@
 #include <cerrno>
 #include <csignal>
 #include <cstring>
+#include <map>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "BinaryCodec.hpp"
+#include "ByteScan.hpp"
+#include "Capability.hpp"
+#include "ChannelSnapshot.hpp"
 #include "CommandParser.hpp"
 #include "ConnectionManager.hpp"
 #include "EventLoop.hpp"
+#include "Handoff.hpp"
 #include "utils.hpp"
 
 extern volatile sig_atomic_t g_shutdown;
+extern volatile sig_atomic_t g_upgrade;
+extern char** environ;
+
+namespace {
+// Layout version of the state handed over by Server::upgrade()
+const uint32_t kHandoffStateVersion = 6;
+const int kHandoffAckTimeoutMs = 10000;
+// Poll interval while the history log writer is behind (it does not wake
+// the loop when it catches up)
+const int kHistoryBacklogRetryMs = 10;
+const char kHandoffAck = 'R';  // Sent by the new process once it serves
+
+// Resolved at startup: after a deploy replaced the binary, /proc/self/exe
+// refers to the deleted old file
+std::string getExecutablePath() {
+  char path[PATH_MAX];
+  ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+  if (length < 0) return std::string();
+  return std::string(path, length);
+}
+
+// Write a set of user fds as indices into the handed over user list
+void writeUserIndices(BinaryWriter& writer, const std::set<int>& fds,
+                      const std::map<int, uint32_t>& indexByFd) {
+  std::vector<uint32_t> indices;
+  for (std::set<int>::const_iterator it = fds.begin(); it != fds.end();
+       ++it) {
+    std::map<int, uint32_t>::const_iterator found = indexByFd.find(*it);
+    if (found != indexByFd.end()) indices.push_back(found->second);
+  }
+  writer.writeU32(static_cast<uint32_t>(indices.size()));
+  for (size_t i = 0; i < indices.size(); ++i) writer.writeU32(indices[i]);
+}
 
-Server::Server(const std::string& portStr, const std::string& password)
+User* readUser(BinaryReader& reader, const std::vector<User*>& users) {
+  uint32_t index = reader.readU32();
+  if (index >= users.size()) {
+    throw std::runtime_error("Handoff: invalid user reference");
+  }
+  return users[index];
+}
+
+void waitForAck(int sock) {
+  struct pollfd pfd;
+  pfd.fd = sock;
+  pfd.events = POLLIN;
+  int ready;
+  while ((ready = poll(&pfd, 1, kHandoffAckTimeoutMs)) < 0) {
+    if (errno != EINTR) {
+      throw std::runtime_error(createErrorMessage("poll", errno));
+    }
+  }
+  if (ready == 0) {
+    throw std::runtime_error("timed out waiting for the new process");
+  }
+  char ack = 0;
+  ssize_t received = recv(sock, &ack, 1, 0);
+  if (received != 1 || ack != kHandoffAck) {
+    throw std::runtime_error("new process failed to resume");
+  }
+}
+}  // namespace
+
+Server::Server(const std::string& portStr, const std::string& password,
+               const ServerConfig& config)
     : password_(password),
-      serverSocket_(INVALID_FD),
-      cmdRouter_(&userManager_, &channelManager_, &eventLoop_, password) {
+      config_(config),
+      profiler_(&metrics_, config.slowLoopThreshold,
+                config.loopReportInterval),
+      connManager_(&metrics_),
+      cmdRouter_(&userManager_, &channelManager_, &eventLoop_, password),
+      adminServer_(&eventLoop_, &metrics_),
+      linkManager_(&eventLoop_, &userManager_, &channelManager_, &cmdRouter_),
+      snapshotPid_(-1),
+      nextSnapshotTime_(getMonotonicTime() + config.snapshotInterval) {
   validateAndSetPort(portStr);
   validatePassword(password);
-  setupServerSocket();
+  executablePath_ = getExecutablePath();
+  cmdRouter_.setLinkManager(&linkManager_);
+  cmdRouter_.setMalformedLimit(config_.malformedLimit);
+  cmdRouter_.setHistoryLimit(config_.historyMemory);
+
+  // Create the event loop first: listeners register themselves
+  eventLoop_.create(config_.eventBackend);
+  if (!config_.historyDirectory.empty()) {
+    cmdRouter_.openHistoryLog(config_.historyDirectory,
+                              config_.historyChannels);
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      std::string("Event backend: ") +
+          (config_.eventBackend == EVENT_BACKEND_IO_URING ? "io_uring"
+                                                           : "epoll"));
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      std::string("Byte scanning: ") + getScanLevelName(getScanLevel()));
+  if (config_.upgradeFd >= 0) {
+    resumeFromHandoff(config_.upgradeFd);
+  } else {
+    restoreSnapshot();
+    setupListeners();
+  }
+  if (!config_.adminListen.empty()) {
+    adminServer_.listen(config_.adminListen);
+  }
+  linkManager_.start(config_);
 }
 
 Server::~Server() {
   // UserManager destructor will clean up all users automatically
-  if (serverSocket_ != INVALID_FD) close(serverSocket_);
+  for (size_t i = 0; i < listenFds_.size(); ++i) close(listenFds_[i]);
 }
 
 // ==========================================
@@ -56,7 +162,12 @@ void Server::run() {
   struct epoll_event events[kMaxEvents];
 
   while (!g_shutdown) {
-    int nfds = eventLoop_.wait(events, kMaxEvents, 30000);
+    if (g_upgrade) {
+      g_upgrade = 0;
+      if (upgrade()) return;
+    }
+
+    int nfds = eventLoop_.wait(events, kMaxEvents, getWaitTimeout());
     if (nfds < 0) {
       if (errno == EINTR) {
         // Interrupted by signal
@@ -67,10 +178,42 @@ void Server::run() {
                     createErrorMessage("epoll_wait", errno)));
     }
 
+    profiler_.beginIteration(nfds);
+    cmdRouter_.updateClock();
     for (int i = 0; i < nfds; ++i) {
       handleEvent(events[i]);
     }
+    linkManager_.runTimers();
+    adminServer_.runTimers();
+    cmdRouter_.retryHistoryLog();
+    disconnectKilledUsers();
+    flushWrites();
+    linkManager_.flush();
+    reportLoopProfile();
+    updateGauges();
+    metrics_.increment(METRIC_SYSCALLS, eventLoop_.takeSyscallCount());
+    if (!config_.snapshotPath.empty()) runSnapshots();
+  }
+  if (!config_.snapshotPath.empty()) saveSnapshot();
+}
+
+int Server::getWaitTimeout() const {
+  // Output queued by a link closed while flushing
+  if (eventLoop_.hasWriteRequests()) return 0;
+  int timeout = 30000;
+  if (cmdRouter_.hasHistoryBacklog()) timeout = kHistoryBacklogRetryMs;
+  int linkTimeout = linkManager_.getTimeoutMs();
+  if (linkTimeout >= 0 && linkTimeout < timeout) timeout = linkTimeout;
+  int adminTimeout = adminServer_.getTimeoutMs();
+  if (adminTimeout >= 0 && adminTimeout < timeout) timeout = adminTimeout;
+  if (!config_.snapshotPath.empty() && config_.snapshotInterval > 0) {
+    double remaining = nextSnapshotTime_ - getMonotonicTime();
+    if (remaining < 0) remaining = 0;
+    if (remaining * 1000 < timeout) {
+      timeout = static_cast<int>(remaining * 1000) + 1;
+    }
   }
+  return timeout;
 }
 
 // ==========================================
@@ -80,14 +223,35 @@ void Server::handleEvent(const struct epoll_event& event) {
   int fd = event.data.fd;
   uint32_t events = event.events;
 
-  // Server socket: new connection
-  if (fd == serverSocket_) {
+  // Listening socket: new connection
+  if (isListener(fd)) {
     if (events & EPOLLIN) {
-      acceptConnections();
+      double start = getMonotonicTime();
+      acceptConnections(fd);
+      profiler_.record(LOOP_PHASE_ACCEPT, fd, getMonotonicTime() - start);
     }
     return;
   }
 
+  // Answers of the history log's writer thread
+  if (fd == eventLoop_.getWakeupFd()) {
+    eventLoop_.consumeWakeup();
+    cmdRouter_.deliverHistory();
+    return;
+  }
+
+  // Admin listener and its connections (metrics endpoint)
+  if (adminServer_.ownsFd(fd)) {
+    adminServer_.handleEvent(fd, events);
+    return;
+  }
+
+  // Server links
+  if (linkManager_.ownsFd(fd)) {
+    linkManager_.handleEvent(fd, events);
+    return;
+  }
+
   // User socket: error handling
   if (events & (EPOLLERR | EPOLLHUP)) {
     handleUserError(fd);
@@ -115,38 +279,51 @@ void Server::handleEvent(const struct epoll_event& event) {
   }
 }
 
-void Server::acceptConnections() {
+void Server::acceptConnections(int listenFd) {
   // Edge-triggered: accept all pending connections
   while (true) {
-    User* newUser = connManager_.acceptConnection(serverSocket_);
+    User* newUser = connManager_.acceptConnection(listenFd);
     if (!newUser) break;  // No more connections (EAGAIN)
 
     // Check user limit to prevent resource exhaustion
-    if (userManager_.getUsers().size() >= kMaxUsers) {
+    if (userManager_.getLocalUserCount() >= kMaxUsers) {
       log(LOG_LEVEL_WARNING, LOG_CATEGORY_CONNECTION,
           "Maximum user limit reached, rejecting connection from " +
               newUser->getIp());
       delete newUser;  // User destructor closes the socket
+      metrics_.increment(METRIC_CONNECTIONS_REJECTED);
+      continue;
+    }
+
+    metrics_.increment(METRIC_CONNECTIONS_ACCEPTED);
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_CONNECTION,
+        "New connection: " + newUser->getIp());
+
+    // Send initial message inline: the socket buffer of a new connection is
+    // empty, so this normally completes and the fd is registered once with
+    // EPOLLIN only
+    newUser->getWriteBuffer() +=
+        ":ft_irc NOTICE * :Please authenticate with PASS command\r\n";
+    SendResult sendResult = connManager_.sendData(newUser);
+    if (sendResult == SEND_ERROR) {
+      log(LOG_LEVEL_WARNING, LOG_CATEGORY_CONNECTION,
+          "Connection closed before greeting: " + newUser->getIp());
+      delete newUser;  // User destructor closes the socket
+      metrics_.increment(METRIC_CONNECTIONS_CLOSED);
       continue;
     }
+    uint32_t events = EPOLLIN;
+    if (sendResult == SEND_SUCCESS) events |= EPOLLOUT;
 
     // Add user to manager and event loop with exception safety
     try {
       userManager_.addUser(newUser);
-      eventLoop_.addFd(newUser->getSocketFd(), EPOLLIN);
+      eventLoop_.addFd(newUser->getSocketFd(), events);
     } catch (...) {
       // If eventLoop_.addFd() fails, remove user from manager to prevent leak
       userManager_.removeUser(newUser->getSocketFd());
       throw;
     }
-
-    log(LOG_LEVEL_INFO, LOG_CATEGORY_CONNECTION,
-        "New connection: " + newUser->getIp());
-
-    // Send initial message
-    newUser->getWriteBuffer() +=
-        ":ft_irc NOTICE * :Please authenticate with PASS command\r\n";
-    eventLoop_.modifyFd(newUser->getSocketFd(), EPOLLIN | EPOLLOUT);
   }
 }
 
@@ -163,7 +340,10 @@ void Server::handleUserRead(User* user) {
   std::vector<std::string> messages;
 
   // Receive data
+  int fd = user->getSocketFd();
+  double start = getMonotonicTime();
   ReceiveResult result = connManager_.receiveData(user, messages);
+  profiler_.record(LOOP_PHASE_READ, fd, getMonotonicTime() - start);
 
   if (result == RECV_CLOSED || result == RECV_ERROR) {
     disconnectUser(user->getSocketFd());
@@ -171,12 +351,19 @@ void Server::handleUserRead(User* user) {
   }
 
   // Process received messages
+  metrics_.increment(METRIC_MESSAGES_RECEIVED, messages.size());
   for (size_t i = 0; i < messages.size(); ++i) {
+    start = getMonotonicTime();
     CommandResult result = cmdRouter_.processMessage(user, messages[i]);
+    double duration = getMonotonicTime() - start;
+    metrics_.observe(METRIC_COMMAND_DURATION, duration);
+    profiler_.record(LOOP_PHASE_DISPATCH, fd, duration);
     if (result == CMD_DISCONNECT) {
       // Flush write buffer before disconnecting
       if (!user->getWriteBuffer().empty()) {
+        start = getMonotonicTime();
         connManager_.sendData(user);
+        profiler_.record(LOOP_PHASE_WRITE, fd, getMonotonicTime() - start);
       }
       disconnectUser(user->getSocketFd());
       return;
@@ -192,7 +379,10 @@ void Server::handleUserWrite(User* user) {
             int_to_string(bufferSize) + " bytes");
   }
 
+  double start = getMonotonicTime();
   SendResult result = connManager_.sendData(user);
+  profiler_.record(LOOP_PHASE_WRITE, user->getSocketFd(),
+                   getMonotonicTime() - start);
 
   if (result == SEND_ERROR) {
     log(LOG_LEVEL_ERROR, LOG_CATEGORY_CONNECTION,
@@ -201,6 +391,9 @@ void Server::handleUserWrite(User* user) {
     return;
   }
 
+  // A LIST or WHO in progress continues as its output drains
+  if (user->getReplyCursor()) cmdRouter_.continueReply(user);
+
   // All data sent: remove EPOLLOUT
   if (result == SEND_COMPLETE) {
     log(LOG_LEVEL_DEBUG, LOG_CATEGORY_NETWORK,
@@ -210,29 +403,98 @@ void Server::handleUserWrite(User* user) {
   // If SEND_SUCCESS, keep EPOLLOUT (retry next time)
 }
 
+void Server::flushWrites() {
+  std::vector<int> fds;
+  eventLoop_.takeWriteRequests(fds);
+  if (fds.empty()) return;
+
+  // An fd can be queued twice if it was closed and reused within the round
+  std::sort(fds.begin(), fds.end());
+  fds.erase(std::unique(fds.begin(), fds.end()), fds.end());
+
+  std::vector<User*> users;
+  for (size_t i = 0; i < fds.size(); ++i) {
+    User* user = userManager_.getUserByFd(fds[i]);
+    if (user && !user->getWriteBuffer().empty()) users.push_back(user);
+  }
+
+  std::vector<SendResult> results;
+  double start = getMonotonicTime();
+  connManager_.sendBatch(eventLoop_, users, results);
+  // Shared by the whole batch, so not attributed to a connection
+  profiler_.record(LOOP_PHASE_WRITE, -1, getMonotonicTime() - start);
+
+  for (size_t i = 0; i < users.size(); ++i) {
+    if (results[i] == SEND_ERROR) {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_CONNECTION,
+          "Send error for " + users[i]->getIp() + ", disconnecting");
+      disconnectUser(users[i]->getSocketFd());
+    } else if (results[i] == SEND_SUCCESS) {
+      // Socket buffer full: continue once the socket becomes writable
+      eventLoop_.modifyFd(users[i]->getSocketFd(), EPOLLIN | EPOLLOUT);
+    } else if (users[i]->getReplyCursor()) {
+      // Sent in full: queue the next part of a LIST or WHO for the next
+      // round
+      cmdRouter_.continueReply(users[i]);
+    }
+  }
+}
+
 void Server::disconnectUser(int fd) {
+  // Leave the channels and tell the other members and servers
+  User* user = userManager_.getUserByFd(fd);
+  if (user) cmdRouter_.quitUser(user, "Connection closed");
   eventLoop_.removeFd(fd);
   userManager_.removeUser(fd);
+  metrics_.increment(METRIC_CONNECTIONS_CLOSED);
+}
+
+// Local users that lost a nickname collision: send the ERROR, then close
+void Server::disconnectKilledUsers() {
+  std::vector<int> fds;
+  linkManager_.takeKilledUsers(fds);
+  for (size_t i = 0; i < fds.size(); ++i) {
+    User* user = userManager_.getUserByFd(fds[i]);
+    if (!user) continue;
+    connManager_.sendData(user);
+    disconnectUser(fds[i]);
+  }
+}
+
+void Server::reportLoopProfile() {
+  if (profiler_.endIteration()) {
+    log(LOG_LEVEL_WARNING, LOG_CATEGORY_SYSTEM,
+        "Slow event loop " + profiler_.formatIteration() + ", worst: " +
+            describeConnection(profiler_.getIterationWorstFd()));
+  }
+  if (profiler_.takeIntervalSummary()) {
+    std::string summary = "Event loop: " + profiler_.formatInterval();
+    if (profiler_.getIntervalWorstFd() >= 0) {
+      summary += " by " + describeConnection(profiler_.getIntervalWorstFd());
+    }
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM, summary);
+  }
+}
+
+std::string Server::describeConnection(int fd) {
+  if (fd < 0) return "none";
+  if (isListener(fd)) return "listener";
+  User* user = userManager_.getUserByFd(fd);
+  if (!user) return "fd " + int_to_string(fd) + " (closed)";
+  std::string nick = user->getNickname().empty() ? "*" : user->getNickname();
+  return nick + "@" + user->getIp() + " (fd " + int_to_string(fd) + ")";
+}
+
+void Server::updateGauges() {
+  metrics_.setGauge(METRIC_USERS_CONNECTED, userManager_.getLocalUserCount());
+  metrics_.setGauge(METRIC_CHANNELS, channelManager_.getChannels().size());
 }
 
 // ==========================================
 // Setup and validation
 // ==========================================
 void Server::validateAndSetPort(const std::string& portStr) {
-  if (portStr.length() != 4)
-    throw std::runtime_error(
-        "Invalid port: must be exactly 4 digits (6665-6669)");
-
-  port_ = 0;
-  for (size_t i = 0; i < 4; ++i) {
-    if (!std::isdigit(static_cast<unsigned char>(portStr[i])))
-      throw std::runtime_error("Invalid port: contains non-digit characters");
-    port_ = port_ * 10 + (portStr[i] - '0');
-  }
-
-  if (port_ < 6665 || port_ > 6669) {
-    throw std::runtime_error("Invalid port: allowed range is 6665-6669");
-  }
+  port_ = ServerConfig::parsePort(portStr);
 }
 
 // NOLINTNEXTLINE(readability-convert-member-functions-to-static)
@@ -251,51 +513,457 @@ void Server::validatePassword(const std::string& password) {
   }
 }
 
-void Server::setupServerSocket() {
-  // Create TCP socket for IPv4
-  serverSocket_ = socket(AF_INET, SOCK_STREAM, 0);
-  if (serverSocket_ < 0) {
+void Server::setupListeners() {
+  if (config_.listenAddresses.empty()) {
+    openListener(ListenAddress("*", port_, 0));
+    return;
+  }
+  for (size_t i = 0; i < config_.listenAddresses.size(); ++i) {
+    openListener(config_.listenAddresses[i]);
+  }
+}
+
+void Server::openListener(const ListenAddress& listenAddress) {
+  struct sockaddr_storage address;
+  std::memset(&address, 0, sizeof(address));
+  socklen_t addressLen;
+  bool wildcard = listenAddress.host == "*";
+  bool ipv6 = wildcard || listenAddress.host.find(':') != std::string::npos;
+
+  // Wildcard: one dual-stack IPv6 socket also accepts IPv4 connections
+  // (as v4-mapped addresses); fall back to IPv4 on hosts without IPv6
+  int fd = -1;
+  if (ipv6) {
+    fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0 && wildcard && errno == EAFNOSUPPORT) ipv6 = false;
+  }
+  if (!ipv6) {
+    fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  }
+  if (fd < 0) {
     int errsv = errno;
     throw std::runtime_error(createErrorMessage("socket", errsv));
   }
+  listenFds_.push_back(fd);  // Closed by the destructor on failure
 
   // SO_REUSEADDR: Allow quick server restart
   int opt = 1;
-  if (setsockopt(serverSocket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) <
-      0) {
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
     int errsv = errno;
     throw std::runtime_error(createErrorMessage("setsockopt", errsv));
   }
 
-  // Set non-blocking mode
-  if (fcntl(serverSocket_, F_SETFL, O_NONBLOCK) < 0) {
-    int errsv = errno;
-    throw std::runtime_error(createErrorMessage("fcntl", errsv));
+  if (ipv6) {
+    // Explicit IPv6 addresses are IPv6-only so that an IPv4 listener can
+    // share the port; the default of this option is system dependent
+    int v6only = wildcard ? 0 : 1;
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) <
+        0) {
+      int errsv = errno;
+      throw std::runtime_error(createErrorMessage("setsockopt", errsv));
+    }
+    struct sockaddr_in6* addr6 =
+        reinterpret_cast<struct sockaddr_in6*>(&address);
+    addr6->sin6_family = AF_INET6;
+    addr6->sin6_port = htons(listenAddress.port);
+    if (wildcard) {
+      addr6->sin6_addr = in6addr_any;
+    } else {
+      inet_pton(AF_INET6, listenAddress.host.c_str(), &addr6->sin6_addr);
+    }
+    addressLen = sizeof(*addr6);
+  } else {
+    struct sockaddr_in* addr4 = reinterpret_cast<struct sockaddr_in*>(&address);
+    addr4->sin_family = AF_INET;
+    addr4->sin_port = htons(listenAddress.port);
+    if (wildcard) {
+      addr4->sin_addr.s_addr = htonl(INADDR_ANY);
+    } else {
+      inet_pton(AF_INET, listenAddress.host.c_str(), &addr4->sin_addr);
+    }
+    addressLen = sizeof(*addr4);
   }
 
-  // Bind to address
-  struct sockaddr_in address;
-  std::memset(&address, 0, sizeof(address));
-  address.sin_family = AF_INET;
-  address.sin_addr.s_addr = INADDR_ANY;
-  address.sin_port = htons(port_);
+  std::string description =
+      (ipv6 && !wildcard ? "[" + listenAddress.host + "]"
+                         : listenAddress.host) +
+      ":" + int_to_string(listenAddress.port);
 
-  if (bind(serverSocket_, reinterpret_cast<struct sockaddr*>(&address),
-           sizeof(address)) < 0) {
+  // Bind to address
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), addressLen) < 0) {
     int errsv = errno;
-    throw std::runtime_error(createErrorMessage("bind", errsv));
+    throw std::runtime_error(createErrorMessage("bind", errsv) + " (" +
+                             description + ")");
   }
 
   // Listen for connections
-  if (listen(serverSocket_, kMaxQueue) < 0) {
+  int backlog = listenAddress.backlog > 0 ? listenAddress.backlog : kMaxQueue;
+  if (listen(fd, backlog) < 0) {
     int errsv = errno;
     throw std::runtime_error(createErrorMessage("listen", errsv));
   }
 
-  // Create epoll instance and register server socket
-  eventLoop_.create();
-  eventLoop_.addFd(serverSocket_, EPOLLIN);
+  eventLoop_.addFd(fd, EPOLLIN);
+
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Server started listening on " + description + " (" +
+          (wildcard ? (ipv6 ? "dual-stack, " : "IPv4 only, ") : "") +
+          "backlog " + int_to_string(backlog) + ")");
+}
+
+bool Server::isListener(int fd) const {
+  return std::find(listenFds_.begin(), listenFds_.end(), fd) !=
+         listenFds_.end();
+}
+
+// ==========================================
+// Channel snapshots
+// ==========================================
+
+void Server::restoreSnapshot() {
+  if (config_.snapshotPath.empty()) return;
+  double start = getMonotonicTime();
+  try {
+    size_t count =
+        ChannelSnapshot::restore(config_.snapshotPath, channelManager_);
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+        "Restored " + int_to_string(count) + " channels from " +
+            config_.snapshotPath + " in " +
+            int_to_string(static_cast<int>(
+                (getMonotonicTime() - start) * 1000000)) +
+            " us");
+  } catch (std::exception& e) {
+    // A bad snapshot must not keep the server from starting
+    channelManager_.removeAll();
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        std::string("Channel snapshot not restored: ") + e.what());
+  }
+}
+
+void Server::runSnapshots() {
+  if (snapshotPid_ > 0) reapSnapshot(WNOHANG);
+  if (snapshotPid_ > 0 || config_.snapshotInterval <= 0) return;
+  double now = getMonotonicTime();
+  if (now < nextSnapshotTime_) return;
+  nextSnapshotTime_ = now + config_.snapshotInterval;
+  startSnapshot();
+}
+
+// The snapshot is encoded and written by a forked child from its
+// copy-on-write image of the state, so the reactor only pays for fork()
+void Server::startSnapshot() {
+  pid_t pid = fork();
+  if (pid < 0) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        "Channel snapshot: " + createErrorMessage("fork", errno));
+    return;
+  }
+  if (pid == 0) {
+    int status = 0;
+    try {
+      ChannelSnapshot::write(
+          config_.snapshotPath,
+          ChannelSnapshot::encode(channelManager_));
+    } catch (std::exception& e) {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          std::string("Channel snapshot failed: ") + e.what());
+      status = 1;
+    }
+    _exit(status);  // No destructors: the sockets belong to the parent
+  }
+  snapshotPid_ = pid;
+}
+
+void Server::reapSnapshot(int options) {
+  int status;
+  pid_t pid = waitpid(snapshotPid_, &status, options);
+  if (pid == 0) return;  // Still running
+  snapshotPid_ = -1;
+  if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+    log(LOG_LEVEL_DEBUG, LOG_CATEGORY_SYSTEM,
+        "Channel snapshot written to " + config_.snapshotPath);
+  }
+}
 
+// Final snapshot when the server stops: nothing left to stall
+void Server::saveSnapshot() {
+  if (snapshotPid_ > 0) reapSnapshot(0);
+  try {
+    ChannelSnapshot::write(
+        config_.snapshotPath,
+        ChannelSnapshot::encode(channelManager_));
+    log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+        "Channel snapshot saved to " + config_.snapshotPath);
+  } catch (std::exception& e) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        std::string("Channel snapshot failed: ") + e.what());
+  }
+}
+
+// ==========================================
+// Upgrade (socket handoff)
+// ==========================================
+
+// The old process keeps its sockets until the new one confirms that it
+// serves them, so a failed upgrade leaves this process running as before.
+// Clients only see a short pause: their sockets never close and unread data
+// waits in the kernel buffers.
+bool Server::upgrade() {
   log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
-      "Server started listening on port " + int_to_string(port_));
+      "Upgrade requested, starting " + executablePath_);
+  if (executablePath_.empty()) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        "Upgrade failed: executable path unknown");
+    return false;
+  }
+
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        "Upgrade failed: " + createErrorMessage("socketpair", errno));
+    return false;
+  }
+
+  // Everything the child needs is prepared before fork(): only
+  // async-signal-safe calls are allowed between fork() and exec
+  std::string fdVariable = "IRCSERV_UPGRADE_FD=" + int_to_string(sv[1]);
+  std::vector<char*> envp;
+  for (char** env = environ; *env; ++env) {
+    if (std::strncmp(*env, "IRCSERV_UPGRADE_FD=", 19) != 0) {
+      envp.push_back(*env);
+    }
+  }
+  envp.push_back(const_cast<char*>(fdVariable.c_str()));
+  envp.push_back(NULL);
+  std::string portStr = int_to_string(port_);
+  char* argv[] = {const_cast<char*>(executablePath_.c_str()),
+                  const_cast<char*>(portStr.c_str()),
+                  const_cast<char*>(password_.c_str()), NULL};
+
+  // The new process binds the admin address itself and reconnects the
+  // links; users of other servers quit here and come back with the burst
+  adminServer_.stop();
+  linkManager_.stop();
+  // Written out before the new process appends to the same files
+  cmdRouter_.closeHistoryLog();
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    fcntl(sv[1], F_SETFD, 0);  // Keep the handoff socket across exec
+    execve(argv[0], argv, &envp[0]);
+    _exit(127);
+  }
+  int errsv = errno;
+  close(sv[1]);
+
+  try {
+    if (pid < 0) {
+      throw std::runtime_error(createErrorMessage("fork", errsv));
+    }
+    std::vector<int> fds;
+    std::string state = serializeState(fds);
+    Handoff::send(sv[0], state, fds);
+    waitForAck(sv[0]);
+  } catch (std::exception& e) {
+    log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+        std::string("Upgrade failed: ") + e.what());
+    close(sv[0]);
+    if (pid > 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, NULL, 0);
+    }
+    if (!config_.adminListen.empty()) {
+      try {
+        adminServer_.listen(config_.adminListen);
+      } catch (std::exception& e) {
+        log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+            std::string("Admin listener not restored: ") + e.what());
+      }
+    }
+    try {
+      linkManager_.start(config_);
+    } catch (std::exception& e) {
+      log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+          std::string("Link listener not restored: ") + e.what());
+    }
+    if (!config_.historyDirectory.empty()) {
+      try {
+        cmdRouter_.openHistoryLog(config_.historyDirectory,
+                                  config_.historyChannels);
+      } catch (std::exception& e) {
+        log(LOG_LEVEL_ERROR, LOG_CATEGORY_SYSTEM,
+            std::string("History log not reopened: ") + e.what());
+      }
+    }
+    return false;
+  }
+
+  close(sv[0]);
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Upgrade complete, handed over to new process " + int_to_string(pid));
+  return true;
+}
+
+// State layout (BinaryWriter encoding):
+//   version, listener count, user count, users, channel count, channels
+// fds receives the listeners followed by the user sockets in the order of
+// the users; channels refer to users by that index.
+std::string Server::serializeState(std::vector<int>& fds) {
+  BinaryWriter writer;
+  writer.writeU32(kHandoffStateVersion);
+
+  fds.assign(listenFds_.begin(), listenFds_.end());
+  writer.writeU32(static_cast<uint32_t>(listenFds_.size()));
+
+  const std::map<int, User*>& users = userManager_.getUsers();
+  std::map<int, uint32_t> indexByFd;
+  writer.writeU32(static_cast<uint32_t>(users.size()));
+  for (std::map<int, User*>::const_iterator it = users.begin();
+       it != users.end(); ++it) {
+    User* user = it->second;
+    uint32_t index = static_cast<uint32_t>(indexByFd.size());
+    indexByFd[it->first] = index;
+    fds.push_back(it->first);
+    writer.writeString(user->getIp());
+    writer.writeString(user->getNickname());
+    writer.writeString(user->getUsername());
+    writer.writeString(user->getRealname());
+    writer.writeBool(user->isAuthenticated());
+    writer.writeBool(user->isRegistered());
+    writer.writeU32(user->getCaps());
+    writer.writeBool(user->isNegotiatingCaps());
+    writer.writeString(user->getAwayMessage());
+    const std::vector<std::string>& monitored = user->getMonitored();
+    writer.writeU32(static_cast<uint32_t>(monitored.size()));
+    for (size_t i = 0; i < monitored.size(); ++i) {
+      writer.writeString(monitored[i]);
+    }
+    writer.writeString(user->getReadBuffer());
+    writer.writeString(user->getWriteBuffer());
+  }
+
+  const CaseMappedMap<Channel*>& channels =
+      channelManager_.getChannels();
+  writer.writeU32(static_cast<uint32_t>(channels.size()));
+  for (CaseMappedMap<Channel*>::const_iterator it = channels.begin();
+       it != channels.end(); ++it) {
+    const Channel* channel = it->second;
+    writer.writeString(channel->getName());
+    writer.writeString(channel->getTopic());
+    writer.writeString(channel->getKey());
+    writer.writeBool(channel->isInviteOnly());
+    writer.writeBool(channel->isTopicRestricted());
+    writer.writeBool(channel->hasUserLimit());
+    writer.writeU32(static_cast<uint32_t>(channel->getUserLimit()));
+    writeUserIndices(writer, channel->getMembers(), indexByFd);
+    writeUserIndices(writer, channel->getOperators(), indexByFd);
+    writeUserIndices(writer, channel->getInvited(), indexByFd);
+    ChannelSnapshot::writeMasks(writer, channel);
+  }
+  return writer.getData();
+}
+
+void Server::resumeFromHandoff(int sock) {
+  std::string state;
+  std::vector<int> fds;
+  Handoff::receive(sock, state, fds);
+  restoreState(state, fds);
+
+  // Confirm: the old process exits and leaves the sockets to us
+  char ack = kHandoffAck;
+  ssize_t sent = send(sock, &ack, 1, MSG_NOSIGNAL);
+  int errsv = errno;
+  close(sock);
+  if (sent != 1) {
+    throw std::runtime_error(createErrorMessage("send (handoff)", errsv));
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Resumed from previous process: " +
+          int_to_string(userManager_.getUsers().size()) + " users, " +
+          int_to_string(channelManager_.getChannels().size()) + " channels");
+}
+
+void Server::restoreState(const std::string& state,
+                          const std::vector<int>& fds) {
+  BinaryReader reader(state.data(), state.size());
+  if (reader.readU32() != kHandoffStateVersion) {
+    throw std::runtime_error("Handoff: unsupported state version");
+  }
+
+  size_t nextFd = 0;
+  uint32_t listenerCount = reader.readU32();
+  if (listenerCount > fds.size()) {
+    throw std::runtime_error("Handoff: missing listening sockets");
+  }
+  for (uint32_t i = 0; i < listenerCount; ++i) {
+    int fd = fds[nextFd++];
+    listenFds_.push_back(fd);
+    eventLoop_.addFd(fd, EPOLLIN);
+  }
+  log(LOG_LEVEL_INFO, LOG_CATEGORY_SYSTEM,
+      "Server resumed listening on " + int_to_string(listenerCount) +
+          " socket(s)");
+
+  uint32_t userCount = reader.readU32();
+  if (userCount > fds.size() - nextFd) {
+    throw std::runtime_error("Handoff: missing client sockets");
+  }
+  std::vector<User*> users;
+  for (uint32_t i = 0; i < userCount; ++i) {
+    int fd = fds[nextFd++];
+    std::string ip = reader.readString();
+    User* user = new User(fd, ip);
+    userManager_.addUser(user);
+    users.push_back(user);
+
+    std::string nickname = reader.readString();
+    if (!nickname.empty()) userManager_.updateNickname(user, "", nickname);
+    user->setUsername(reader.readString());
+    user->setRealname(reader.readString());
+    user->setAuthenticated(reader.readBool());
+    user->setRegistered(reader.readBool());
+    user->setCaps(reader.readU32() & allCapabilities());
+    user->setNegotiatingCaps(reader.readBool());
+    user->setAwayMessage(reader.readString());
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      userManager_.addMonitor(user, reader.readString());
+    }
+    user->getReadBuffer() = reader.readString();
+    user->getWriteBuffer() = reader.readString();
+
+    // Data that arrived during the handoff is reported on registration
+    uint32_t events = EPOLLIN;
+    if (!user->getWriteBuffer().empty()) events |= EPOLLOUT;
+    eventLoop_.addFd(fd, events);
+  }
+
+  uint32_t channelCount = reader.readU32();
+  for (uint32_t i = 0; i < channelCount; ++i) {
+    std::string name = reader.readString();
+    Channel* channel = channelManager_.createChannel(name);
+    if (!channel) throw std::runtime_error("Handoff: duplicate channel");
+    channel->setTopic(reader.readString());
+    std::string key = reader.readString();
+    if (!key.empty()) channel->setKey(key);
+    channel->setInviteOnly(reader.readBool());
+    channel->setTopicRestricted(reader.readBool());
+    bool hasUserLimit = reader.readBool();
+    uint32_t userLimit = reader.readU32();
+    if (hasUserLimit) channel->setUserLimit(userLimit);
+
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      User* user = readUser(reader, users);
+      channel->addMember(user->getSocketFd());
+      user->joinChannel(channel);
+    }
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      channel->addOperator(readUser(reader, users)->getSocketFd());
+    }
+    for (uint32_t count = reader.readU32(); count > 0; --count) {
+      channel->addInvite(readUser(reader, users)->getSocketFd());
+    }
+    ChannelSnapshot::readMasks(reader, channel);
+  }
+
+  if (!reader.atEnd()) throw std::runtime_error("Handoff: trailing data");
 }
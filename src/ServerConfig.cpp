@@ -0,0 +1,208 @@
+#include "ServerConfig.hpp"
+
+#include <arpa/inet.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+ListenAddress::ListenAddress() : port(0), backlog(0) {}
+
+ListenAddress::ListenAddress(const std::string& host, int port, int backlog)
+    : host(host), port(port), backlog(backlog) {}
+
+ServerConfig::ServerConfig()
+    : slowLoopThreshold(0.050),
+      loopReportInterval(60.0),
+      eventBackend(EVENT_BACKEND_EPOLL),
+      snapshotInterval(60.0),
+      malformedLimit(50),
+      historyMemory(16384 * 1024),
+      upgradeFd(-1),
+      serverName("ft_irc") {}
+
+// Helper: Read an environment variable, empty string if unset
+static std::string getEnv(const char* name) {
+  const char* value = std::getenv(name);
+  return value ? std::string(value) : std::string();
+}
+
+// Helper: Read a non-negative integer environment variable
+// Returns: defaultValue if the variable is unset
+static unsigned long getEnvUnsigned(const char* name,
+                                    unsigned long defaultValue) {
+  std::string value = getEnv(name);
+  if (value.empty()) return defaultValue;
+  if (value.length() > 9) {
+    throw std::runtime_error(std::string("Invalid ") + name + ": too large");
+  }
+  unsigned long result = 0;
+  for (size_t i = 0; i < value.length(); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(value[i]))) {
+      throw std::runtime_error(std::string("Invalid ") + name +
+                               ": must be a non-negative integer");
+    }
+    result = result * 10 + (value[i] - '0');
+  }
+  return result;
+}
+
+// Helper: Parse a decimal number of at most maxDigits digits
+// Returns: -1 if str is empty, too long or contains non-digits
+static long parseDecimal(const std::string& str, size_t maxDigits) {
+  if (str.empty() || str.length() > maxDigits) return -1;
+  long result = 0;
+  for (size_t i = 0; i < str.length(); ++i) {
+    if (!std::isdigit(static_cast<unsigned char>(str[i]))) return -1;
+    result = result * 10 + (str[i] - '0');
+  }
+  return result;
+}
+
+// Helper: Split a comma separated list, empty string: no entries
+static std::vector<std::string> splitList(const std::string& list) {
+  std::vector<std::string> entries;
+  size_t start = 0;
+  while (!list.empty() && start <= list.length()) {
+    size_t comma = list.find(',', start);
+    if (comma == std::string::npos) comma = list.length();
+    entries.push_back(list.substr(start, comma - start));
+    start = comma + 1;
+  }
+  return entries;
+}
+
+int ServerConfig::parsePort(const std::string& portStr) {
+  long port = parseDecimal(portStr, 5);
+  if (port < 1 || port > 65535) {
+    throw std::runtime_error("Invalid port: must be a number from 1 to 65535");
+  }
+  return static_cast<int>(port);
+}
+
+ListenAddress ServerConfig::parseListenAddress(const std::string& spec) {
+  std::string rest = spec;
+  int backlog = 0;
+  size_t slash = rest.rfind('/');
+  if (slash != std::string::npos) {
+    long value = parseDecimal(rest.substr(slash + 1), 5);
+    if (value < 1) {
+      throw std::runtime_error("Invalid listen address \"" + spec +
+                               "\": backlog must be a positive number");
+    }
+    backlog = static_cast<int>(value);
+    rest.erase(slash);
+  }
+
+  size_t colon = rest.rfind(':');
+  if (colon == std::string::npos || colon == 0) {
+    throw std::runtime_error("Invalid listen address \"" + spec +
+                             "\": expected <host>:<port>");
+  }
+  std::string host = rest.substr(0, colon);
+  int port = parsePort(rest.substr(colon + 1));
+
+  // Validate the host now so that configuration errors surface at startup
+  unsigned char buf[sizeof(struct in6_addr)];
+  if (host.length() > 2 && host[0] == '[' && host[host.length() - 1] == ']') {
+    host = host.substr(1, host.length() - 2);
+    if (inet_pton(AF_INET6, host.c_str(), buf) != 1) {
+      throw std::runtime_error("Invalid listen address \"" + spec +
+                               "\": bad IPv6 address");
+    }
+  } else if (host != "*" && inet_pton(AF_INET, host.c_str(), buf) != 1) {
+    throw std::runtime_error("Invalid listen address \"" + spec +
+                             "\": host must be *, an IPv4 address or an "
+                             "IPv6 address in brackets");
+  }
+  return ListenAddress(host, port, backlog);
+}
+
+ListenAddress ServerConfig::parsePeerAddress(const std::string& spec) {
+  if (spec.find('/') != std::string::npos) {
+    throw std::runtime_error("Invalid link address \"" + spec +
+                             "\": expected <host>:<port>");
+  }
+  ListenAddress address = parseListenAddress(spec);
+  if (address.host == "*") {
+    throw std::runtime_error("Invalid link address \"" + spec +
+                             "\": host must be an address");
+  }
+  return address;
+}
+
+bool ServerConfig::isValidServerName(const std::string& name) {
+  if (name.empty() || name.length() > 63) return false;
+  for (size_t i = 0; i < name.length(); ++i) {
+    unsigned char c = static_cast<unsigned char>(name[i]);
+    if (!std::isalnum(c) && c != '.' && c != '-' && c != '_') return false;
+  }
+  return true;
+}
+
+ServerConfig ServerConfig::fromEnvironment() {
+  ServerConfig config;
+  config.adminListen = getEnv("IRCSERV_ADMIN_LISTEN");
+  config.slowLoopThreshold =
+      getEnvUnsigned("IRCSERV_SLOW_LOOP_MS", 50) / 1000.0;
+  config.loopReportInterval =
+      static_cast<double>(getEnvUnsigned("IRCSERV_LOOP_REPORT_INTERVAL", 60));
+  std::vector<std::string> listen = splitList(getEnv("IRCSERV_LISTEN"));
+  for (size_t i = 0; i < listen.size(); ++i) {
+    config.listenAddresses.push_back(parseListenAddress(listen[i]));
+  }
+
+  std::string backend = getEnv("IRCSERV_EVENT_BACKEND");
+  if (backend == "io_uring") {
+    config.eventBackend = EVENT_BACKEND_IO_URING;
+  } else if (!backend.empty() && backend != "epoll") {
+    throw std::runtime_error(
+        "Invalid IRCSERV_EVENT_BACKEND: must be \"epoll\" or \"io_uring\"");
+  }
+
+  config.snapshotPath = getEnv("IRCSERV_SNAPSHOT_PATH");
+  config.snapshotInterval =
+      static_cast<double>(getEnvUnsigned("IRCSERV_SNAPSHOT_INTERVAL", 60));
+
+  config.malformedLimit =
+      static_cast<int>(getEnvUnsigned("IRCSERV_MALFORMED_LIMIT", 50));
+
+  config.historyMemory = getEnvUnsigned("IRCSERV_HISTORY_KB", 16384) * 1024;
+  config.historyDirectory = getEnv("IRCSERV_HISTORY_DIR");
+  config.historyChannels = splitList(getEnv("IRCSERV_HISTORY_CHANNELS"));
+
+  if (!getEnv("IRCSERV_UPGRADE_FD").empty()) {
+    config.upgradeFd =
+        static_cast<int>(getEnvUnsigned("IRCSERV_UPGRADE_FD", 0));
+  }
+
+  std::string serverName = getEnv("IRCSERV_SERVER_NAME");
+  if (!serverName.empty()) config.serverName = serverName;
+  if (!isValidServerName(config.serverName)) {
+    throw std::runtime_error(
+        "Invalid IRCSERV_SERVER_NAME: use up to 63 letters, digits, '.', "
+        "'-' or '_'");
+  }
+  std::string linkListen = getEnv("IRCSERV_LINK_LISTEN");
+  if (!linkListen.empty()) config.linkListen = parseListenAddress(linkListen);
+  std::vector<std::string> peers = splitList(getEnv("IRCSERV_LINKS"));
+  for (size_t i = 0; i < peers.size(); ++i) {
+    config.linkPeers.push_back(parsePeerAddress(peers[i]));
+  }
+  config.linkPassword = getEnv("IRCSERV_LINK_PASSWORD");
+  if ((config.linkListen.port != 0 || !config.linkPeers.empty()) &&
+      config.linkPassword.empty()) {
+    throw std::runtime_error(
+        "IRCSERV_LINK_PASSWORD is required for server links");
+  }
+  for (size_t i = 0; i < config.linkPassword.length(); ++i) {
+    if (!std::isgraph(static_cast<unsigned char>(config.linkPassword[i]))) {
+      throw std::runtime_error(
+          "Invalid IRCSERV_LINK_PASSWORD: contains non-printable or space "
+          "characters");
+    }
+  }
+  return config;
+}
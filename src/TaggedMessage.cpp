@@ -0,0 +1,40 @@
+#include "TaggedMessage.hpp"
+
+#include <string>
+
+#include "Capability.hpp"
+
+TaggedMessage::TaggedMessage(const std::string& line, MessageClock* clock,
+                             const std::string& clientTags, bool tagsOnly)
+    : line_(line),
+      clock_(clock),
+      clientTags_(clientTags),
+      tagsOnly_(tagsOnly) {}
+
+TaggedMessage::~TaggedMessage() {}
+
+const std::string& TaggedMessage::render(unsigned caps) {
+  bool time = (caps & CAP_SERVER_TIME) != 0;
+  bool tags = (caps & CAP_MESSAGE_TAGS) != 0;
+  if (!tags && tagsOnly_) return none_;
+  if (!time && !tags) return line_;
+
+  std::string& variant = variants_[(time ? 1 : 0) + (tags ? 2 : 0) - 1];
+  if (!variant.empty()) return variant;
+  variant.reserve(line_.length() + clientTags_.length() + 80);
+  variant += '@';
+  if (time) variant += "time=" + clock_->getServerTime();
+  if (tags) {
+    if (time) variant += ';';
+    variant += "msgid=" + getMsgId();
+    if (!clientTags_.empty()) variant += ";" + clientTags_;
+  }
+  variant += ' ';
+  variant += line_;
+  return variant;
+}
+
+const std::string& TaggedMessage::getMsgId() {
+  if (msgid_.empty()) msgid_ = clock_->nextMsgId();
+  return msgid_;
+}
@@ -14,16 +14,41 @@
 
 #include <unistd.h>
 
-#include <set>
+#include <climits>
+#include <ctime>
 #include <string>
+#include <vector>
 
-#include "utils.hpp"
+namespace {
+// Identities are never reused (see User::getIdentity())
+unsigned long g_nextIdentity = 1;
+}  // namespace
+
+ReplyCursor::ReplyCursor(ReplyKind kind)
+    : kind(kind),
+      slot(0),
+      nextId(INT_MIN),
+      minUsers(0),
+      maxUsers(static_cast<size_t>(-1)) {}
 
 User::User(int socketFd, const std::string& ip)
-    : socketFd_(socketFd), ip_(ip), authenticated_(false), registered_(false) {}
+    : socketFd_(socketFd),
+      ip_(ip),
+      authenticated_(false),
+      registered_(false),
+      nickTime_(static_cast<long>(std::time(NULL))),
+      linkFd_(INVALID_FD),
+      malformedCount_(0),
+      malformedWindowStart_(0.0),
+      replyCursor_(NULL),
+      identity_(g_nextIdentity++),
+      caps_(0),
+      negotiatingCaps_(false) {}
 
 User::~User() {
-  if (socketFd_ != INVALID_FD) {
+  delete replyCursor_;
+  // Remote users have a negative id and no socket
+  if (socketFd_ >= 0) {
     close(socketFd_);
   }
 }
@@ -43,10 +68,36 @@ bool User::isAuthenticated() const { return authenticated_; }
 
 bool User::isRegistered() const { return registered_; }
 
+const std::string& User::getUid() const { return uid_; }
+
+long User::getNickTime() const { return nickTime_; }
+
+unsigned long User::getIdentity() const { return identity_; }
+
+unsigned User::getCaps() const { return caps_; }
+
+bool User::hasCap(unsigned cap) const { return (caps_ & cap) != 0; }
+
+bool User::isNegotiatingCaps() const { return negotiatingCaps_; }
+
+const std::string& User::getAwayMessage() const { return awayMessage_; }
+
+const std::vector<std::string>& User::getMonitored() const {
+  return monitored_;
+}
+
+std::vector<std::string>& User::getMonitored() { return monitored_; }
+
 // Setters
-void User::setNickname(const std::string& nickname) { nickname_ = nickname; }
+void User::setNickname(const std::string& nickname) {
+  nickname_ = nickname;
+  identity_ = g_nextIdentity++;
+}
 
-void User::setUsername(const std::string& username) { username_ = username; }
+void User::setUsername(const std::string& username) {
+  username_ = username;
+  identity_ = g_nextIdentity++;
+}
 
 void User::setRealname(const std::string& realname) { realname_ = realname; }
 
@@ -56,27 +107,79 @@ void User::setAuthenticated(bool authenticated) {
 
 void User::setRegistered(bool registered) { registered_ = registered; }
 
+void User::setUid(const std::string& uid) { uid_ = uid; }
+
+void User::setNickTime(long nickTime) { nickTime_ = nickTime; }
+
+void User::setCaps(unsigned caps) { caps_ = caps; }
+
+void User::setNegotiatingCaps(bool negotiating) {
+  negotiatingCaps_ = negotiating;
+}
+
+void User::setAwayMessage(const std::string& message) {
+  awayMessage_ = message;
+}
+
+// Remote users
+void User::setRemote(const std::string& server, int linkFd) {
+  server_ = server;
+  linkFd_ = linkFd;
+}
+
+bool User::isRemote() const { return !server_.empty(); }
+
+const std::string& User::getServer() const { return server_; }
+
+int User::getLinkFd() const { return linkFd_; }
+
 // Channel operations
-void User::joinChannel(const std::string& channel) {
-  // Normalize channel name to match ChannelManager's indexing
-  std::string normalizedChannel = normalizeChannelName(channel);
-  joinedChannels_.insert(normalizedChannel);
+void User::joinChannel(Channel* channel) {
+  if (!isInChannel(channel)) joinedChannels_.push_back(channel);
 }
 
-void User::leaveChannel(const std::string& channel) {
-  std::string normalizedChannel = normalizeChannelName(channel);
-  joinedChannels_.erase(normalizedChannel);
+void User::leaveChannel(Channel* channel) {
+  for (size_t i = 0; i < joinedChannels_.size(); ++i) {
+    if (joinedChannels_[i] == channel) {
+      // Order does not matter: swap with the last one
+      joinedChannels_[i] = joinedChannels_.back();
+      joinedChannels_.pop_back();
+      return;
+    }
+  }
 }
 
-bool User::isInChannel(const std::string& channel) const {
-  std::string normalizedChannel = normalizeChannelName(channel);
-  return joinedChannels_.find(normalizedChannel) != joinedChannels_.end();
+bool User::isInChannel(const Channel* channel) const {
+  for (size_t i = 0; i < joinedChannels_.size(); ++i) {
+    if (joinedChannels_[i] == channel) return true;
+  }
+  return false;
 }
 
-const std::set<std::string>& User::getJoinedChannels() const {
+const std::vector<Channel*>& User::getJoinedChannels() const {
   return joinedChannels_;
 }
 
+int User::countMalformed(double now, double window) {
+  if (malformedCount_ == 0 || now - malformedWindowStart_ >= window) {
+    malformedCount_ = 0;
+    malformedWindowStart_ = now;
+  }
+  return ++malformedCount_;
+}
+
+ReplyCursor* User::getReplyCursor() { return replyCursor_; }
+
+void User::startReply(const ReplyCursor& cursor) {
+  delete replyCursor_;
+  replyCursor_ = new ReplyCursor(cursor);
+}
+
+void User::endReply() {
+  delete replyCursor_;
+  replyCursor_ = NULL;
+}
+
 // Buffer access
 std::string& User::getReadBuffer() { return readBuffer_; }
 
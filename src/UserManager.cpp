@@ -1,8 +1,12 @@
 #include "UserManager.hpp"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include "utils.hpp"
 
-UserManager::UserManager() {}
+UserManager::UserManager() : remoteUserCount_(0) {}
 
 UserManager::~UserManager() { removeAll(); }
 
@@ -14,12 +18,13 @@ void UserManager::addUser(User* user) {
   }
 
   users_[user->getSocketFd()] = user;
+  if (user->isRemote()) ++remoteUserCount_;
+  if (!user->getUid().empty()) usersByUid_[user->getUid()] = user;
 
   // Add to nickname index if user has a nickname
   // Nicknames are case-insensitive per RFC1459
   if (!user->getNickname().empty()) {
-    std::string normalizedNick = normalizeNickname(user->getNickname());
-    usersByNick_[normalizedNick] = user;
+    usersByNick_.set(user->getNickname(), user);
   }
 }
 
@@ -35,10 +40,10 @@ void UserManager::removeUser(int fd) {
   std::string ip = user->getIp();
 
   // Remove from nickname index (case-insensitive)
-  if (!user->getNickname().empty()) {
-    std::string normalizedNick = normalizeNickname(user->getNickname());
-    usersByNick_.erase(normalizedNick);
-  }
+  if (!user->getNickname().empty()) usersByNick_.erase(user->getNickname());
+  if (!user->getUid().empty()) usersByUid_.erase(user->getUid());
+  if (user->isRemote()) --remoteUserCount_;
+  clearMonitors(user);
 
   delete user;  // User destructor closes the socket
   users_.erase(it);
@@ -54,6 +59,9 @@ void UserManager::removeAll() {
   }
   users_.clear();
   usersByNick_.clear();
+  usersByUid_.clear();
+  watchers_.clear();
+  remoteUserCount_ = 0;
 }
 
 User* UserManager::getUserByFd(int fd) {
@@ -63,17 +71,24 @@ User* UserManager::getUserByFd(int fd) {
 }
 
 User* UserManager::getUserByNickname(const std::string& nickname) {
-  std::string normalizedNick = normalizeNickname(nickname);
-  std::map<std::string, User*>::iterator it = usersByNick_.find(normalizedNick);
-  if (it == usersByNick_.end()) return NULL;
+  User** user = usersByNick_.find(nickname);
+  return user ? *user : NULL;
+}
+
+User* UserManager::getUserByUid(const std::string& uid) {
+  std::map<std::string, User*>::iterator it = usersByUid_.find(uid);
+  if (it == usersByUid_.end()) return NULL;
   return it->second;
 }
 
 const std::map<int, User*>& UserManager::getUsers() const { return users_; }
 
+size_t UserManager::getLocalUserCount() const {
+  return users_.size() - remoteUserCount_;
+}
+
 bool UserManager::isNicknameInUse(const std::string& nickname) const {
-  std::string normalizedNick = normalizeNickname(nickname);
-  return usersByNick_.find(normalizedNick) != usersByNick_.end();
+  return usersByNick_.find(nickname) != NULL;
 }
 
 void UserManager::updateNickname(User* user, const std::string& oldNick,
@@ -85,17 +100,57 @@ void UserManager::updateNickname(User* user, const std::string& oldNick,
   }
 
   // Remove old nickname from index (case-insensitive)
-  if (!oldNick.empty()) {
-    std::string normalizedOldNick = normalizeNickname(oldNick);
-    usersByNick_.erase(normalizedOldNick);
-  }
+  if (!oldNick.empty()) usersByNick_.erase(oldNick);
 
   // Update user's nickname (preserve original case)
   user->setNickname(newNick);
 
   // Add new nickname to index (case-insensitive)
-  if (!newNick.empty()) {
-    std::string normalizedNewNick = normalizeNickname(newNick);
-    usersByNick_[normalizedNewNick] = user;
+  if (!newNick.empty()) usersByNick_.set(newNick, user);
+}
+
+void UserManager::setUid(User* user, const std::string& uid) {
+  if (!user->getUid().empty()) usersByUid_.erase(user->getUid());
+  user->setUid(uid);
+  if (!uid.empty()) usersByUid_[uid] = user;
+}
+
+bool UserManager::addMonitor(User* user, const std::string& nickname) {
+  std::vector<std::string>& monitored = user->getMonitored();
+  for (size_t i = 0; i < monitored.size(); ++i) {
+    if (ircCaseEqual(monitored[i], nickname)) return true;
+  }
+  if (monitored.size() >= kMaxMonitored) return false;
+  monitored.push_back(nickname);
+  std::vector<User*>* watchers = watchers_.find(nickname);
+  if (watchers) {
+    watchers->push_back(user);
+  } else {
+    watchers_.set(nickname, std::vector<User*>(1, user));
+  }
+  return true;
+}
+
+void UserManager::removeMonitor(User* user, const std::string& nickname) {
+  std::vector<std::string>& monitored = user->getMonitored();
+  for (size_t i = 0; i < monitored.size(); ++i) {
+    if (!ircCaseEqual(monitored[i], nickname)) continue;
+    std::vector<User*>* watchers = watchers_.find(nickname);
+    watchers->erase(std::find(watchers->begin(), watchers->end(), user));
+    if (watchers->empty()) watchers_.erase(nickname);
+    // Last: nickname may be this entry
+    monitored.erase(monitored.begin() + i);
+    return;
   }
 }
+
+void UserManager::clearMonitors(User* user) {
+  while (!user->getMonitored().empty()) {
+    removeMonitor(user, user->getMonitored().back());
+  }
+}
+
+const std::vector<User*>* UserManager::getWatchers(
+    const std::string& nickname) const {
+  return watchers_.find(nickname);
+}
@@ -17,9 +17,11 @@
 #include <string>
 
 #include "Server.hpp"
+#include "ServerConfig.hpp"
 #include "utils.hpp"
 
 volatile sig_atomic_t g_shutdown = 0;
+volatile sig_atomic_t g_upgrade = 0;
 
 namespace {
 void checkUsage(int argc) {
@@ -29,11 +31,13 @@ void checkUsage(int argc) {
 
 void signalHandler(int signum) {
   if (signum == SIGINT || signum == SIGTERM) g_shutdown = 1;
+  if (signum == SIGUSR2) g_upgrade = 1;  // Hand over to a new binary
 }
 
 void setupSignalHandlers() {
   signal(SIGINT, signalHandler);
   signal(SIGTERM, signalHandler);
+  signal(SIGUSR2, signalHandler);
   signal(SIGPIPE, SIG_IGN);
 }
 }  // namespace
@@ -42,7 +46,7 @@ int main(int argc, char* argv[]) {
   try {
     checkUsage(argc);
     setupSignalHandlers();
-    Server server(argv[1], argv[2]);
+    Server server(argv[1], argv[2], ServerConfig::fromEnvironment());
     server.run();
   } catch (std::exception& e) {
     std::cerr << e.what() << std::endl;
@@ -12,20 +12,25 @@
 
 #include "../include/utils.hpp"
 
+#include <stdint.h>
 #include <time.h>
 
-#include <cctype>
 #include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
 
+#include "../include/ByteScan.hpp"
+
 std::string createLog(LogLevel level, LogCategory category,
                       const std::string& message) {
+  // localtime_r: the history log's writer thread logs too
   time_t now = time(NULL);
+  struct tm local;
   char timeStr[20];
-  strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", localtime(&now));
+  strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S",
+           localtime_r(&now, &local));
 
   std::string color;
   std::string levelStr;
@@ -83,7 +88,9 @@ std::string createLog(LogLevel level, LogCategory category,
 }
 
 void log(LogLevel level, LogCategory category, const std::string& message) {
-  std::cout << createLog(level, category, message) << std::endl;
+  // One write per line, so that lines of two threads do not interleave
+  // (std::cout is synchronized with stdio, whose calls are locked)
+  std::cout << createLog(level, category, message) + "\n" << std::flush;
 }
 
 std::string createErrorMessage(const std::string& context, int errsv) {
@@ -96,20 +103,69 @@ std::string int_to_string(int value) {
   return oss.str();
 }
 
-std::string normalizeNickname(const std::string& nickname) {
-  std::string normalized;
-  normalized.reserve(nickname.length());
-  for (size_t i = 0; i < nickname.length(); ++i) {
-    normalized += std::tolower(static_cast<unsigned char>(nickname[i]));
+char ircToLower(char c) {
+  if (c >= 'A' && c <= '^') return static_cast<char>(c + ('a' - 'A'));
+  return c;
+}
+
+bool ircCaseEqual(const std::string& a, const std::string& b) {
+  if (a.length() != b.length()) return false;
+  for (size_t i = 0; i < a.length(); ++i) {
+    if (ircToLower(a[i]) != ircToLower(b[i])) return false;
+  }
+  return true;
+}
+
+size_t ircCaseHash(const std::string& s) {
+  // FNV-1a
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < s.length(); ++i) {
+    hash ^= static_cast<unsigned char>(ircToLower(s[i]));
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+bool ircMatch(const std::string& mask, const std::string& name) {
+  size_t m = 0;
+  size_t n = 0;
+  // Last '*' seen and where its run currently ends: backtrack there
+  size_t star = std::string::npos;
+  size_t resume = 0;
+  while (n < name.length()) {
+    if (m < mask.length() && mask[m] == '*') {
+      star = m++;
+      resume = n;
+    } else if (m < mask.length() &&
+               (mask[m] == '?' || ircToLower(mask[m]) == ircToLower(name[n]))) {
+      ++m;
+      ++n;
+    } else if (star != std::string::npos) {
+      m = star + 1;
+      n = ++resume;
+    } else {
+      return false;
+    }
   }
+  while (m < mask.length() && mask[m] == '*') ++m;
+  return m == mask.length();
+}
+
+std::string normalizeNickname(const std::string& nickname) {
+  std::string normalized(nickname);
+  if (!normalized.empty()) foldCase(&normalized[0], normalized.length());
   return normalized;
 }
 
 std::string normalizeChannelName(const std::string& channelName) {
-  std::string normalized;
-  normalized.reserve(channelName.length());
-  for (size_t i = 0; i < channelName.length(); ++i) {
-    normalized += std::tolower(static_cast<unsigned char>(channelName[i]));
-  }
+  std::string normalized(channelName);
+  if (!normalized.empty()) foldCase(&normalized[0], normalized.length());
   return normalized;
 }
+
+double getMonotonicTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<double>(ts.tv_sec) +
+         static_cast<double>(ts.tv_nsec) / 1000000000.0;
+}
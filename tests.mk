@@ -105,6 +105,101 @@ e2e-setup:
 e2e-clean:
 	$(RM) -r tests/e2e/.venv tests/e2e/.pytest_cache
 
+# ==============================================================================
+# Benchmarks
+# ==============================================================================
+
+# Compare the epoll and io_uring event loop backends
+.PHONY: bench
+bench: $(NAME)
+	@python3 tests/bench/bench_event_backend.py --binary ./$(NAME)
+
+# Throughput of the lock-free MPSC mailbox (producer threads -> event loop)
+BENCH_MAILBOX_NAME = bench_mailbox
+BENCH_MAILBOX_OBJ = $(BUILD_DIR)/EventLoop.o $(BUILD_DIR)/IoUring.o \
+                    $(BUILD_DIR)/utils.o $(BUILD_DIR)/ByteScan.o
+
+.PHONY: bench-mailbox
+bench-mailbox: $(BENCH_MAILBOX_NAME)
+	@./$(BENCH_MAILBOX_NAME)
+
+$(BENCH_MAILBOX_NAME): tests/bench/bench_mailbox.cpp $(BENCH_MAILBOX_OBJ)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@ \
+		-lpthread
+
+# Byte scanning kernels (framing, parameter checks, casemapping) per level
+# Built from source with -O2: the server objects are not optimized
+BENCH_SCAN_NAME = bench_byte_scan
+BENCH_SCAN_SRC = $(SRC_DIR)/ByteScan.cpp $(SRC_DIR)/utils.cpp
+
+.PHONY: bench-scan
+bench-scan: $(BENCH_SCAN_NAME)
+	@./$(BENCH_SCAN_NAME)
+
+$(BENCH_SCAN_NAME): tests/bench/bench_byte_scan.cpp $(BENCH_SCAN_SRC)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@
+
+# Ban list checks: plain glob, compiled masks and the per-user cache
+BENCH_HOSTMASK_NAME = bench_hostmask
+BENCH_HOSTMASK_SRC = $(SRC_DIR)/Hostmask.cpp $(SRC_DIR)/Channel.cpp \
+                     $(SRC_DIR)/User.cpp $(SRC_DIR)/ByteScan.cpp \
+                     $(SRC_DIR)/utils.cpp
+
+.PHONY: bench-hostmask
+bench-hostmask: $(BENCH_HOSTMASK_NAME)
+	@./$(BENCH_HOSTMASK_NAME)
+
+$(BENCH_HOSTMASK_NAME): tests/bench/bench_hostmask.cpp $(BENCH_HOSTMASK_SRC)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@
+
+# server-time and msgid tags: per recipient and per broadcast rendering
+BENCH_TAGS_NAME = bench_message_tags
+BENCH_TAGS_SRC = $(SRC_DIR)/MessageClock.cpp $(SRC_DIR)/TaggedMessage.cpp
+
+.PHONY: bench-tags
+bench-tags: $(BENCH_TAGS_NAME)
+	@./$(BENCH_TAGS_NAME)
+
+$(BENCH_TAGS_NAME): tests/bench/bench_message_tags.cpp $(BENCH_TAGS_SRC)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@
+
+# CHATHISTORY: whole messages and a linear scan, and the history rings
+BENCH_HISTORY_NAME = bench_history
+BENCH_HISTORY_SRC = $(SRC_DIR)/ChannelHistory.cpp $(SRC_DIR)/HistoryStore.cpp \
+                    $(SRC_DIR)/MessageClock.cpp $(SRC_DIR)/utils.cpp \
+                    $(SRC_DIR)/ByteScan.cpp
+
+.PHONY: bench-history
+bench-history: $(BENCH_HISTORY_NAME)
+	@./$(BENCH_HISTORY_NAME)
+
+$(BENCH_HISTORY_NAME): tests/bench/bench_history.cpp $(BENCH_HISTORY_SRC)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@
+
+# Join burst to a 10k-member channel: dispatch and time to first paint,
+# without and with batch (the server but its main loop, built with -O2)
+BENCH_JOIN_NAME = bench_join
+BENCH_JOIN_SRC = $(filter-out $(SRC_DIR)/main.cpp $(SRC_DIR)/Server.cpp,$(SRC))
+
+.PHONY: bench-join
+bench-join: $(BENCH_JOIN_NAME)
+	@./$(BENCH_JOIN_NAME)
+
+$(BENCH_JOIN_NAME): tests/bench/bench_join.cpp $(BENCH_JOIN_SRC)
+	@echo "Linking $@..."
+	@$(CXX) -std=c++17 -O2 -Wall -Wextra -Werror -I$(INC_DIR) $^ -o $@ \
+		$(LDLIBS)
+
+# Server CPU time per line while clients flood malformed messages
+.PHONY: bench-malformed
+bench-malformed: $(NAME)
+	@python3 tests/bench/bench_malformed_flood.py --binary ./$(NAME)
+
 # ==============================================================================
 # Combined test commands
 # ==============================================================================
@@ -0,0 +1,124 @@
+// Throughput of the byte scanning kernels (ByteScan.hpp) per level.
+//
+// Builds a large pipelined buffer of PRIVMSG lines, as a client flooding
+// the server would send, and times per level:
+//   frame   - splitting it into lines with findCrlf
+//   params  - findForbiddenByte over every line (validateParams)
+//   fold    - foldCase over every line (normalizeNickname and friends)
+// plus the framing loop the server used before (find + erase per line).
+//
+// Usage:
+//     ./bench_byte_scan [buffer MiB] [rounds]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ByteScan.hpp"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+std::string buildBuffer(size_t bytes) {
+  std::string buffer;
+  buffer.reserve(bytes + 512);
+  for (int i = 0; buffer.size() < bytes; ++i) {
+    buffer += ":Nick" + std::to_string(i % 1000) + " PRIVMSG #Channel" +
+              std::to_string(i % 50) + " :" + std::string(40 + i % 200, 'M') +
+              "\r\n";
+  }
+  return buffer;
+}
+
+size_t frame(const std::string& buffer, std::vector<size_t>& starts) {
+  starts.clear();
+  size_t start = 0;
+  size_t pos = findCrlf(buffer.data(), buffer.size());
+  while (pos < buffer.size()) {
+    starts.push_back(start);
+    start = pos + 2;
+    pos = start + findCrlf(buffer.data() + start, buffer.size() - start);
+  }
+  return starts.size();
+}
+
+size_t frameFindErase(std::string buffer) {
+  size_t count = 0;
+  size_t pos = buffer.find("\r\n");
+  while (pos != std::string::npos) {
+    std::string message = buffer.substr(0, pos);
+    buffer.erase(0, pos + 2);
+    count += !message.empty();
+    pos = buffer.find("\r\n");
+  }
+  return count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t mib = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 4;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+  std::string buffer = buildBuffer(mib * 1024 * 1024);
+  std::vector<size_t> starts;
+  size_t lines = frame(buffer, starts);
+  starts.push_back(buffer.size() + 2);
+  double gib = static_cast<double>(buffer.size()) * rounds / (1 << 30);
+  std::printf("%zu MiB, %zu lines, %d rounds\n", mib, lines, rounds);
+  std::printf("%-8s %10s %10s %10s  (GiB/s)\n", "level", "frame", "params",
+              "fold");
+
+  ScanLevel levels[] = {SCAN_LEVEL_SCALAR, SCAN_LEVEL_SSE2, SCAN_LEVEL_AVX2};
+  for (int l = 0; l < 3; ++l) {
+    if (setScanLevel(levels[l]) != levels[l]) {
+      std::printf("%-8s unsupported\n", getScanLevelName(levels[l]));
+      continue;
+    }
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (int r = 0; r < rounds; ++r) sink += frame(buffer, starts);
+    double frameTime = seconds(start);
+    starts.push_back(buffer.size() + 2);
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        size_t length = starts[i + 1] - 2 - starts[i];
+        sink += findForbiddenByte(buffer.data() + starts[i], length);
+      }
+    }
+    double paramsTime = seconds(start);
+
+    std::string copy = buffer;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+      for (size_t i = 0; i + 1 < starts.size(); ++i) {
+        foldCase(&copy[starts[i]], starts[i + 1] - 2 - starts[i]);
+      }
+    }
+    double foldTime = seconds(start);
+
+    std::printf("%-8s %10.2f %10.2f %10.2f  [%zu]\n",
+                getScanLevelName(levels[l]), gib / frameTime,
+                gib / paramsTime, gib / foldTime, sink % 10);
+  }
+
+  // The old loop copies the rest of the buffer for every line: only a
+  // slice of it, or this takes minutes
+  std::string slice = buffer.substr(0, 256 * 1024);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  size_t count = frameFindErase(slice);
+  double oldTime = seconds(start);
+  std::printf("find+erase framing on 256 KiB: %.2f GiB/s (%zu lines)\n",
+              static_cast<double>(slice.size()) / (1 << 30) / oldTime, count);
+  return 0;
+}
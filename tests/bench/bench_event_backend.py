@@ -0,0 +1,165 @@
+"""Compare the epoll and io_uring event loop backends.
+
+Starts ./ircserv once per backend, joins a number of receivers and one
+sender to a channel and sends PRIVMSGs in steps of --burst messages, each
+step waiting until every receiver got the previous one (one dispatch round
+per step; a single huge burst would collapse into a few large sends).
+Reports delivered messages per second, system calls per second and per
+delivered message (from the ircserv_syscalls_total metric) and server CPU
+time per delivered message (from /proc/<pid>/stat).
+
+Usage:
+    python3 tests/bench/bench_event_backend.py [--clients N] [--messages M]
+                                               [--burst B]
+"""
+
+import argparse
+import os
+import selectors
+import socket
+import subprocess
+import sys
+import tempfile
+import time
+
+PASSWORD = "password"
+CHANNEL = "#bench"
+
+
+def read_metric(admin_path, name):
+    """Scrape one unlabeled metric from the admin listener."""
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    sock.connect(admin_path)
+    sock.sendall(b"GET /metrics HTTP/1.0\r\n\r\n")
+    data = b""
+    while True:
+        chunk = sock.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    sock.close()
+    for line in data.decode().splitlines():
+        if line.startswith(name + " "):
+            return float(line.split()[1])
+    raise RuntimeError("metric not found: " + name)
+
+
+def cpu_seconds(pid):
+    """User + system CPU time of a process."""
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    # utime and stime are fields 14 and 15 (1-based, counting pid and comm)
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def connect(port, nick):
+    sock = socket.create_connection(("127.0.0.1", port))
+    sock.sendall(("PASS %s\r\nNICK %s\r\nUSER %s 0 * :%s\r\nJOIN %s\r\n"
+                  % (PASSWORD, nick, nick, nick, CHANNEL)).encode())
+    # Wait for the JOIN echo: the client is a channel member from now on
+    buf = b""
+    while (" JOIN " + CHANNEL).encode() not in buf:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise RuntimeError(nick + ": connection closed during setup")
+        buf += chunk
+    sock.setblocking(False)
+    return sock
+
+
+def wait_for_port(port, timeout=5.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port)).close()
+            return
+        except OSError:
+            time.sleep(0.05)
+    raise RuntimeError("server did not start")
+
+
+def run(binary, backend, port, clients, messages, burst):
+    admin_path = os.path.join(tempfile.mkdtemp(), "admin.sock")
+    env = dict(os.environ,
+               IRCSERV_EVENT_BACKEND=backend,
+               IRCSERV_ADMIN_LISTEN="unix:" + admin_path)
+    server = subprocess.Popen([binary, str(port), PASSWORD], env=env,
+                              stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+    try:
+        wait_for_port(port)
+        receivers = [connect(port, "recv%d" % i) for i in range(clients)]
+        sender = connect(port, "sender")
+
+        sel = selectors.DefaultSelector()
+        for sock in receivers:
+            sel.register(sock, selectors.EVENT_READ)
+        expected = messages * clients
+
+        syscalls_before = read_metric(admin_path, "ircserv_syscalls_total")
+        cpu_before = cpu_seconds(server.pid)
+        start = time.time()
+
+        line = ("PRIVMSG %s :benchmark payload 0123456789\r\n"
+                % CHANNEL).encode()
+        delivered = 0
+        sent_messages = 0
+        while delivered < expected:
+            if delivered == sent_messages * clients:
+                step = min(burst, messages - sent_messages)
+                sender.setblocking(True)
+                sender.sendall(line * step)
+                sender.setblocking(False)
+                sent_messages += step
+            for key, _ in sel.select(timeout=1.0):
+                try:
+                    data = key.fileobj.recv(65536)
+                except BlockingIOError:
+                    continue
+                delivered += data.count(b" PRIVMSG ")
+            if time.time() - start > 300:
+                raise RuntimeError("timed out (%d/%d delivered)"
+                                   % (delivered, expected))
+
+        elapsed = time.time() - start
+        cpu = cpu_seconds(server.pid) - cpu_before
+        syscalls = (read_metric(admin_path, "ircserv_syscalls_total")
+                    - syscalls_before)
+        for sock in receivers + [sender]:
+            sock.close()
+        return {
+            "backend": backend,
+            "msgs_per_sec": delivered / elapsed,
+            "syscalls_per_sec": syscalls / elapsed,
+            "syscalls_per_msg": syscalls / delivered,
+            "cpu_us_per_msg": cpu * 1e6 / delivered,
+        }
+    finally:
+        server.terminate()
+        server.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--binary", default="./ircserv")
+    parser.add_argument("--port", type=int, default=6669)
+    parser.add_argument("--clients", type=int, default=50)
+    parser.add_argument("--messages", type=int, default=2000)
+    parser.add_argument("--burst", type=int, default=1)
+    args = parser.parse_args()
+
+    print("%d receivers, %d messages each, %d per step"
+          % (args.clients, args.messages, args.burst))
+    print("%-9s %12s %14s %13s %12s" % ("backend", "msgs/s", "syscalls/s",
+                                         "syscalls/msg", "CPU us/msg"))
+    for backend in ("epoll", "io_uring"):
+        r = run(args.binary, backend, args.port, args.clients, args.messages,
+                args.burst)
+        print("%-9s %12.0f %14.0f %13.3f %12.2f"
+              % (r["backend"], r["msgs_per_sec"], r["syscalls_per_sec"],
+                 r["syscalls_per_msg"], r["cpu_us_per_msg"]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,115 @@
+// Cost of keeping and querying channel history (CHATHISTORY).
+//
+// Each channel keeps its last 1000 messages; messages go to channels in
+// turn, every one recorded then one CHATHISTORY BEFORE msgid=... looked up
+// per message. Compared:
+//   naive  - a deque of whole messages (a string per field) per channel,
+//            the msgid found by a linear scan
+//   ring   - HistoryStore: interned senders, one arena per channel, msgids
+//            found by binary search
+// Memory is what the store accounts for (ring) and the string capacities
+// plus the deque entries (naive), per message kept.
+//
+// Usage:
+//     ./bench_history [messages] [channels]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "ChannelHistory.hpp"
+#include "HistoryStore.hpp"
+#include "MessageClock.hpp"
+
+namespace {
+
+const size_t kPerChannel = 1000;
+
+double seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+std::string channelOf(long message, long channels) {
+  return "#channel" + std::to_string(message % channels);
+}
+
+std::string sourceOf(long message) {
+  return "nick" + std::to_string(message % 20) + "!user@192.168.1." +
+         std::to_string(message % 20);
+}
+
+const char kText[] = "hello, this is a message of a typical length";
+
+size_t naiveBytes(const HistoryMessage& message) {
+  return sizeof(HistoryMessage) + message.source.capacity() +
+         message.msgid.capacity() + message.text.capacity();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long messages = argc > 1 ? std::atol(argv[1]) : 200000;
+  long channels = argc > 2 ? std::atol(argv[2]) : 20;
+  MessageClock clock;
+  std::vector<std::string> ids;
+  for (long m = 0; m < messages; ++m) ids.push_back(clock.nextMsgId());
+  size_t found = 0;
+
+  std::vector<std::deque<HistoryMessage> > naive(channels);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (long m = 0; m < messages; ++m) {
+    std::deque<HistoryMessage>& history = naive[m % channels];
+    HistoryMessage message;
+    message.time = m;
+    message.source = sourceOf(m);
+    message.msgid = ids[m];
+    message.text = kText;
+    history.push_back(message);
+    if (history.size() > kPerChannel) history.pop_front();
+    const std::string& wanted = ids[m / 2];
+    for (size_t i = 0; i < history.size(); ++i) {
+      if (history[i].msgid == wanted) {
+        found += i;
+        break;
+      }
+    }
+  }
+  double naiveTime = seconds(start);
+  size_t naiveMemory = 0;
+  size_t naiveKept = 0;
+  for (long c = 0; c < channels; ++c) {
+    for (size_t i = 0; i < naive[c].size(); ++i) {
+      naiveMemory += naiveBytes(naive[c][i]);
+    }
+    naiveKept += naive[c].size();
+  }
+
+  HistoryStore store;
+  store.setLimits(static_cast<size_t>(1) << 30, kPerChannel);
+  start = std::chrono::steady_clock::now();
+  for (long m = 0; m < messages; ++m) {
+    std::string channel = channelOf(m, channels);
+    store.record(channel, m, sourceOf(m), ids[m], kText);
+    found += store.find(channel)->find(ids[m / 2]);
+  }
+  double ringTime = seconds(start);
+  size_t ringKept = 0;
+  for (long c = 0; c < channels; ++c) {
+    ringKept += store.find(channelOf(c, channels))->size();
+  }
+
+  std::printf("%ld messages to %ld channels, %zu kept [%zu]\n", messages,
+              channels, ringKept, found);
+  std::printf("%-8s %14s %14s\n", "", "ns/message", "bytes/message");
+  std::printf("%-8s %14.0f %14zu\n", "naive", naiveTime * 1e9 / messages,
+              naiveMemory / naiveKept);
+  std::printf("%-8s %14.0f %14zu\n", "ring", ringTime * 1e9 / messages,
+              store.getBytes() / ringKept);
+  return 0;
+}
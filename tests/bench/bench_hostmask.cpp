@@ -0,0 +1,89 @@
+// Cost of checking a user against a full ban list (Channel::kMaxMasks).
+//
+// Times per check:
+//   glob     - ircMatch() on the mask strings (no compilation)
+//   compiled - Hostmask::matches() on the compiled masks
+//   cached   - Channel::isBanned() with the per-user cache warm
+//
+// Usage:
+//     ./bench_hostmask [checks]
+
+#include <fcntl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Channel.hpp"
+#include "Hostmask.hpp"
+#include "utils.hpp"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Bans of the shapes seen in practice: nick bans, host bans, user@host
+std::string makeBan(int i) {
+  switch (i % 4) {
+    case 0:
+      return "spammer" + std::to_string(i) + "!*@*";
+    case 1:
+      return "*!*@10." + std::to_string(i) + ".*";
+    case 2:
+      return "*!evil" + std::to_string(i) + "@*.example.net";
+    default:
+      return "*bot" + std::to_string(i) + "*!*@*";
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long checks = argc > 1 ? std::atol(argv[1]) : 20000;
+  Channel channel("#bench");
+  std::vector<Hostmask> compiled;
+  for (size_t i = 0; i < Channel::kMaxMasks; ++i) {
+    channel.addMask(MASK_LIST_BAN, makeBan(static_cast<int>(i)), "op", 0);
+    compiled.push_back(Hostmask(makeBan(static_cast<int>(i))));
+  }
+  // Nobody is banned: every check walks the whole list
+  User user(open("/dev/null", O_RDONLY), "192.168.1.20");
+  user.setNickname("innocent");
+  user.setUsername("someone");
+  std::string target = Hostmask::makeTarget(&user);
+
+  size_t hits = 0;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (long c = 0; c < checks; ++c) {
+    for (size_t i = 0; i < compiled.size(); ++i) {
+      hits += ircMatch(compiled[i].getMask(), target);
+    }
+  }
+  double globTime = seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  for (long c = 0; c < checks; ++c) {
+    for (size_t i = 0; i < compiled.size(); ++i) {
+      hits += compiled[i].matches(target);
+    }
+  }
+  double compiledTime = seconds(start);
+
+  start = std::chrono::steady_clock::now();
+  for (long c = 0; c < checks; ++c) hits += channel.isBanned(&user);
+  double cachedTime = seconds(start);
+
+  std::printf("%zu bans, %ld checks [%zu]\n", compiled.size(), checks, hits);
+  std::printf("%-10s %12s\n", "", "ns/check");
+  std::printf("%-10s %12.0f\n", "glob", globTime * 1e9 / checks);
+  std::printf("%-10s %12.0f\n", "compiled", compiledTime * 1e9 / checks);
+  std::printf("%-10s %12.0f\n", "cached", cachedTime * 1e9 / checks);
+  return 0;
+}
@@ -0,0 +1,174 @@
+// Time to first paint of a join to a big channel (JOIN, topic and names).
+//
+// A client joins a channel of [members] members through CommandRouter, as
+// the server handles it; its output is then sent like Server::flushWrites()
+// does, over a socketpair to a reader thread. A client can paint the
+// channel once it has the whole burst: the end of the BATCH with batch, the
+// RPL_ENDOFNAMES without (it cannot tell which lines belong together).
+// Reported per join, without and with the batch capability:
+//   dispatch - handling the JOIN, its relay to every member included
+//   paint    - from the JOIN until the reader has the last line
+//   sends    - send() calls for the joiner's output
+//   lines, bytes - of the burst
+//
+// Usage:
+//     ./bench_join [members] [joins]
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Capability.hpp"
+#include "ChannelManager.hpp"
+#include "CommandRouter.hpp"
+#include "EventLoop.hpp"
+#include "UserManager.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char kPassword[] = "password";
+
+double micros(Clock::time_point start, Clock::time_point end) {
+  std::chrono::duration<double, std::micro> elapsed = end - start;
+  return elapsed.count();
+}
+
+void registerUser(CommandRouter* router, User* user,
+                  const std::string& nickname) {
+  router->processMessage(user, std::string("PASS ") + kPassword);
+  router->processMessage(user, "NICK " + nickname);
+  router->processMessage(user, "USER " + nickname + " 0 * :Bench");
+}
+
+// Output of everyone but the joiner is not sent: drop it
+void dropOutput(UserManager* users, EventLoop* loop) {
+  const std::map<int, User*>& all = users->getUsers();
+  for (std::map<int, User*>::const_iterator it = all.begin();
+       it != all.end(); ++it) {
+    it->second->getWriteBuffer().clear();
+  }
+  std::vector<int> fds;
+  loop->takeWriteRequests(fds);
+}
+
+struct Result {
+  double dispatch;
+  double paint;
+  size_t sends;
+  size_t lines;
+  size_t bytes;
+};
+
+Result join(CommandRouter* router, User* joiner, int clientFd) {
+  std::atomic<size_t> expected(static_cast<size_t>(-1));
+  Clock::time_point painted;
+  std::thread reader([&] {
+    std::vector<char> buffer(65536);
+    size_t received = 0;
+    while (received < expected.load()) {
+      ssize_t n = read(clientFd, buffer.data(), buffer.size());
+      if (n <= 0) break;
+      received += static_cast<size_t>(n);
+    }
+    painted = Clock::now();
+  });
+
+  Result result;
+  Clock::time_point start = Clock::now();
+  router->processMessage(joiner, "JOIN #big");
+  result.dispatch = micros(start, Clock::now());
+  std::string& out = joiner->getWriteBuffer();
+  result.bytes = out.size();
+  result.lines = 0;
+  for (size_t i = 0; i < out.size(); ++i) result.lines += out[i] == '\n';
+  expected.store(out.size());
+  result.sends = 0;
+  size_t sent = 0;
+  while (sent < out.size()) {
+    ssize_t n = send(joiner->getSocketFd(), out.data() + sent,
+                     out.size() - sent, MSG_NOSIGNAL);
+    ++result.sends;
+    if (n <= 0) break;
+    sent += static_cast<size_t>(n);
+  }
+  out.clear();
+  reader.join();
+  result.paint = micros(start, painted);
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long members = argc > 1 ? std::atol(argv[1]) : 10000;
+  long joins = argc > 2 ? std::atol(argv[2]) : 20;
+  std::cout.setstate(std::ios::failbit);  // No server log
+
+  EventLoop loop;
+  UserManager users;
+  ChannelManager channels;
+  CommandRouter router(&users, &channels, &loop, kPassword);
+
+  // Members are put into the channel directly: joining them one by one
+  // would relay every JOIN to all the others
+  Channel* channel = channels.createChannel("#big");
+  channel->setTopic("a channel of " + std::to_string(members) + " members");
+  int devNull = open("/dev/null", O_RDWR);
+  for (long m = 0; m < members; ++m) {
+    User* member = new User(dup(devNull), "10.0.0.1");
+    users.addUser(member);
+    registerUser(&router, member, "m" + std::to_string(m));
+    channel->addMember(member->getSocketFd());
+    if (m == 0) channel->addOperator(member->getSocketFd());
+    member->joinChannel(channel);
+  }
+  close(devNull);
+
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+    std::perror("socketpair");
+    return 1;
+  }
+  User* joiner = new User(pair[0], "10.0.0.2");
+  users.addUser(joiner);
+  registerUser(&router, joiner, "joiner");
+  dropOutput(&users, &loop);
+  join(&router, joiner, pair[1]);  // Warm up: buffers reach their size
+  router.processMessage(joiner, "PART #big");
+
+  std::printf("%ld members, %ld joins each\n", members, joins);
+  std::printf("%-6s %12s %12s %8s %8s %10s\n", "", "dispatch us", "paint us",
+              "sends", "lines", "bytes");
+  const char* names[] = {"plain", "batch"};
+  for (int mode = 0; mode < 2; ++mode) {
+    joiner->setCaps(mode ? CAP_BATCH : 0);
+    Result total = {0, 0, 0, 0, 0};
+    for (long j = 0; j < joins; ++j) {
+      dropOutput(&users, &loop);
+      Result result = join(&router, joiner, pair[1]);
+      total.dispatch += result.dispatch;
+      total.paint += result.paint;
+      total.sends += result.sends;
+      total.lines = result.lines;
+      total.bytes = result.bytes;
+      router.processMessage(joiner, "PART #big");
+    }
+    std::printf("%-6s %12.0f %12.0f %8.1f %8zu %10zu\n", names[mode],
+                total.dispatch / joins, total.paint / joins,
+                static_cast<double>(total.sends) / joins, total.lines,
+                total.bytes);
+  }
+  close(pair[1]);
+  return 0;
+}
@@ -0,0 +1,103 @@
+// Throughput of Mailbox<std::string> (MpscQueue + eventfd wakeup).
+//
+// N producer threads post fixed-size lines as fast as the mailbox accepts
+// them; the consumer sleeps in EventLoop::wait() and drains on every
+// wakeup, like a reactor receiving output for its connections. Reports
+// messages per second and how many wakeups (eventfd reads) the consumer
+// needed: few wakeups per message means bursts are coalesced.
+//
+// Usage:
+//     ./bench_mailbox [messages per producer] [capacity]
+
+#include <sys/epoll.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "MpscQueue.hpp"
+
+namespace {
+
+struct Result {
+  double seconds;
+  size_t wakeups;
+};
+
+Result run(EventBackend backend, int producers, int perProducer,
+           size_t capacity) {
+  EventLoop loop;
+  loop.create(backend);
+  loop.enableWakeup();
+  Mailbox<std::string> mailbox(&loop, capacity);
+  const std::string line(64, 'x');
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.emplace_back([&mailbox, &line, perProducer]() {
+      for (int i = 0; i < perProducer; ++i) {
+        while (!mailbox.post(line)) std::this_thread::yield();
+      }
+    });
+  }
+
+  size_t total = static_cast<size_t>(producers) * perProducer;
+  size_t received = 0;
+  size_t wakeups = 0;
+  std::vector<std::string> messages;
+  struct epoll_event events[8];
+  while (received < total) {
+    int n = loop.wait(events, 8, 1000);
+    if (n < 0 && errno != EINTR) {
+      std::perror("wait");
+      std::exit(1);
+    }
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.fd != loop.getWakeupFd()) continue;
+      loop.consumeWakeup();
+      ++wakeups;
+      messages.clear();
+      received += mailbox.drain(messages);
+    }
+  }
+  for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  Result result = {elapsed.count(), wakeups};
+  return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int perProducer = argc > 1 ? std::atoi(argv[1]) : 200000;
+  size_t capacity = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 4096;
+  const char* names[] = {"epoll", "io_uring"};
+  EventBackend backends[] = {EVENT_BACKEND_EPOLL, EVENT_BACKEND_IO_URING};
+
+  std::printf("%-9s %9s %12s %10s %12s\n", "backend", "producers",
+              "msgs/s", "wakeups", "msgs/wakeup");
+  for (int b = 0; b < 2; ++b) {
+    for (int producers = 1; producers <= 4; producers *= 2) {
+      Result result;
+      try {
+        result = run(backends[b], producers, perProducer, capacity);
+      } catch (const std::exception& e) {
+        std::printf("%-9s unavailable: %s\n", names[b], e.what());
+        break;
+      }
+      double total = static_cast<double>(producers) * perProducer;
+      std::printf("%-9s %9d %12.0f %10zu %12.1f\n", names[b], producers,
+                  total / result.seconds, result.wakeups,
+                  total / (result.wakeups ? result.wakeups : 1));
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+"""Server CPU cost of clients flooding malformed lines.
+
+Starts ./ircserv with IRCSERV_MALFORMED_LIMIT=0 (flooders are never
+disconnected), connects --clients raw sockets and makes each send
+--lines malformed lines in chunks, then a PING to know when the server
+has consumed them all. Reports lines per second and server CPU time per
+malformed line (from /proc/<pid>/stat). Run it with --binary against an
+older build to compare.
+
+Usage:
+    python3 tests/bench/bench_malformed_flood.py [--binary ./ircserv]
+                                                 [--clients N] [--lines M]
+"""
+
+import argparse
+import os
+import socket
+import subprocess
+import sys
+import time
+
+PASSWORD = "password"
+GARBAGE = [b"NI-CK bad", b" leading space", b":prefixonly",
+           b"CMD 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16"]
+
+
+def cpu_seconds(pid):
+    """User + system CPU time of a process."""
+    with open("/proc/%d/stat" % pid) as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def wait_for_port(port, timeout=5.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            socket.create_connection(("127.0.0.1", port)).close()
+            return
+        except OSError:
+            time.sleep(0.05)
+    raise RuntimeError("server did not start")
+
+
+def drain(sock):
+    """Read what is there without blocking; replies must not pile up."""
+    data = b""
+    while True:
+        try:
+            chunk = sock.recv(65536)
+        except BlockingIOError:
+            return data
+        if not chunk:
+            raise RuntimeError("server closed the connection")
+        data += chunk
+
+
+def run(binary, port, clients, lines, chunk):
+    env = dict(os.environ, IRCSERV_MALFORMED_LIMIT="0")
+    server = subprocess.Popen([binary, str(port), PASSWORD], env=env,
+                              stdout=subprocess.DEVNULL,
+                              stderr=subprocess.DEVNULL)
+    try:
+        wait_for_port(port)
+        socks = []
+        for _ in range(clients):
+            sock = socket.create_connection(("127.0.0.1", port))
+            sock.setblocking(False)
+            socks.append(sock)
+
+        payload = b"".join(GARBAGE[i % len(GARBAGE)] + b"\r\n"
+                           for i in range(chunk))
+        cpu_before = cpu_seconds(server.pid)
+        start = time.time()
+        sent = 0
+        while sent < lines:
+            for sock in socks:
+                view = memoryview(payload)
+                while view:
+                    try:
+                        view = view[sock.send(view):]
+                    except BlockingIOError:
+                        drain(sock)
+                drain(sock)
+            sent += chunk
+        for sock in socks:
+            sock.setblocking(True)
+            sock.sendall(b"PING :done\r\n")
+        for sock in socks:
+            data = b""
+            while b"PONG" not in data and b"done" not in data:
+                data = data[-64:] + sock.recv(65536)
+        elapsed = time.time() - start
+        cpu = cpu_seconds(server.pid) - cpu_before
+        for sock in socks:
+            sock.close()
+        total = sent * clients
+        return total / elapsed, cpu * 1e6 / total
+    finally:
+        server.terminate()
+        server.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--binary", default="./ircserv")
+    parser.add_argument("--port", type=int, default=6669)
+    parser.add_argument("--clients", type=int, default=10)
+    parser.add_argument("--lines", type=int, default=20000)
+    parser.add_argument("--chunk", type=int, default=200)
+    args = parser.parse_args()
+
+    rate, cpu_us = run(os.path.abspath(args.binary), args.port, args.clients,
+                       args.lines, args.chunk)
+    print("%d clients x %d malformed lines" % (args.clients, args.lines))
+    print("%12s %16s" % ("lines/s", "CPU us/line"))
+    print("%12.0f %16.2f" % (rate, cpu_us))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,92 @@
+// Cost of the server-time and msgid tags of one channel message.
+//
+// Times per message fanned out to a channel (recipients = members, half of
+// them with server-time and message-tags):
+//   naive   - time() and strftime() (as createLog() does) and the tags
+//             rendered for every recipient
+//   cached  - MessageClock read once per message batch, TaggedMessage
+//             rendering each variant once per message
+//
+// Usage:
+//     ./bench_message_tags [messages] [recipients]
+
+#include <sys/time.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+#include "Capability.hpp"
+#include "MessageClock.hpp"
+#include "TaggedMessage.hpp"
+
+namespace {
+
+double seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+const char kLine[] =
+    ":nick!user@192.168.1.20 PRIVMSG #bench :hello, this is a message\r\n";
+
+// Recipients alternate between no capabilities and both tag ones
+unsigned capsOf(long recipient) {
+  return recipient % 2 ? CAP_SERVER_TIME | CAP_MESSAGE_TAGS : 0;
+}
+
+std::string naiveTagged(unsigned long id) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  char rendered[32];
+  struct tm utc;
+  gmtime_r(&now.tv_sec, &utc);
+  size_t length =
+      strftime(rendered, sizeof(rendered), "%Y-%m-%dT%H:%M:%S", &utc);
+  std::snprintf(rendered + length, sizeof(rendered) - length, ".%03dZ",
+                static_cast<int>(now.tv_usec / 1000));
+  return "@time=" + std::string(rendered) + ";msgid=" + std::to_string(id) +
+         " " + kLine;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  long messages = argc > 1 ? std::atol(argv[1]) : 20000;
+  long recipients = argc > 2 ? std::atol(argv[2]) : 100;
+  size_t bytes = 0;
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  unsigned long nextId = 0;
+  for (long m = 0; m < messages; ++m) {
+    ++nextId;
+    for (long r = 0; r < recipients; ++r) {
+      bytes += capsOf(r) ? naiveTagged(nextId).size() : sizeof(kLine) - 1;
+    }
+  }
+  double naiveTime = seconds(start);
+
+  MessageClock clock;
+  std::string line(kLine);
+  start = std::chrono::steady_clock::now();
+  for (long m = 0; m < messages; ++m) {
+    // The server updates once per loop iteration, often for many messages
+    if (m % 16 == 0) clock.update();
+    TaggedMessage message(line, &clock, "", false);
+    for (long r = 0; r < recipients; ++r) {
+      bytes += message.render(capsOf(r)).size();
+    }
+  }
+  double cachedTime = seconds(start);
+
+  std::printf("%ld messages x %ld recipients [%zu]\n", messages, recipients,
+              bytes);
+  std::printf("%-8s %14s\n", "", "ns/message");
+  std::printf("%-8s %14.0f\n", "naive", naiveTime * 1e9 / messages);
+  std::printf("%-8s %14.0f\n", "cached", cachedTime * 1e9 / messages);
+  return 0;
+}
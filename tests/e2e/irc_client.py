@@ -12,12 +12,13 @@ class IRCMessage:
         """
         Parse an IRC protocol message.
 
-        Format: [:prefix] COMMAND [param1 param2 ...] [:trailing]
+        Format: [@tags] [:prefix] COMMAND [param1 param2 ...] [:trailing]
 
         Args:
             raw_line: Raw IRC message line (without CRLF)
         """
         self.raw = raw_line
+        self.tags = {}
         self.prefix = None
         self.command = None
         self.params = []
@@ -25,6 +26,13 @@ class IRCMessage:
         parts = raw_line.split(' ')
         idx = 0
 
+        # Parse tags (optional), values left escaped
+        if parts[idx].startswith('@'):
+            for tag in parts[idx][1:].split(';'):
+                key, _, value = tag.partition('=')
+                self.tags[key] = value
+            idx += 1
+
         # Parse prefix (optional)
         if parts[idx].startswith(':'):
             self.prefix = parts[idx][1:]  # Remove leading ':'
@@ -46,12 +54,13 @@ class IRCMessage:
                 idx += 1
 
     def __repr__(self):
-        return f"IRCMessage(command={self.command}, prefix={self.prefix}, params={self.params})"
+        return f"IRCMessage(tags={self.tags}, command={self.command}, prefix={self.prefix}, params={self.params})"
 
     def to_dict(self) -> Dict:
         """Convert to dictionary for easy testing."""
         return {
             'raw': self.raw,
+            'tags': self.tags,
             'prefix': self.prefix,
             'command': self.command,
             'params': self.params
@@ -0,0 +1,214 @@
+"""Test IRCv3 capability negotiation (CAP) and message tags."""
+
+import re
+
+from irc_client import IRCClient, IRCMessage
+
+
+def read_until(client, command):
+    """Read messages up to and including the first one with command."""
+    messages = []
+    while not messages or messages[-1].command != command:
+        messages.append(IRCMessage(client.recv_line()))
+    return messages
+
+
+def connect(server_config, nickname, caps=""):
+    """Register nickname, first enabling caps (space-separated) if any."""
+    client = IRCClient(host=server_config["host"],
+                       port=server_config["port"], timeout=5.0)
+    client.connect()
+    if caps:
+        client.send_raw("CAP LS 302")
+        client.send_raw("CAP REQ :" + caps)
+    client.pass_cmd(server_config["password"])
+    client.nick(nickname)
+    client.user(nickname, "Cap Tester")
+    if caps:
+        client.send_raw("CAP END")
+    read_until(client, "001")
+    client.recv_lines(timeout=0.3)
+    return client
+
+
+def test_cap_negotiation_holds_registration(irc_client, server_config):
+    """
+    CAP LS suspends registration until CAP END; REQ is all or nothing.
+
+    Manual reproduction with nc -C:
+        CAP LS 302      (:ft_irc CAP * LS :message-tags echo-message)
+        PASS password / NICK capper / USER capper 0 * :Cap  (no 001 yet)
+        CAP REQ :echo-message bogus   (:ft_irc CAP capper NAK :...)
+        CAP REQ :echo-message         (:ft_irc CAP capper ACK :echo-message)
+        CAP LIST                      (:ft_irc CAP capper LIST :echo-message)
+        CAP END                       (:ft_irc 001 capper ...)
+    """
+    irc_client.send_raw("CAP LS 302")
+    ls = read_until(irc_client, "CAP")[-1]
+    assert ls.params[:2] == ["*", "LS"]
+    assert set(ls.params[2].split()) >= {"message-tags", "echo-message",
+                                         "server-time"}
+
+    irc_client.pass_cmd(server_config["password"])
+    irc_client.nick("capper")
+    irc_client.user("capper", "Cap Tester")
+    assert irc_client.wait_for_reply("001", timeout=0.5) is None
+
+    irc_client.send_raw("CAP REQ :echo-message bogus")
+    nak = read_until(irc_client, "CAP")[-1]
+    assert nak.params == ["capper", "NAK", "echo-message bogus"]
+    irc_client.send_raw("CAP REQ :echo-message")
+    ack = read_until(irc_client, "CAP")[-1]
+    assert ack.params == ["capper", "ACK", "echo-message"]
+    irc_client.send_raw("CAP LIST")
+    assert read_until(irc_client, "CAP")[-1].params == [
+        "capper", "LIST", "echo-message"]
+    irc_client.send_raw("CAP FOO")
+    assert read_until(irc_client, "410")[-1].params[1] == "FOO"
+
+    irc_client.send_raw("CAP END")
+    assert irc_client.wait_for_reply("001", timeout=2.0) is not None
+
+
+def test_client_tags_reach_message_tags_clients(server_config):
+    """
+    Client-only tags go to recipients with message-tags; echo-message
+    returns the sender's own messages.
+
+    Manual reproduction with two nc -C sessions (tagger with
+    CAP REQ :message-tags echo-message, plain without CAP):
+        tagger: @+draft/react=x PRIVMSG #tags :hi
+        tagger: (@+draft/react=x :tagger!... PRIVMSG #tags :hi, its echo)
+        plain:  (:tagger!... PRIVMSG #tags :hi)
+        tagger: @+typing=active TAGMSG plain   (plain gets nothing)
+    """
+    tagger = connect(server_config, "tagger", "message-tags echo-message")
+    reader = connect(server_config, "reader", "message-tags")
+    plain = connect(server_config, "plain")
+    try:
+        for client in (tagger, reader, plain):
+            client.join("#tags")
+            read_until(client, "366")
+        tagger.recv_lines(timeout=0.3)
+        reader.recv_lines(timeout=0.3)
+
+        tagger.send_raw("@+draft/react=x;label=1 PRIVMSG #tags :hi")
+        echo = read_until(tagger, "PRIVMSG")[-1]
+        assert sorted(echo.tags) == ["+draft/react", "msgid"]
+        assert echo.tags["+draft/react"] == "x"
+        assert echo.params == ["#tags", "hi"]
+        tagged = read_until(reader, "PRIVMSG")[-1]
+        assert tagged.tags == echo.tags
+        untagged = read_until(plain, "PRIVMSG")[-1]
+        assert untagged.tags == {} and untagged.params == ["#tags", "hi"]
+
+        tagger.send_raw("@+typing=active TAGMSG #tags")
+        typing = read_until(reader, "TAGMSG")[-1]
+        assert typing.tags["+typing"] == "active"
+        assert typing.prefix.startswith("tagger!")
+        assert read_until(tagger, "TAGMSG")[-1].params == ["#tags"]
+        plain.send_raw("PING :after")
+        assert read_until(plain, "PONG")[-1].command == "PONG"
+    finally:
+        for client in (tagger, reader, plain):
+            client.disconnect()
+
+
+def test_server_time_and_msgid(server_config):
+    """
+    Relayed messages carry the time (server-time) and a msgid
+    (message-tags), the same for every recipient of one message.
+
+    Manual reproduction with nc -C:
+        timer: CAP REQ :server-time, JOIN #time
+        ider:  CAP REQ :server-time message-tags, JOIN #time
+        (timer: @time=2026-10-18T12:34:56.789Z :ider!... JOIN #time)
+        timer: PRIVMSG #time :tick
+        (ider: @time=...;msgid=... :timer!... PRIVMSG #time :tick)
+    """
+    timer = connect(server_config, "timer", "server-time")
+    ider = connect(server_config, "ider", "server-time message-tags")
+    watcher = connect(server_config, "watcher", "message-tags")
+    try:
+        timer.join("#time")
+        read_until(timer, "366")
+        ider.join("#time")
+        join = read_until(timer, "JOIN")[-1]
+        assert list(join.tags) == ["time"]
+        assert re.fullmatch(r"\d{4}-\d\d-\d\dT\d\d:\d\d:\d\d\.\d{3}Z",
+                            join.tags["time"])
+        read_until(ider, "366")
+        watcher.join("#time")
+        read_until(watcher, "366")
+        ider.recv_lines(timeout=0.3)
+
+        timer.send_raw("PRIVMSG #time :tick")
+        with_time = read_until(ider, "PRIVMSG")[-1]
+        assert sorted(with_time.tags) == ["msgid", "time"]
+        without_time = read_until(watcher, "PRIVMSG")[-1]
+        assert without_time.tags == {"msgid": with_time.tags["msgid"]}
+
+        timer.send_raw("PRIVMSG #time :tock")
+        assert read_until(ider, "PRIVMSG")[-1].tags["msgid"] != \
+            with_time.tags["msgid"]
+    finally:
+        for client in (timer, ider, watcher):
+            client.disconnect()
+
+
+def test_long_tags_are_accepted(authenticated_client):
+    """
+    Tags may take 8191 bytes on top of the 512 of the message.
+
+    Manual reproduction:
+        $ python3 -c 'print("@+x=" + "a" * 8000 + " PING :long\\r")' | nc ...
+        (:ft_irc PONG ft_irc :long)
+    """
+    authenticated_client.recv_lines(timeout=0.3)
+    authenticated_client.send_raw("@+x=" + "a" * 8000 + " PING :long")
+    pong = read_until(authenticated_client, "PONG")[-1]
+    assert pong.params[-1] == "long"
+
+
+def test_join_burst_comes_in_a_batch(server_config):
+    """
+    With batch, the JOIN, topic and names of a join are one BATCH; other
+    members and clients without batch get plain lines.
+
+    Manual reproduction with nc -C:
+        founder: JOIN #burst, TOPIC #burst :hello
+        batcher (CAP REQ :batch): JOIN #burst
+        (:ft_irc BATCH +1 ft_irc/join #burst
+         @batch=1 :batcher!... JOIN #burst
+         @batch=1 :ft_irc 332 ..., @batch=1 :ft_irc 353 ..., ... 366 ...
+         :ft_irc BATCH -1)
+    """
+    founder = connect(server_config, "founder")
+    batcher = connect(server_config, "batcher", "batch")
+    try:
+        founder.join("#burst")
+        read_until(founder, "366")
+        founder.topic("#burst", "hello")
+        read_until(founder, "TOPIC")
+
+        batcher.join("#burst")
+        burst = read_until(batcher, "366")
+        burst.append(IRCMessage(batcher.recv_line()))
+        assert [msg.command for msg in burst] == ["BATCH", "JOIN", "332",
+                                                  "353", "366", "BATCH"]
+        reference = burst[0].params[0][1:]
+        assert burst[0].params == ["+" + reference, "ft_irc/join", "#burst"]
+        assert all(msg.tags == {"batch": reference} for msg in burst[1:-1])
+        assert burst[-1].params == ["-" + reference]
+        assert burst[3].params[-1].split() == ["@founder", "batcher"]
+
+        join = read_until(founder, "JOIN")[-1]
+        assert join.tags == {} and join.prefix.startswith("batcher!")
+        founder.part("#burst")
+        read_until(founder, "PART")
+        founder.join("#burst")
+        assert [msg.command for msg in read_until(founder, "366")] == [
+            "JOIN", "332", "353", "366"]
+    finally:
+        founder.disconnect()
+        batcher.disconnect()
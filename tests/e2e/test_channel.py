@@ -1,7 +1,7 @@
 """Test channel operations (JOIN, PART, TOPIC, MODE)."""
 
 import time
-from irc_client import IRCMessage
+from irc_client import IRCClient, IRCMessage
 
 
 def test_join_channel(authenticated_client):
@@ -451,3 +451,247 @@ def test_mode_user_limit(two_clients):
     assert error_msg.command == "471"
     assert len(error_msg.params) >= 2
     assert error_msg.params[0] == "user2"
+
+
+def test_quit_sent_once_to_shared_members(two_clients):
+    """
+    A member sharing several channels with a quitting user gets one QUIT.
+
+    Manual reproduction with irssi:
+        user1 and user2 both join #shared-a and #shared-b
+        user2: /quit bye
+        (user1 receives a single :user2!... QUIT :bye)
+    """
+    client1, client2 = two_clients
+    for channel in ("#shared-a", "#shared-b"):
+        client1.join(channel)
+        client2.join(channel)
+    time.sleep(0.3)
+    client1.recv_lines(timeout=0.5)
+
+    client2.quit_cmd("bye")
+    lines = client1.recv_lines(timeout=1.0)
+    quits = [line for line in lines if IRCMessage(line).command == "QUIT"]
+    assert len(quits) == 1, f"Expected one QUIT, got {quits}"
+
+
+def test_nick_change_seen_by_channel_members(two_clients):
+    """
+    A nickname change reaches the user and each member sharing a channel
+    with it once.
+
+    Manual reproduction with irssi:
+        user1 and user2 both join #nick-a and #nick-b
+        user2: /nick renamed
+        (user1 receives a single :user2!... NICK renamed)
+    """
+    client1, client2 = two_clients
+    for channel in ("#nick-a", "#nick-b"):
+        client1.join(channel)
+        client2.join(channel)
+    time.sleep(0.3)
+    client1.recv_lines(timeout=0.5)
+    client2.recv_lines(timeout=0.5)
+
+    client2.nick("renamed")
+    for client in (client1, client2):
+        lines = client.recv_lines(timeout=1.0)
+        nicks = [IRCMessage(line) for line in lines
+                 if IRCMessage(line).command == "NICK"]
+        assert len(nicks) == 1, f"Expected one NICK, got {lines}"
+        assert nicks[0].params == ["renamed"]
+        assert nicks[0].prefix.startswith("user2!")
+
+
+def test_join_sends_names(two_clients):
+    """
+    JOIN is followed by the member list (353) and its end (366).
+
+    Manual reproduction with irssi:
+        user1: /join #names
+        user2: /join #names
+        (user2 receives :ft_irc 353 user2 = #names :@user1 user2
+         and :ft_irc 366 user2 #names :End of /NAMES list)
+    """
+    client1, client2 = two_clients
+    client1.join("#names")
+    time.sleep(0.2)
+    client2.join("#names")
+    lines = client2.recv_lines(timeout=1.0)
+    messages = [IRCMessage(line) for line in lines]
+    replies = [msg for msg in messages if msg.command == "353"]
+    assert len(replies) == 1, f"Expected one 353, got {lines}"
+    assert replies[0].params[:3] == ["user2", "=", "#names"]
+    assert sorted(replies[0].params[3].split()) == ["@user1", "user2"]
+    assert any(msg.command == "366" and msg.params[1] == "#names"
+               for msg in messages), f"Expected 366, got {lines}"
+
+    client1.recv_lines(timeout=0.5)
+    client1.send_raw("NAMES #names,#nowhere")
+    lines = client1.recv_lines(timeout=1.0)
+    ends = [IRCMessage(line).params[1] for line in lines
+            if IRCMessage(line).command == "366"]
+    assert ends == ["#names", "#nowhere"]
+
+
+def test_names_packs_large_channel(server_config):
+    """
+    NAMES of a large channel uses as few lines as the 512-byte limit allows.
+
+    Manual reproduction: join #packed with 60 clients, then /names #packed
+    from any of them; each 353 line carries as many nicknames as fit.
+    """
+    clients = []
+    nicks = ["packer%03d" % i for i in range(60)]
+    try:
+        for nick in nicks:
+            client = IRCClient(host=server_config["host"],
+                               port=server_config["port"], timeout=5.0)
+            client.connect()
+            clients.append(client)
+            client.pass_cmd(server_config["password"])
+            client.nick(nick)
+            client.user(nick, "Packer")
+            assert client.wait_for_reply("001", timeout=2.0)
+            client.join("#packed")
+        time.sleep(0.5)
+        observer = clients[0]
+        observer.recv_lines(timeout=0.5)
+
+        observer.send_raw("NAMES #packed")
+        lines = []
+        while not lines or IRCMessage(lines[-1]).command != "366":
+            lines.append(observer.recv_line())
+        replies = [line for line in lines if IRCMessage(line).command == "353"]
+        names = []
+        for line in replies:
+            assert len(line) + 2 <= 512
+            names += IRCMessage(line).params[3].split()
+        assert sorted(name.lstrip("@") for name in names) == nicks
+        # One more name would not have fit on any line but the last
+        for line in replies[:-1]:
+            assert len(line) + 2 + len(" packer000") > 512
+        assert len(replies) == 2
+    finally:
+        for client in clients:
+            client.disconnect()
+
+
+def read_list(client):
+    """Send nothing; read 322 replies up to 323 as {channel: (users, topic)}."""
+    channels = {}
+    while True:
+        msg = IRCMessage(client.recv_line())
+        if msg.command == "323":
+            return channels
+        if msg.command == "322":
+            channels[msg.params[1]] = (int(msg.params[2]), msg.params[3])
+
+
+def test_list_filters(two_clients):
+    """
+    LIST takes channel masks and member count filters.
+
+    Manual reproduction with irssi:
+        user1: /join #list-a, /join #list-b, /topic #list-a hello
+        user2: /join #list-a
+        user1: /quote LIST #list-*,<2
+        (only #list-b is listed, then :ft_irc 323 user1 :End of /LIST)
+    """
+    client1, client2 = two_clients
+    client1.join("#list-a")
+    client1.join("#list-b")
+    client1.topic("#list-a", "hello world")
+    client2.join("#list-a")
+    time.sleep(0.3)
+    client1.recv_lines(timeout=0.5)
+
+    client1.send_raw("LIST")
+    channels = read_list(client1)
+    assert channels["#list-a"] == (2, "hello world")
+    assert channels["#list-b"] == (1, "")
+
+    client1.send_raw("LIST #LIST-A")
+    assert read_list(client1) == {"#list-a": (2, "hello world")}
+
+    client1.send_raw("LIST #list-*,<2")
+    assert read_list(client1) == {"#list-b": (1, "")}
+
+    client1.send_raw("LIST #list-*,>1")
+    assert list(read_list(client1)) == ["#list-a"]
+
+
+def test_list_streams_large_result(two_clients):
+    """
+    A LIST larger than the server's output threshold arrives complete.
+
+    The server queues it in pieces as the client reads, so the result is
+    never held in one buffer; the client sees one uninterrupted list.
+    """
+    client1, client2 = two_clients
+    names = ["#many-%03d" % i for i in range(400)]
+    for name in names:
+        client1.join(name)
+    time.sleep(1.0)
+    client1.recv_lines(timeout=0.5)
+
+    client2.send_raw("LIST #many-*")
+    time.sleep(0.5)  # Let the socket buffers fill before reading
+    assert sorted(read_list(client2)) == names
+
+
+def test_ban_exception_and_invite_exception(two_clients):
+    """
+    +b keeps matching users out and silent, +e overrides it and +I lets
+    users into an invite-only channel.
+
+    Manual reproduction with irssi:
+        user1: /join #bans, /mode #bans +b user2
+        user2: /join #bans          (474 Cannot join channel (+b))
+        user1: /mode #bans b        (367 #bans user2!*@* user1 <time>, 368)
+        user1: /mode #bans +e *!user2@*
+        user2: /join #bans          (joins)
+        user1: /mode #bans -e *!user2@*
+        user2: /msg #bans hi        (404 Cannot send to channel)
+    """
+    client1, client2 = two_clients
+    client1.join("#bans")
+    time.sleep(0.2)
+    client1.mode("#bans", "+b user2")
+    lines = client1.recv_lines(timeout=0.5)
+    assert any(IRCMessage(line).command == "MODE" and
+               IRCMessage(line).params[1:] == ["+b", "user2!*@*"]
+               for line in lines), f"Expected MODE +b, got {lines}"
+
+    client2.join("#bans")
+    assert client2.wait_for_reply("474", timeout=2.0) is not None
+
+    client1.send_raw("MODE #bans b")
+    bans = client1.wait_for_reply("367", timeout=2.0)
+    assert bans is not None and bans.params[2:4] == ["user2!*@*", "user1"]
+    assert client1.wait_for_reply("368", timeout=2.0) is not None
+
+    client1.mode("#bans", "+e *!user2@*")
+    time.sleep(0.2)
+    client2.join("#bans")
+    lines = client2.recv_lines(timeout=0.5)
+    assert any(IRCMessage(line).command == "JOIN" for line in lines)
+
+    client1.mode("#bans", "-e *!user2@*")
+    time.sleep(0.2)
+    client2.recv_lines(timeout=0.3)
+    client2.privmsg("#bans", "hi")
+    assert client2.wait_for_reply("404", timeout=2.0) is not None
+
+    # Invite-only: an invite exception admits without an invitation
+    client1.join("#invex")
+    time.sleep(0.2)
+    client1.mode("#invex", "+i")
+    client2.join("#invex")
+    assert client2.wait_for_reply("473", timeout=2.0) is not None
+    client1.mode("#invex", "+I user2")
+    time.sleep(0.2)
+    client2.join("#invex")
+    lines = client2.recv_lines(timeout=0.5)
+    assert any(IRCMessage(line).command == "JOIN" and "#invex" in line
+               for line in lines), f"Expected JOIN, got {lines}"
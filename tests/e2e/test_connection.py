@@ -1,6 +1,6 @@
 """Test basic connection and authentication scenarios."""
 
-from irc_client import IRCClient
+from irc_client import IRCClient, IRCMessage
 
 
 def test_connect_to_server(server_config):
@@ -187,3 +187,39 @@ def test_ping_pong(authenticated_client):
     lines = authenticated_client.recv_lines(timeout=1.0)
     pong_found = any("PONG" in line and "test123" in line for line in lines)
     assert pong_found, "Should receive PONG response"
+
+
+def test_isupport_advertises_limits(irc_client, server_config):
+    """
+    Registration ends with RPL_ISUPPORT (005) lines listing the server's
+    limits, and RPL_MYINFO (004) lists the channel modes handled.
+
+    Manual reproduction with nc -C:
+        PASS password / NICK limits / USER limits 0 * :x
+        (:ft_irc 004 limits ft_irc 1.0 io beIklito)
+        (:ft_irc 005 limits AWAYLEN=200 CASEMAPPING=rfc1459 ... :are ...)
+    """
+    irc_client.pass_cmd(server_config["password"])
+    irc_client.nick("limits")
+    irc_client.user("limits", "Limits Test")
+    myinfo = irc_client.wait_for_reply("004", timeout=2.0)
+    assert myinfo.params[4] == "beIklito"
+
+    tokens = {}
+    for line in irc_client.recv_lines(timeout=0.5):
+        msg = IRCMessage(line)
+        if msg.command != "005":
+            continue
+        assert msg.params[0] == "limits"
+        assert msg.params[-1] == "are supported by this server"
+        for token in msg.params[1:-1]:
+            name, _, value = token.partition("=")
+            tokens[name] = value
+    assert tokens["NICKLEN"] == "9"
+    assert tokens["CHANNELLEN"] == "200"
+    assert tokens["CHANMODES"] == "beI,k,l,it"
+    assert tokens["CASEMAPPING"] == "rfc1459"
+    assert tokens["MAXTARGETS"] == "4"
+    assert tokens["MONITOR"] == "100"
+    assert tokens["CHATHISTORY"] == "100"
+    assert "PRIVMSG:4" in tokens["TARGMAX"].split(",")
@@ -0,0 +1,241 @@
+"""Test channel history playback (CHATHISTORY).
+
+The persistent log test starts its own server: it is stopped and started
+again on the same history directory.
+"""
+
+import os
+import signal
+import subprocess
+import time
+
+from irc_client import IRCClient, IRCMessage
+
+
+SERVER_BINARY = os.path.join(os.path.dirname(__file__), "..", "..", "ircserv")
+HISTORY_PORT = 6673
+
+
+def read_until(client, command):
+    """Read messages up to and including the first one with command."""
+    messages = []
+    while not messages or messages[-1].command != command:
+        messages.append(IRCMessage(client.recv_line()))
+    return messages
+
+
+def connect(server_config, nickname, caps=""):
+    """Register nickname, first enabling caps (space-separated) if any."""
+    client = IRCClient(host=server_config["host"],
+                       port=server_config["port"], timeout=5.0)
+    client.connect()
+    if caps:
+        client.send_raw("CAP REQ :" + caps)
+    client.pass_cmd(server_config["password"])
+    client.nick(nickname)
+    client.user(nickname, "History Tester")
+    if caps:
+        client.send_raw("CAP END")
+    read_until(client, "001")
+    client.recv_lines(timeout=0.3)
+    return client
+
+
+def query(client, request):
+    """CHATHISTORY request; returns its replies (read up to a PONG)."""
+    client.send_raw("CHATHISTORY " + request)
+    client.send_raw("PING :history")
+    return read_until(client, "PONG")[:-1]
+
+
+def test_chathistory_queries(server_config):
+    """
+    Channel members replay its last messages by time or msgid.
+
+    Manual reproduction with nc -C:
+        talker: JOIN #past, then PRIVMSG #past :one ... :five
+        reader: CAP REQ :message-tags server-time, JOIN #past
+        reader: CHATHISTORY LATEST #past * 2
+        (@time=...;msgid=... :talker!talker@... PRIVMSG #past :four, five)
+        reader: CHATHISTORY BEFORE #past msgid=<id of three> 10  (one, two)
+    """
+    talker = connect(server_config, "talker")
+    reader = connect(server_config, "reader", "message-tags server-time")
+    try:
+        talker.join("#past")
+        read_until(talker, "366")
+        for text in ("one", "two", "three", "four", "five"):
+            talker.send_raw("PRIVMSG #past :" + text)
+        talker.send_raw("PING :sent")
+        read_until(talker, "PONG")
+        reader.join("#past")
+        read_until(reader, "366")
+
+        latest = query(reader, "LATEST #past * 2")
+        assert [msg.params for msg in latest] == [["#past", "four"],
+                                                  ["#past", "five"]]
+        assert latest[0].prefix.startswith("talker!talker@")
+        assert sorted(latest[0].tags) == ["msgid", "time"]
+
+        everything = query(reader, "LATEST #PAST * 100")
+        texts = [msg.params[1] for msg in everything]
+        assert texts == ["one", "two", "three", "four", "five"]
+        ids = [msg.tags["msgid"] for msg in everything]
+
+        before = query(reader, "BEFORE #past msgid=%s 10" % ids[2])
+        assert [msg.params[1] for msg in before] == ["one", "two"]
+        after = query(reader, "AFTER #past msgid=%s 2" % ids[1])
+        assert [msg.params[1] for msg in after] == ["three", "four"]
+        around = query(reader, "AROUND #past msgid=%s 3" % ids[2])
+        assert [msg.params[1] for msg in around] == ["two", "three", "four"]
+        newer = query(reader, "LATEST #past msgid=%s 10" % ids[3])
+        assert [msg.params[1] for msg in newer] == ["five"]
+
+        since = query(reader, "AFTER #past timestamp=2000-01-01T00:00:00Z 1")
+        assert [msg.params[1] for msg in since] == ["one"]
+        assert query(reader, "BEFORE #past msgid=unknown 10") == []
+    finally:
+        talker.disconnect()
+        reader.disconnect()
+
+
+def test_chathistory_batch(server_config):
+    """
+    With batch, the playback is one "chathistory" BATCH, empty if nothing
+    matched.
+
+    Manual reproduction with nc -C:
+        CAP REQ :batch server-time, JOIN #batched, PRIVMSG #batched :hi
+        CHATHISTORY LATEST #batched * 10
+        (:ft_irc BATCH +1 chathistory #batched
+         @batch=1;time=... :... PRIVMSG #batched :hi
+         :ft_irc BATCH -1)
+    """
+    client = connect(server_config, "batched", "batch server-time")
+    try:
+        client.join("#batched")
+        read_until(client, "366")
+        assert IRCMessage(client.recv_line()).command == "BATCH"  # Join
+        client.send_raw("PRIVMSG #batched :hi")
+        playback = query(client, "LATEST #batched * 10")
+        assert [msg.command for msg in playback] == ["BATCH", "PRIVMSG",
+                                                     "BATCH"]
+        reference = playback[0].params[0][1:]
+        assert playback[0].params == ["+" + reference, "chathistory",
+                                      "#batched"]
+        assert sorted(playback[1].tags) == ["batch", "time"]
+        assert playback[1].tags["batch"] == reference
+        assert playback[2].params == ["-" + reference]
+
+        empty = query(client, "BEFORE #batched msgid=unknown 10")
+        assert [msg.command for msg in empty] == ["BATCH", "BATCH"]
+    finally:
+        client.disconnect()
+
+
+def test_chathistory_errors(server_config):
+    """
+    Only members may read a channel's history; bad parameters FAIL.
+
+    Manual reproduction with nc -C:
+        CHATHISTORY LATEST #nowhere * 10
+        (:ft_irc FAIL CHATHISTORY INVALID_TARGET LATEST #nowhere :...)
+        JOIN #mine, CHATHISTORY LATEST #mine * 0
+        (:ft_irc FAIL CHATHISTORY INVALID_PARAMS LATEST :Invalid limit)
+    """
+    client = connect(server_config, "historian")
+    try:
+        fail = query(client, "LATEST #nowhere * 10")[-1]
+        assert fail.command == "FAIL"
+        assert fail.params[:4] == ["CHATHISTORY", "INVALID_TARGET", "LATEST",
+                                   "#nowhere"]
+
+        client.join("#mine")
+        read_until(client, "366")
+        assert query(client, "LATEST #mine * 10") == []
+        for request, context in (("LATEST #mine * 0", "LATEST"),
+                                 ("BEFORE #mine * 10", "BEFORE"),
+                                 ("AFTER #mine timestamp=now 10", "AFTER"),
+                                 ("SEARCH #mine * 10", "SEARCH")):
+            fail = query(client, request)[-1]
+            assert fail.params[:3] == ["CHATHISTORY", "INVALID_PARAMS",
+                                       context]
+        assert query(client, "LATEST #mine")[-1].command == "461"
+    finally:
+        client.disconnect()
+
+
+def start_history_server(history_dir, log_path):
+    env = dict(os.environ, IRCSERV_HISTORY_DIR=str(history_dir),
+               IRCSERV_HISTORY_CHANNELS="#kept")
+    with open(log_path, "w") as log:
+        process = subprocess.Popen(
+            [os.path.abspath(SERVER_BINARY), str(HISTORY_PORT), "password"],
+            stdout=log, stderr=subprocess.STDOUT, env=env)
+    deadline = time.time() + 10.0
+    while time.time() < deadline:
+        with open(log_path) as log:
+            if "Server started listening" in log.read():
+                return process
+        time.sleep(0.05)
+    process.kill()
+    raise AssertionError("server did not start")
+
+
+def stop_history_server(process):
+    process.send_signal(signal.SIGTERM)
+    process.wait(timeout=5)
+
+
+def test_chathistory_survives_restart(tmp_path):
+    """
+    Messages of channels in IRCSERV_HISTORY_CHANNELS are written to disk and
+    replayed after a restart; other channels only keep them in memory.
+
+    Manual reproduction with nc -C:
+        $ IRCSERV_HISTORY_DIR=/tmp/history IRCSERV_HISTORY_CHANNELS=#kept \
+          ./ircserv 6667 password
+        JOIN #kept and #lost, PRIVMSG #kept :one, PRIVMSG #lost :gone
+        (stop the server with ^C and start it the same way)
+        JOIN #kept, CHATHISTORY LATEST #kept * 10  (one)
+        JOIN #lost, CHATHISTORY LATEST #lost * 10  (nothing)
+    """
+    config = {"host": "localhost", "port": HISTORY_PORT,
+              "password": "password"}
+    history_dir = tmp_path / "history"
+    log_path = tmp_path / "server.log"
+    process = start_history_server(history_dir, log_path)
+    try:
+        talker = connect(config, "talker")
+        for channel in ("#kept", "#lost"):
+            talker.join(channel)
+            read_until(talker, "366")
+        for text in ("one", "two", "three"):
+            talker.send_raw("PRIVMSG #kept :" + text)
+        talker.send_raw("PRIVMSG #lost :gone")
+        talker.send_raw("PING :sent")
+        read_until(talker, "PONG")
+        talker.disconnect()
+        stop_history_server(process)
+        assert os.path.isdir(history_dir / "%23kept")
+
+        process = start_history_server(history_dir, log_path)
+        reader = connect(config, "reader", "message-tags")
+        for channel in ("#kept", "#lost"):
+            reader.join(channel)
+            read_until(reader, "366")
+        kept = query(reader, "LATEST #kept * 10")
+        assert [msg.params[1] for msg in kept] == ["one", "two", "three"]
+        assert kept[0].prefix.startswith("talker!talker@")
+        after = query(reader, "AFTER #kept msgid=%s 10"
+                      % kept[0].tags["msgid"])
+        assert [msg.params[1] for msg in after] == ["two", "three"]
+        around = query(reader, "AROUND #kept msgid=%s 3"
+                       % kept[1].tags["msgid"])
+        assert [msg.params[1] for msg in around] == ["one", "two", "three"]
+        assert query(reader, "LATEST #lost * 10") == []
+        reader.disconnect()
+    finally:
+        if process.poll() is None:
+            process.kill()
+        process.wait(timeout=5)
@@ -0,0 +1,326 @@
+"""Test server-to-server links (IRCSERV_LINK_LISTEN, IRCSERV_LINKS).
+
+The tests start their own servers in a chain a - b - c: b accepts links,
+a and c connect to it, so messages between a and c pass through b.
+"""
+
+import os
+import re
+import signal
+import socket
+import subprocess
+import time
+
+import pytest
+from irc_client import IRCClient, IRCMessage
+
+
+SERVER_BINARY = os.path.join(os.path.dirname(__file__), "..", "..", "ircserv")
+PASSWORD = "password"
+LINK_PASSWORD = "linkpass"
+CLIENT_PORTS = {"a": 6670, "b": 6671, "c": 6672}
+HUB_LINK_PORT = 16671
+
+
+def wait_for_port_free(port, timeout=5.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        with socket.socket(socket.AF_INET6) as probe:
+            probe.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            try:
+                probe.bind(("::", port))
+                return
+            except OSError:
+                time.sleep(0.05)
+
+
+def count_in_log(log_path, pattern):
+    with open(log_path) as f:
+        return len(re.findall(pattern, f.read()))
+
+
+def wait_for_log(log_path, pattern, count=1, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if count_in_log(log_path, pattern) >= count:
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def wait_for_command(client, command, timeout=2.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        msg = IRCMessage(client.recv_line())
+        if msg.command == command:
+            return msg
+    return None
+
+
+class Network:
+    def __init__(self, tmp_path):
+        self.tmp_path = tmp_path
+        self.processes = {}
+        self.clients = []
+
+    def log(self, name):
+        return self.tmp_path / f"{name}.log"
+
+    def start(self, name):
+        port = CLIENT_PORTS[name]
+        wait_for_port_free(port)
+        env = dict(os.environ,
+                   IRCSERV_SERVER_NAME=f"{name}.test",
+                   IRCSERV_LINK_PASSWORD=LINK_PASSWORD)
+        if name == "b":
+            wait_for_port_free(HUB_LINK_PORT)
+            env["IRCSERV_LINK_LISTEN"] = f"127.0.0.1:{HUB_LINK_PORT}"
+        else:
+            env["IRCSERV_LINKS"] = f"127.0.0.1:{HUB_LINK_PORT}"
+        with open(self.log(name), "w") as log:
+            self.processes[name] = subprocess.Popen(
+                [os.path.abspath(SERVER_BINARY), str(port), PASSWORD],
+                stdout=log, stderr=subprocess.STDOUT, env=env)
+        assert wait_for_log(self.log(name), r"Server started listening")
+
+    def wait_linked(self, name, count=1):
+        assert wait_for_log(self.log(name), r"Link established with", count)
+
+    def register(self, server, nickname):
+        client = IRCClient(port=CLIENT_PORTS[server], timeout=5.0)
+        client.connect()
+        client.pass_cmd(PASSWORD)
+        client.nick(nickname)
+        client.user(nickname, "Link Test")
+        client.nickname = nickname
+        self.clients.append(client)
+        return client
+
+    def stop(self):
+        for client in self.clients:
+            try:
+                client.disconnect()
+            except OSError:
+                pass
+        for process in self.processes.values():
+            if process.poll() is None:
+                process.kill()
+            process.wait(timeout=5)
+
+
+@pytest.fixture
+def network(tmp_path):
+    net = Network(tmp_path)
+    yield net
+    net.stop()
+
+
+@pytest.fixture
+def linked(network):
+    network.start("b")
+    network.start("a")
+    network.start("c")
+    network.wait_linked("b", 2)
+    return network
+
+
+def join_all(network, channel, *clients):
+    """Join one after another; each join has reached every server before
+    the next one (simultaneous joins may both create the channel)."""
+    for i, client in enumerate(clients):
+        client.join(channel)
+        for member in clients[:i + 1]:
+            msg = wait_for_command(member, "JOIN")
+            assert msg, f"JOIN of client {i} not seen"
+        for name in network.processes:
+            assert wait_for_log(network.log(name),
+                                rf"{client.nickname} joined {channel}")
+
+
+def test_channel_messages_cross_servers(linked):
+    """
+    Users on different servers share channels and private messages.
+
+    Manual reproduction:
+        $ IRCSERV_SERVER_NAME=b IRCSERV_LINK_PASSWORD=x \\
+          IRCSERV_LINK_LISTEN=127.0.0.1:16671 ./ircserv 6671 password
+        $ IRCSERV_SERVER_NAME=a IRCSERV_LINK_PASSWORD=x \\
+          IRCSERV_LINKS=127.0.0.1:16671 ./ircserv 6670 password
+        (clients on 6670 and 6671 join the same channel and talk)
+    """
+    alice = linked.register("a", "alice")
+    assert alice.wait_for_reply("001")
+    carol = linked.register("c", "carol")
+    assert carol.wait_for_reply("001")
+
+    join_all(linked, "#net", alice, carol)
+    alice.privmsg("#net", "hello from a")
+    msg = wait_for_command(carol, "PRIVMSG")
+    assert msg and msg.params == ["#net", "hello from a"]
+    assert msg.prefix.startswith("alice!")
+
+    carol.privmsg("alice", "private hello")
+    msg = wait_for_command(alice, "PRIVMSG")
+    assert msg and msg.params == ["alice", "private hello"]
+
+
+def test_nickname_in_use_on_other_server(linked):
+    alice = linked.register("a", "alice")
+    assert alice.wait_for_reply("001")
+    time.sleep(0.3)
+
+    other = linked.register("c", "alice")
+    assert other.wait_for_reply("433")
+
+
+def test_channel_state_propagates(linked):
+    """TOPIC, MODE, INVITE and KICK of one server apply everywhere."""
+    alice = linked.register("a", "alice")
+    carol = linked.register("c", "carol")
+    dave = linked.register("b", "dave")
+    for client in (alice, carol, dave):
+        assert client.wait_for_reply("001")
+
+    join_all(linked, "#state", alice, carol)
+    alice.topic("#state", "linked topic")
+    msg = wait_for_command(carol, "TOPIC")
+    assert msg and msg.params[-1] == "linked topic"
+
+    # alice is the operator on every server: +i keeps dave out
+    alice.mode("#state", "+i")
+    assert wait_for_command(carol, "MODE")
+    dave.join("#state")
+    assert dave.wait_for_reply("473")
+
+    # Only operators may invite to +i channels: carol is not one
+    carol.invite("dave", "#state")
+    assert carol.wait_for_reply("482")
+    alice.invite("dave", "#state")
+    assert wait_for_command(dave, "INVITE")
+    dave.join("#state")
+    assert wait_for_command(dave, "JOIN")
+
+    alice.kick("#state", "carol", "bye")
+    msg = wait_for_command(carol, "KICK")
+    assert msg and msg.params[:2] == ["#state", "carol"]
+    carol.privmsg("#state", "still here?")
+    assert carol.wait_for_reply("404")
+
+
+def test_quit_reaches_other_servers(linked):
+    alice = linked.register("a", "alice")
+    carol = linked.register("c", "carol")
+    for client in (alice, carol):
+        assert client.wait_for_reply("001")
+    join_all(linked, "#quit", alice, carol)
+
+    carol.quit_cmd("gone")
+    msg = wait_for_command(alice, "QUIT")
+    assert msg and msg.prefix.startswith("carol!")
+    assert msg.params[-1] == "gone"
+
+
+def test_burst_for_late_server(network):
+    """A server linking later learns the existing users and channels."""
+    network.start("b")
+    network.start("a")
+    network.wait_linked("a")
+    alice = network.register("a", "alice")
+    assert alice.wait_for_reply("001")
+    alice.join("#early")
+    assert wait_for_command(alice, "JOIN")
+    alice.topic("#early", "set before c")
+    assert wait_for_command(alice, "TOPIC")
+    assert wait_for_log(network.log("b"), r"changed topic of #early")
+
+    network.start("c")
+    network.wait_linked("c")
+    carol = network.register("c", "carol")
+    assert carol.wait_for_reply("001")
+    carol.join("#early")
+    assert wait_for_command(carol, "JOIN")
+    carol.topic("#early")
+    reply = carol.wait_for_reply("332")
+    assert reply and reply.params[-1] == "set before c"
+    carol.privmsg("#early", "hi")
+    assert wait_for_command(alice, "PRIVMSG")
+
+
+def test_burst_carries_mask_lists(network):
+    """Bans set before a server links reach it in the burst (BMASK)."""
+    network.start("b")
+    network.start("a")
+    network.wait_linked("a")
+    alice = network.register("a", "alice")
+    assert alice.wait_for_reply("001")
+    alice.join("#masked")
+    assert wait_for_command(alice, "JOIN")
+    alice.mode("#masked", "+b mallory")
+    assert wait_for_command(alice, "MODE")
+    assert wait_for_log(network.log("b"), r"set mode \+b on #masked")
+
+    network.start("c")
+    network.wait_linked("c")
+    mallory = network.register("c", "mallory")
+    assert mallory.wait_for_reply("001")
+    mallory.join("#masked")
+    assert mallory.wait_for_reply("474")
+    mallory.send_raw("NICK carol")
+    assert wait_for_command(mallory, "NICK")
+    mallory.join("#masked")
+    assert wait_for_command(mallory, "JOIN")
+    mallory.send_raw("MODE #masked b")
+    ban = mallory.wait_for_reply("367")
+    assert ban and ban.params[2] == "mallory!*@*"
+
+
+def test_netsplit_removes_remote_users(linked):
+    """
+    When the hub dies, the users behind it quit with the netsplit reason
+    and the link is re-established once it is back.
+    """
+    alice = linked.register("a", "alice")
+    carol = linked.register("c", "carol")
+    for client in (alice, carol):
+        assert client.wait_for_reply("001")
+    join_all(linked, "#split", carol, alice)
+
+    linked.processes["b"].send_signal(signal.SIGKILL)
+    linked.processes["b"].wait(timeout=5)
+    msg = wait_for_command(alice, "QUIT", timeout=5.0)
+    assert msg and msg.prefix.startswith("carol!")
+    assert msg.params[-1] == "a.test b.test"
+
+    # alice is alone on a: she became operator again
+    alice.mode("#split", "+t")
+    assert wait_for_command(alice, "MODE")
+
+    linked.start("b")
+    assert wait_for_log(linked.log("a"), r"Link established with", 2,
+                        timeout=15.0)
+
+
+def test_silent_link_is_closed(network):
+    """
+    A connection to the link port that never sends SERVER is closed after
+    the handshake timeout, so silent connections cannot fill the link
+    table.
+
+    Manual reproduction:
+        $ IRCSERV_LINK_LISTEN=127.0.0.1:16671 IRCSERV_LINK_PASSWORD=x \\
+              ./ircserv 6667 password
+        $ nc 127.0.0.1 16671
+        (after 10 seconds the server sends "ERROR :Handshake timed out"
+         and closes the connection)
+    """
+    network.start("b")
+    with socket.create_connection(("127.0.0.1", HUB_LINK_PORT)) as silent:
+        silent.settimeout(15.0)
+        data = b""
+        while True:
+            chunk = silent.recv(4096)
+            if not chunk:
+                break
+            data += chunk
+    assert b"ERROR :Handshake timed out" in data
+    assert wait_for_log(network.log("b"), r"Handshake timed out")
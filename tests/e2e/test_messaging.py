@@ -55,6 +55,29 @@ def test_privmsg_to_user(two_clients):
     assert test_message in privmsg.params[1]  # message content
 
 
+def test_privmsg_to_several_targets(two_clients):
+    """
+    PRIVMSG takes a comma-separated list of up to MAXTARGETS (4) targets.
+
+    Manual reproduction with nc -C (as user1):
+        PRIVMSG user2,nobody :hello      (user2 gets it, 401 for nobody)
+        PRIVMSG a,b,c,d,e :too many      (:ft_irc 407 user1 a,b,c,d,e :...)
+    """
+    client1, client2 = two_clients
+    client1.recv_lines(timeout=0.5)
+    client2.recv_lines(timeout=0.5)
+
+    client1.send_raw("PRIVMSG user2,nobody :hello both")
+    client1.send_raw("PRIVMSG user2,a,b,c,d :too many")
+    replies = [IRCMessage(line) for line in client1.recv_lines(timeout=1.0)]
+    assert [(m.command, m.params[1]) for m in replies] == [
+        ("401", "nobody"), ("407", "user2,a,b,c,d")]
+
+    received = [IRCMessage(line) for line in client2.recv_lines(timeout=0.5)]
+    assert [m.params for m in received if m.command == "PRIVMSG"] == [
+        ["user2", "hello both"]]
+
+
 def test_privmsg_to_channel(two_clients):
     """
     Test sending message to channel.
@@ -0,0 +1,134 @@
+"""Test away state (AWAY) and nickname watching (MONITOR)."""
+
+from irc_client import IRCClient, IRCMessage
+
+
+def read_until(client, command):
+    """Read messages up to and including the first one with command."""
+    messages = []
+    while not messages or messages[-1].command != command:
+        messages.append(IRCMessage(client.recv_line()))
+    return messages
+
+
+def connect(server_config, nickname):
+    client = IRCClient(host=server_config["host"],
+                       port=server_config["port"], timeout=5.0)
+    client.connect()
+    client.pass_cmd(server_config["password"])
+    client.nick(nickname)
+    client.user(nickname, "Monitor Tester")
+    read_until(client, "001")
+    client.recv_lines(timeout=0.3)
+    return client
+
+
+def test_away_is_reported(server_config):
+    """
+    Away users are answered with RPL_AWAY, shown in WHOIS and as G in WHO.
+
+    Manual reproduction with nc -C:
+        napper: AWAY :gone fishing       (:ft_irc 306 napper :...)
+        caller: PRIVMSG napper :hi       (:ft_irc 301 caller napper :gone...)
+        caller: WHO napper               (... napper G :0 Monitor Tester)
+        napper: AWAY                     (:ft_irc 305 napper :...)
+    """
+    napper = connect(server_config, "napper")
+    caller = connect(server_config, "caller")
+    try:
+        napper.send_raw("AWAY :gone fishing")
+        assert read_until(napper, "306")[-1].params[0] == "napper"
+
+        caller.send_raw("PRIVMSG napper :hi")
+        caller.send_raw("WHOIS napper")
+        caller.send_raw("WHO napper")
+        replies = read_until(caller, "315")
+        away = [msg.params for msg in replies if msg.command == "301"]
+        assert away == [["caller", "napper", "gone fishing"]] * 2
+        who = [msg for msg in replies if msg.command == "352"][0]
+        assert who.params[6] == "G"
+        assert read_until(napper, "PRIVMSG")[-1].params == ["napper", "hi"]
+
+        napper.send_raw("AWAY")
+        assert read_until(napper, "305")[-1].params[0] == "napper"
+        caller.send_raw("PRIVMSG napper :back?")
+        caller.send_raw("PING :done")
+        assert "301" not in [m.command for m in read_until(caller, "PONG")]
+    finally:
+        napper.disconnect()
+        caller.disconnect()
+
+
+def test_monitor_notifies_watchers(server_config):
+    """
+    MONITOR reports the watched nicknames' status, then their sign-on, nick
+    changes and quit.
+
+    Manual reproduction with nc -C:
+        watcher: MONITOR + friend,nobody
+        (:ft_irc 731 watcher :friend,nobody)
+        (connect as friend)      (:ft_irc 730 watcher :friend!friend@...)
+        friend: NICK pal         (:ft_irc 731 watcher :friend)
+        watcher: MONITOR L       (:ft_irc 732 watcher :friend,nobody, 733)
+        friend: NICK friend, QUIT  (730, then 731 watcher :friend)
+    """
+    watcher = connect(server_config, "watcher")
+    friend = None
+    try:
+        watcher.send_raw("MONITOR + friend,nobody")
+        offline = read_until(watcher, "731")[-1]
+        assert offline.params == ["watcher", "friend,nobody"]
+
+        friend = connect(server_config, "friend")
+        online = read_until(watcher, "730")[-1]
+        assert online.params[0] == "watcher"
+        assert online.params[1].startswith("friend!friend@")
+
+        friend.nick("pal")
+        assert read_until(watcher, "731")[-1].params == ["watcher", "friend"]
+        watcher.send_raw("MONITOR L")
+        listed = read_until(watcher, "733")
+        assert listed[0].params == ["watcher", "friend,nobody"]
+        watcher.send_raw("MONITOR S")
+        assert read_until(watcher, "731")[-1].params == ["watcher",
+                                                         "friend,nobody"]
+
+        friend.nick("friend")
+        assert read_until(watcher, "730")[-1].params[1].startswith("friend!")
+        friend.send_raw("QUIT :bye")
+        assert read_until(watcher, "731")[-1].params == ["watcher", "friend"]
+
+        watcher.send_raw("MONITOR - friend")
+        watcher.send_raw("MONITOR L")
+        assert read_until(watcher, "733")[0].params == ["watcher", "nobody"]
+        watcher.send_raw("MONITOR C")
+        watcher.send_raw("MONITOR L")
+        assert [m.command for m in read_until(watcher, "733")] == ["733"]
+    finally:
+        watcher.disconnect()
+        if friend:
+            friend.disconnect()
+
+
+def test_monitor_list_is_limited(server_config):
+    """
+    A client watches 100 nicknames at most; the rest is refused with
+    ERR_MONLISTFULL.
+
+    Manual reproduction with nc -C:
+        MONITOR + n0,n1,...,n101
+        (:ft_irc 734 <nick> 100 n100,n101 :Monitor list is full)
+    """
+    client = connect(server_config, "collector")
+    try:
+        names = ["n%d" % i for i in range(102)]
+        client.send_raw("MONITOR + " + ",".join(names))
+        full = read_until(client, "734")[-1]
+        assert full.params[:3] == ["collector", "100", "n100,n101"]
+        client.send_raw("PING :listed")
+        offline = [m for m in read_until(client, "PONG")
+                   if m.command == "731"]
+        listed = ",".join(m.params[1] for m in offline).split(",")
+        assert listed == names[:100]
+    finally:
+        client.disconnect()
@@ -429,3 +429,39 @@ def test_rapid_reconnection(server_config):
 
     finally:
         final_client.disconnect()
+
+
+def test_malformed_flood_is_throttled_then_disconnected(server_config):
+    """
+    Test server handling of a client flooding malformed lines.
+
+    Manual reproduction:
+        $ (for i in $(seq 60); do printf 'NI-CK bad\\r\\n'; done; sleep 1) \\
+          | nc localhost 6667
+
+    Expected: The first 5 malformed lines are answered with
+    "ERROR :Invalid message format", later ones are dropped silently and
+    the 50th (IRCSERV_MALFORMED_LIMIT) closes the connection with
+    "ERROR :Closing Link: ... (Too many malformed messages)". Other clients
+    are not affected.
+    """
+    client = IRCClient(host=server_config["host"], port=server_config["port"])
+    client.connect()
+    client.socket.sendall(b"NI-CK bad\r\n" * 60)
+    lines = client.recv_lines(timeout=2.0)
+    client.disconnect()
+
+    replies = [line for line in lines if "Invalid message format" in line]
+    assert len(replies) == 5, f"Expected 5 replies, got {lines}"
+    assert lines[-1].startswith("ERROR :Closing Link")
+    assert "Too many malformed messages" in lines[-1]
+
+    other = IRCClient(host=server_config["host"], port=server_config["port"])
+    try:
+        other.connect()
+        other.pass_cmd(server_config["password"])
+        other.nick("postflood")
+        other.user("postflood", "Post Flood")
+        assert other.wait_for_reply("001", timeout=2.0)
+    finally:
+        other.disconnect()
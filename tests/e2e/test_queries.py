@@ -0,0 +1,105 @@
+"""Test user queries (WHO, WHOIS)."""
+
+import time
+
+from irc_client import IRCMessage
+
+
+def read_until(client, end_code):
+    """Read messages up to and including the one with end_code."""
+    messages = []
+    while not messages or messages[-1].command != end_code:
+        messages.append(IRCMessage(client.recv_line()))
+    return messages
+
+
+def test_who_channel(two_clients):
+    """
+    WHO #channel lists its members, operators flagged with @.
+
+    Manual reproduction with irssi:
+        user1: /join #who
+        user2: /join #who
+        user2: /who #who
+        (:ft_irc 352 user2 #who user1 <host> ft_irc user1 H@ :0 User One,
+         the same for user2 with H, then :ft_irc 315 user2 #who :End of
+         /WHO list)
+    """
+    client1, client2 = two_clients
+    client1.join("#who")
+    time.sleep(0.2)
+    client2.join("#who")
+    time.sleep(0.3)
+    client2.recv_lines(timeout=0.5)
+
+    client2.send_raw("WHO #who")
+    messages = read_until(client2, "315")
+    replies = {msg.params[5]: msg for msg in messages if msg.command == "352"}
+    assert sorted(replies) == ["user1", "user2"]
+    assert replies["user1"].params[1] == "#who"
+    assert replies["user1"].params[2] == "user1"
+    assert replies["user1"].params[4] == "ft_irc"
+    assert replies["user1"].params[6] == "H@"
+    assert replies["user1"].params[7] == "0 User One"
+    assert replies["user2"].params[6] == "H"
+    assert messages[-1].params[1] == "#who"
+
+
+def test_who_mask(two_clients):
+    """
+    WHO <mask> matches nicknames, user names, hosts and real names.
+
+    Manual reproduction with irssi:
+        /who user1       (one reply: exact nickname)
+        /who *User Two   (user2, by real name)
+        /who nobody*     (only :ft_irc 315 ... nobody* :End of /WHO list)
+    """
+    client1, client2 = two_clients
+    client1.recv_lines(timeout=0.3)
+
+    client1.send_raw("WHO USER1")
+    messages = read_until(client1, "315")
+    assert [msg.params[5] for msg in messages if msg.command == "352"] == [
+        "user1"]
+    assert messages[-1].params[1] == "USER1"
+
+    client1.send_raw("WHO *User?Two")
+    messages = read_until(client1, "315")
+    assert [msg.params[5] for msg in messages if msg.command == "352"] == [
+        "user2"]
+
+    client1.send_raw("WHO nobody*")
+    assert [msg.command for msg in read_until(client1, "315")] == ["315"]
+
+
+def test_whois(two_clients):
+    """
+    WHOIS reports the user, its server and its channels.
+
+    Manual reproduction with irssi:
+        user1: /join #whois-a, /join #whois-b
+        user2: /whois user1
+        (311 user1 user1 <host> * :User One, 312 ... ft_irc,
+         319 ... :@#whois-a @#whois-b, 318 ... :End of /WHOIS list)
+        user2: /whois ghost
+        (401 ghost :No such nick/channel, 318)
+    """
+    client1, client2 = two_clients
+    client1.join("#whois-a")
+    client1.join("#whois-b")
+    time.sleep(0.3)
+    client2.recv_lines(timeout=0.3)
+
+    client2.send_raw("WHOIS User1")
+    messages = read_until(client2, "318")
+    by_code = {msg.command: msg for msg in messages}
+    assert by_code["311"].params[1:3] == ["user1", "user1"]
+    assert by_code["311"].params[-1] == "User One"
+    assert by_code["312"].params[2] == "ft_irc"
+    assert sorted(by_code["319"].params[2].split()) == ["@#whois-a",
+                                                        "@#whois-b"]
+    assert by_code["318"].params[1] == "user1"
+
+    client2.send_raw("WHOIS ghost")
+    messages = read_until(client2, "318")
+    assert [msg.command for msg in messages] == ["401", "318"]
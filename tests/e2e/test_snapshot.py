@@ -0,0 +1,168 @@
+"""Test channel snapshots (IRCSERV_SNAPSHOT_PATH).
+
+The test starts its own server: it is killed to simulate a crash and then
+started again on the same snapshot file.
+"""
+
+import os
+import re
+import signal
+import socket
+import subprocess
+import time
+
+import pytest
+from irc_client import IRCClient, IRCMessage
+
+
+SERVER_BINARY = os.path.join(os.path.dirname(__file__), "..", "..", "ircserv")
+SNAPSHOT_PORT = 6669
+PASSWORD = "password"
+
+
+def wait_for_port_free(timeout=5.0):
+    """A killed server's sockets can outlive it briefly (io_uring teardown
+    is asynchronous, a snapshot writer may still be running)."""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        with socket.socket(socket.AF_INET6) as probe:
+            probe.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+            try:
+                probe.bind(("::", SNAPSHOT_PORT))
+                return
+            except OSError:
+                time.sleep(0.05)
+
+
+def start_server(snapshot_path, log_path, interval="1"):
+    wait_for_port_free()
+    env = dict(os.environ,
+               IRCSERV_SNAPSHOT_PATH=str(snapshot_path),
+               IRCSERV_SNAPSHOT_INTERVAL=interval)
+    with open(log_path, "w") as log:
+        process = subprocess.Popen(
+            [os.path.abspath(SERVER_BINARY), str(SNAPSHOT_PORT), PASSWORD],
+            stdout=log, stderr=subprocess.STDOUT, env=env)
+    assert wait_for_log(log_path, r"Server started listening")
+    return process
+
+
+def count_in_log(log_path, pattern):
+    with open(log_path) as f:
+        return len(re.findall(pattern, f.read()))
+
+
+def wait_for_log(log_path, pattern, count=1, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if count_in_log(log_path, pattern) >= count:
+            return True
+        time.sleep(0.05)
+    return False
+
+
+def register(nickname):
+    client = IRCClient(port=SNAPSHOT_PORT, timeout=5.0)
+    client.connect()
+    client.pass_cmd(PASSWORD)
+    client.nick(nickname)
+    client.user(nickname, "Snapshot Test")
+    assert client.wait_for_reply("001", timeout=2.0), f"{nickname}: no 001"
+    return client
+
+
+def wait_for_command(client, command, timeout=2.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        msg = IRCMessage(client.recv_line())
+        if msg.command == command:
+            return msg
+    return None
+
+
+@pytest.fixture
+def snapshot_files(tmp_path):
+    processes = []
+    yield tmp_path / "channels.snap", tmp_path / "server.log", processes
+    for process in processes:
+        if process.poll() is None:
+            process.kill()
+        process.wait(timeout=5)
+
+
+def test_channel_configuration_survives_crash(snapshot_files):
+    """
+    Channel settings written by the periodic snapshot are restored after
+    the server is killed.
+
+    Manual reproduction:
+        $ IRCSERV_SNAPSHOT_PATH=/tmp/channels.snap ./ircserv 6667 password
+        (create a channel, set topic and modes, wait a minute)
+        $ kill -9 <pid>; restart the server the same way
+        (the log shows "Restored 1 channels"; +i still keeps out everybody
+         without an invite exception, the first one to join is operator)
+    """
+    snapshot_path, log_path, processes = snapshot_files
+    processes.append(start_server(snapshot_path, log_path))
+
+    alice = register("alice")
+    alice.join("#persist")
+    assert wait_for_command(alice, "JOIN")
+    alice.topic("#persist", "kept across restarts")
+    alice.mode("#persist", "+ik sesame")
+    assert wait_for_command(alice, "MODE")
+    alice.mode("#persist", "+I alice!*@*")
+    assert wait_for_command(alice, "MODE")
+
+    # A snapshot started after the changes: wait for two more
+    written = count_in_log(log_path, r"Channel snapshot written")
+    assert wait_for_log(log_path, r"Channel snapshot written", written + 2)
+    processes[0].send_signal(signal.SIGKILL)
+    processes[0].wait(timeout=5)
+    alice.disconnect()
+
+    processes.append(start_server(snapshot_path, log_path))
+    assert wait_for_log(log_path, r"Restored 1 channels")
+
+    # Invite-only still applies to everybody without an invite exception
+    bob = register("bob")
+    bob.join("#persist", "sesame")
+    assert bob.wait_for_reply("473", timeout=2.0)
+
+    # The key too, even with the exception
+    alice = register("alice")
+    alice.join("#persist", "wrong")
+    assert alice.wait_for_reply("475", timeout=2.0)
+
+    alice.join("#persist", "sesame")
+    assert wait_for_command(alice, "JOIN")
+    alice.topic("#persist")
+    reply = alice.wait_for_reply("332", timeout=2.0)
+    assert reply and reply.params[-1] == "kept across restarts"
+
+    # The first member is operator: inviting bob is allowed
+    alice.invite("bob", "#persist")
+    assert alice.wait_for_reply("341", timeout=2.0)
+    bob.join("#persist", "sesame")
+    assert wait_for_command(bob, "JOIN")
+
+    alice.disconnect()
+    bob.disconnect()
+
+
+def test_snapshot_written_on_shutdown(snapshot_files):
+    """A clean shutdown writes a final snapshot without waiting."""
+    snapshot_path, log_path, processes = snapshot_files
+    process = start_server(snapshot_path, log_path, interval="0")
+    processes.append(process)
+
+    client = register("carol")
+    client.join("#shutdown")
+    assert wait_for_command(client, "JOIN")
+    process.send_signal(signal.SIGTERM)
+    process.wait(timeout=5)
+    assert os.path.exists(snapshot_path)
+
+    processes.append(start_server(snapshot_path, log_path))
+    assert wait_for_log(log_path, r"Restored 1 channels")
+    client.disconnect()
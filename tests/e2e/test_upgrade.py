@@ -0,0 +1,197 @@
+"""Test the zero-downtime upgrade (SIGUSR2 socket handoff).
+
+The test starts its own server because the upgrade replaces the process:
+the running server hands its listening socket, all client sockets and the
+user/channel state over to a freshly exec'd binary and exits.
+"""
+
+import os
+import re
+import shutil
+import signal
+import socket
+import subprocess
+import threading
+import time
+
+import pytest
+from irc_client import IRCClient, IRCMessage
+
+
+SERVER_BINARY = os.path.join(os.path.dirname(__file__), "..", "..", "ircserv")
+UPGRADE_PORT = 6668
+PASSWORD = "password"
+
+
+def wait_for_log(log_path, pattern, timeout=10.0):
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        with open(log_path) as f:
+            match = re.search(pattern, f.read())
+        if match:
+            return match
+        time.sleep(0.05)
+    return None
+
+
+def wait_for_exit(pid, timeout=5.0):
+    """Wait for a process that is not our child (reparented after exec)."""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        try:
+            with open(f"/proc/{pid}/stat") as f:
+                if f.read().rsplit(")", 1)[1].split()[0] == "Z":
+                    return
+        except FileNotFoundError:
+            return
+        time.sleep(0.05)
+
+
+def register(nickname):
+    client = IRCClient(port=UPGRADE_PORT, timeout=5.0)
+    client.connect()
+    client.pass_cmd(PASSWORD)
+    client.nick(nickname)
+    client.user(nickname, "Upgrade Test")
+    assert client.wait_for_reply("001", timeout=2.0), f"{nickname}: no 001"
+    return client
+
+
+def join(client, channel):
+    client.join(channel)
+    while IRCMessage(client.recv_line()).command != "JOIN":
+        pass
+
+
+@pytest.fixture
+def upgrade_server(tmp_path):
+    """Start a server with a log file; yields (process, log, all pids)."""
+    log_path = tmp_path / "server.log"
+    with open(log_path, "w") as log:
+        process = subprocess.Popen(
+            [os.path.abspath(SERVER_BINARY), str(UPGRADE_PORT), PASSWORD],
+            stdout=log, stderr=subprocess.STDOUT)
+    assert wait_for_log(log_path, r"Server started listening"), \
+        "server did not start"
+    pids = [process.pid]
+
+    yield process, log_path, pids
+
+    for pid in pids:
+        try:
+            os.kill(pid, signal.SIGTERM)
+        except ProcessLookupError:
+            pass
+    process.wait(timeout=5)
+    for pid in pids[1:]:
+        wait_for_exit(pid)
+
+
+def test_upgrade_under_load_keeps_clients_and_state(upgrade_server):
+    """
+    Clients stay connected across an upgrade and no message is lost.
+
+    Manual reproduction:
+        $ ./ircserv 6667 password &
+        (connect with irssi, join channels, keep chatting)
+        $ kill -USR2 %1
+        (the log shows "Upgrade complete, handed over to new process <pid>";
+         irssi stays connected, channels and topics are unchanged)
+    """
+    process, log_path, pids = upgrade_server
+
+    sender = register("sender")
+    receiver = register("receiver")
+    join(sender, "#upgrade")
+    sender.topic("#upgrade", "survives upgrades")
+    join(receiver, "#upgrade")
+    # Incomplete command: must be completed by the new process
+    receiver.socket.sendall(b"TOPIC #upg")
+
+    total = 2000
+    errors = []
+
+    def send_messages():
+        try:
+            for i in range(total):
+                sender.socket.sendall(
+                    f"PRIVMSG #upgrade :message {i}\r\n".encode())
+                if i % 50 == 0:
+                    time.sleep(0.01)
+        except OSError as e:
+            errors.append(e)
+
+    thread = threading.Thread(target=send_messages)
+    thread.start()
+    time.sleep(0.1)
+    process.send_signal(signal.SIGUSR2)
+
+    received = []
+    deadline = time.time() + 20
+    while len(received) < total and time.time() < deadline:
+        try:
+            msg = IRCMessage(receiver.recv_line())
+        except socket.timeout:
+            continue
+        except ConnectionError:
+            break
+        if msg.command == "PRIVMSG":
+            received.append(msg.params[-1])
+    thread.join()
+
+    match = wait_for_log(log_path, r"handed over to new process (\d+)")
+    assert match, "upgrade did not complete"
+    pids.append(int(match.group(1)))
+    process.wait(timeout=5)  # The old process exits after the handoff
+
+    assert not errors, f"sender failed: {errors}"
+    assert received == [f"message {i}" for i in range(total)]
+
+    # Partial command and channel state were carried over
+    receiver.socket.sendall(b"rade\r\n")
+    reply = receiver.wait_for_reply("332", timeout=2.0)
+    assert reply and reply.params[-1] == "survives upgrades"
+
+    # The nickname is still taken, the listener still accepts
+    newcomer = IRCClient(port=UPGRADE_PORT, timeout=5.0)
+    newcomer.connect()
+    newcomer.pass_cmd(PASSWORD)
+    newcomer.nick("sender")
+    assert newcomer.wait_for_reply("433", timeout=2.0)
+    newcomer.nick("newcomer")
+    newcomer.user("newcomer", "Upgrade Test")
+    assert newcomer.wait_for_reply("001", timeout=2.0)
+    join(newcomer, "#upgrade")
+    sender.privmsg("#upgrade", "after upgrade")
+    lines = newcomer.recv_lines(timeout=1.0)
+    assert any("after upgrade" in line for line in lines)
+
+    for client in (sender, receiver, newcomer):
+        client.disconnect()
+
+
+def test_failed_upgrade_keeps_serving(tmp_path):
+    """If the new binary cannot start, the old process keeps serving."""
+    binary = tmp_path / "ircserv"
+    shutil.copy(SERVER_BINARY, binary)
+    log_path = tmp_path / "server.log"
+    with open(log_path, "w") as log:
+        process = subprocess.Popen([str(binary), str(UPGRADE_PORT), PASSWORD],
+                                   stdout=log, stderr=subprocess.STDOUT)
+    try:
+        assert wait_for_log(log_path, r"Server started listening")
+        client = register("survivor")
+        join(client, "#stay")
+
+        os.remove(binary)  # exec of the new process fails
+        process.send_signal(signal.SIGUSR2)
+        assert wait_for_log(log_path, r"Upgrade failed")
+        assert process.poll() is None
+
+        client.topic("#stay", "still here")
+        lines = client.recv_lines(timeout=1.0)
+        assert any("TOPIC #stay" in line for line in lines)
+        assert register("latecomer")
+    finally:
+        process.terminate()
+        process.wait(timeout=5)
@@ -0,0 +1,94 @@
+#include "AdminServer.hpp"
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+class AdminServerTest : public ::testing::Test {
+ protected:
+  EventLoop loop;
+  Metrics metrics;
+  AdminServer admin;
+  std::string path;
+
+  AdminServerTest() : admin(&loop, &metrics) {}
+
+  void SetUp() override {
+    std::cout.setstate(std::ios::failbit);
+    loop.create(EVENT_BACKEND_EPOLL);
+    path = "/tmp/ircserv_admin_test_" + std::to_string(getpid());
+    admin.listen("unix:" + path);
+  }
+
+  void TearDown() override {
+    admin.stop();
+    std::cout.clear();
+  }
+
+  int connectClient() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    EXPECT_EQ(connect(fd, reinterpret_cast<struct sockaddr*>(&addr),
+                      sizeof(addr)),
+              0);
+    return fd;
+  }
+
+  // Dispatch the admin events until nothing happens for 100 ms
+  void runLoop() {
+    struct epoll_event events[16];
+    int n;
+    while ((n = loop.wait(events, 16, 100)) > 0) {
+      for (int i = 0; i < n; ++i) {
+        if (admin.ownsFd(events[i].data.fd)) {
+          admin.handleEvent(events[i].data.fd, events[i].events);
+        }
+      }
+    }
+  }
+
+  static std::string readAll(int fd) {
+    std::string data;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) data.append(buffer, n);
+    return data;
+  }
+};
+
+TEST_F(AdminServerTest, IdleConnectionsDoNotLockScrapersOut) {
+  std::vector<int> idle;
+  for (int i = 0; i < 8; ++i) {
+    idle.push_back(connectClient());
+    runLoop();
+  }
+  // Activity counts, not the accept time: idle[1] is now the idlest
+  ASSERT_EQ(write(idle[0], "GET /met", 8), 8);
+  runLoop();
+
+  int scraper = connectClient();
+  const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+  ASSERT_EQ(write(scraper, request, sizeof(request) - 1),
+            static_cast<ssize_t>(sizeof(request) - 1));
+  runLoop();
+  std::string response = readAll(scraper);
+  EXPECT_EQ(response.compare(0, 15, "HTTP/1.1 200 OK"), 0) << response;
+  EXPECT_EQ(readAll(idle[1]), "");  // The idlest one made room
+  struct pollfd alive = {idle[0], POLLIN, 0};
+  EXPECT_EQ(poll(&alive, 1, 0), 0);  // Still open
+
+  for (size_t i = 0; i < idle.size(); ++i) close(idle[i]);
+  close(scraper);
+}
@@ -0,0 +1,59 @@
+#include "BinaryCodec.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include "gtest/gtest.h"
+
+TEST(BinaryCodecTest, RoundTripsAllTypes) {
+  BinaryWriter writer;
+  writer.writeU8(0xAB);
+  writer.writeU32(0xDEADBEEF);
+  writer.writeBool(true);
+  writer.writeBool(false);
+  writer.writeString("#channel");
+  writer.writeString(std::string("a\0b", 3));
+  writer.writeString("");
+
+  const std::string& data = writer.getData();
+  BinaryReader reader(data.data(), data.size());
+  EXPECT_EQ(reader.readU8(), 0xAB);
+  EXPECT_EQ(reader.readU32(), 0xDEADBEEFU);
+  EXPECT_TRUE(reader.readBool());
+  EXPECT_FALSE(reader.readBool());
+  EXPECT_EQ(reader.readString(), "#channel");
+  EXPECT_EQ(reader.readString(), std::string("a\0b", 3));
+  EXPECT_EQ(reader.readString(), "");
+  EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(BinaryCodecTest, U32IsLittleEndian) {
+  BinaryWriter writer;
+  writer.writeU32(0x01020304);
+  EXPECT_EQ(writer.getData(), std::string("\x04\x03\x02\x01", 4));
+}
+
+TEST(BinaryCodecTest, U64IsLittleEndian) {
+  BinaryWriter writer;
+  writer.writeU64(0x0102030405060708ULL);
+  EXPECT_EQ(writer.getData(),
+            std::string("\x08\x07\x06\x05\x04\x03\x02\x01", 8));
+  BinaryReader reader(writer.getData().data(), writer.getData().size());
+  EXPECT_EQ(reader.readU64(), 0x0102030405060708ULL);
+}
+
+TEST(BinaryCodecTest, TruncatedDataThrows) {
+  BinaryWriter writer;
+  writer.writeString("topic");
+  std::string data = writer.getData();
+
+  BinaryReader shortString(data.data(), data.size() - 1);
+  EXPECT_THROW(shortString.readString(), std::runtime_error);
+
+  BinaryReader shortInteger(data.data(), 3);
+  EXPECT_THROW(shortInteger.readU32(), std::runtime_error);
+
+  BinaryReader empty(data.data(), 0);
+  EXPECT_TRUE(empty.atEnd());
+  EXPECT_THROW(empty.readU8(), std::runtime_error);
+}
@@ -0,0 +1,111 @@
+#include "ByteScan.hpp"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils.hpp"
+
+// Every kernel level the CPU supports is compared with a plain reference
+class ByteScanTest : public ::testing::TestWithParam<ScanLevel> {
+ protected:
+  ScanLevel previous;
+
+  void SetUp() override {
+    previous = getScanLevel();
+    if (setScanLevel(GetParam()) != GetParam()) {
+      setScanLevel(previous);
+      GTEST_SKIP() << "CPU lacks " << getScanLevelName(GetParam());
+    }
+  }
+
+  void TearDown() override { setScanLevel(previous); }
+
+  // Random bytes biased towards the interesting ones
+  static std::string randomBuffer(size_t length, unsigned int* seed) {
+    static const char kBytes[] = {'\r', '\n', '\0', 'A', 'Z', '[', '^',
+                                  '~',  'a',  '@',  '`', '_', '\x04'};
+    std::string buffer(length, 'x');
+    for (size_t i = 0; i < length; ++i) {
+      int pick = rand_r(seed) % 40;
+      if (pick < static_cast<int>(sizeof(kBytes))) {
+        buffer[i] = kBytes[pick];
+      } else {
+        buffer[i] = static_cast<char>(rand_r(seed) % 256);
+      }
+    }
+    return buffer;
+  }
+};
+
+TEST_P(ByteScanTest, FindCrlfAtEveryOffset) {
+  // A single "\r\n" at every position of buffers spanning several vectors
+  for (size_t length = 0; length < 100; ++length) {
+    std::string buffer(length, 'x');
+    EXPECT_EQ(findCrlf(buffer.data(), length), length);
+    for (size_t pos = 0; pos + 1 < length; ++pos) {
+      buffer[pos] = '\r';
+      buffer[pos + 1] = '\n';
+      ASSERT_EQ(findCrlf(buffer.data(), length), pos) << length;
+      buffer[pos] = 'x';
+      buffer[pos + 1] = 'x';
+    }
+  }
+  // A lone '\r' or '\n' is not a line end, also across a vector boundary
+  std::string split(64, 'x');
+  split[31] = '\r';
+  split[33] = '\n';
+  EXPECT_EQ(findCrlf(split.data(), split.length()), split.length());
+  split[32] = '\n';
+  EXPECT_EQ(findCrlf(split.data(), split.length()), 31U);
+  EXPECT_EQ(findCrlf("\r", 1), 1U);
+}
+
+TEST_P(ByteScanTest, MatchesReferenceOnRandomBuffers) {
+  unsigned int seed = 42;
+  for (int round = 0; round < 2000; ++round) {
+    size_t length = rand_r(&seed) % 200;
+    std::string buffer = randomBuffer(length, &seed);
+    size_t offset = rand_r(&seed) % 8;  // Unaligned starts
+    if (offset > length) offset = length;
+    const char* data = buffer.data() + offset;
+    size_t size = length - offset;
+
+    size_t crlf = std::string(data, size).find("\r\n");
+    ASSERT_EQ(findCrlf(data, size), crlf == std::string::npos ? size : crlf);
+
+    size_t forbidden = std::string(data, size).find_first_of(
+        std::string("\r\n\0", 3));
+    ASSERT_EQ(findForbiddenByte(data, size),
+              forbidden == std::string::npos ? size : forbidden);
+
+    std::string folded(data, size);
+    std::string expected(data, size);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      expected[i] = ircToLower(expected[i]);
+    }
+    if (!folded.empty()) foldCase(&folded[0], folded.size());
+    ASSERT_EQ(folded, expected);
+  }
+}
+
+TEST_P(ByteScanTest, FoldCaseRfc1459) {
+  std::string text = "NICK[AWAY]\\^~ Mixed Case #CHANNEL-{x}|@`0123456789";
+  foldCase(&text[0], text.size());
+  EXPECT_EQ(text, "nick{away}|~~ mixed case #channel-{x}|@`0123456789");
+}
+
+INSTANTIATE_TEST_SUITE_P(Levels, ByteScanTest,
+                         ::testing::Values(SCAN_LEVEL_SCALAR, SCAN_LEVEL_SSE2,
+                                           SCAN_LEVEL_AVX2));
+
+TEST(RemoveByteTest, RemovesEveryOccurrence) {
+  char data[] = "\x04PRIV\x04MSG\x04\x04 #a\x04";
+  size_t length = removeByte(data, sizeof(data) - 1, '\x04');
+  EXPECT_EQ(std::string(data, length), "PRIVMSG #a");
+
+  char clean[] = "PING x";
+  EXPECT_EQ(removeByte(clean, 6, '\x04'), 6U);
+  EXPECT_EQ(removeByte(clean, 0, '\x04'), 0U);
+}
@@ -0,0 +1,94 @@
+#include "CaseMappedMap.hpp"
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "gtest/gtest.h"
+
+TEST(CaseMappedMapTest, FindsKeysCaseInsensitively) {
+  CaseMappedMap<int> map;
+  map.set("Alice[away]", 1);
+  map.set("#General", 2);
+
+  ASSERT_NE(map.find("alice{AWAY}"), static_cast<int*>(NULL));
+  EXPECT_EQ(*map.find("ALICE[away]"), 1);
+  EXPECT_EQ(*map.find("#general"), 2);
+  EXPECT_EQ(map.find("alice"), static_cast<int*>(NULL));
+  EXPECT_EQ(map.size(), 2U);
+}
+
+TEST(CaseMappedMapTest, SetReplacesAndKeepsFirstSpelling) {
+  CaseMappedMap<int> map;
+  map.set("Bob", 1);
+  map.set("BOB", 2);
+  EXPECT_EQ(map.size(), 1U);
+  EXPECT_EQ(*map.find("bob"), 2);
+  EXPECT_EQ(map.begin()->first, "Bob");
+}
+
+TEST(CaseMappedMapTest, EraseAndIterate) {
+  CaseMappedMap<int> map;
+  EXPECT_FALSE(map.erase("missing"));
+  EXPECT_TRUE(map.begin() == map.end());
+  map.set("a", 1);
+  map.set("b", 2);
+  map.set("c", 3);
+  EXPECT_TRUE(map.erase("B"));
+  EXPECT_FALSE(map.erase("b"));
+
+  int sum = 0;
+  for (CaseMappedMap<int>::const_iterator it = map.begin(); it != map.end();
+       ++it) {
+    sum += it->second;
+  }
+  EXPECT_EQ(sum, 4);
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.find("a"), static_cast<int*>(NULL));
+}
+
+TEST(CaseMappedMapTest, ResumesIterationFromSlot) {
+  CaseMappedMap<int> map;
+  for (int i = 0; i < 50; ++i) map.set("#chan" + std::to_string(i), i);
+
+  // Visit the table in pieces of 7 entries, resuming by slot
+  std::set<int> seen;
+  size_t slot = 0;
+  CaseMappedMap<int>::const_iterator it = map.from(slot);
+  while (it != map.end()) {
+    for (int n = 0; n < 7 && it != map.end(); ++n, ++it) {
+      EXPECT_TRUE(seen.insert(it->second).second);
+    }
+    slot = it.slot();
+    it = map.from(slot);
+  }
+  EXPECT_EQ(seen.size(), 50U);
+  EXPECT_TRUE(map.from(slot + 1000) == map.end());
+}
+
+// Random insert/erase churn against std::map keyed by the normalized name:
+// growth and backward-shift deletion must never lose an entry
+TEST(CaseMappedMapTest, MatchesReferenceUnderChurn) {
+  CaseMappedMap<int> map;
+  std::map<std::string, int> reference;
+  unsigned int seed = 12345;
+  for (int step = 0; step < 20000; ++step) {
+    seed = seed * 1103515245U + 12345U;
+    std::string key = "nick" + std::to_string((seed >> 8) % 300);
+    if ((seed >> 4) & 1) key[0] = 'N';
+    if ((seed >> 20) % 3 == 0) {
+      EXPECT_EQ(map.erase(key), reference.erase(normalizeNickname(key)) > 0);
+    } else {
+      map.set(key, step);
+      reference[normalizeNickname(key)] = step;
+    }
+  }
+  ASSERT_EQ(map.size(), reference.size());
+  for (std::map<std::string, int>::const_iterator it = reference.begin();
+       it != reference.end(); ++it) {
+    const int* value = map.find(it->first);
+    ASSERT_NE(value, static_cast<const int*>(NULL)) << it->first;
+    EXPECT_EQ(*value, it->second);
+  }
+}
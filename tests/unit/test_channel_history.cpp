@@ -0,0 +1,144 @@
+#include "ChannelHistory.hpp"
+
+#include <cstdio>
+#include <string>
+
+#include "HistoryStore.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+std::string msgidOf(int n) {
+  // Shortlex order, as MessageClock::nextMsgId() grows
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "id-%x", n);
+  return buffer;
+}
+}  // namespace
+
+TEST(ChannelHistoryTest, KeepsMessagesOldestFirst) {
+  ChannelHistory history("#chan");
+  EXPECT_TRUE(history.empty());
+  history.append(1000, "alice!a@host", msgidOf(1), "hello");
+  history.append(2000, "bob!b@host", msgidOf(2), "");
+  history.append(1500, "alice!a@host", msgidOf(3), "late clock");
+
+  ASSERT_EQ(history.size(), 3U);
+  HistoryMessage first = history.get(0);
+  EXPECT_EQ(first.time, 1000);
+  EXPECT_EQ(first.source, "alice!a@host");
+  EXPECT_EQ(first.msgid, msgidOf(1));
+  EXPECT_EQ(first.text, "hello");
+  EXPECT_EQ(history.get(1).text, "");
+  EXPECT_EQ(history.get(2).time, 2000);  // Never earlier than the last one
+  EXPECT_EQ(history.get(2).source, "alice!a@host");
+}
+
+TEST(ChannelHistoryTest, FindsByTimeAndMsgId) {
+  ChannelHistory history("#chan");
+  for (int i = 0; i < 300; ++i) {
+    history.append(1000 + (i / 2) * 10, "nick!u@h", msgidOf(i), "text");
+  }
+
+  EXPECT_EQ(history.lowerBound(0), 0U);
+  EXPECT_EQ(history.lowerBound(1010), 2U);
+  EXPECT_EQ(history.upperBound(1010), 4U);
+  EXPECT_EQ(history.lowerBound(1015), 4U);
+  EXPECT_EQ(history.upperBound(1015), 4U);
+  EXPECT_EQ(history.upperBound(1000000), 300U);
+
+  EXPECT_EQ(history.find(msgidOf(0)), 0U);
+  EXPECT_EQ(history.find(msgidOf(15)), 15U);   // "id-f"
+  EXPECT_EQ(history.find(msgidOf(16)), 16U);   // "id-10", longer
+  EXPECT_EQ(history.find(msgidOf(299)), 299U);
+  EXPECT_EQ(history.find(msgidOf(300)), 300U);
+  EXPECT_EQ(history.find("id-"), 300U);
+}
+
+TEST(ChannelHistoryTest, EvictionReturnsWhatAppendTook) {
+  ChannelHistory history("#chan");
+  size_t first = history.append(1, "alice!a@host", msgidOf(1), "one");
+  size_t second = history.append(2, "alice!a@host", msgidOf(2), "two");
+  size_t third = history.append(3, "bob!b@host", msgidOf(3), "three");
+  EXPECT_GT(first, second);  // The source was interned once
+  EXPECT_EQ(history.getBytes(), first + second + third);
+
+  EXPECT_EQ(history.evictOldest(), second);  // alice is still referenced
+  EXPECT_EQ(history.get(0).text, "two");
+  EXPECT_EQ(history.evictOldest(), first);
+  EXPECT_EQ(history.get(0).source, "bob!b@host");
+  EXPECT_EQ(history.get(0).text, "three");
+  EXPECT_EQ(history.evictOldest(), third);
+  EXPECT_TRUE(history.empty());
+  EXPECT_EQ(history.getBytes(), 0U);
+}
+
+TEST(ChannelHistoryTest, SurvivesManyEvictions) {
+  ChannelHistory history("#chan");
+  for (int i = 0; i < 5000; ++i) {
+    history.append(i, i % 2 ? "odd!o@h" : "even!e@h", msgidOf(i),
+                   std::string(i % 50, 'x'));
+    if (history.size() > 100) history.evictOldest();
+  }
+  ASSERT_EQ(history.size(), 100U);
+  for (size_t i = 0; i < history.size(); ++i) {
+    int n = 4900 + static_cast<int>(i);
+    HistoryMessage message = history.get(i);
+    EXPECT_EQ(message.time, n);
+    EXPECT_EQ(message.source, n % 2 ? "odd!o@h" : "even!e@h");
+    EXPECT_EQ(message.msgid, msgidOf(n));
+    EXPECT_EQ(message.text, std::string(n % 50, 'x'));
+  }
+  EXPECT_EQ(history.find(msgidOf(4950)), 50U);
+}
+
+TEST(HistoryStoreTest, KeepsAtMostMaxMessagesPerChannel) {
+  HistoryStore store;
+  store.setLimits(1 << 20, 3);
+  for (int i = 0; i < 5; ++i) {
+    store.record("#Chan", i, "nick!u@h", msgidOf(i), "text");
+  }
+  const ChannelHistory* history = store.find("#chan");
+  ASSERT_NE(history, nullptr);
+  EXPECT_EQ(history->getChannel(), "#Chan");
+  ASSERT_EQ(history->size(), 3U);
+  EXPECT_EQ(history->get(0).time, 2);
+  EXPECT_EQ(store.getBytes(), history->getBytes());
+  EXPECT_EQ(store.find("#other"), nullptr);
+}
+
+TEST(HistoryStoreTest, EvictsTheOldestMessageOfAllChannels) {
+  HistoryStore store;
+  ChannelHistory sample("#sample");
+  size_t first = sample.append(0, "n!u@h", msgidOf(0), "text");
+  size_t next = sample.append(0, "n!u@h", msgidOf(1), "text");
+  size_t limit = 2 * first + next - 1;  // One message short of 3 of them
+  store.setLimits(limit, 1000);
+
+  store.record("#old", 1, "n!u@h", msgidOf(1), "text");
+  store.record("#new", 2, "n!u@h", msgidOf(2), "text");
+  store.record("#new", 3, "n!u@h", msgidOf(3), "text");
+  EXPECT_EQ(store.find("#old"), nullptr);  // Emptied, then deleted
+  ASSERT_NE(store.find("#new"), nullptr);
+  EXPECT_EQ(store.find("#new")->size(), 2U);
+  EXPECT_LE(store.getBytes(), limit);
+
+  store.record("#old", 4, "n!u@h", msgidOf(4), "text");
+  EXPECT_EQ(store.find("#new")->size(), 1U);
+  EXPECT_EQ(store.find("#new")->get(0).time, 3);
+  EXPECT_EQ(store.find("#old")->size(), 1U);
+}
+
+TEST(HistoryStoreTest, ZeroLimitDisablesIt) {
+  HistoryStore store;
+  EXPECT_FALSE(store.isEnabled());
+  store.record("#chan", 1, "n!u@h", msgidOf(1), "text");
+  EXPECT_EQ(store.find("#chan"), nullptr);
+
+  store.setLimits(1 << 20, 1000);
+  store.record("#chan", 1, "n!u@h", msgidOf(1), "text");
+  EXPECT_NE(store.find("#chan"), nullptr);
+  store.setLimits(0, 1000);
+  EXPECT_FALSE(store.isEnabled());
+  EXPECT_EQ(store.find("#chan"), nullptr);
+  EXPECT_EQ(store.getBytes(), 0U);
+}
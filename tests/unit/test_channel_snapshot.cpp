@@ -0,0 +1,166 @@
+#include "ChannelSnapshot.hpp"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "BinaryCodec.hpp"
+#include "ChannelManager.hpp"
+#include "UserManager.hpp"
+#include "gtest/gtest.h"
+
+class ChannelSnapshotTest : public ::testing::Test {
+ protected:
+  std::string dir;
+  std::string path;
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/ircserv_snapshot_XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    dir = tmpl;
+    path = dir + "/channels.snap";
+  }
+
+  void TearDown() override {
+    unlink(path.c_str());
+    rmdir(dir.c_str());
+  }
+
+  User* addUser(UserManager& users, const std::string& nickname) {
+    User* user = new User(open("/dev/null", O_RDONLY), "127.0.0.1");
+    users.addUser(user);
+    users.updateNickname(user, "", nickname);
+    return user;
+  }
+};
+
+TEST_F(ChannelSnapshotTest, RoundTripsChannelConfiguration) {
+  UserManager users;
+  ChannelManager channels;
+  User* alice = addUser(users, "Alice");
+  User* bob = addUser(users, "bob");
+
+  Channel* config = channels.createChannel("#Config");
+  config->setTopic("release on friday");
+  config->setKey("secret");
+  config->setInviteOnly(true);
+  config->setTopicRestricted(true);
+  config->setUserLimit(10);
+  config->addMember(alice->getSocketFd());
+  config->addMember(bob->getSocketFd());
+  config->addOperator(alice->getSocketFd());
+  channels.createChannel("#plain");
+
+  ChannelSnapshot::write(path, ChannelSnapshot::encode(channels));
+
+  ChannelManager restored;
+  EXPECT_EQ(ChannelSnapshot::restore(path, restored), 2U);
+  Channel* channel = restored.getChannel("#config");
+  ASSERT_NE(channel, nullptr);
+  EXPECT_EQ(channel->getName(), "#Config");
+  EXPECT_EQ(channel->getTopic(), "release on friday");
+  EXPECT_EQ(channel->getKey(), "secret");
+  EXPECT_TRUE(channel->isInviteOnly());
+  EXPECT_TRUE(channel->isTopicRestricted());
+  EXPECT_TRUE(channel->hasUserLimit());
+  EXPECT_EQ(channel->getUserLimit(), 10U);
+  EXPECT_EQ(channel->getMemberCount(), 0U);
+  EXPECT_TRUE(channel->getOperators().empty());
+
+  Channel* plain = restored.getChannel("#plain");
+  ASSERT_NE(plain, nullptr);
+  EXPECT_FALSE(plain->isInviteOnly());
+  EXPECT_FALSE(plain->hasUserLimit());
+  EXPECT_TRUE(plain->getKey().empty());
+}
+
+TEST_F(ChannelSnapshotTest, MissingFileRestoresNothing) {
+  ChannelManager channels;
+  EXPECT_EQ(ChannelSnapshot::restore(path, channels), 0U);
+  EXPECT_TRUE(channels.getChannels().empty());
+}
+
+TEST_F(ChannelSnapshotTest, WriteReplacesFileAtomically) {
+  ChannelManager channels;
+  channels.createChannel("#first");
+  ChannelSnapshot::write(path, ChannelSnapshot::encode(channels));
+  channels.removeChannel("#first");
+  channels.createChannel("#second");
+  ChannelSnapshot::write(path, ChannelSnapshot::encode(channels));
+
+  ChannelManager restored;
+  EXPECT_EQ(ChannelSnapshot::restore(path, restored), 1U);
+  EXPECT_TRUE(restored.channelExists("#second"));
+  // Only the snapshot itself is left: no temporary file
+  unlink(path.c_str());
+  EXPECT_EQ(rmdir(dir.c_str()), 0);
+}
+
+TEST_F(ChannelSnapshotTest, MalformedFileThrows) {
+  ChannelManager channels;
+  channels.createChannel("#channel");
+  std::string data = ChannelSnapshot::encode(channels);
+
+  std::ofstream(path.c_str()) << data.substr(0, data.size() - 3);
+  ChannelManager truncated;
+  EXPECT_THROW(ChannelSnapshot::restore(path, truncated), std::runtime_error);
+
+  std::ofstream(path.c_str()) << "not a snapshot";
+  ChannelManager foreign;
+  EXPECT_THROW(ChannelSnapshot::restore(path, foreign), std::runtime_error);
+}
+
+TEST_F(ChannelSnapshotTest, RoundTripsMaskLists) {
+  ChannelManager channels;
+  Channel* channel = channels.createChannel("#masks");
+  channel->addMask(MASK_LIST_BAN, "*!*@10.0.0.*", "alice", 1700000000);
+  channel->addMask(MASK_LIST_BAN, "spammer", "alice", 1700000001);
+  channel->addMask(MASK_LIST_EXCEPTION, "*!friend@*", "bob", 1700000002);
+  channel->addMask(MASK_LIST_INVITE_EXCEPTION, "*!*@trusted", "bob",
+                   1700000003);
+  ChannelSnapshot::write(path, ChannelSnapshot::encode(channels));
+
+  ChannelManager restored;
+  ASSERT_EQ(ChannelSnapshot::restore(path, restored), 1U);
+  Channel* copy = restored.getChannel("#masks");
+  ASSERT_NE(copy, nullptr);
+  const std::vector<MaskEntry>& bans = copy->getMasks(MASK_LIST_BAN);
+  ASSERT_EQ(bans.size(), 2U);
+  EXPECT_EQ(bans[0].mask.getMask(), "*!*@10.0.0.*");
+  EXPECT_EQ(bans[1].mask.getMask(), "spammer!*@*");
+  EXPECT_EQ(bans[1].setBy, "alice");
+  EXPECT_EQ(bans[1].setAt, 1700000001);
+  ASSERT_EQ(copy->getMasks(MASK_LIST_EXCEPTION).size(), 1U);
+  EXPECT_EQ(copy->getMasks(MASK_LIST_INVITE_EXCEPTION)[0].setBy, "bob");
+}
+
+// Snapshots written before the mask lists existed
+TEST_F(ChannelSnapshotTest, ReadsVersion1Files) {
+  BinaryWriter writer;
+  writer.writeU32(0x53435249);
+  writer.writeU32(1);
+  writer.writeU32(1);
+  writer.writeString("#old");
+  writer.writeString("topic");
+  writer.writeString("");
+  writer.writeBool(false);
+  writer.writeBool(true);
+  writer.writeBool(false);
+  writer.writeU32(0);
+  writer.writeU32(1);
+  writer.writeString("alice");
+  std::ofstream(path.c_str()) << writer.getData();
+
+  ChannelManager restored;
+  ASSERT_EQ(ChannelSnapshot::restore(path, restored), 1U);
+  Channel* channel = restored.getChannel("#old");
+  ASSERT_NE(channel, nullptr);
+  EXPECT_EQ(channel->getTopic(), "topic");
+  EXPECT_TRUE(channel->getOperators().empty());  // Nicknames are skipped
+  EXPECT_TRUE(channel->getMasks(MASK_LIST_BAN).empty());
+}
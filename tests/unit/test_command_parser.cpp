@@ -357,3 +357,102 @@ TEST_F(CommandParserTest, ColonInRegularParam) {
   ASSERT_EQ(cmd.params.size(), static_cast<size_t>(1));
   EXPECT_EQ(cmd.params[0], "param:with:colons");
 }
+
+// ==========================================
+// Result codes (parse)
+// ==========================================
+
+TEST_F(CommandParserTest, ParseReturnsResultCodes) {
+  Command cmd;
+  EXPECT_EQ(parser.parse("PRIVMSG #chan :hi", cmd), PARSE_OK);
+  EXPECT_EQ(cmd.command, "PRIVMSG");
+
+  struct {
+    const char* message;
+    ParseResult expected;
+  } cases[] = {{"", PARSE_ERROR_EMPTY},
+               {" NICK a", PARSE_ERROR_LEADING_SPACE},
+               {": NICK a", PARSE_ERROR_EMPTY_PREFIX},
+               {":prefix", PARSE_ERROR_PREFIX_ONLY},
+               {":prefix   ", PARSE_ERROR_NO_COMMAND},
+               {"NI-CK a", PARSE_ERROR_BAD_COMMAND},
+               {"C 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16",
+                PARSE_ERROR_TOO_MANY_PARAMS},
+               {"PRIVMSG #a :x\ry", PARSE_ERROR_CR},
+               {"PRIVMSG #a :x\ny", PARSE_ERROR_LF}};
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    Command partial;
+    EXPECT_EQ(parser.parse(cases[i].message, partial), cases[i].expected)
+        << cases[i].message;
+  }
+  Command partial;
+  EXPECT_EQ(parser.parse(std::string(511, 'A'), partial),
+            PARSE_ERROR_TOO_LONG);
+  EXPECT_EQ(parser.parse(std::string("PRIVMSG #a :x\0y", 15), partial),
+            PARSE_ERROR_NUL);
+}
+
+TEST_F(CommandParserTest, ParseCommandThrowsDescription) {
+  try {
+    parser.parseCommand("NI-CK alice");
+    FAIL() << "Expected std::runtime_error";
+  } catch (const std::runtime_error& e) {
+    EXPECT_STREQ(e.what(),
+                 CommandParser::getErrorMessage(PARSE_ERROR_BAD_COMMAND));
+  }
+}
+
+// ==========================================
+// IRCv3 message tags
+// ==========================================
+
+TEST_F(CommandParserTest, ParsesTagsAsSpansOfTheLine) {
+  std::string message =
+      "@+draft/typing=active;time=2026-01-01T00:00:00Z;+flag;"
+      "+msg=a\\sb\\:c\\\\ :nick PRIVMSG #a :hi";
+  Command cmd;
+  ASSERT_EQ(parser.parse(message, cmd), PARSE_OK);
+  EXPECT_EQ(cmd.prefix, "nick");
+  EXPECT_EQ(cmd.command, "PRIVMSG");
+  ASSERT_EQ(cmd.tags.size(), 4U);
+  EXPECT_EQ(cmd.tags[0].key, message.data() + 1);
+  EXPECT_EQ(std::string(cmd.tags[0].key, cmd.tags[0].keyLength),
+            "+draft/typing");
+  EXPECT_EQ(std::string(cmd.tags[0].value, cmd.tags[0].valueLength),
+            "active");
+  EXPECT_EQ(cmd.tags[2].valueLength, 0U);
+
+  const MessageTag* tag = CommandParser::findTag(cmd, "+msg");
+  ASSERT_NE(tag, nullptr);
+  EXPECT_EQ(CommandParser::unescapeTagValue(*tag), "a b;c\\");
+  EXPECT_EQ(CommandParser::findTag(cmd, "+draft"), nullptr);
+  EXPECT_EQ(CommandParser::getClientTags(cmd),
+            "+draft/typing=active;+flag;+msg=a\\sb\\:c\\\\");
+}
+
+TEST_F(CommandParserTest, TagBudgetIsSeparateFromTheMessage) {
+  // 8191 bytes of tags, '@' and space included, then a full 510 bytes
+  std::string tags = "@+a=" + std::string(8191 - 5, 'x') + " ";
+  std::string rest = "PRIVMSG #a :" + std::string(510 - 12, 'y');
+  Command cmd;
+  EXPECT_EQ(parser.parse(tags + rest, cmd), PARSE_OK);
+  Command tooLong;
+  EXPECT_EQ(parser.parse("@+a=x" + tags.substr(4) + rest, tooLong),
+            PARSE_ERROR_TAGS_TOO_LONG);
+  Command longRest;
+  EXPECT_EQ(parser.parse(tags + rest + "y", longRest), PARSE_ERROR_TOO_LONG);
+}
+
+TEST_F(CommandParserTest, RejectsMalformedTags) {
+  const char* cases[] = {"@ PING a", "@=v PING a", "@+ PING a",
+                         "@a b=c PING a", "@vendor/ PING a", "@a;;b=\x01 X"};
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    Command cmd;
+    ParseResult result = parser.parse(cases[i], cmd);
+    EXPECT_NE(result, PARSE_OK) << cases[i];
+  }
+  Command cmd;
+  EXPECT_EQ(parser.parse("@a=b", cmd), PARSE_ERROR_NO_COMMAND);
+  EXPECT_EQ(parser.parse(std::string("@a=\0 PING", 9), cmd),
+            PARSE_ERROR_BAD_TAG);
+}
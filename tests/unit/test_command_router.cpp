@@ -0,0 +1,106 @@
+#include "CommandRouter.hpp"
+
+#include <fcntl.h>
+
+#include <iostream>
+#include <string>
+
+#include "ChannelManager.hpp"
+#include "EventLoop.hpp"
+#include "UserManager.hpp"
+#include "gtest/gtest.h"
+
+class CommandRouterTest : public ::testing::Test {
+ protected:
+  UserManager users;
+  ChannelManager channels;
+  EventLoop loop;
+  CommandRouter router;
+
+  CommandRouterTest() : router(&users, &channels, &loop, "test") {}
+
+  void SetUp() override { std::cout.setstate(std::ios::failbit); }
+  void TearDown() override { std::cout.clear(); }
+
+  User* registerUser(const std::string& nickname) {
+    User* user = new User(open("/dev/null", O_RDONLY), "127.0.0.1");
+    users.addUser(user);
+    router.processMessage(user, "PASS test");
+    router.processMessage(user, "NICK " + nickname);
+    router.processMessage(user, "USER " + nickname + " 0 * :Router Test");
+    user->getWriteBuffer().clear();
+    return user;
+  }
+
+  // All of user's output, continuing paused replies as Server does once
+  // the write buffer was sent
+  std::string drain(User* user) {
+    std::string output;
+    std::string& out = user->getWriteBuffer();
+    while (!out.empty()) {
+      output += out;
+      out.clear();
+      router.continueReply(user);
+    }
+    return output;
+  }
+
+  static size_t countReplies(const std::string& output,
+                             const std::string& numeric) {
+    size_t count = 0;
+    std::string needle = " " + numeric + " ";
+    for (size_t pos = output.find(needle); pos != std::string::npos;
+         pos = output.find(needle, pos + 1)) {
+      ++count;
+    }
+    return count;
+  }
+};
+
+TEST_F(CommandRouterTest, ListReplacedWhilePausedStillEnds) {
+  User* user = registerUser("lister");
+  // Well over the 8 KiB at which a LIST pauses
+  for (int i = 0; i < 200; ++i) {
+    Channel* channel = channels.createChannel("#c" + std::to_string(i));
+    channel->setTopic(std::string(100, 't'));
+  }
+
+  router.processMessage(user, "LIST");
+  ASSERT_NE(user->getReplyCursor(), nullptr);  // Paused
+  router.processMessage(user, "LIST");
+  std::string output = drain(user);
+  EXPECT_EQ(countReplies(output, "321"), 2U);
+  EXPECT_EQ(countReplies(output, "323"), 2U);
+  EXPECT_EQ(user->getReplyCursor(), nullptr);
+
+  // A WHO ends the paused LIST too
+  router.processMessage(user, "LIST");
+  router.processMessage(user, "WHO lister");
+  output = drain(user);
+  EXPECT_EQ(countReplies(output, "323"), 1U);
+  EXPECT_EQ(countReplies(output, "315"), 1U);
+}
+
+TEST_F(CommandRouterTest, EmptyWhoMaskListsEverybody) {
+  User* user = registerUser("asker");
+  registerUser("other");
+
+  router.processMessage(user, "WHO :");
+  std::string output = drain(user);
+  EXPECT_EQ(countReplies(output, "352"), 2U);
+  EXPECT_NE(output.find(" 315 asker * :"), std::string::npos);
+}
+
+TEST_F(CommandRouterTest, PrivmsgSendsOnceToEachTarget) {
+  User* sender = registerUser("sender");
+  User* member = registerUser("member");
+  router.processMessage(sender, "JOIN #a");
+  router.processMessage(member, "JOIN #a");
+  drain(sender);
+  drain(member);
+
+  router.processMessage(sender, "PRIVMSG #a,#A,#a,member,MEMBER :x");
+  std::string output = drain(member);
+  EXPECT_EQ(countReplies(output, "PRIVMSG"), 2U);  // #a and member
+  EXPECT_EQ(drain(sender), "");
+}
@@ -0,0 +1,177 @@
+#include "ConnectionManager.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "Metrics.hpp"
+#include "User.hpp"
+#include "gtest/gtest.h"
+
+// ==========================================
+// Accept path
+// ==========================================
+
+class ConnectionManagerAcceptTest : public ::testing::Test {
+ protected:
+  Metrics metrics;
+  ConnectionManager connManager{&metrics};
+  int listenFd = -1;
+  struct sockaddr_in address;
+
+  void SetUp() override {
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    ASSERT_GE(listenFd, 0);
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;  // Any free port
+    socklen_t len = sizeof(address);
+    ASSERT_EQ(bind(listenFd, reinterpret_cast<struct sockaddr*>(&address),
+                   sizeof(address)),
+              0);
+    ASSERT_EQ(listen(listenFd, 8), 0);
+    ASSERT_EQ(getsockname(listenFd, reinterpret_cast<struct sockaddr*>(&address),
+                          &len),
+              0);
+  }
+
+  void TearDown() override { close(listenFd); }
+
+  int connectClient() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_EQ(connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                      sizeof(address)),
+              0);
+    return fd;
+  }
+};
+
+TEST_F(ConnectionManagerAcceptTest, AcceptedSocketIsNonBlockingAndCloexec) {
+  int client = connectClient();
+  User* user = connManager.acceptConnection(listenFd);
+  ASSERT_NE(user, nullptr);
+  EXPECT_EQ(user->getIp(), "127.0.0.1");
+  EXPECT_TRUE(fcntl(user->getSocketFd(), F_GETFL) & O_NONBLOCK);
+  EXPECT_TRUE(fcntl(user->getSocketFd(), F_GETFD) & FD_CLOEXEC);
+  // One accept4() call, no fcntl()
+  EXPECT_EQ(metrics.getCounter(METRIC_SYSCALLS), 1UL);
+  delete user;
+  close(client);
+}
+
+TEST_F(ConnectionManagerAcceptTest, ReturnsNullWhenNoConnectionIsPending) {
+  EXPECT_EQ(connManager.acceptConnection(listenFd), nullptr);
+}
+
+// ==========================================
+// Batched send
+// ==========================================
+
+TEST(ConnectionManagerSendBatchTest, CompletesAndErasesSentData) {
+  Metrics metrics;
+  ConnectionManager connManager(&metrics);
+  EventLoop loop;
+  loop.create();
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+  User* user = new User(fds[0], "127.0.0.1");
+  user->getWriteBuffer() = "PING :x\r\n";
+  std::vector<User*> users(1, user);
+  std::vector<SendResult> results;
+  connManager.sendBatch(loop, users, results);
+
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(results[0], SEND_COMPLETE);
+  EXPECT_TRUE(user->getWriteBuffer().empty());
+  EXPECT_EQ(metrics.getCounter(METRIC_BYTES_SENT), 9UL);
+  delete user;  // Closes fds[0]
+  close(fds[1]);
+}
+
+TEST(ConnectionManagerSendBatchTest, FullSocketBufferKeepsRemainder) {
+  Metrics metrics;
+  ConnectionManager connManager(&metrics);
+  EventLoop loop;
+  loop.create();
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+
+  User* user = new User(fds[0], "127.0.0.1");
+  user->getWriteBuffer() = std::string(4 * 1024 * 1024, 'x');
+  std::vector<User*> users(1, user);
+  std::vector<SendResult> results;
+  connManager.sendBatch(loop, users, results);
+
+  EXPECT_EQ(results[0], SEND_SUCCESS);
+  EXPECT_FALSE(user->getWriteBuffer().empty());
+  delete user;
+  close(fds[1]);
+}
+
+// ==========================================
+// Receive path
+// ==========================================
+
+// Pipelined lines, a "\r\n" split across two reads, Ctrl-D and empty lines
+TEST(ConnectionManagerReceiveTest, FramesPipelinedAndSplitLines) {
+  Metrics metrics;
+  ConnectionManager connManager(&metrics);
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  User* user = new User(fds[0], "127.0.0.1");
+  std::vector<std::string> messages;
+
+  std::string first = "PING a\r\n\r\nPRIV\x04MSG #c :x\r\nPART #c\r";
+  ASSERT_EQ(write(fds[1], first.data(), first.size()),
+            static_cast<ssize_t>(first.size()));
+  EXPECT_EQ(connManager.receiveData(user, messages), RECV_SUCCESS);
+  ASSERT_EQ(messages.size(), 2U);
+  EXPECT_EQ(messages[0], "PING a");
+  EXPECT_EQ(messages[1], "PRIVMSG #c :x");
+  EXPECT_EQ(user->getReadBuffer(), "PART #c\r");
+
+  ASSERT_EQ(write(fds[1], "\nQUIT", 5), 5);
+  messages.clear();
+  EXPECT_EQ(connManager.receiveData(user, messages), RECV_SUCCESS);
+  ASSERT_EQ(messages.size(), 1U);
+  EXPECT_EQ(messages[0], "PART #c");
+  EXPECT_EQ(user->getReadBuffer(), "QUIT");
+  delete user;
+  close(fds[1]);
+}
+
+// A tagged line may reach MAX_BUFFER_SIZE, an incomplete one that long
+// cannot end within it anymore
+TEST(ConnectionManagerReceiveTest, LimitsTheIncompleteLine) {
+  Metrics metrics;
+  ConnectionManager connManager(&metrics);
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  User* user = new User(fds[0], "127.0.0.1");
+  std::vector<std::string> messages;
+
+  std::string line = "@+x=" + std::string(MAX_BUFFER_SIZE - 11, 'a') +
+                     " PING\r\n";
+  ASSERT_EQ(line.size(), static_cast<size_t>(MAX_BUFFER_SIZE));
+  ASSERT_EQ(write(fds[1], line.data(), line.size()),
+            static_cast<ssize_t>(line.size()));
+  EXPECT_EQ(connManager.receiveData(user, messages), RECV_SUCCESS);
+  ASSERT_EQ(messages.size(), 1U);
+  EXPECT_EQ(messages[0].size(), line.size() - 2);
+
+  line.replace(line.size() - 2, 2, "GG");
+  ASSERT_EQ(write(fds[1], line.data(), line.size()),
+            static_cast<ssize_t>(line.size()));
+  EXPECT_EQ(connManager.receiveData(user, messages), RECV_ERROR);
+  delete user;
+  close(fds[1]);
+}
@@ -0,0 +1,160 @@
+#include "EventLoop.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// ==========================================
+// Both backends behind the same interface
+// ==========================================
+
+class EventLoopTest : public ::testing::TestWithParam<EventBackend> {
+ protected:
+  EventLoop loop;
+  int fds[2];
+
+  void SetUp() override {
+    try {
+      loop.create(GetParam());
+    } catch (const std::runtime_error& e) {
+      GTEST_SKIP() << "Backend unavailable: " << e.what();
+    }
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+  }
+
+  void TearDown() override {
+    if (IsSkipped()) return;
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  // Wait until an event for fd arrives, merging duplicates
+  uint32_t waitFor(int fd, int timeout = 1000) {
+    struct epoll_event events[8];
+    uint32_t mask = 0;
+    int n = loop.wait(events, 8, timeout);
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.fd == fd) mask |= events[i].events;
+    }
+    return mask;
+  }
+};
+
+TEST_P(EventLoopTest, ReportsReadableFd) {
+  loop.addFd(fds[0], EPOLLIN);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  EXPECT_TRUE(waitFor(fds[0]) & EPOLLIN);
+}
+
+TEST_P(EventLoopTest, TimesOutWithoutEvents) {
+  loop.addFd(fds[0], EPOLLIN);
+  EXPECT_EQ(waitFor(fds[0], 10), 0U);
+}
+
+TEST_P(EventLoopTest, ModifyReportsCurrentWritability) {
+  loop.addFd(fds[0], EPOLLIN);
+  EXPECT_EQ(waitFor(fds[0], 10), 0U);
+  loop.modifyFd(fds[0], EPOLLIN | EPOLLOUT);
+  EXPECT_TRUE(waitFor(fds[0]) & EPOLLOUT);
+}
+
+TEST_P(EventLoopTest, EdgeTriggeredReportsNewDataAgain) {
+  loop.addFd(fds[0], EPOLLIN);
+  ASSERT_EQ(write(fds[1], "a", 1), 1);
+  EXPECT_TRUE(waitFor(fds[0]) & EPOLLIN);
+  ASSERT_EQ(write(fds[1], "b", 1), 1);
+  EXPECT_TRUE(waitFor(fds[0]) & EPOLLIN);
+}
+
+TEST_P(EventLoopTest, RemovedFdIsSilent) {
+  loop.addFd(fds[0], EPOLLIN);
+  loop.removeFd(fds[0]);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  EXPECT_EQ(waitFor(fds[0], 10), 0U);
+}
+
+TEST_P(EventLoopTest, AddingFdTwiceThrows) {
+  loop.addFd(fds[0], EPOLLIN);
+  EXPECT_THROW(loop.addFd(fds[0], EPOLLIN), std::runtime_error);
+}
+
+TEST_P(EventLoopTest, SendBatchReportsBytesAndErrors) {
+  std::string data = "PING :batch\r\n";
+  SendRequest requests[2];
+  requests[0].fd = fds[0];
+  requests[0].data = data.data();
+  requests[0].length = data.size();
+  requests[1].fd = -1;  // Invalid descriptor
+  requests[1].data = data.data();
+  requests[1].length = data.size();
+  loop.sendBatch(requests, 2);
+
+  EXPECT_EQ(requests[0].result, static_cast<ssize_t>(data.size()));
+  EXPECT_EQ(requests[1].result, -EBADF);
+  char buf[64];
+  EXPECT_EQ(read(fds[1], buf, sizeof(buf)),
+            static_cast<ssize_t>(data.size()));
+}
+
+TEST_P(EventLoopTest, SendBatchReportsFullSocketBuffer) {
+  std::string chunk(65536, 'x');
+  SendRequest request;
+  request.fd = fds[0];
+  request.data = chunk.data();
+  request.length = chunk.size();
+  do {
+    loop.sendBatch(&request, 1);
+  } while (request.result > 0);
+  EXPECT_EQ(request.result, -EAGAIN);
+}
+
+TEST_P(EventLoopTest, PollEventsSurviveSendBatch) {
+  // Completions drained while waiting for the sends are kept for wait()
+  loop.addFd(fds[0], EPOLLIN);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  std::string data = "a";
+  SendRequest request;
+  request.fd = fds[0];
+  request.data = data.data();
+  request.length = data.size();
+  loop.sendBatch(&request, 1);
+  EXPECT_TRUE(waitFor(fds[0]) & EPOLLIN);
+}
+
+TEST_P(EventLoopTest, CountsSystemCalls) {
+  loop.takeSyscallCount();
+  loop.addFd(fds[0], EPOLLIN);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  waitFor(fds[0]);
+  // epoll: epoll_ctl + epoll_wait, io_uring: one io_uring_enter
+  unsigned long expected = GetParam() == EVENT_BACKEND_EPOLL ? 2UL : 1UL;
+  EXPECT_EQ(loop.takeSyscallCount(), expected);
+  EXPECT_EQ(loop.takeSyscallCount(), 0UL);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, EventLoopTest,
+                         ::testing::Values(EVENT_BACKEND_EPOLL,
+                                           EVENT_BACKEND_IO_URING));
+
+// ==========================================
+// Deferred write requests
+// ==========================================
+
+TEST(EventLoopWriteRequestTest, TakeReturnsRequestsInOrderAndClears) {
+  EventLoop loop;
+  loop.requestWrite(7);
+  loop.requestWrite(5);
+  std::vector<int> fds;
+  loop.takeWriteRequests(fds);
+  ASSERT_EQ(fds.size(), 2U);
+  EXPECT_EQ(fds[0], 7);
+  EXPECT_EQ(fds[1], 5);
+  loop.takeWriteRequests(fds);
+  EXPECT_TRUE(fds.empty());
+}
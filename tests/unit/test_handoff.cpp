@@ -0,0 +1,83 @@
+#include "Handoff.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+class HandoffTest : public ::testing::Test {
+ protected:
+  int sv[2] = {-1, -1};
+
+  void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv), 0);
+  }
+
+  void TearDown() override {
+    if (sv[0] >= 0) close(sv[0]);
+    if (sv[1] >= 0) close(sv[1]);
+  }
+};
+
+TEST_F(HandoffTest, TransfersStateAndDescriptorsInOrder) {
+  int pipeFds[2];
+  ASSERT_EQ(pipe(pipeFds), 0);
+
+  // More than one SCM_RIGHTS message worth of descriptors, alternating
+  // between the two pipe ends to check the order
+  std::vector<int> sent;
+  for (size_t i = 0; i < Handoff::kMaxFdsPerMessage + 50; ++i) {
+    sent.push_back(dup(pipeFds[i % 2]));
+    ASSERT_GE(sent.back(), 0);
+  }
+  // Larger than the socket buffer: the receiver must run concurrently
+  std::string state(1 << 20, 'x');
+  state[12345] = '\0';
+
+  std::thread sender([&] { Handoff::send(sv[0], state, sent); });
+  std::string receivedState;
+  std::vector<int> received;
+  Handoff::receive(sv[1], receivedState, received);
+  sender.join();
+
+  EXPECT_EQ(receivedState, state);
+  ASSERT_EQ(received.size(), sent.size());
+  struct stat pipeStat;
+  ASSERT_EQ(fstat(pipeFds[0], &pipeStat), 0);
+  for (size_t i = 0; i < received.size(); ++i) {
+    struct stat st;
+    ASSERT_EQ(fstat(received[i], &st), 0);
+    // Both ends share the inode, the access mode tells them apart
+    EXPECT_EQ(st.st_ino, pipeStat.st_ino);
+    EXPECT_EQ(fcntl(received[i], F_GETFL) & O_ACCMODE,
+              i % 2 ? O_WRONLY : O_RDONLY);
+    EXPECT_TRUE(fcntl(received[i], F_GETFD) & FD_CLOEXEC);
+  }
+
+  for (size_t i = 0; i < sent.size(); ++i) close(sent[i]);
+  for (size_t i = 0; i < received.size(); ++i) close(received[i]);
+  close(pipeFds[0]);
+  close(pipeFds[1]);
+}
+
+TEST_F(HandoffTest, PeerClosedThrows) {
+  close(sv[0]);
+  sv[0] = -1;
+  std::string state;
+  std::vector<int> fds;
+  EXPECT_THROW(Handoff::receive(sv[1], state, fds), std::runtime_error);
+}
+
+TEST_F(HandoffTest, BadMagicThrows) {
+  ASSERT_EQ(write(sv[0], "NICK foo\r\n\0\0", 12), 12);
+  std::string state;
+  std::vector<int> fds;
+  EXPECT_THROW(Handoff::receive(sv[1], state, fds), std::runtime_error);
+}
@@ -0,0 +1,262 @@
+#include "HistoryLog.hpp"
+
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+std::string msgidOf(int n) {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "id-%x", n);
+  return buffer;
+}
+
+std::vector<std::string> texts(const std::vector<HistoryMessage>& messages) {
+  std::vector<std::string> result;
+  for (size_t i = 0; i < messages.size(); ++i) {
+    result.push_back(messages[i].text);
+  }
+  return result;
+}
+
+std::vector<std::string> range(int first, int end) {
+  std::vector<std::string> result;
+  for (int i = first; i < end; ++i) {
+    result.push_back("message " + std::to_string(i));
+  }
+  return result;
+}
+
+HistoryRef byMsgId(int n) {
+  HistoryRef ref = {true, 0, msgidOf(n)};
+  return ref;
+}
+
+HistoryRef byTime(long time) {
+  HistoryRef ref = {false, time, ""};
+  return ref;
+}
+}  // namespace
+
+class HistoryLogTest : public ::testing::Test {
+ protected:
+  std::string dir;
+  std::vector<std::string> channels;
+  EventLoop loop;  // Woken by the answers
+
+  void SetUp() override {
+    char tmpl[] = "/tmp/ircserv_history_XXXXXX";
+    ASSERT_NE(mkdtemp(tmpl), nullptr);
+    dir = tmpl;
+    channels.push_back("#Audit");
+    loop.create(EVENT_BACKEND_EPOLL);
+    loop.enableWakeup();
+  }
+
+  void TearDown() override {
+    std::string command = "rm -rf " + dir;
+    ASSERT_EQ(system(command.c_str()), 0);
+  }
+
+  void open(HistoryLog* log,
+            size_t segmentBytes = HistoryLog::kDefaultSegmentBytes) {
+    log->open(dir, channels, &loop, segmentBytes);
+  }
+
+  // Wait until answers holds count queries
+  void waitForAnswers(HistoryLog* log, std::vector<HistoryQuery>* answers,
+                      size_t count) {
+    struct epoll_event event;
+    while (answers->size() < count && loop.wait(&event, 1, 5000) > 0) {
+      loop.consumeWakeup();
+      log->takeAnswers(*answers);
+    }
+    ASSERT_EQ(answers->size(), count);
+  }
+
+  // One read of #audit (ref NULL: none), answered by the writer
+  std::vector<HistoryMessage> read(HistoryLog* log, HistorySide side,
+                                   const HistoryRef* ref, size_t limit) {
+    HistoryQuery query;
+    query.id = 1;
+    query.channel = "#audit";
+    if (ref) query.ref = *ref;
+    HistoryRead spec = {side, ref != NULL, limit, {}};
+    query.reads.push_back(spec);
+    std::vector<HistoryQuery> answers;
+    EXPECT_TRUE(log->query(query));
+    waitForAnswers(log, &answers, 1);
+    if (answers.empty()) return std::vector<HistoryMessage>();
+    return answers[0].reads[0].messages;
+  }
+
+  // Message n: sent at 1000 + 10n
+  void appendMessages(HistoryLog* log, int first, int end) {
+    for (int i = first; i < end; ++i) {
+      log->append("#audit", 1000 + 10 * i, "nick!user@host", msgidOf(i),
+                  "message " + std::to_string(i));
+    }
+  }
+
+  std::vector<std::string> segmentFiles(const char* extension) {
+    std::vector<std::string> files;
+    std::string path = dir + "/%23audit";
+    DIR* d = opendir(path.c_str());
+    if (!d) return files;
+    while (struct dirent* entry = readdir(d)) {
+      std::string name = entry->d_name;
+      if (name.size() > 4 &&
+          name.compare(name.size() - 4, 4, extension) == 0) {
+        files.push_back(path + "/" + name);
+      }
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+};
+
+TEST_F(HistoryLogTest, ReadsWhatItWroteAcrossSegments) {
+  {
+    HistoryLog log;
+    open(&log, 1024);
+    EXPECT_TRUE(log.isLogged("#AUDIT"));
+    EXPECT_FALSE(log.isLogged("#other"));
+    appendMessages(&log, 0, 200);
+  }  // Written out by the destructor
+  EXPECT_GT(segmentFiles(".log").size(), 5U);
+
+  HistoryLog log;
+  open(&log, 1024);
+  std::vector<HistoryMessage> messages = read(&log, HISTORY_BEFORE, NULL, 5);
+  EXPECT_EQ(texts(messages), range(195, 200));
+  EXPECT_EQ(messages[0].time, 1000 + 10 * 195);
+  EXPECT_EQ(messages[0].source, "nick!user@host");
+  EXPECT_EQ(messages[0].msgid, msgidOf(195));
+
+  HistoryRef ref = byMsgId(100);
+  EXPECT_EQ(texts(read(&log, HISTORY_BEFORE, &ref, 40)), range(60, 100));
+  EXPECT_EQ(texts(read(&log, HISTORY_AFTER, &ref, 100)), range(101, 200));
+  EXPECT_EQ(texts(read(&log, HISTORY_FROM, &ref, 3)), range(100, 103));
+
+  ref = byTime(1000 + 10 * 50);
+  EXPECT_EQ(texts(read(&log, HISTORY_AFTER, &ref, 2)), range(51, 53));
+  ref = byTime(1000 + 10 * 50 - 5);
+  EXPECT_EQ(texts(read(&log, HISTORY_BEFORE, &ref, 1000)), range(0, 50));
+
+  HistoryQuery other;
+  other.id = 2;
+  other.channel = "#other";
+  EXPECT_FALSE(log.query(other));
+}
+
+TEST_F(HistoryLogTest, ContinuesTheLastSegment) {
+  {
+    HistoryLog log;
+    open(&log);
+    appendMessages(&log, 0, 10);
+  }
+  {
+    HistoryLog log;
+    open(&log);
+    appendMessages(&log, 10, 40);
+  }
+  EXPECT_EQ(segmentFiles(".log").size(), 1U);
+  HistoryLog log;
+  open(&log);
+  HistoryRef ref = byMsgId(5);
+  EXPECT_EQ(texts(read(&log, HISTORY_AFTER, &ref, 30)), range(6, 36));
+}
+
+TEST_F(HistoryLogTest, QueriesSeeWhatWasAppendedBefore) {
+  HistoryLog log;
+  open(&log);
+  appendMessages(&log, 0, 3);
+  EXPECT_EQ(texts(read(&log, HISTORY_BEFORE, NULL, 10)), range(0, 3));
+}
+
+TEST_F(HistoryLogTest, CloseAnswersQueuedQueries) {
+  HistoryLog log;
+  open(&log);
+  appendMessages(&log, 0, 5);
+  HistoryQuery query;
+  query.channel = "#audit";
+  HistoryRead spec = {HISTORY_BEFORE, false, 2, {}};
+  query.reads.push_back(spec);
+  for (query.id = 0; query.id < HistoryLog::kMaxQueries; ++query.id) {
+    ASSERT_TRUE(log.query(query));
+  }
+  EXPECT_FALSE(log.query(query));  // Until answers are taken back
+  log.close();
+
+  size_t queries = HistoryLog::kMaxQueries;
+  std::vector<HistoryQuery> answers;
+  log.takeAnswers(answers);
+  ASSERT_EQ(answers.size(), queries);
+  EXPECT_EQ(answers.back().id, queries - 1);
+  EXPECT_EQ(texts(answers.back().reads[0].messages), range(3, 5));
+}
+
+// Without further appends or queries
+TEST_F(HistoryLogTest, BacklogDrainsWhenRetried) {
+  HistoryLog log;
+  open(&log);
+  appendMessages(&log, 0, 20000);  // More than the writer's mailbox holds
+  for (int i = 0; i < 5000 && log.hasBacklog(); ++i) {
+    log.retryBacklog();
+    usleep(1000);
+  }
+  EXPECT_FALSE(log.hasBacklog());
+  EXPECT_EQ(texts(read(&log, HISTORY_BEFORE, NULL, 2)), range(19998, 20000));
+}
+
+TEST_F(HistoryLogTest, RecoversFromAnIncompleteRecord) {
+  {
+    HistoryLog log;
+    open(&log);
+    appendMessages(&log, 0, 40);
+  }
+  // A crash in the middle of a batch: half a record, index entries lost
+  std::string logPath = segmentFiles(".log").back();
+  std::string indexPath = segmentFiles(".idx").back();
+  {
+    std::ofstream out(logPath.c_str(), std::ios::app | std::ios::binary);
+    out << std::string("\x30\x00\x00\x00\x01\x02", 6);
+  }
+  ASSERT_EQ(truncate(indexPath.c_str(), 16 + 5), 0);
+
+  {
+    HistoryLog log;
+    open(&log);
+    EXPECT_EQ(texts(read(&log, HISTORY_BEFORE, NULL, 100)), range(0, 40));
+    appendMessages(&log, 40, 41);
+  }
+  struct stat info;
+  ASSERT_EQ(stat(indexPath.c_str(), &info), 0);
+  EXPECT_EQ(info.st_size, 3 * 16);  // Records 0, 16 and 32
+
+  HistoryLog log;
+  open(&log);
+  HistoryRef ref = byMsgId(35);
+  EXPECT_EQ(texts(read(&log, HISTORY_FROM, &ref, 100)), range(35, 41));
+}
+
+TEST_F(HistoryLogTest, OneProcessPerDirectory) {
+  HistoryLog first;
+  open(&first);
+  HistoryLog second;
+  EXPECT_THROW(open(&second), std::runtime_error);
+  EXPECT_FALSE(second.isOpen());
+  first.close();
+  EXPECT_NO_THROW(open(&second));
+}
@@ -0,0 +1,96 @@
+#include "Hostmask.hpp"
+
+#include <fcntl.h>
+
+#include <string>
+
+#include "Channel.hpp"
+#include "gtest/gtest.h"
+#include "utils.hpp"
+
+TEST(HostmaskTest, NormalizeCompletesMissingParts) {
+  EXPECT_EQ(Hostmask::normalize("nick"), "nick!*@*");
+  EXPECT_EQ(Hostmask::normalize("user@host"), "*!user@host");
+  EXPECT_EQ(Hostmask::normalize("nick!user"), "nick!user@*");
+  EXPECT_EQ(Hostmask::normalize("@host"), "*!*@host");
+  EXPECT_EQ(Hostmask::normalize("n!u@h"), "n!u@h");
+  EXPECT_EQ(Hostmask::normalize("!"), "*!*@*");
+}
+
+TEST(HostmaskTest, MatchesCasemappedTargets) {
+  Hostmask ban("Bad[Guy]!*@10.0.*");
+  EXPECT_EQ(ban.getMask(), "Bad[Guy]!*@10.0.*");
+  EXPECT_TRUE(ban.matches("bad{guy}!user@10.0.3.4"));
+  EXPECT_FALSE(ban.matches("badguy!user@10.0.3.4"));
+  EXPECT_FALSE(ban.matches("bad{guy}!user@10.1.3.4"));
+
+  Hostmask exact("alice!alice@127.0.0.1");
+  EXPECT_TRUE(exact.matches("alice!alice@127.0.0.1"));
+  EXPECT_FALSE(exact.matches("alice!alice@127.0.0.10"));
+
+  Hostmask question("a?c!*@*");
+  EXPECT_TRUE(question.matches("abc!x@y"));
+  EXPECT_FALSE(question.matches("ac!x@y"));
+}
+
+// The compiled matcher agrees with the plain wildcard matcher
+TEST(HostmaskTest, AgreesWithIrcMatch) {
+  const char* masks[] = {"*",          "*!*@*",         "a*!*@*",
+                         "*b*c*!*@*",  "a?*!u@h",       "*!*@*.example",
+                         "ab*ab!*@*",  "*a*a*a*!*@*",   "?!?@?",
+                         "*x?y*!*@*z", "nick!user@host"};
+  const char* targets[] = {"a!b@c",         "abcabc!u@h",     "ab!u@h",
+                           "abab!u@h",      "abxab!u@h",      "aaa!u@h",
+                           "x!y@z",         "nick!user@host", "xzy!q@zz",
+                           "q!r@h.example", "b!c@example"};
+  for (size_t m = 0; m < sizeof(masks) / sizeof(masks[0]); ++m) {
+    Hostmask mask(masks[m]);
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); ++t) {
+      EXPECT_EQ(mask.matches(targets[t]),
+                ircMatch(mask.getMask(), targets[t]))
+          << masks[m] << " / " << targets[t];
+    }
+  }
+}
+
+TEST(HostmaskTest, ChannelBanCacheFollowsIdentityAndLists) {
+  Channel channel("#bans");
+  User user(open("/dev/null", O_RDONLY), "10.0.0.1");
+  user.setNickname("spammer");
+  user.setUsername("spam");
+
+  EXPECT_FALSE(channel.isBanned(&user));
+  EXPECT_TRUE(channel.addMask(MASK_LIST_BAN, "spammer", "op", 0));
+  EXPECT_FALSE(channel.addMask(MASK_LIST_BAN, "SPAMMER!*@*", "op", 0));
+  EXPECT_TRUE(channel.isBanned(&user));
+
+  // A new nickname is a new identity: not served from the cache
+  user.setNickname("innocent");
+  EXPECT_FALSE(channel.isBanned(&user));
+  user.setNickname("spammer");
+  EXPECT_TRUE(channel.isBanned(&user));
+
+  // List changes drop cached results
+  EXPECT_TRUE(channel.addMask(MASK_LIST_EXCEPTION, "*!spam@*", "op", 0));
+  EXPECT_FALSE(channel.isBanned(&user));
+  EXPECT_TRUE(channel.removeMask(MASK_LIST_EXCEPTION, "*!SPAM@*"));
+  EXPECT_TRUE(channel.isBanned(&user));
+  EXPECT_TRUE(channel.removeMask(MASK_LIST_BAN, "spammer"));
+  EXPECT_FALSE(channel.removeMask(MASK_LIST_BAN, "spammer"));
+  EXPECT_FALSE(channel.isBanned(&user));
+
+  EXPECT_FALSE(channel.isInviteException(&user));
+  channel.addMask(MASK_LIST_INVITE_EXCEPTION, "*!*@10.0.0.*", "op", 0);
+  EXPECT_TRUE(channel.isInviteException(&user));
+}
+
+TEST(HostmaskTest, ChannelListsAreBounded) {
+  Channel channel("#full");
+  size_t maxMasks = Channel::kMaxMasks;
+  for (size_t i = 0; i < maxMasks; ++i) {
+    EXPECT_TRUE(channel.addMask(MASK_LIST_BAN,
+                                "n" + std::to_string(i), "op", 0));
+  }
+  EXPECT_FALSE(channel.addMask(MASK_LIST_BAN, "one-more", "op", 0));
+  EXPECT_EQ(channel.getMasks(MASK_LIST_BAN).size(), maxMasks);
+}
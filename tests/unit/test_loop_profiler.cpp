@@ -0,0 +1,91 @@
+#include "LoopProfiler.hpp"
+
+#include <string>
+
+#include "Metrics.hpp"
+#include "gtest/gtest.h"
+
+// ==========================================
+// Per-iteration attribution
+// ==========================================
+
+TEST(LoopProfilerTest, WorstFdAccumulatesPhasesOfOneConnection) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.0);
+
+  profiler.beginIteration(2);
+  profiler.record(LOOP_PHASE_READ, 5, 0.010);
+  profiler.record(LOOP_PHASE_DISPATCH, 5, 0.020);
+  profiler.record(LOOP_PHASE_READ, 7, 0.025);
+  profiler.endIteration();
+
+  // fd 5 cost 30ms in total, fd 7 only 25ms
+  EXPECT_EQ(profiler.getIterationWorstFd(), 5);
+}
+
+TEST(LoopProfilerTest, PhaseTimesFeedMetrics) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.0);
+
+  profiler.beginIteration(1);
+  profiler.record(LOOP_PHASE_DISPATCH, 4, 0.5);
+  profiler.record(LOOP_PHASE_WRITE, 4, 0.25);
+  profiler.endIteration();
+
+  EXPECT_DOUBLE_EQ(metrics.getTime(METRIC_LOOP_DISPATCH_TIME), 0.5);
+  EXPECT_DOUBLE_EQ(metrics.getTime(METRIC_LOOP_WRITE_TIME), 0.25);
+  EXPECT_EQ(metrics.getCounter(METRIC_LOOP_ITERATIONS), 1UL);
+  EXPECT_EQ(metrics.getHistogramCount(METRIC_LOOP_EVENTS_PER_WAKEUP), 1UL);
+}
+
+TEST(LoopProfilerTest, NoConnectionRecorded) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.0);
+
+  profiler.beginIteration(0);
+  profiler.endIteration();
+  EXPECT_EQ(profiler.getIterationWorstFd(), -1);
+}
+
+// ==========================================
+// Slow iterations and interval summaries
+// ==========================================
+
+TEST(LoopProfilerTest, ZeroThresholdNeverReportsSlow) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.0);
+
+  profiler.beginIteration(1);
+  EXPECT_FALSE(profiler.endIteration());
+  EXPECT_EQ(metrics.getCounter(METRIC_LOOP_SLOW_ITERATIONS), 0UL);
+}
+
+TEST(LoopProfilerTest, DisabledIntervalNeverSummarizes) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.0);
+
+  profiler.beginIteration(1);
+  profiler.endIteration();
+  EXPECT_FALSE(profiler.takeIntervalSummary());
+}
+
+TEST(LoopProfilerTest, IntervalWorstFdSpansIterations) {
+  Metrics metrics;
+  LoopProfiler profiler(&metrics, 0.0, 0.000001);
+
+  // fd 8 is never the worst of a single iteration but costs most overall
+  profiler.beginIteration(2);
+  profiler.record(LOOP_PHASE_READ, 9, 0.004);
+  profiler.record(LOOP_PHASE_READ, 8, 0.003);
+  profiler.endIteration();
+  profiler.beginIteration(2);
+  profiler.record(LOOP_PHASE_READ, 9, 0.001);
+  profiler.record(LOOP_PHASE_READ, 8, 0.003);
+  profiler.record(LOOP_PHASE_READ, 10, 0.004);
+  profiler.endIteration();
+
+  ASSERT_TRUE(profiler.takeIntervalSummary());
+  EXPECT_EQ(profiler.getIntervalWorstFd(), 8);
+  EXPECT_NE(profiler.formatInterval().find("2 iterations"),
+            std::string::npos);
+}
@@ -1,7 +1,8 @@
 // Test main with required global variables
 #include <signal.h>
 
-// Define global variable required by Server.cpp
+// Define global variables required by Server.cpp
 volatile sig_atomic_t g_shutdown = 0;
+volatile sig_atomic_t g_upgrade = 0;
 
 // Google Test will provide its own main() function via -lgtest_main
@@ -0,0 +1,86 @@
+#include "MessageClock.hpp"
+
+#include <ctime>
+#include <set>
+#include <string>
+
+#include "ChannelHistory.hpp"
+#include "gtest/gtest.h"
+
+TEST(MessageClockTest, ServerTimeIsUtcIso8601WithMilliseconds) {
+  MessageClock clock;
+  time_t before = time(NULL);
+  clock.update();
+  time_t after = time(NULL);
+  const std::string& serverTime = clock.getServerTime();
+  ASSERT_EQ(serverTime.size(), 24U);
+  EXPECT_EQ(serverTime[10], 'T');
+  EXPECT_EQ(serverTime[19], '.');
+  EXPECT_EQ(serverTime[23], 'Z');
+
+  struct tm parsed = {};
+  ASSERT_NE(strptime(serverTime.c_str(), "%Y-%m-%dT%H:%M:%S", &parsed),
+            nullptr);
+  time_t shown = timegm(&parsed);
+  EXPECT_GE(shown, before);
+  EXPECT_LE(shown, after);
+}
+
+TEST(MessageClockTest, TimeOnlyMovesOnUpdate) {
+  MessageClock clock;
+  std::string first = clock.getServerTime();
+  struct timespec pause = {0, 5000000};
+  nanosleep(&pause, NULL);
+  EXPECT_EQ(clock.getServerTime(), first);
+  clock.update();
+  EXPECT_GT(clock.getServerTime(), first);
+}
+
+TEST(MessageClockTest, MsgIdsAreUniqueAcrossClocks) {
+  std::set<std::string> ids;
+  MessageClock first;
+  for (int i = 0; i < 1000; ++i) ids.insert(first.nextMsgId());
+  EXPECT_EQ(ids.size(), 1000U);
+
+  struct timespec pause = {0, 1000000};
+  nanosleep(&pause, NULL);
+  MessageClock second;  // The process after an upgrade
+  EXPECT_EQ(ids.count(second.nextMsgId()), 0U);
+}
+
+// An old process's counter may be longer than the next process's
+TEST(MessageClockTest, MsgIdsOrderAcrossClocks) {
+  MessageClock first;
+  std::string previous = first.nextMsgId();
+  for (int i = 0; i < 0x1000; ++i) {
+    std::string id = first.nextMsgId();
+    ASSERT_LT(compareMsgIds(previous, id), 0) << previous << " " << id;
+    previous = id;
+  }
+
+  struct timespec pause = {0, 1000000};
+  nanosleep(&pause, NULL);
+  MessageClock second;
+  std::string next = second.nextMsgId();
+  EXPECT_LT(next.length(), previous.length());
+  EXPECT_LT(compareMsgIds(previous, next), 0) << previous << " " << next;
+  EXPECT_GT(compareMsgIds(next, previous), 0);
+  EXPECT_EQ(compareMsgIds(next, next), 0);
+}
+
+TEST(MessageClockTest, ParsesWhatItFormats) {
+  MessageClock clock;
+  clock.update();
+  long millis = 0;
+  ASSERT_TRUE(MessageClock::parseServerTime(clock.getServerTime(), &millis));
+  EXPECT_EQ(millis, clock.getMillis());
+  EXPECT_EQ(MessageClock::formatServerTime(millis), clock.getServerTime());
+
+  ASSERT_TRUE(MessageClock::parseServerTime("2019-01-04T14:33:26Z", &millis));
+  EXPECT_EQ(millis, 1546612406000L);
+  EXPECT_EQ(MessageClock::formatServerTime(millis + 7),
+            "2019-01-04T14:33:26.007Z");
+  EXPECT_FALSE(MessageClock::parseServerTime("2019-01-04 14:33:26Z", &millis));
+  EXPECT_FALSE(MessageClock::parseServerTime("2019-01-04T14:33:26", &millis));
+  EXPECT_FALSE(MessageClock::parseServerTime("yesterday", &millis));
+}
@@ -0,0 +1,88 @@
+#include "Metrics.hpp"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// ==========================================
+// Counters and gauges
+// ==========================================
+
+TEST(MetricsTest, CountersStartAtZero) {
+  Metrics metrics;
+  EXPECT_EQ(metrics.getCounter(METRIC_CONNECTIONS_ACCEPTED), 0UL);
+  EXPECT_EQ(metrics.getCounter(METRIC_BYTES_SENT), 0UL);
+  EXPECT_EQ(metrics.getGauge(METRIC_USERS_CONNECTED), 0L);
+}
+
+TEST(MetricsTest, IncrementCounter) {
+  Metrics metrics;
+  metrics.increment(METRIC_CONNECTIONS_ACCEPTED);
+  metrics.increment(METRIC_CONNECTIONS_ACCEPTED);
+  metrics.increment(METRIC_BYTES_RECEIVED, 512);
+  EXPECT_EQ(metrics.getCounter(METRIC_CONNECTIONS_ACCEPTED), 2UL);
+  EXPECT_EQ(metrics.getCounter(METRIC_BYTES_RECEIVED), 512UL);
+}
+
+TEST(MetricsTest, SetGaugeOverwrites) {
+  Metrics metrics;
+  metrics.setGauge(METRIC_CHANNELS, 5);
+  metrics.setGauge(METRIC_CHANNELS, 3);
+  EXPECT_EQ(metrics.getGauge(METRIC_CHANNELS), 3L);
+}
+
+// ==========================================
+// Prometheus rendering
+// ==========================================
+
+TEST(MetricsTest, RenderCounterWithHelpAndType) {
+  Metrics metrics;
+  metrics.increment(METRIC_MESSAGES_RECEIVED, 7);
+  std::string out = metrics.render();
+  EXPECT_NE(out.find("# TYPE ircserv_messages_received_total counter\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("\nircserv_messages_received_total 7\n"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, RenderGauge) {
+  Metrics metrics;
+  metrics.setGauge(METRIC_USERS_CONNECTED, 42);
+  std::string out = metrics.render();
+  EXPECT_NE(out.find("# TYPE ircserv_users_connected gauge\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("\nircserv_users_connected 42\n"), std::string::npos);
+}
+
+TEST(MetricsTest, HistogramBucketsAreCumulative) {
+  Metrics metrics;
+  metrics.observe(METRIC_COMMAND_DURATION, 0.00001);  // first bucket
+  metrics.observe(METRIC_COMMAND_DURATION, 0.003);    // le=0.005
+  metrics.observe(METRIC_COMMAND_DURATION, 10.0);     // +Inf only
+  EXPECT_EQ(metrics.getHistogramCount(METRIC_COMMAND_DURATION), 3UL);
+
+  std::string out = metrics.render();
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"5e-05\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"0.0025\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"0.005\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"0.25\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"+Inf\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_count 3\n"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, BoundaryValueFallsIntoItsBucket) {
+  // Prometheus buckets are "less than or equal"
+  Metrics metrics;
+  metrics.observe(METRIC_COMMAND_DURATION, 0.001);
+  std::string out = metrics.render();
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"0.0005\"} 0\n"),
+            std::string::npos);
+  EXPECT_NE(out.find("ircserv_command_duration_seconds_bucket{le=\"0.001\"} 1\n"),
+            std::string::npos);
+}
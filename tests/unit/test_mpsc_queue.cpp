@@ -0,0 +1,175 @@
+#include "MpscQueue.hpp"
+
+#include <sys/epoll.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventLoop.hpp"
+#include "gtest/gtest.h"
+
+// ==========================================
+// MpscQueue
+// ==========================================
+
+TEST(MpscQueueTest, RoundsCapacityToPowerOfTwo) {
+  EXPECT_EQ(MpscQueue<int>(0).getCapacity(), 2U);
+  EXPECT_EQ(MpscQueue<int>(5).getCapacity(), 8U);
+  EXPECT_EQ(MpscQueue<int>(64).getCapacity(), 64U);
+}
+
+TEST(MpscQueueTest, PopsInFifoOrder) {
+  MpscQueue<std::string> queue(4);
+  int value = 0;
+  std::string popped;
+  EXPECT_FALSE(queue.tryPop(popped));
+  // Wrap around the ring several times
+  for (int round = 0; round < 5; ++round) {
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(queue.tryPush(std::to_string(value + i)));
+    }
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(queue.tryPop(popped));
+      EXPECT_EQ(popped, std::to_string(value + i));
+    }
+    value += 3;
+  }
+  EXPECT_FALSE(queue.tryPop(popped));
+}
+
+TEST(MpscQueueTest, RejectsPushWhenFull) {
+  MpscQueue<int> queue(4);
+  for (int i = 0; i < 4; ++i) ASSERT_TRUE(queue.tryPush(i));
+  EXPECT_FALSE(queue.tryPush(4));
+  int popped = -1;
+  ASSERT_TRUE(queue.tryPop(popped));
+  EXPECT_EQ(popped, 0);
+  EXPECT_TRUE(queue.tryPush(4));
+}
+
+// Every producer's values arrive complete and in the order it pushed them
+TEST(MpscQueueTest, StressManyProducers) {
+  const int kProducers = 4;
+  const int kPerProducer = 200000;
+  MpscQueue<long> queue(1024);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&queue, p]() {
+      for (int i = 0; i < kPerProducer; ++i) {
+        long value = static_cast<long>(p) * kPerProducer + i;
+        while (!queue.tryPush(value)) std::this_thread::yield();
+      }
+    });
+  }
+
+  std::vector<long> next(kProducers, 0);
+  long received = 0;
+  while (received < static_cast<long>(kProducers) * kPerProducer) {
+    long value;
+    if (!queue.tryPop(value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    int producer = static_cast<int>(value / kPerProducer);
+    ASSERT_GE(producer, 0);
+    ASSERT_LT(producer, kProducers);
+    ASSERT_EQ(value % kPerProducer, next[producer]);
+    ++next[producer];
+    ++received;
+  }
+  for (size_t i = 0; i < producers.size(); ++i) producers[i].join();
+  long leftover;
+  EXPECT_FALSE(queue.tryPop(leftover));
+}
+
+// ==========================================
+// Mailbox
+// ==========================================
+
+class MailboxTest : public ::testing::TestWithParam<EventBackend> {
+ protected:
+  EventLoop loop;
+
+  void SetUp() override {
+    try {
+      loop.create(GetParam());
+    } catch (const std::runtime_error& e) {
+      GTEST_SKIP() << "Backend unavailable: " << e.what();
+    }
+    loop.enableWakeup();
+  }
+
+  // Retries a wait() interrupted by a signal, as Server::run() does
+  bool waitForWakeup(int timeout) {
+    struct epoll_event events[8];
+    int n;
+    do {
+      n = loop.wait(events, 8, timeout);
+    } while (n < 0 && errno == EINTR);
+    for (int i = 0; i < n; ++i) {
+      if (events[i].data.fd == loop.getWakeupFd()) {
+        loop.consumeWakeup();
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+TEST_P(MailboxTest, PostFromOtherThreadWakesLoop) {
+  Mailbox<std::string> mailbox(&loop, 16);
+  std::thread producer([&mailbox]() { mailbox.post("hello"); });
+  EXPECT_TRUE(waitForWakeup(1000));
+  producer.join();
+
+  std::vector<std::string> messages;
+  EXPECT_EQ(mailbox.drain(messages), 1U);
+  ASSERT_EQ(messages.size(), 1U);
+  EXPECT_EQ(messages[0], "hello");
+}
+
+TEST_P(MailboxTest, OneWakeupPerDrain) {
+  Mailbox<int> mailbox(&loop, 16);
+  for (int i = 0; i < 10; ++i) ASSERT_TRUE(mailbox.post(i));
+  EXPECT_TRUE(waitForWakeup(1000));
+  std::vector<int> messages;
+  EXPECT_EQ(mailbox.drain(messages), 10U);
+  EXPECT_FALSE(waitForWakeup(10));
+
+  // Posting after the drain signals again
+  ASSERT_TRUE(mailbox.post(10));
+  EXPECT_TRUE(waitForWakeup(1000));
+}
+
+TEST_P(MailboxTest, StressNoMessageLost) {
+  const int kProducers = 4;
+  const int kPerProducer = 50000;
+  Mailbox<int> mailbox(&loop, 256);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&mailbox]() {
+      for (int i = 0; i < kPerProducer; ++i) {
+        while (!mailbox.post(i)) std::this_thread::yield();
+      }
+    });
+  }
+
+  // Only drain after a wakeup: a lost signal would stall the test
+  std::vector<int> messages;
+  size_t total = static_cast<size_t>(kProducers) * kPerProducer;
+  while (messages.size() < total) {
+    ASSERT_TRUE(waitForWakeup(2000)) << messages.size() << " received";
+    mailbox.drain(messages);
+  }
+  for (size_t i = 0; i < producers.size(); ++i) producers[i].join();
+  EXPECT_EQ(messages.size(), total);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, MailboxTest,
+                         ::testing::Values(EVENT_BACKEND_EPOLL,
+                                           EVENT_BACKEND_IO_URING));
@@ -0,0 +1,164 @@
+#include "ServerConfig.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+// ==========================================
+// Port validation
+// ==========================================
+
+TEST(ServerConfigTest, ParsePortAcceptsFullRange) {
+  EXPECT_EQ(ServerConfig::parsePort("1"), 1);
+  EXPECT_EQ(ServerConfig::parsePort("6667"), 6667);
+  EXPECT_EQ(ServerConfig::parsePort("65535"), 65535);
+}
+
+TEST(ServerConfigTest, ParsePortRejectsInvalid) {
+  EXPECT_THROW(ServerConfig::parsePort(""), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePort("0"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePort("65536"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePort("66a7"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePort("-1"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePort("000006667"), std::runtime_error);
+}
+
+// ==========================================
+// Listen addresses
+// ==========================================
+
+TEST(ServerConfigTest, ParseWildcardListenAddress) {
+  ListenAddress address = ServerConfig::parseListenAddress("*:6667");
+  EXPECT_EQ(address.host, "*");
+  EXPECT_EQ(address.port, 6667);
+  EXPECT_EQ(address.backlog, 0);
+}
+
+TEST(ServerConfigTest, ParseIPv4ListenAddressWithBacklog) {
+  ListenAddress address =
+      ServerConfig::parseListenAddress("127.0.0.1:7000/128");
+  EXPECT_EQ(address.host, "127.0.0.1");
+  EXPECT_EQ(address.port, 7000);
+  EXPECT_EQ(address.backlog, 128);
+}
+
+TEST(ServerConfigTest, ParseIPv6ListenAddressStripsBrackets) {
+  ListenAddress address =
+      ServerConfig::parseListenAddress("[2001:db8::1]:6697/64");
+  EXPECT_EQ(address.host, "2001:db8::1");
+  EXPECT_EQ(address.port, 6697);
+  EXPECT_EQ(address.backlog, 64);
+}
+
+TEST(ServerConfigTest, ParseListenAddressRejectsInvalid) {
+  EXPECT_THROW(ServerConfig::parseListenAddress("6667"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parseListenAddress(":6667"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parseListenAddress("localhost:6667"),
+               std::runtime_error);
+  EXPECT_THROW(ServerConfig::parseListenAddress("::1:6667"),
+               std::runtime_error);  // IPv6 needs brackets
+  EXPECT_THROW(ServerConfig::parseListenAddress("[::1]:0"),
+               std::runtime_error);
+  EXPECT_THROW(ServerConfig::parseListenAddress("*:6667/0"),
+               std::runtime_error);
+}
+
+TEST(ServerConfigTest, FromEnvironmentReadsListenList) {
+  setenv("IRCSERV_LISTEN", "*:6667,[::1]:6697/32", 1);
+  ServerConfig config = ServerConfig::fromEnvironment();
+  unsetenv("IRCSERV_LISTEN");
+
+  ASSERT_EQ(config.listenAddresses.size(), 2U);
+  EXPECT_EQ(config.listenAddresses[0].host, "*");
+  EXPECT_EQ(config.listenAddresses[1].host, "::1");
+  EXPECT_EQ(config.listenAddresses[1].backlog, 32);
+}
+
+TEST(ServerConfigTest, FromEnvironmentWithoutListenListIsEmpty) {
+  unsetenv("IRCSERV_LISTEN");
+  EXPECT_TRUE(ServerConfig::fromEnvironment().listenAddresses.empty());
+}
+
+TEST(ServerConfigTest, FromEnvironmentReadsMalformedLimit) {
+  unsetenv("IRCSERV_MALFORMED_LIMIT");
+  EXPECT_EQ(ServerConfig::fromEnvironment().malformedLimit, 50);
+  setenv("IRCSERV_MALFORMED_LIMIT", "0", 1);
+  EXPECT_EQ(ServerConfig::fromEnvironment().malformedLimit, 0);
+  setenv("IRCSERV_MALFORMED_LIMIT", "-1", 1);
+  EXPECT_THROW(ServerConfig::fromEnvironment(), std::runtime_error);
+  unsetenv("IRCSERV_MALFORMED_LIMIT");
+}
+
+TEST(ServerConfigTest, FromEnvironmentReadsHistoryMemory) {
+  unsetenv("IRCSERV_HISTORY_KB");
+  EXPECT_EQ(ServerConfig::fromEnvironment().historyMemory, 16384U * 1024);
+  setenv("IRCSERV_HISTORY_KB", "64", 1);
+  EXPECT_EQ(ServerConfig::fromEnvironment().historyMemory, 65536U);
+  setenv("IRCSERV_HISTORY_KB", "0", 1);
+  EXPECT_EQ(ServerConfig::fromEnvironment().historyMemory, 0U);
+  unsetenv("IRCSERV_HISTORY_KB");
+}
+
+TEST(ServerConfigTest, FromEnvironmentReadsHistoryLog) {
+  unsetenv("IRCSERV_HISTORY_DIR");
+  unsetenv("IRCSERV_HISTORY_CHANNELS");
+  EXPECT_TRUE(ServerConfig::fromEnvironment().historyDirectory.empty());
+  EXPECT_TRUE(ServerConfig::fromEnvironment().historyChannels.empty());
+  setenv("IRCSERV_HISTORY_DIR", "/var/lib/ircserv", 1);
+  setenv("IRCSERV_HISTORY_CHANNELS", "#audit,&ops", 1);
+  ServerConfig config = ServerConfig::fromEnvironment();
+  EXPECT_EQ(config.historyDirectory, "/var/lib/ircserv");
+  ASSERT_EQ(config.historyChannels.size(), 2U);
+  EXPECT_EQ(config.historyChannels[0], "#audit");
+  EXPECT_EQ(config.historyChannels[1], "&ops");
+  unsetenv("IRCSERV_HISTORY_DIR");
+  unsetenv("IRCSERV_HISTORY_CHANNELS");
+}
+
+// ==========================================
+// Server links
+// ==========================================
+
+TEST(ServerConfigTest, ParsePeerAddress) {
+  ListenAddress address = ServerConfig::parsePeerAddress("[::1]:16667");
+  EXPECT_EQ(address.host, "::1");
+  EXPECT_EQ(address.port, 16667);
+  EXPECT_THROW(ServerConfig::parsePeerAddress("*:16667"), std::runtime_error);
+  EXPECT_THROW(ServerConfig::parsePeerAddress("127.0.0.1:16667/8"),
+               std::runtime_error);
+}
+
+TEST(ServerConfigTest, ValidServerNames) {
+  EXPECT_TRUE(ServerConfig::isValidServerName("irc.example-1_a"));
+  EXPECT_FALSE(ServerConfig::isValidServerName(""));
+  EXPECT_FALSE(ServerConfig::isValidServerName("irc/1"));
+  EXPECT_FALSE(ServerConfig::isValidServerName("irc example"));
+  EXPECT_FALSE(ServerConfig::isValidServerName(std::string(64, 'a')));
+}
+
+TEST(ServerConfigTest, FromEnvironmentReadsLinks) {
+  setenv("IRCSERV_SERVER_NAME", "hub.test", 1);
+  setenv("IRCSERV_LINK_PASSWORD", "linkpass", 1);
+  setenv("IRCSERV_LINK_LISTEN", "127.0.0.1:16667", 1);
+  setenv("IRCSERV_LINKS", "127.0.0.1:16668,[::1]:16669", 1);
+  ServerConfig config = ServerConfig::fromEnvironment();
+  unsetenv("IRCSERV_LINKS");
+  unsetenv("IRCSERV_LINK_LISTEN");
+
+  EXPECT_EQ(config.serverName, "hub.test");
+  EXPECT_EQ(config.linkPassword, "linkpass");
+  EXPECT_EQ(config.linkListen.port, 16667);
+  ASSERT_EQ(config.linkPeers.size(), 2U);
+  EXPECT_EQ(config.linkPeers[1].host, "::1");
+
+  // Links need a password
+  unsetenv("IRCSERV_LINK_PASSWORD");
+  setenv("IRCSERV_LINKS", "127.0.0.1:16668", 1);
+  EXPECT_THROW(ServerConfig::fromEnvironment(), std::runtime_error);
+  unsetenv("IRCSERV_LINKS");
+
+  setenv("IRCSERV_SERVER_NAME", "bad name", 1);
+  EXPECT_THROW(ServerConfig::fromEnvironment(), std::runtime_error);
+  unsetenv("IRCSERV_SERVER_NAME");
+}
@@ -0,0 +1,47 @@
+#include "TaggedMessage.hpp"
+
+#include <string>
+
+#include "Capability.hpp"
+#include "MessageClock.hpp"
+#include "gtest/gtest.h"
+
+namespace {
+const char kLine[] = ":a!b@c PRIVMSG #x :hi\r\n";
+}  // namespace
+
+TEST(TaggedMessageTest, RendersTheTagsEachRecipientEnabled) {
+  MessageClock clock;
+  TaggedMessage message(kLine, &clock, "+react=x", false);
+  const std::string time = "time=" + clock.getServerTime();
+
+  EXPECT_EQ(message.render(0), kLine);
+  EXPECT_EQ(message.render(CAP_ECHO_MESSAGE), kLine);
+  EXPECT_EQ(message.render(CAP_SERVER_TIME), "@" + time + " " + kLine);
+
+  std::string tagged = message.render(CAP_MESSAGE_TAGS);
+  ASSERT_EQ(tagged.compare(0, 7, "@msgid="), 0);
+  std::string msgid = tagged.substr(7, tagged.find(';') - 7);
+  EXPECT_EQ(tagged, "@msgid=" + msgid + ";+react=x " + kLine);
+  EXPECT_EQ(message.render(CAP_SERVER_TIME | CAP_MESSAGE_TAGS),
+            "@" + time + ";msgid=" + msgid + ";+react=x " + kLine);
+}
+
+TEST(TaggedMessageTest, SharesOneRenderingAndIdPerMessage) {
+  MessageClock clock;
+  TaggedMessage message(kLine, &clock, "", false);
+  const std::string& first = message.render(CAP_MESSAGE_TAGS);
+  EXPECT_EQ(&message.render(CAP_MESSAGE_TAGS), &first);
+
+  TaggedMessage next(kLine, &clock, "", false);
+  EXPECT_NE(next.render(CAP_MESSAGE_TAGS), first);
+}
+
+TEST(TaggedMessageTest, TagsOnlySkipsClientsWithoutMessageTags) {
+  MessageClock clock;
+  TaggedMessage message(":a!b@c TAGMSG #x\r\n", &clock, "+typing=active",
+                        true);
+  EXPECT_TRUE(message.render(0).empty());
+  EXPECT_TRUE(message.render(CAP_SERVER_TIME).empty());
+  EXPECT_FALSE(message.render(CAP_MESSAGE_TAGS).empty());
+}
@@ -0,0 +1,52 @@
+#include "UserManager.hpp"
+
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+User* addUser(UserManager* users, const std::string& nickname) {
+  User* user = new User(open("/dev/null", O_RDONLY), "127.0.0.1");
+  users->addUser(user);
+  users->updateNickname(user, "", nickname);
+  return user;
+}
+}  // namespace
+
+TEST(UserManagerTest, MonitorIndexesWatchersByNickname) {
+  UserManager users;
+  User* alice = addUser(&users, "alice");
+  User* bob = addUser(&users, "bob");
+  EXPECT_EQ(users.getWatchers("carol"), nullptr);
+
+  EXPECT_TRUE(users.addMonitor(alice, "Carol"));
+  EXPECT_TRUE(users.addMonitor(alice, "CAROL"));  // Already watched
+  EXPECT_TRUE(users.addMonitor(bob, "carol"));
+  ASSERT_NE(users.getWatchers("carol"), nullptr);
+  EXPECT_EQ(*users.getWatchers("carol"), std::vector<User*>({alice, bob}));
+  EXPECT_EQ(alice->getMonitored(), std::vector<std::string>({"Carol"}));
+
+  users.removeMonitor(alice, "carol");
+  EXPECT_TRUE(alice->getMonitored().empty());
+  EXPECT_EQ(*users.getWatchers("CAROL"), std::vector<User*>({bob}));
+  users.removeUser(bob->getSocketFd());
+  EXPECT_EQ(users.getWatchers("carol"), nullptr);
+}
+
+TEST(UserManagerTest, MonitorListIsLimited) {
+  UserManager users;
+  User* alice = addUser(&users, "alice");
+  for (size_t i = 0; i < UserManager::kMaxMonitored; ++i) {
+    EXPECT_TRUE(users.addMonitor(alice, "nick" + std::to_string(i)));
+  }
+  EXPECT_FALSE(users.addMonitor(alice, "onemore"));
+  EXPECT_EQ(users.getWatchers("onemore"), nullptr);
+
+  users.clearMonitors(alice);
+  EXPECT_TRUE(alice->getMonitored().empty());
+  EXPECT_EQ(users.getWatchers("nick0"), nullptr);
+  EXPECT_TRUE(users.addMonitor(alice, "onemore"));
+}
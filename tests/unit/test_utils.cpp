@@ -27,7 +27,9 @@ TEST(UtilsTest, NormalizeNickname_MixedCase) {
 
 TEST(UtilsTest, NormalizeNickname_WithSpecialChars) {
   // IRC allows special chars in nicknames: []{}|^_-`
-  EXPECT_EQ(normalizeNickname("Alice[]"), "alice[]");
+  // RFC1459 casemapping: [\]^ are the upper case of {|}~
+  EXPECT_EQ(normalizeNickname("Alice[]"), "alice{}");
+  EXPECT_EQ(normalizeNickname("Back\\Slash^"), "back|slash~");
   EXPECT_EQ(normalizeNickname("Bob-123"), "bob-123");
   EXPECT_EQ(normalizeNickname("User_Name"), "user_name");
   EXPECT_EQ(normalizeNickname("Test|User"), "test|user");
@@ -130,6 +132,34 @@ TEST(UtilsTest, NormalizationMakesEqual) {
             normalizeChannelName("#ChAnNeL"));
 }
 
+// ==========================================
+// RFC1459 casemapping Tests
+// ==========================================
+
+TEST(UtilsTest, IrcCaseEqual_Rfc1459) {
+  EXPECT_TRUE(ircCaseEqual("Nick[away]", "nick{AWAY}"));
+  EXPECT_TRUE(ircCaseEqual("a\\b^", "A|B~"));
+  EXPECT_FALSE(ircCaseEqual("nick", "nick_"));
+  EXPECT_FALSE(ircCaseEqual("nick@", "nick`"));  // Outside the mapping
+}
+
+TEST(UtilsTest, IrcCaseHash_MatchesEquality) {
+  EXPECT_EQ(ircCaseHash("#Chan[1]"), ircCaseHash("#chan{1}"));
+  EXPECT_EQ(ircCaseHash("NICK^"), ircCaseHash("nick~"));
+  EXPECT_NE(ircCaseHash("alice"), ircCaseHash("bob"));
+}
+
+TEST(UtilsTest, IrcMatch_Wildcards) {
+  EXPECT_TRUE(ircMatch("*", ""));
+  EXPECT_TRUE(ircMatch("#chan*", "#channel"));
+  EXPECT_TRUE(ircMatch("#C?AN[*]", "#chan{1}"));
+  EXPECT_TRUE(ircMatch("*a*b*c", "xxaxbxxbc"));  // Needs backtracking
+  EXPECT_TRUE(ircMatch("#test", "#TEST"));
+  EXPECT_FALSE(ircMatch("#test", "#test2"));
+  EXPECT_FALSE(ircMatch("?", ""));
+  EXPECT_FALSE(ircMatch("*a*b", "xxaxc"));
+}
+
 // ==========================================
 // int_to_string Tests
 // ==========================================